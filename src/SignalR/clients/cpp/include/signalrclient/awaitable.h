@@ -0,0 +1,214 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+// Awaitable variants of the hub_connection and connection operations for use in C++20 coroutines, e.g.:
+//
+//     auto result = co_await signalr::co_invoke(hub_connection, _XPLATSTR("Add"), arguments);
+//
+// Invocations and sends on hub_connection and prepared_method are built on the callback based variants of
+// `invoke` and `send` and don't create any pplx tasks. The remaining operations await the pplx task returned
+// by the corresponding method. The awaiting coroutine is resumed on the thread that completed the operation
+// which for invocations is the thread processing received messages, so long running work should be moved
+// elsewhere. The header is empty when the compiler does not support coroutines.
+
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include "pplx/pplxtasks.h"
+#include "cpprest/json.h"
+#include "hub_connection.h"
+#include "connection.h"
+#include "prepared_method.h"
+
+namespace signalr
+{
+    namespace details
+    {
+        // `await_suspend` and the completion handler race to set `m_ready` - if the handler runs first (e.g. the
+        // operation fails synchronously) the coroutine is not suspended, otherwise the handler resumes it
+        template <typename Invoke>
+        class invoke_awaiter
+        {
+        public:
+            explicit invoke_awaiter(Invoke invoke)
+                : m_invoke(std::move(invoke)), m_ready(false)
+            { }
+
+            invoke_awaiter(const invoke_awaiter&) = delete;
+            invoke_awaiter& operator=(const invoke_awaiter&) = delete;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> awaiting)
+            {
+                m_invoke([this, awaiting](const web::json::value& result, std::exception_ptr exception)
+                {
+                    m_result = result;
+                    m_exception = exception;
+                    if (m_ready.exchange(true))
+                    {
+                        awaiting.resume();
+                    }
+                });
+
+                return !m_ready.exchange(true);
+            }
+
+            web::json::value await_resume()
+            {
+                if (m_exception)
+                {
+                    std::rethrow_exception(m_exception);
+                }
+
+                return std::move(m_result);
+            }
+
+        private:
+            Invoke m_invoke;
+            std::atomic<bool> m_ready;
+            web::json::value m_result;
+            std::exception_ptr m_exception;
+        };
+
+        template <typename Send>
+        class send_awaiter
+        {
+        public:
+            explicit send_awaiter(Send send)
+                : m_send(std::move(send)), m_ready(false)
+            { }
+
+            send_awaiter(const send_awaiter&) = delete;
+            send_awaiter& operator=(const send_awaiter&) = delete;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> awaiting)
+            {
+                m_send([this, awaiting](std::exception_ptr exception)
+                {
+                    m_exception = exception;
+                    if (m_ready.exchange(true))
+                    {
+                        awaiting.resume();
+                    }
+                });
+
+                return !m_ready.exchange(true);
+            }
+
+            void await_resume()
+            {
+                if (m_exception)
+                {
+                    std::rethrow_exception(m_exception);
+                }
+            }
+
+        private:
+            Send m_send;
+            std::atomic<bool> m_ready;
+            std::exception_ptr m_exception;
+        };
+
+        template <typename T>
+        class task_awaiter
+        {
+        public:
+            explicit task_awaiter(pplx::task<T> task)
+                : m_task(std::move(task))
+            { }
+
+            bool await_ready() const
+            {
+                return m_task.is_done();
+            }
+
+            void await_suspend(std::coroutine_handle<> awaiting)
+            {
+                m_task.then([awaiting](pplx::task<T>) { awaiting.resume(); });
+            }
+
+            T await_resume()
+            {
+                return m_task.get();
+            }
+
+        private:
+            pplx::task<T> m_task;
+        };
+    }
+
+    inline auto co_invoke(hub_connection& hub_connection, const utility::string_t& method_name,
+        const web::json::value& arguments = web::json::value::array())
+    {
+        return details::invoke_awaiter([&hub_connection, method_name, arguments](const hub_connection::invocation_completed_handler& completed)
+        {
+            hub_connection.invoke(method_name, arguments, completed);
+        });
+    }
+
+    inline auto co_invoke(const prepared_method& method, const web::json::value& arguments = web::json::value::array())
+    {
+        return details::invoke_awaiter([method, arguments](const hub_connection::invocation_completed_handler& completed)
+        {
+            method.invoke(arguments, completed);
+        });
+    }
+
+    inline auto co_send(hub_connection& hub_connection, const utility::string_t& method_name,
+        const web::json::value& arguments = web::json::value::array())
+    {
+        return details::send_awaiter([&hub_connection, method_name, arguments](const hub_connection::send_completed_handler& completed)
+        {
+            hub_connection.send(method_name, arguments, completed);
+        });
+    }
+
+    inline auto co_send(const prepared_method& method, const web::json::value& arguments = web::json::value::array())
+    {
+        return details::send_awaiter([method, arguments](const hub_connection::send_completed_handler& completed)
+        {
+            method.send(arguments, completed);
+        });
+    }
+
+    inline details::task_awaiter<void> co_start(hub_connection& hub_connection)
+    {
+        return details::task_awaiter<void>(hub_connection.start());
+    }
+
+    inline details::task_awaiter<void> co_stop(hub_connection& hub_connection)
+    {
+        return details::task_awaiter<void>(hub_connection.stop());
+    }
+
+    inline details::task_awaiter<void> co_start(connection& connection)
+    {
+        return details::task_awaiter<void>(connection.start());
+    }
+
+    inline details::task_awaiter<void> co_send(connection& connection, const utility::string_t& data)
+    {
+        return details::task_awaiter<void>(connection.send(data));
+    }
+
+    inline details::task_awaiter<void> co_stop(connection& connection)
+    {
+        return details::task_awaiter<void>(connection.stop());
+    }
+}
+
+#endif
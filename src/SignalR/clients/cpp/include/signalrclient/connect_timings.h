@@ -0,0 +1,47 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "_exports.h"
+#include <chrono>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    enum class connect_phase
+    {
+        // from starting the connection until the first negotiate response was received. Includes resolving the host
+        // name and setting up the TCP connection and TLS session for the request, which the http client does not
+        // report separately. With multiple endpoints this is the time until the endpoint that was used responded
+        negotiate,
+        // following the redirects of the negotiate responses, zero if the server did not redirect
+        redirects,
+        // connecting the websocket including setting up its connection and the upgrade request
+        websocket_connect,
+        // from sending the handshake request until the handshake response was received, hub connections only
+        handshake
+    };
+
+    // How long each phase of starting a connection took.
+    struct connect_timings
+    {
+        static const size_t phase_count = 4;
+
+        // when the connection was started
+        std::chrono::system_clock::time_point start_time;
+        // the time each phase took, negative if the phase was not reached
+        std::chrono::nanoseconds phases[phase_count];
+        // the number of redirects followed
+        int redirect_count;
+        // the time elapsed between starting the connection and completing the last phase that was reached
+        std::chrono::nanoseconds total;
+
+        SIGNALRCLIENT_API connect_timings() noexcept;
+
+        SIGNALRCLIENT_API std::chrono::nanoseconds __cdecl get_phase(connect_phase phase) const noexcept;
+
+        // formats the timings in milliseconds, e.g. "negotiate: 12.5 ms, redirects: 0.0 ms (0), ..."
+        SIGNALRCLIENT_API utility::string_t __cdecl to_string() const;
+    };
+}
@@ -6,11 +6,14 @@
 #include "_exports.h"
 #include <memory>
 #include <functional>
+#include <cstdint>
+#include <vector>
 #include "pplx/pplxtasks.h"
 #include "connection_state.h"
 #include "trace_level.h"
 #include "log_writer.h"
 #include "signalr_client_config.h"
+#include "connect_timings.h"
 
 namespace signalr
 {
@@ -21,8 +24,16 @@ namespace signalr
     public:
         typedef std::function<void __cdecl(const utility::string_t&)> message_received_handler;
 
+        // receives the UTF-8 encoded bytes of a message which are only valid until the handler returns
+        typedef std::function<void __cdecl(const uint8_t* data, size_t length)> raw_message_received_handler;
+
         SIGNALRCLIENT_API explicit connection(const utility::string_t& url, trace_level trace_level = trace_level::all, std::shared_ptr<log_writer> log_writer = nullptr);
 
+        // Creates a connection to a server deployed at multiple endpoints. All endpoints are negotiated with in
+        // parallel when the connection starts and the first one to respond is used. If the connection is lost
+        // the connection fails over to the remaining endpoints, fastest responders first.
+        SIGNALRCLIENT_API explicit connection(const std::vector<utility::string_t>& urls, trace_level trace_level = trace_level::all, std::shared_ptr<log_writer> log_writer = nullptr);
+
         SIGNALRCLIENT_API ~connection();
 
         connection(const connection&) = delete;
@@ -33,7 +44,15 @@ namespace signalr
 
         SIGNALRCLIENT_API pplx::task<void> __cdecl send(const utility::string_t& data);
 
+        // Sends the UTF-8 encoded data without copying it. The connection takes over the buffer and releases it
+        // once the data was sent.
+        SIGNALRCLIENT_API pplx::task<void> __cdecl send(std::vector<uint8_t>&& data);
+
         SIGNALRCLIENT_API void __cdecl set_message_received(const message_received_handler& message_received_callback);
+
+        // When set, received messages are passed to this handler without being copied to strings and the message
+        // received handler is not invoked.
+        SIGNALRCLIENT_API void __cdecl set_raw_message_received(const raw_message_received_handler& raw_message_received_callback);
         SIGNALRCLIENT_API void __cdecl set_disconnected(const std::function<void __cdecl()>& disconnected_callback);
 
         SIGNALRCLIENT_API void __cdecl set_client_config(const signalr_client_config& config);
@@ -43,6 +62,9 @@ namespace signalr
         SIGNALRCLIENT_API connection_state __cdecl get_connection_state() const noexcept;
         SIGNALRCLIENT_API utility::string_t __cdecl get_connection_id() const;
 
+        // the timings of the phases of the last start, also logged at trace_level::events once the connection started
+        SIGNALRCLIENT_API connect_timings __cdecl get_connect_timings() const;
+
     private:
         // The recommended smart pointer to use when doing pImpl is the `std::unique_ptr`. However
         // we are capturing the m_pImpl instance in the lambdas used by tasks which can outlive
@@ -4,14 +4,21 @@
 #pragma once
 
 #include "_exports.h"
+#include <chrono>
 #include <memory>
 #include <functional>
+#include <vector>
 #include "pplx/pplxtasks.h"
 #include "cpprest/json.h"
 #include "connection_state.h"
 #include "trace_level.h"
 #include "log_writer.h"
 #include "signalr_client_config.h"
+#include "prepared_method.h"
+#include "json_view.h"
+#include "inbound_queue.h"
+#include "result_cache.h"
+#include "connect_timings.h"
 
 namespace signalr
 {
@@ -22,9 +29,22 @@ namespace signalr
     public:
         typedef std::function<void __cdecl (const web::json::value&)> method_invoked_handler;
 
+        typedef std::function<void __cdecl (const json_view&)> method_invoked_view_handler;
+
+        typedef std::function<void __cdecl (const web::json::value&, std::exception_ptr)> invocation_completed_handler;
+
+        typedef std::function<void __cdecl (std::exception_ptr)> send_completed_handler;
+
         SIGNALRCLIENT_API explicit hub_connection(const utility::string_t& url, trace_level trace_level = trace_level::all,
             std::shared_ptr<log_writer> log_writer = nullptr);
 
+        // Creates a connection to a hub deployed at multiple endpoints. All endpoints are negotiated with in parallel
+        // when the connection starts and the first one to respond is used. If the connection is lost the connection
+        // fails over to the remaining endpoints, fastest responders first. Invocations pending when the connection
+        // fails over are failed since the new endpoint does not know about them.
+        SIGNALRCLIENT_API explicit hub_connection(const std::vector<utility::string_t>& urls, trace_level trace_level = trace_level::all,
+            std::shared_ptr<log_writer> log_writer = nullptr);
+
         SIGNALRCLIENT_API ~hub_connection();
 
         hub_connection(const hub_connection&) = delete;
@@ -37,16 +57,69 @@ namespace signalr
         SIGNALRCLIENT_API connection_state __cdecl get_connection_state() const;
         SIGNALRCLIENT_API utility::string_t __cdecl get_connection_id() const;
 
+        // the timings of the phases of the last start including the handshake, also logged at trace_level::events once
+        // the connection started
+        SIGNALRCLIENT_API connect_timings __cdecl get_connect_timings() const;
+
         SIGNALRCLIENT_API void __cdecl set_disconnected(const std::function<void __cdecl()>& disconnected_callback);
 
         SIGNALRCLIENT_API void __cdecl set_client_config(const signalr_client_config& config);
 
+        SIGNALRCLIENT_API void __cdecl set_invocation_timeout(std::chrono::milliseconds timeout);
+
         SIGNALRCLIENT_API void __cdecl on(const utility::string_t& event_name, const method_invoked_handler& handler);
 
+        // Registers a handler that gets a read-only view of the arguments instead of a copy. The view is only valid
+        // until the handler returns. See signalr_client_config::set_message_parsing.
+        SIGNALRCLIENT_API void __cdecl on(const utility::string_t& event_name, const method_invoked_view_handler& handler);
+
+        // Registers a handler that is invoked off the thread receiving messages through a bounded queue so that a
+        // handler which can't keep up with the invocations received does not hold up receiving messages. See
+        // inbound_queue_config.
+        SIGNALRCLIENT_API void __cdecl on(const utility::string_t& event_name, const method_invoked_handler& handler,
+            const inbound_queue_config& queue_config);
+
+        // the depth and drop counters of the queue of the handler registered for the event with a queue
+        SIGNALRCLIENT_API inbound_queue_stats __cdecl get_inbound_queue_stats(const utility::string_t& event_name) const;
+
+        // Makes concurrent invocations of the method with equal arguments share a single invocation: an invocation
+        // made while an equal one is waiting for its result is not sent but completes with the result (or the error,
+        // including a timeout) of the one in flight. Meant for read-only methods. Invocations that can be canceled
+        // are never coalesced.
+        SIGNALRCLIENT_API void __cdecl coalesce_invocations(const utility::string_t& method_name);
+
+        // Caches the results of the method, which must be idempotent, so that invocations with the arguments of a
+        // cached result complete with the cached result without contacting the server. Only successful results are
+        // cached. See result_cache_config.
+        SIGNALRCLIENT_API void __cdecl cache_results(const utility::string_t& method_name, const result_cache_config& cache_config);
+
+        // the hit and miss counters of the cache of the method
+        SIGNALRCLIENT_API result_cache_stats __cdecl get_result_cache_stats(const utility::string_t& method_name) const;
+
+        // drops the cached results of the method, e.g. from the handler of a message the server sends when they change
+        SIGNALRCLIENT_API void __cdecl invalidate_cached_results(const utility::string_t& method_name);
+
         SIGNALRCLIENT_API pplx::task<web::json::value> invoke(const utility::string_t& method_name, const web::json::value& arguments = web::json::value::array());
 
+        SIGNALRCLIENT_API pplx::task<web::json::value> __cdecl invoke(const utility::string_t& method_name, const web::json::value& arguments,
+            const pplx::cancellation_token& cancellation_token);
+
+        SIGNALRCLIENT_API pplx::task<web::json::value> __cdecl invoke(const utility::string_t& method_name, const web::json::value& arguments,
+            std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token = pplx::cancellation_token::none());
+
         SIGNALRCLIENT_API pplx::task<void> send(const utility::string_t& method_name, const web::json::value& arguments = web::json::value::array());
 
+        // Callback based variants of invoke and send which don't create a task for each call. The handler is invoked
+        // exactly once, possibly before the call returns, with either the result or the error and must not throw.
+        // These are used by the awaitables in awaitable.h.
+        SIGNALRCLIENT_API void __cdecl invoke(const utility::string_t& method_name, const web::json::value& arguments,
+            const invocation_completed_handler& invocation_completed);
+
+        SIGNALRCLIENT_API void __cdecl send(const utility::string_t& method_name, const web::json::value& arguments,
+            const send_completed_handler& send_completed);
+
+        SIGNALRCLIENT_API prepared_method __cdecl prepare(const utility::string_t& method_name);
+
     private:
         std::shared_ptr<hub_connection_impl> m_pImpl;
     };
@@ -0,0 +1,64 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "_exports.h"
+#include <cstdint>
+#include <functional>
+#include "cpprest/json.h"
+
+namespace signalr
+{
+    // What happens to an invocation received for a subscription whose queue is full
+    enum class queue_overflow_policy
+    {
+        // the thread receiving messages waits until the handler made room in the queue. Messages are not read from
+        // the socket in the meantime so TCP flow control slows the server down
+        block,
+        // the oldest queued invocation is dropped
+        drop_oldest,
+        // only the latest invocation per conflation key is queued. An invocation replaces the queued invocation with
+        // the same key, keeping its place in the queue, so the handler gets the latest value of each key. The
+        // oldest invocation is dropped when an invocation with a new key is received while the queue is full
+        conflate
+    };
+
+    // Configures the queue invocations of a subscription are delivered through. The handler of a subscription with
+    // a queue is invoked on a thread pool thread, or on a thread of the queue with queue_overflow_policy::block, so
+    // it does not hold up receiving messages. Invocations are passed to the handler one at a time.
+    class inbound_queue_config
+    {
+    public:
+        typedef std::function<utility::string_t __cdecl(const web::json::value& arguments)> conflation_key_extractor;
+
+        SIGNALRCLIENT_API inbound_queue_config();
+
+        // the maximum number of queued invocations, 1000 by default
+        SIGNALRCLIENT_API size_t __cdecl get_capacity() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_capacity(size_t capacity);
+
+        // queue_overflow_policy::block by default
+        SIGNALRCLIENT_API queue_overflow_policy __cdecl get_overflow_policy() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_overflow_policy(queue_overflow_policy overflow_policy);
+
+        // maps the arguments of an invocation to its conflation key, required by queue_overflow_policy::conflate
+        SIGNALRCLIENT_API conflation_key_extractor __cdecl get_conflation_key_extractor() const;
+        SIGNALRCLIENT_API void __cdecl set_conflation_key_extractor(const conflation_key_extractor& conflation_key_extractor);
+
+    private:
+        size_t m_capacity;
+        queue_overflow_policy m_overflow_policy;
+        conflation_key_extractor m_conflation_key_extractor;
+    };
+
+    struct inbound_queue_stats
+    {
+        // the number of invocations waiting for the handler
+        size_t depth;
+        // invocations dropped because the queue was full
+        uint64_t dropped;
+        // invocations replaced by a newer invocation with the same conflation key before they were handled
+        uint64_t conflated;
+    };
+}
@@ -0,0 +1,97 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "_exports.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    enum class invocation_stage
+    {
+        // the invocation message was written to the send buffer
+        serialized,
+        // the message was handed to the transport
+        enqueued,
+        // the transport finished sending the message
+        frame_written,
+        // the completion message was received (or the invocation failed, timed out or was canceled)
+        completion_received,
+        // the handler the result was passed to returned
+        callback_completed
+    };
+
+    // The timings of a single hub invocation. The invocation is identified by a W3C trace context whose trace id
+    // and span id are sent to the server in the traceparent header of the invocation so that client and server
+    // spans can be correlated.
+    struct invocation_span
+    {
+        static const size_t stage_count = 5;
+
+        uint8_t trace_id[16];
+        uint8_t span_id[8];
+        // when the invocation was started
+        std::chrono::system_clock::time_point start_time;
+        // the time elapsed between the start of the invocation and each stage, negative if the stage was not reached
+        std::chrono::nanoseconds stages[stage_count];
+        bool succeeded;
+
+        SIGNALRCLIENT_API std::chrono::nanoseconds __cdecl get_stage(invocation_stage stage) const noexcept;
+
+        // formats the trace context as a traceparent header value
+        SIGNALRCLIENT_API utility::string_t __cdecl traceparent() const;
+    };
+
+    // Receives the spans of completed invocations. Spans are recorded on the thread that completed the invocation
+    // so implementations must be thread safe and should return quickly.
+    class invocation_trace_sink
+    {
+    public:
+        virtual void __cdecl record(const invocation_span& span) = 0;
+
+        virtual ~invocation_trace_sink() {}
+    };
+
+    // Keeps recorded spans in a fixed size buffer without taking locks. Spans recorded while the buffer is full are
+    // dropped. Recording is safe from any number of threads but only one thread may drain or flush at a time.
+    class ring_buffer_trace_sink : public invocation_trace_sink
+    {
+    public:
+        // the capacity is rounded up to a power of two
+        SIGNALRCLIENT_API explicit ring_buffer_trace_sink(size_t capacity = 4096);
+
+        SIGNALRCLIENT_API ~ring_buffer_trace_sink();
+
+        ring_buffer_trace_sink(const ring_buffer_trace_sink&) = delete;
+        ring_buffer_trace_sink& operator=(const ring_buffer_trace_sink&) = delete;
+
+        SIGNALRCLIENT_API void __cdecl record(const invocation_span& span) override;
+
+        // removes the recorded spans from the buffer and appends them to `spans`, returns the number of spans
+        SIGNALRCLIENT_API size_t __cdecl drain(std::vector<invocation_span>& spans);
+
+        // Removes the recorded spans from the buffer and appends them to the file at the given path, one line per
+        // span with the traceparent, the start time in microseconds since the epoch, the stage timings in
+        // microseconds (-1 for stages that were not reached) and whether the invocation succeeded, separated by
+        // commas. Returns the number of spans written.
+        SIGNALRCLIENT_API size_t __cdecl flush(const utility::string_t& path);
+
+        SIGNALRCLIENT_API size_t __cdecl get_capacity() const noexcept;
+        SIGNALRCLIENT_API uint64_t __cdecl get_dropped_count() const noexcept;
+
+    private:
+        struct slot;
+
+        std::unique_ptr<slot[]> m_slots;
+        const size_t m_mask;
+        std::atomic<size_t> m_enqueue_position;
+        std::atomic<size_t> m_dequeue_position;
+        std::atomic<uint64_t> m_dropped_count;
+    };
+}
@@ -0,0 +1,68 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "_exports.h"
+#include <cstdint>
+#include "cpprest/json.h"
+
+namespace signalr
+{
+    namespace details
+    {
+        struct json_node;
+    }
+
+    // A read-only view of a JSON value of a received message. The value is stored in memory that is reused for
+    // the next message so the view, and anything obtained from it other than copies, are only valid until the
+    // handler the view was passed to returns. Use `to_value` to keep the value. Accessing a value as a type it
+    // does not have throws a web::json::json_exception.
+    class json_view
+    {
+    public:
+        // creates a view of a null value
+        SIGNALRCLIENT_API json_view() noexcept;
+
+        SIGNALRCLIENT_API web::json::value::value_type __cdecl type() const noexcept;
+
+        SIGNALRCLIENT_API bool __cdecl is_null() const noexcept;
+        SIGNALRCLIENT_API bool __cdecl is_boolean() const noexcept;
+        SIGNALRCLIENT_API bool __cdecl is_number() const noexcept;
+        SIGNALRCLIENT_API bool __cdecl is_integer() const noexcept;
+        SIGNALRCLIENT_API bool __cdecl is_string() const noexcept;
+        SIGNALRCLIENT_API bool __cdecl is_array() const noexcept;
+        SIGNALRCLIENT_API bool __cdecl is_object() const noexcept;
+
+        SIGNALRCLIENT_API bool __cdecl as_bool() const;
+        SIGNALRCLIENT_API double __cdecl as_double() const;
+        SIGNALRCLIENT_API int __cdecl as_integer() const;
+        SIGNALRCLIENT_API int64_t __cdecl as_int64() const;
+        SIGNALRCLIENT_API utility::string_t __cdecl as_string() const;
+
+        // the characters of a string value without copying them; the characters are not null terminated
+        SIGNALRCLIENT_API const utility::char_t* __cdecl string_data() const;
+        SIGNALRCLIENT_API size_t __cdecl string_length() const;
+
+        // the number of elements of an array or fields of an object, 0 for other values
+        SIGNALRCLIENT_API size_t __cdecl size() const;
+
+        // the element of an array or the value of a field of an object at the given index
+        SIGNALRCLIENT_API json_view __cdecl operator[](size_t index) const;
+        SIGNALRCLIENT_API utility::string_t __cdecl field_name(size_t index) const;
+
+        SIGNALRCLIENT_API bool __cdecl has_field(const utility::string_t& key) const;
+        SIGNALRCLIENT_API json_view __cdecl at(const utility::string_t& key) const;
+
+        // copies the viewed value
+        SIGNALRCLIENT_API web::json::value __cdecl to_value() const;
+        SIGNALRCLIENT_API utility::string_t __cdecl serialize() const;
+
+    private:
+        friend class json_arena_parser;
+
+        explicit json_view(const details::json_node* node) noexcept;
+
+        const details::json_node* m_node;
+    };
+}
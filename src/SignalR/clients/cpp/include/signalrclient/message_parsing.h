@@ -0,0 +1,19 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+namespace signalr
+{
+    enum class message_parsing
+    {
+        // each received message is parsed into a web::json::value
+        dom,
+        // received messages are parsed into an arena owned by the connection which is reused for every message
+        arena,
+        // like arena but only the fields of the message envelope are parsed when a message is received. Arguments
+        // and results are parsed when they are first accessed so the arguments of invocations of methods without
+        // a handler are never parsed
+        lazy
+    };
+}
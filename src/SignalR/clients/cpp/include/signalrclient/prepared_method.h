@@ -0,0 +1,51 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "_exports.h"
+#include <chrono>
+#include <memory>
+#include <functional>
+#include "pplx/pplxtasks.h"
+#include "cpprest/json.h"
+
+namespace signalr
+{
+    class hub_connection_impl;
+    class invocation_envelope;
+
+    // A handle to a hub method returned by `hub_connection::prepare`. The parts of the invocation message that do
+    // not depend on the arguments are serialized once when the handle is created so invoking the method through
+    // the handle only serializes the arguments. The handle does not keep the hub connection alive.
+    class prepared_method
+    {
+    public:
+        SIGNALRCLIENT_API pplx::task<web::json::value> __cdecl invoke(const web::json::value& arguments = web::json::value::array()) const;
+
+        SIGNALRCLIENT_API pplx::task<web::json::value> __cdecl invoke(const web::json::value& arguments,
+            const pplx::cancellation_token& cancellation_token) const;
+
+        SIGNALRCLIENT_API pplx::task<web::json::value> __cdecl invoke(const web::json::value& arguments,
+            std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token = pplx::cancellation_token::none()) const;
+
+        SIGNALRCLIENT_API pplx::task<void> __cdecl send(const web::json::value& arguments = web::json::value::array()) const;
+
+        // callback based variants, see `hub_connection::invoke` and `hub_connection::send`
+        SIGNALRCLIENT_API void __cdecl invoke(const web::json::value& arguments,
+            const std::function<void __cdecl (const web::json::value&, std::exception_ptr)>& invocation_completed) const;
+
+        SIGNALRCLIENT_API void __cdecl send(const web::json::value& arguments,
+            const std::function<void __cdecl (std::exception_ptr)>& send_completed) const;
+
+        SIGNALRCLIENT_API const utility::string_t& __cdecl get_method_name() const;
+
+    private:
+        friend class hub_connection;
+
+        prepared_method(const std::weak_ptr<hub_connection_impl>& hub_connection, const std::shared_ptr<const invocation_envelope>& envelope);
+
+        std::weak_ptr<hub_connection_impl> m_hub_connection;
+        std::shared_ptr<const invocation_envelope> m_envelope;
+    };
+}
@@ -0,0 +1,48 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "_exports.h"
+#include <chrono>
+#include <cstdint>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    // Configures the cache of the results of a hub method. Results are cached per arguments for the time to live
+    // and the least recently used result is evicted when the cache is full.
+    class result_cache_config
+    {
+    public:
+        SIGNALRCLIENT_API result_cache_config();
+
+        // how long a result is returned from the cache, 1 second by default
+        SIGNALRCLIENT_API std::chrono::milliseconds __cdecl get_time_to_live() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_time_to_live(std::chrono::milliseconds time_to_live);
+
+        // the maximum number of cached results, 1000 by default
+        SIGNALRCLIENT_API size_t __cdecl get_max_entries() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_max_entries(size_t max_entries);
+
+        // when set, the cached results are dropped whenever the server invokes this client method. Handlers can
+        // still be registered for it with hub_connection::on
+        SIGNALRCLIENT_API utility::string_t __cdecl get_invalidation_event() const;
+        SIGNALRCLIENT_API void __cdecl set_invalidation_event(const utility::string_t& event_name);
+
+    private:
+        std::chrono::milliseconds m_time_to_live;
+        size_t m_max_entries;
+        utility::string_t m_invalidation_event;
+    };
+
+    struct result_cache_stats
+    {
+        // invocations completed from the cache
+        uint64_t hits;
+        // invocations sent to the server since no result for their arguments was cached or it had expired
+        uint64_t misses;
+        // the number of cached results, including the expired ones not evicted yet
+        size_t entries;
+    };
+}
@@ -6,12 +6,26 @@
 #include "cpprest/http_client.h"
 #include "cpprest/ws_client.h"
 #include "_exports.h"
+#include "message_parsing.h"
+#include "invocation_trace.h"
 
 namespace signalr
 {
+    class http_client_pool;
+    class tls_session_cache;
+
+    // Copies of a config share an immutable snapshot of the settings so that copying a config, which every
+    // connection and request does, does not copy the http and websocket client configs and the headers. Changing a
+    // setting replaces the snapshot of the config it was changed on and leaves the snapshots of its copies unchanged.
     class signalr_client_config
     {
     public:
+        // maps an invocation received from the server to the key its handler is dispatched by, see
+        // set_partition_key_extractor
+        typedef std::function<size_t __cdecl(const utility::string_t& target, const web::json::value& arguments)> partition_key_extractor;
+
+        SIGNALRCLIENT_API signalr_client_config();
+
         SIGNALRCLIENT_API void __cdecl set_proxy(const web::web_proxy &proxy);
         // Please note that setting credentials does not work in all cases.
         // For example, Basic Authentication fails under Win32.
@@ -28,9 +42,105 @@ namespace signalr
         SIGNALRCLIENT_API web::http::http_headers __cdecl get_http_headers() const noexcept;
         SIGNALRCLIENT_API void __cdecl set_http_headers(const web::http::http_headers& http_headers);
 
+        // When enabled (and supported by the server) messages sent to the server are retained until the server
+        // acknowledges them. If the transport drops, it is re-connected once and the unacknowledged messages are
+        // replayed so that a short network blip does not lose messages or fail pending invocations.
+        SIGNALRCLIENT_API bool __cdecl get_stateful_reconnect() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_stateful_reconnect(bool stateful_reconnect);
+
+        // The maximum number of bytes of unacknowledged messages retained for replay. Sending fails if the
+        // retained messages would exceed this size.
+        SIGNALRCLIENT_API size_t __cdecl get_stateful_reconnect_buffer_size() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_stateful_reconnect_buffer_size(size_t buffer_size);
+
+        // When set, the websocket frames sent and received by the connection are written to a traffic capture file
+        // at the given path so that the traffic can be replayed offline. An existing file is overwritten when the
+        // connection connects to the server for the first time.
+        SIGNALRCLIENT_API utility::string_t __cdecl get_traffic_capture_path() const;
+        SIGNALRCLIENT_API void __cdecl set_traffic_capture_path(const utility::string_t& path);
+
+        // How hub connections parse received messages. With message_parsing::arena messages are parsed into memory
+        // reused for every message which avoids allocating the nodes and strings of each message. With
+        // message_parsing::lazy arguments are in addition not parsed until a handler accesses them. Handlers
+        // registered with a json_view get a view of the arguments in every mode.
+        SIGNALRCLIENT_API message_parsing __cdecl get_message_parsing() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_message_parsing(message_parsing message_parsing);
+
+        // Messages with at least this many records, which the server sends when it batches messages or replays
+        // them after a reconnect, are parsed on multiple threads and processed in order once parsed. Records
+        // parsed in parallel are parsed into web::json::values regardless of the message parsing mode. 0, the
+        // default, parses all messages on the thread receiving them.
+        SIGNALRCLIENT_API size_t __cdecl get_parallel_parsing_threshold() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_parallel_parsing_threshold(size_t record_count);
+
+        // When set, hub connections record a span with the timings of each invocation in the sink and send the
+        // trace context of the span to the server in the traceparent header of the invocation. Tracing is off by
+        // default and costs a null check per invocation when off.
+        SIGNALRCLIENT_API std::shared_ptr<invocation_trace_sink> __cdecl get_invocation_trace_sink() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_invocation_trace_sink(const std::shared_ptr<invocation_trace_sink>& sink);
+
+        // When set, the handlers of invocations received from the server are not invoked on the thread receiving
+        // messages but on a pool of dispatch threads. Invocations the extractor returns the same key for are handled
+        // one at a time in the order they were received while invocations with different keys are handled
+        // concurrently. Handlers registered with a json_view get a view of a copy of the arguments.
+        SIGNALRCLIENT_API partition_key_extractor __cdecl get_partition_key_extractor() const;
+        SIGNALRCLIENT_API void __cdecl set_partition_key_extractor(const partition_key_extractor& partition_key_extractor);
+
+        // The number of dispatch threads used when a partition key extractor is set. 0, the default, uses a thread
+        // per processor. Connections with the same dispatch concurrency share their dispatch threads, so keys of
+        // different connections can share a partition and be handled one at a time.
+        SIGNALRCLIENT_API size_t __cdecl get_dispatch_concurrency() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_dispatch_concurrency(size_t dispatch_concurrency);
+
+        // The maximum number of invocations a hub connection has in flight. Invocations made while the limit is
+        // reached wait in a queue, where their timeout and cancellation already apply, and are sent in order as
+        // earlier invocations complete. 0, the default, does not limit invocations.
+        SIGNALRCLIENT_API size_t __cdecl get_max_concurrent_invocations() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_max_concurrent_invocations(size_t max_concurrent_invocations);
+
+        // When enabled, the limit of invocations in flight adapts to the latency of completed invocations: it is
+        // lowered when invocations take much longer than usual or time out, and raised back up to the maximum
+        // concurrent invocations as latency recovers, so that a slow server sees less load instead of more.
+        SIGNALRCLIENT_API bool __cdecl get_adaptive_concurrency_limit() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_adaptive_concurrency_limit(bool adaptive_concurrency_limit);
+
+        // When set, messages sent with hub_connection::send are not sent right away but appended to a durable outbox kept
+        // in memory-mapped files in this directory, and sent from there in batches while the connection is connected.
+        // Sending does not fail while the connection is down and messages that were not sent yet are sent once a hub
+        // connection using the same directory connects, even after the process restarted. A message may be sent twice if
+        // the process stops right after sending it. The files are not flushed to disk explicitly, so messages sent shortly
+        // before the operating system crashed or the machine lost power can be lost. Invocations that expect a result are
+        // not affected since their results could not be delivered after a restart. Messages sent through the outbox keep
+        // their order among each other, but invocations and stream messages don't wait for the outbox, so one made after a
+        // send can reach the server before the sent message does. The outbox of a hub connection can only be changed while
+        // it is disconnected and no messages are being sent from the outbox.
+        SIGNALRCLIENT_API utility::string_t __cdecl get_outbox_directory() const;
+        SIGNALRCLIENT_API void __cdecl set_outbox_directory(const utility::string_t& directory);
+
+        // The maximum size in bytes of the files of the outbox. Sending fails while the outbox is full.
+        SIGNALRCLIENT_API size_t __cdecl get_outbox_size() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_outbox_size(size_t outbox_size);
+
+        // When enabled, the default, TLS sessions established with a server are cached in a cache shared by all
+        // connections in the process and resumed by later negotiate requests, websocket connections and reconnects
+        // to the same origin with the same http and websocket client configs, which saves a round trip and the key
+        // exchange of a full handshake. Only sessions whose server certificate was verified are cached. Not
+        // supported on Windows: negotiate requests are sent with WinHTTP, which resumes sessions on its own, and
+        // websocket connections, which use OpenSSL there as well, always perform a full handshake.
+        SIGNALRCLIENT_API bool __cdecl get_tls_session_resumption() const noexcept;
+        SIGNALRCLIENT_API void __cdecl set_tls_session_resumption(bool tls_session_resumption);
+
     private:
-        web::http::client::http_client_config m_http_client_config;
-        web::websockets::client::websocket_client_config m_websocket_client_config;
-        web::http::http_headers m_http_headers;
+        friend class http_client_pool;
+        friend class tls_session_cache;
+
+        struct settings;
+
+        std::shared_ptr<const settings> m_settings;
+
+        const web::http::client::http_client_config& http_client_config() const noexcept;
+        uint64_t http_client_config_id() const noexcept;
+        uint64_t tls_config_id() const noexcept;
+        settings& update_settings();
     };
 }
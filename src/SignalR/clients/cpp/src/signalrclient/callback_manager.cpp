@@ -18,14 +18,14 @@ namespace signalr
     }
 
     // note: callback must not throw except for the `on_progress` callback which will never be invoked from the dtor
-    utility::string_t callback_manager::register_callback(const std::function<void(const web::json::value&)>& callback)
+    utility::string_t callback_manager::register_callback(std::function<void(const web::json::value&)> callback)
     {
         auto callback_id = get_callback_id();
 
         {
             std::lock_guard<std::mutex> lock(m_map_lock);
 
-            m_callbacks.insert(std::make_pair(callback_id, callback));
+            m_callbacks.emplace(callback_id, std::move(callback));
         }
 
         return callback_id;
@@ -46,11 +46,14 @@ namespace signalr
                 return false;
             }
 
-            callback = iter->second;
-
             if (remove_callback)
             {
-                m_callbacks.erase(callback_id);
+                callback = std::move(iter->second);
+                m_callbacks.erase(iter);
+            }
+            else
+            {
+                callback = iter->second;
             }
         }
 
@@ -69,15 +72,18 @@ namespace signalr
 
     void callback_manager::clear(const web::json::value& arguments)
     {
+        std::unordered_map<utility::string_t, std::function<void(const web::json::value&)>> callbacks;
+
         {
             std::lock_guard<std::mutex> lock(m_map_lock);
 
-            for (auto& kvp : m_callbacks)
-            {
-                kvp.second(arguments);
-            }
+            callbacks.swap(m_callbacks);
+        }
 
-            m_callbacks.clear();
+        // callbacks are invoked outside the lock so that they can safely call back into the callback_manager
+        for (auto& kvp : callbacks)
+        {
+            kvp.second(arguments);
         }
     }
 
@@ -20,7 +20,7 @@ namespace signalr
         callback_manager(const callback_manager&) = delete;
         callback_manager& operator=(const callback_manager&) = delete;
 
-        utility::string_t register_callback(const std::function<void(const web::json::value&)>& callback);
+        utility::string_t register_callback(std::function<void(const web::json::value&)> callback);
         bool invoke_callback(const utility::string_t& callback_id, const web::json::value& arguments, bool remove_callback);
         bool remove_callback(const utility::string_t& callback_id);
         void clear(const web::json::value& arguments);
@@ -0,0 +1,62 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/connect_timings.h"
+#include <cstdio>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        const char* phase_names[connect_timings::phase_count] = { "negotiate", "redirects", "websocket connect", "handshake" };
+
+        void append_milliseconds(std::string& buffer, std::chrono::nanoseconds duration)
+        {
+            char milliseconds[32];
+            std::snprintf(milliseconds, sizeof(milliseconds), "%.1f ms", duration.count() / 1000000.0);
+            buffer.append(milliseconds);
+        }
+    }
+
+    connect_timings::connect_timings() noexcept
+        : redirect_count(0), total(0)
+    {
+        for (auto& phase : phases)
+        {
+            phase = std::chrono::nanoseconds(-1);
+        }
+    }
+
+    std::chrono::nanoseconds connect_timings::get_phase(connect_phase phase) const noexcept
+    {
+        return phases[static_cast<size_t>(phase)];
+    }
+
+    // phases that were not reached are left out
+    utility::string_t connect_timings::to_string() const
+    {
+        std::string buffer;
+        for (size_t i = 0; i < phase_count; ++i)
+        {
+            if (phases[i].count() < 0)
+            {
+                continue;
+            }
+
+            buffer.append(phase_names[i]).append(": ");
+            append_milliseconds(buffer, phases[i]);
+            if (i == static_cast<size_t>(connect_phase::redirects))
+            {
+                buffer.append(" (").append(std::to_string(redirect_count)).append(")");
+            }
+            buffer.append(", ");
+        }
+
+        buffer.append("total: ");
+        append_milliseconds(buffer, total);
+
+        return utility::conversions::to_string_t(buffer);
+    }
+}
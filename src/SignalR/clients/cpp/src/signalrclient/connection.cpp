@@ -12,6 +12,10 @@ namespace signalr
         : m_pImpl(connection_impl::create(url, trace_level, std::move(log_writer)))
     {}
 
+    connection::connection(const std::vector<utility::string_t>& urls, trace_level trace_level, std::shared_ptr<log_writer> log_writer)
+        : m_pImpl(connection_impl::create(urls, trace_level, std::move(log_writer)))
+    {}
+
     // Do NOT remove this destructor. Letting the compiler generate and inline the default dtor may lead to
     // undefinded behavior since we are using an incomplete type. More details here:  http://herbsutter.com/gotw/_100/
     connection::~connection() = default;
@@ -26,11 +30,21 @@ namespace signalr
         return m_pImpl->send(data);
     }
 
+    pplx::task<void> connection::send(std::vector<uint8_t>&& data)
+    {
+        return m_pImpl->send(std::move(data));
+    }
+
     void connection::set_message_received(const message_received_handler& message_received_callback)
     {
         m_pImpl->set_message_received(message_received_callback);
     }
 
+    void connection::set_raw_message_received(const raw_message_received_handler& raw_message_received_callback)
+    {
+        m_pImpl->set_raw_message_received(raw_message_received_callback);
+    }
+
     void connection::set_disconnected(const std::function<void()>& disconnected_callback)
     {
         m_pImpl->set_disconnected(disconnected_callback);
@@ -55,4 +69,9 @@ namespace signalr
     {
         return m_pImpl->get_connection_id();
     }
+
+    connect_timings connection::get_connect_timings() const
+    {
+        return m_pImpl->get_connect_timings();
+    }
 }
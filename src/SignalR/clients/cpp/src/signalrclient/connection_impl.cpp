@@ -4,6 +4,7 @@
 #include "stdafx.h"
 #include <thread>
 #include <algorithm>
+#include <chrono>
 #include "constants.h"
 #include "connection_impl.h"
 #include "request_sender.h"
@@ -17,8 +18,33 @@ namespace signalr
     // unnamed namespace makes it invisble outside this translation unit
     namespace
     {
+        pplx::task<void> log_send_errors(pplx::task<void> send_task, logger logger)
+        {
+            return send_task
+                .then([logger](pplx::task<void> send_task)
+                {
+                    try
+                    {
+                        send_task.get();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        logger.log(
+                            trace_level::errors,
+                            utility::string_t(_XPLATSTR("error sending data: "))
+                            .append(utility::conversions::to_string_t(e.what())));
+
+                        throw;
+                    }
+                });
+        }
+
         // this is a workaround for a compiler bug where mutable lambdas won't sometimes compile
         static void log(const logger& logger, trace_level level, const utility::string_t& entry);
+
+        static bool supports_websockets(const negotiation_response& negotiation_response);
+
+        static signalr_client_config with_access_token(signalr_client_config signalr_client_config, const utility::string_t& access_token);
     }
 
     std::shared_ptr<connection_impl> connection_impl::create(const utility::string_t& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer)
@@ -29,39 +55,71 @@ namespace signalr
     std::shared_ptr<connection_impl> connection_impl::create(const utility::string_t& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
         std::unique_ptr<web_request_factory> web_request_factory, std::unique_ptr<transport_factory> transport_factory)
     {
-        return std::shared_ptr<connection_impl>(new connection_impl(url, trace_level,
+        return connection_impl::create(std::vector<utility::string_t>{ url }, trace_level, log_writer,
+            std::move(web_request_factory), std::move(transport_factory));
+    }
+
+    std::shared_ptr<connection_impl> connection_impl::create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+        const std::shared_ptr<log_writer>& log_writer)
+    {
+        return connection_impl::create(urls, trace_level, log_writer, std::make_unique<web_request_factory>(), std::make_unique<transport_factory>());
+    }
+
+    std::shared_ptr<connection_impl> connection_impl::create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+        const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
+        std::unique_ptr<transport_factory> transport_factory)
+    {
+        if (urls.empty())
+        {
+            throw std::invalid_argument("urls cannot be empty");
+        }
+
+        return std::shared_ptr<connection_impl>(new connection_impl(urls, trace_level,
             log_writer ? log_writer : std::make_shared<trace_log_writer>(), std::move(web_request_factory), std::move(transport_factory)));
     }
 
-    connection_impl::connection_impl(const utility::string_t& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
+    connection_impl::connection_impl(const std::vector<utility::string_t>& urls, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
         std::unique_ptr<web_request_factory> web_request_factory, std::unique_ptr<transport_factory> transport_factory)
-        : m_base_url(url), m_connection_state(connection_state::disconnected), m_logger(log_writer, trace_level),
+        : m_base_urls(urls.begin(), urls.end()), m_connection_state(connection_state::disconnected), m_logger(log_writer, trace_level),
         m_transport(nullptr), m_web_request_factory(std::move(web_request_factory)), m_transport_factory(std::move(transport_factory)),
-        m_message_received([](const utility::string_t&) noexcept {}), m_disconnected([]() noexcept {})
+        m_message_received([](const utility::string_t&) noexcept {}), m_disconnected([]() noexcept {}),
+        m_reconnected([]() noexcept {}), m_failed_over([]() noexcept {}), m_stateful_reconnect(false), m_reconnecting(false),
+        m_transport_generation(0), m_current_endpoint(0), m_endpoint_ranking(std::make_shared<endpoint_ranking>())
     { }
 
     connection_impl::~connection_impl()
     {
-        try
+        // The dtor may run on a pool thread so it must not wait for anything. There might be some outstanding tasks
+        // that hold on to the connection via a weak pointer but they won't be able to acquire the instance since it
+        // is being destroyed so it is enough to cancel the ongoing start (if any) and to close the transport without
+        // waiting for the transport to be closed.
+        m_disconnect_cts.cancel();
+
+        auto transport = std::atomic_load(&m_transport);
+        if (transport)
         {
-            // Signaling the event is safe here. We are in the dtor so noone is using this instance. There might be some
-            // outstanding threads that hold on to the connection via a weak pointer but they won't be able to acquire
-            // the instance since it is being destroyed. Note that the event may actually be in non-signaled state here.
-            m_start_completed_event.set();
-            shutdown().get();
-        }
-        catch (const pplx::task_canceled&)
-        {
-            // because we are in the dtor and the `connection_imp` is ref counted we should not get the `task_canceled`
-            // exception because it would indicate that some other thread/task still holds reference to this instance
-            // so how come we are in the dtor?
-            _ASSERTE(false);
-            return;
+            change_state(connection_state::connected, connection_state::disconnecting);
+
+            auto logger = m_logger;
+            transport->disconnect()
+                .then([logger](pplx::task<void> disconnect_task)
+                {
+                    try
+                    {
+                        disconnect_task.get();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        logger.log(trace_level::errors,
+                            utility::string_t(_XPLATSTR("error when disconnecting the transport of a destroyed connection: "))
+                            .append(utility::conversions::to_string_t(e.what())));
+                    }
+                    catch (...) // the task is not observed by anyone else
+                    { }
+                });
         }
-        catch (...) // must not throw from destructors
-        { }
 
-        m_transport = nullptr;
+        std::atomic_store(&m_transport, std::shared_ptr<signalr::transport>());
         change_state(connection_state::disconnected);
     }
 
@@ -76,38 +134,44 @@ namespace signalr
             }
 
             // there should not be any active transport at this point
-            _ASSERTE(!m_transport);
+            _ASSERTE(!std::atomic_load(&m_transport));
 
             m_disconnect_cts = pplx::cancellation_token_source();
-            m_start_completed_event.reset();
-            m_message_id = m_groups_token = m_connection_id = _XPLATSTR("");
+            m_start_completed_tce = pplx::task_completion_event<void>();
+            m_message_id = m_groups_token = m_connection_id = m_connection_token = _XPLATSTR("");
+            m_stateful_reconnect = false;
+            m_reconnecting = false;
         }
 
-        return start_negotiate(m_base_url, 0);
-    }
-
-    pplx::task<void> connection_impl::start_negotiate(const web::uri& url, int redirect_count)
-    {
-        if (redirect_count >= MAX_NEGOTIATE_REDIRECTS)
         {
-            return pplx::task_from_exception<void>(signalr_exception(_XPLATSTR("Negotiate redirection limit exceeded.")));
+            std::lock_guard<std::mutex> lock(m_connect_timings_lock);
+            m_connect_timings = connect_timings();
+            m_connect_timings.start_time = std::chrono::system_clock::now();
+            m_connect_started = std::chrono::steady_clock::now();
         }
 
+        return start_negotiate();
+    }
+
+    pplx::task<void> connection_impl::start_negotiate()
+    {
         pplx::task_completion_event<void> start_tce;
+        // `start` replaces the event when the connection is started again so the continuation must not use the member
+        const auto start_completed_tce = m_start_completed_tce;
 
-        auto weak_connection = weak_from_this();
+        auto weak_connection = std::weak_ptr<connection_impl>(shared_from_this());
 
         pplx::task_from_result()
-            .then([weak_connection, url]()
+            .then([weak_connection]()
         {
             auto connection = weak_connection.lock();
             if (!connection)
             {
-                return pplx::task_from_exception<negotiation_response>(_XPLATSTR("connection no longer exists"));
+                return pplx::task_from_exception<negotiation_result>(_XPLATSTR("connection no longer exists"));
             }
-            return request_sender::negotiate(*connection->m_web_request_factory, url, connection->m_signalr_client_config);
+            return connection->negotiate_endpoints();
         }, m_disconnect_cts.get_token())
-            .then([weak_connection, start_tce, redirect_count, url](negotiation_response negotiation_response)
+            .then([weak_connection, start_tce](negotiation_result negotiation_result)
         {
             auto connection = weak_connection.lock();
             if (!connection)
@@ -115,52 +179,26 @@ namespace signalr
                 return pplx::task_from_exception<void>(_XPLATSTR("connection no longer exists"));
             }
 
-            if (!negotiation_response.error.empty())
-            {
-                return pplx::task_from_exception<void>(signalr_exception(negotiation_response.error));
-            }
-
-            if (!negotiation_response.url.empty())
-            {
-                if (!negotiation_response.accessToken.empty())
-                {
-                    auto headers = connection->m_signalr_client_config.get_http_headers();
-                    headers[_XPLATSTR("Authorization")] = _XPLATSTR("Bearer ") + negotiation_response.accessToken;
-                    connection->m_signalr_client_config.set_http_headers(headers);
-                }
-                return connection->start_negotiate(negotiation_response.url, redirect_count + 1);
-            }
-
-            connection->m_connection_id = std::move(negotiation_response.connectionId);
+            connection->record_negotiate_timings(negotiation_result);
+            const auto transport_started = std::chrono::steady_clock::now();
 
-            // TODO: fallback logic
-
-            bool foundWebsockets = false;
-            for (auto availableTransport : negotiation_response.availableTransports)
             {
-                if (availableTransport.transport == _XPLATSTR("WebSockets"))
-                {
-                    foundWebsockets = true;
-                    break;
-                }
+                // the connection id is available even if the transport fails to start
+                std::lock_guard<std::mutex> lock(connection->m_stop_lock);
+                connection->use_negotiation_result(negotiation_result);
             }
 
-            if (!foundWebsockets)
-            {
-                return pplx::task_from_exception<void>(signalr_exception(_XPLATSTR("The server does not support WebSockets which is currently the only transport supported by this client.")));
-            }
-
-            // TODO: use transfer format
-
-            return connection->start_transport(url)
-                .then([weak_connection, start_tce](std::shared_ptr<transport> transport)
+            return connection->start_transport(negotiation_result)
+                .then([weak_connection, start_tce, transport_started](std::shared_ptr<transport> transport)
             {
                 auto connection = weak_connection.lock();
                 if (!connection)
                 {
                     return pplx::task_from_exception<void>(_XPLATSTR("connection no longer exists"));
                 }
-                connection->m_transport = transport;
+                connection->record_connect_phase(connect_phase::websocket_connect, transport_started);
+
+                std::atomic_store(&connection->m_transport, transport);
 
                 if (!connection->change_state(connection_state::connecting, connection_state::connected))
                 {
@@ -174,7 +212,7 @@ namespace signalr
                 return pplx::task_from_result();
             });
         }, m_disconnect_cts.get_token())
-            .then([start_tce, weak_connection](pplx::task<void> previous_task)
+            .then([start_tce, start_completed_tce, weak_connection](pplx::task<void> previous_task)
         {
             auto connection = weak_connection.lock();
             if (!connection)
@@ -184,7 +222,9 @@ namespace signalr
             try
             {
                 previous_task.get();
-                connection->m_start_completed_event.set();
+                connection->m_logger.log(trace_level::events, utility::string_t(_XPLATSTR("connection started. "))
+                    .append(connection->get_connect_timings().to_string()));
+                start_completed_tce.set();
                 start_tce.set();
             }
             catch (const std::exception & e)
@@ -202,9 +242,9 @@ namespace signalr
                         .append(utility::conversions::to_string_t(e.what())));
                 }
 
-                connection->m_transport = nullptr;
+                std::atomic_store(&connection->m_transport, std::shared_ptr<transport>());
                 connection->change_state(connection_state::disconnected);
-                connection->m_start_completed_event.set();
+                start_completed_tce.set();
                 start_tce.set_exception(std::current_exception());
             }
 
@@ -214,7 +254,192 @@ namespace signalr
         return pplx::create_task(start_tce);
     }
 
-    pplx::task<std::shared_ptr<transport>> connection_impl::start_transport(const web::uri& url)
+    // negotiates with the given endpoint following redirects
+    pplx::task<connection_impl::negotiation_result> connection_impl::negotiate(const web::uri& url, int redirect_count,
+        const utility::string_t& access_token)
+    {
+        if (redirect_count >= MAX_NEGOTIATE_REDIRECTS)
+        {
+            return pplx::task_from_exception<negotiation_result>(signalr_exception(_XPLATSTR("Negotiate redirection limit exceeded.")));
+        }
+
+        auto weak_connection = std::weak_ptr<connection_impl>(shared_from_this());
+
+        const auto client_config = access_token.empty()
+            ? get_client_config()
+            : with_access_token(get_client_config(), access_token);
+
+        return request_sender::negotiate(*m_web_request_factory, url, client_config)
+            .then([weak_connection, url, redirect_count, access_token, client_config](negotiation_response negotiation_response)
+        {
+            auto connection = weak_connection.lock();
+            if (!connection)
+            {
+                return pplx::task_from_exception<negotiation_result>(_XPLATSTR("connection no longer exists"));
+            }
+
+            if (!negotiation_response.error.empty())
+            {
+                return pplx::task_from_exception<negotiation_result>(signalr_exception(negotiation_response.error));
+            }
+
+            if (!negotiation_response.url.empty())
+            {
+                // each redirect overrides the time of the response of the redirect after it so that the result
+                // ends up with the time of the first response
+                const auto responded = std::chrono::steady_clock::now();
+                return connection->negotiate(negotiation_response.url, redirect_count + 1,
+                    negotiation_response.accessToken.empty() ? access_token : negotiation_response.accessToken)
+                    .then([responded](negotiation_result result)
+                    {
+                        result.first_response = responded;
+                        return result;
+                    });
+            }
+
+            negotiation_result result;
+            result.first_response = std::chrono::steady_clock::now();
+            result.redirect_count = redirect_count;
+            result.endpoint = 0;
+            result.url = url;
+            result.response = std::move(negotiation_response);
+            result.access_token = access_token;
+            result.client_config = client_config;
+            return pplx::task_from_result(result);
+        });
+    }
+
+    // When multiple endpoints are configured they are all negotiated with in parallel and the connection uses the
+    // first one that responds. The order in which the other endpoints respond is kept to pick the endpoint to fail
+    // over to if the connection is lost.
+    pplx::task<connection_impl::negotiation_result> connection_impl::negotiate_endpoints()
+    {
+        auto ranking = std::make_shared<endpoint_ranking>();
+        std::atomic_store(&m_endpoint_ranking, ranking);
+
+        if (m_base_urls.size() == 1)
+        {
+            ranking->endpoints.push_back(0);
+            return negotiate(m_base_urls[0], 0, _XPLATSTR(""));
+        }
+
+        struct negotiate_race
+        {
+            std::mutex lock;
+            size_t pending;
+            bool completed;
+            std::exception_ptr last_error;
+            pplx::task_completion_event<negotiation_result> winner;
+        };
+
+        auto race = std::make_shared<negotiate_race>();
+        race->pending = m_base_urls.size();
+        race->completed = false;
+
+        const auto logger = m_logger;
+        const auto started = std::chrono::steady_clock::now();
+
+        for (size_t endpoint = 0; endpoint < m_base_urls.size(); ++endpoint)
+        {
+            const auto url = m_base_urls[endpoint];
+            negotiate(url, 0, _XPLATSTR(""))
+                .then([race, ranking, logger, started, endpoint, url](pplx::task<negotiation_result> negotiate_task)
+            {
+                std::lock_guard<std::mutex> lock(race->lock);
+                race->pending--;
+
+                try
+                {
+                    auto result = negotiate_task.get();
+                    if (!supports_websockets(result.response))
+                    {
+                        throw signalr_exception(_XPLATSTR("The server does not support WebSockets which is currently the only transport supported by this client."));
+                    }
+
+                    result.endpoint = endpoint;
+
+                    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+                    logger.log(trace_level::info, utility::string_t(_XPLATSTR("negotiated with "))
+                        .append(url.to_string())
+                        .append(_XPLATSTR(" in "))
+                        .append(utility::conversions::to_string_t(std::to_string(elapsed.count())))
+                        .append(_XPLATSTR(" ms")));
+
+                    {
+                        std::lock_guard<std::mutex> ranking_lock(ranking->lock);
+                        ranking->endpoints.push_back(endpoint);
+                    }
+
+                    if (!race->completed)
+                    {
+                        race->completed = true;
+                        race->winner.set(result);
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    logger.log(trace_level::info, utility::string_t(_XPLATSTR("negotiating with "))
+                        .append(url.to_string())
+                        .append(_XPLATSTR(" failed due to: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+
+                    race->last_error = std::current_exception();
+                }
+
+                if (race->pending == 0 && !race->completed)
+                {
+                    race->completed = true;
+                    race->winner.set_exception(race->last_error);
+                }
+            });
+        }
+
+        return pplx::create_task(race->winner);
+    }
+
+    pplx::task<std::shared_ptr<transport>> connection_impl::start_transport(const negotiation_result& negotiation_result)
+    {
+        // TODO: fallback logic
+
+        if (!supports_websockets(negotiation_result.response))
+        {
+            return pplx::task_from_exception<std::shared_ptr<transport>>(signalr_exception(_XPLATSTR("The server does not support WebSockets which is currently the only transport supported by this client.")));
+        }
+
+        // TODO: use transfer format
+
+        // the connection token is only returned by newer servers and must be used instead of the id if present
+        const auto& response = negotiation_result.response;
+        return start_transport(negotiation_result.url, negotiation_result.client_config,
+            response.connectionToken.empty() ? response.connectionId : response.connectionToken);
+    }
+
+    void connection_impl::use_negotiation_result(const negotiation_result& negotiation_result)
+    {
+        if (!negotiation_result.access_token.empty())
+        {
+            // the config the access token was negotiated with already has the authorization header
+            m_signalr_client_config = negotiation_result.client_config;
+        }
+
+        m_current_endpoint = negotiation_result.endpoint;
+        m_connection_id = negotiation_result.response.connectionId;
+        m_connection_token = negotiation_result.response.connectionToken;
+        m_transport_url = negotiation_result.url;
+
+        if (m_signalr_client_config.get_stateful_reconnect())
+        {
+            m_stateful_reconnect = negotiation_result.response.useStatefulReconnect;
+            if (!negotiation_result.response.useStatefulReconnect)
+            {
+                m_logger.log(trace_level::info,
+                    _XPLATSTR("the server does not support stateful reconnect. messages will not be replayed if the transport disconnects."));
+            }
+        }
+    }
+
+    pplx::task<std::shared_ptr<transport>> connection_impl::start_transport(const web::uri& url, const signalr_client_config& client_config,
+        const utility::string_t& connection_token)
     {
         auto connection = shared_from_this();
 
@@ -223,6 +448,7 @@ namespace signalr
         auto weak_connection = std::weak_ptr<connection_impl>(connection);
         const auto& disconnect_cts = m_disconnect_cts;
         const auto& logger = m_logger;
+        const auto transport_generation = ++m_transport_generation;
 
         auto process_response_callback =
             [weak_connection, disconnect_cts, logger](const utility::string_t& response) mutable
@@ -246,9 +472,28 @@ namespace signalr
                 }
             };
 
+        auto process_raw_response_callback =
+            [weak_connection, disconnect_cts, logger](const uint8_t* data, size_t length)
+            {
+                // see process_response_callback
+                if (disconnect_cts.get_token().is_canceled())
+                {
+                    logger.log(trace_level::info,
+                        utility::string_t{ _XPLATSTR("ignoring stray message received after connection was restarted. message: " })
+                        .append(utility::conversions::to_string_t(std::string(data, data + length))));
+                    return;
+                }
+
+                auto connection = weak_connection.lock();
+                if (connection)
+                {
+                    connection->process_response(data, length);
+                }
+            };
+
 
         auto error_callback =
-            [weak_connection, connect_request_tce, disconnect_cts, logger](const std::exception &e) mutable
+            [weak_connection, connect_request_tce, disconnect_cts, logger, transport_generation](const std::exception &e) mutable
             {
                 // When a connection is stopped we don't wait for its transport to stop. As a result if the same connection
                 // is immediately re-started the old transport can still invoke this callback. To prevent this we capture
@@ -265,11 +510,18 @@ namespace signalr
 
                 // no op after connection started successfully
                 connect_request_tce.set_exception(e);
+
+                auto connection = weak_connection.lock();
+                if (connection)
+                {
+                    connection->handle_transport_error(transport_generation, e);
+                }
             };
 
         auto transport = connection->m_transport_factory->create_transport(
-            transport_type::websockets, connection->m_logger, connection->m_signalr_client_config,
+            transport_type::websockets, connection->m_logger, client_config,
             process_response_callback, error_callback);
+        transport->set_process_raw_response_callback(process_raw_response_callback);
 
         pplx::create_task([connect_request_tce, disconnect_cts, weak_connection]()
         {
@@ -290,14 +542,15 @@ namespace signalr
             }
         });
 
-        return connection->send_connect_request(transport, url, connect_request_tce)
+        return connection->send_connect_request(transport, url, connection_token, connect_request_tce)
             .then([transport](){ return pplx::task_from_result(transport); });
     }
 
-    pplx::task<void> connection_impl::send_connect_request(const std::shared_ptr<transport>& transport, const web::uri& url, const pplx::task_completion_event<void>& connect_request_tce)
+    pplx::task<void> connection_impl::send_connect_request(const std::shared_ptr<transport>& transport, const web::uri& url,
+        const utility::string_t& connection_token, const pplx::task_completion_event<void>& connect_request_tce)
     {
         auto logger = m_logger;
-        auto query_string = _XPLATSTR("id=" + m_connection_id);
+        auto query_string = _XPLATSTR("id=") + connection_token;
         auto connect_url = url_builder::build_connect(url, transport->get_transport_type(), query_string);
 
         transport->connect(connect_url)
@@ -330,6 +583,302 @@ namespace signalr
         invoke_message_received(response);
     }
 
+    // messages are only converted to strings if there is no raw message received callback
+    void connection_impl::process_response(const uint8_t* data, size_t length)
+    {
+        if (!m_raw_message_received)
+        {
+            process_response(utility::conversions::to_string_t(std::string(data, data + length)));
+            return;
+        }
+
+        if (m_logger.is_enabled(trace_level::messages))
+        {
+            m_logger.log(trace_level::messages,
+                utility::string_t(_XPLATSTR("processing message: ")).append(utility::conversions::to_string_t(std::string(data, data + length))));
+        }
+
+        invoke_raw_message_received(data, length);
+    }
+
+    // Errors reported by a transport after the connection has started mean that the transport lost the connection
+    // to the server. If stateful reconnect was negotiated the server keeps the connection for a while so a new
+    // transport can be connected to pick up where the lost one left off. Otherwise, if multiple endpoints were
+    // configured, the connection fails over to another endpoint. Errors from transports that are no longer
+    // current are ignored.
+    void connection_impl::handle_transport_error(int transport_generation, const std::exception& e)
+    {
+        if ((!m_stateful_reconnect && m_base_urls.size() == 1) || transport_generation != m_transport_generation ||
+            get_connection_state() != connection_state::connected || m_disconnect_cts.get_token().is_canceled())
+        {
+            return;
+        }
+
+        if (m_reconnecting.exchange(true))
+        {
+            return;
+        }
+
+        m_logger.log(trace_level::info, utility::string_t(_XPLATSTR("transport disconnected due to: "))
+            .append(utility::conversions::to_string_t(e.what())));
+
+        if (m_stateful_reconnect)
+        {
+            m_logger.log(trace_level::info, _XPLATSTR("reconnecting the transport"));
+            reconnect_transport();
+        }
+        else
+        {
+            fail_over();
+        }
+    }
+
+    void connection_impl::reconnect_transport()
+    {
+        auto weak_connection = std::weak_ptr<connection_impl>(shared_from_this());
+
+        web::uri transport_url;
+        signalr_client_config client_config;
+        utility::string_t connection_token;
+        {
+            std::lock_guard<std::mutex> lock(m_stop_lock);
+            transport_url = m_transport_url;
+            client_config = m_signalr_client_config;
+            // the connection token is only returned by newer servers and must be used instead of the id if present
+            connection_token = m_connection_token.empty() ? m_connection_id : m_connection_token;
+        }
+
+        start_transport(transport_url, client_config, connection_token)
+            .then([weak_connection](pplx::task<std::shared_ptr<transport>> start_transport_task)
+            {
+                auto connection = weak_connection.lock();
+                if (!connection)
+                {
+                    return;
+                }
+
+                std::shared_ptr<transport> transport;
+                try
+                {
+                    transport = start_transport_task.get();
+                }
+                catch (const std::exception& e)
+                {
+                    connection->m_logger.log(trace_level::errors,
+                        utility::string_t(_XPLATSTR("transport could not be reconnected due to: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+
+                    connection->fail_over();
+                    return;
+                }
+
+                auto reconnected = false;
+                {
+                    // the lock prevents from swapping the transport while the connection is being stopped
+                    std::lock_guard<std::mutex> lock(connection->m_stop_lock);
+                    if (connection->get_connection_state() == connection_state::connected &&
+                        !connection->m_disconnect_cts.get_token().is_canceled())
+                    {
+                        std::atomic_store(&connection->m_transport, transport);
+                        reconnected = true;
+                    }
+
+                    connection->m_reconnecting = false;
+                }
+
+                if (!reconnected)
+                {
+                    transport->disconnect();
+                    return;
+                }
+
+                connection->m_logger.log(trace_level::info, _XPLATSTR("transport reconnected"));
+
+                try
+                {
+                    connection->m_reconnected();
+                }
+                catch (const std::exception &e)
+                {
+                    connection->m_logger.log(
+                        trace_level::errors,
+                        utility::string_t(_XPLATSTR("reconnected callback threw an exception: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+                }
+                catch (...)
+                {
+                    connection->m_logger.log(
+                        trace_level::errors,
+                        utility::string_t(_XPLATSTR("reconnected callback threw an unknown exception")));
+                }
+            });
+    }
+
+    // Fails over to the other endpoints, trying the ones that answered the negotiate request fastest when the
+    // connection was started first. Only the endpoint being failed over to is negotiated with.
+    void connection_impl::fail_over()
+    {
+        const size_t current_endpoint = m_current_endpoint;
+        auto endpoints = std::make_shared<std::vector<size_t>>();
+
+        {
+            auto ranking = std::atomic_load(&m_endpoint_ranking);
+            std::lock_guard<std::mutex> lock(ranking->lock);
+            for (auto endpoint : ranking->endpoints)
+            {
+                if (endpoint != current_endpoint)
+                {
+                    endpoints->push_back(endpoint);
+                }
+            }
+        }
+
+        for (size_t endpoint = 0; endpoint < m_base_urls.size(); ++endpoint)
+        {
+            if (endpoint != current_endpoint && std::find(endpoints->begin(), endpoints->end(), endpoint) == endpoints->end())
+            {
+                endpoints->push_back(endpoint);
+            }
+        }
+
+        fail_over(endpoints, 0);
+    }
+
+    void connection_impl::fail_over(const std::shared_ptr<std::vector<size_t>>& endpoints, size_t index)
+    {
+        if (index >= endpoints->size() || m_disconnect_cts.get_token().is_canceled())
+        {
+            m_reconnecting = false;
+            handle_connection_lost();
+            return;
+        }
+
+        const auto endpoint = (*endpoints)[index];
+        m_logger.log(trace_level::info, utility::string_t(_XPLATSTR("failing over to: ")).append(m_base_urls[endpoint].to_string()));
+
+        auto weak_connection = std::weak_ptr<connection_impl>(shared_from_this());
+        // the connection keeps using the ids and config of the current endpoint until the transport is swapped
+        auto negotiated = std::make_shared<negotiation_result>();
+
+        negotiate(m_base_urls[endpoint], 0, _XPLATSTR(""))
+            .then([weak_connection, endpoint, negotiated](negotiation_result negotiation_result)
+            {
+                auto connection = weak_connection.lock();
+                if (!connection)
+                {
+                    return pplx::task_from_exception<std::shared_ptr<transport>>(_XPLATSTR("connection no longer exists"));
+                }
+
+                negotiation_result.endpoint = endpoint;
+                *negotiated = std::move(negotiation_result);
+                return connection->start_transport(*negotiated);
+            })
+            .then([weak_connection, endpoints, index, negotiated](pplx::task<std::shared_ptr<transport>> start_transport_task)
+            {
+                auto connection = weak_connection.lock();
+                if (!connection)
+                {
+                    return;
+                }
+
+                std::shared_ptr<transport> transport;
+                try
+                {
+                    transport = start_transport_task.get();
+                }
+                catch (const std::exception& e)
+                {
+                    connection->m_logger.log(trace_level::errors,
+                        utility::string_t(_XPLATSTR("failing over to "))
+                        .append(connection->m_base_urls[(*endpoints)[index]].to_string())
+                        .append(_XPLATSTR(" failed due to: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+
+                    connection->fail_over(endpoints, index + 1);
+                    return;
+                }
+                catch (...)
+                {
+                    connection->fail_over(endpoints, index + 1);
+                    return;
+                }
+
+                auto failed_over = false;
+                {
+                    std::lock_guard<std::mutex> lock(connection->m_stop_lock);
+                    if (connection->get_connection_state() == connection_state::connected &&
+                        !connection->m_disconnect_cts.get_token().is_canceled())
+                    {
+                        connection->use_negotiation_result(*negotiated);
+                        std::atomic_store(&connection->m_transport, transport);
+                        failed_over = true;
+                    }
+
+                    connection->m_reconnecting = false;
+                }
+
+                if (!failed_over)
+                {
+                    transport->disconnect();
+                    return;
+                }
+
+                connection->m_logger.log(trace_level::info, utility::string_t(_XPLATSTR("failed over to: "))
+                    .append(connection->get_endpoint_url()));
+
+                try
+                {
+                    connection->m_failed_over();
+                }
+                catch (const std::exception &e)
+                {
+                    connection->m_logger.log(
+                        trace_level::errors,
+                        utility::string_t(_XPLATSTR("failed over callback threw an exception: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+                }
+                catch (...)
+                {
+                    connection->m_logger.log(
+                        trace_level::errors,
+                        utility::string_t(_XPLATSTR("failed over callback threw an unknown exception")));
+                }
+            });
+    }
+
+    void connection_impl::handle_connection_lost()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_stop_lock);
+            if (!change_state(connection_state::connected, connection_state::disconnected))
+            {
+                // the connection is being stopped and the `stop` will take care of the clean up
+                return;
+            }
+
+            m_disconnect_cts.cancel();
+            std::atomic_store(&m_transport, std::shared_ptr<transport>());
+        }
+
+        try
+        {
+            m_disconnected();
+        }
+        catch (const std::exception &e)
+        {
+            m_logger.log(
+                trace_level::errors,
+                utility::string_t(_XPLATSTR("disconnected callback threw an exception: "))
+                .append(utility::conversions::to_string_t(e.what())));
+        }
+        catch (...)
+        {
+            m_logger.log(
+                trace_level::errors,
+                utility::string_t(_XPLATSTR("disconnected callback threw an unknown exception")));
+        }
+    }
+
     void connection_impl::invoke_message_received(const utility::string_t& message)
     {
         try
@@ -349,42 +898,108 @@ namespace signalr
         }
     }
 
-    pplx::task<void> connection_impl::send(const utility::string_t& data)
+    void connection_impl::invoke_raw_message_received(const uint8_t* data, size_t length)
+    {
+        try
+        {
+            m_raw_message_received(data, length);
+        }
+        catch (const std::exception &e)
+        {
+            m_logger.log(
+                trace_level::errors,
+                utility::string_t(_XPLATSTR("message_received callback threw an exception: "))
+                .append(utility::conversions::to_string_t(e.what())));
+        }
+        catch (...)
+        {
+            m_logger.log(trace_level::errors, _XPLATSTR("message_received callback threw an unknown exception"));
+        }
+    }
+
+    connect_timings connection_impl::get_connect_timings() const
+    {
+        std::lock_guard<std::mutex> lock(m_connect_timings_lock);
+        return m_connect_timings;
+    }
+
+    void connection_impl::record_connect_phase(connect_phase phase, std::chrono::steady_clock::time_point started)
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(m_connect_timings_lock);
+        m_connect_timings.phases[static_cast<size_t>(phase)] = now - started;
+        m_connect_timings.total = now - m_connect_started;
+    }
+
+    // negotiating began when the connection was started
+    void connection_impl::record_negotiate_timings(const negotiation_result& negotiation_result)
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(m_connect_timings_lock);
+        m_connect_timings.phases[static_cast<size_t>(connect_phase::negotiate)] = negotiation_result.first_response - m_connect_started;
+        m_connect_timings.phases[static_cast<size_t>(connect_phase::redirects)] = negotiation_result.redirect_count > 0
+            ? now - negotiation_result.first_response
+            : std::chrono::steady_clock::duration(0);
+        m_connect_timings.redirect_count = negotiation_result.redirect_count;
+        m_connect_timings.total = now - m_connect_started;
+    }
+
+    // returns nullptr and sets the error if the connection is not connected
+    std::shared_ptr<transport> connection_impl::get_transport_for_send(pplx::task<void>& error) const
     {
         // To prevent an (unlikely) condition where the transport is nulled out after we checked the connection_state
         // and before sending data we store the pointer in the local variable. In this case `send()` will throw but
         // we won't crash.
-        auto transport = m_transport;
+        auto transport = std::atomic_load(&m_transport);
 
         const auto connection_state = get_connection_state();
         if (connection_state != signalr::connection_state::connected || !transport)
         {
-            return pplx::task_from_exception<void>(signalr_exception(
+            error = pplx::task_from_exception<void>(signalr_exception(
                 utility::string_t(_XPLATSTR("cannot send data when the connection is not in the connected state. current connection state: "))
                     .append(translate_connection_state(connection_state))));
+            return nullptr;
+        }
+
+        return transport;
+    }
+
+    pplx::task<void> connection_impl::send(const utility::string_t& data)
+    {
+        pplx::task<void> error;
+        auto transport = get_transport_for_send(error);
+        if (!transport)
+        {
+            return error;
         }
 
         auto logger = m_logger;
 
         logger.log(trace_level::info, utility::string_t(_XPLATSTR("sending data: ")).append(data));
 
-        return transport->send(data)
-            .then([logger](pplx::task<void> send_task)
-            mutable {
-                try
-                {
-                    send_task.get();
-                }
-                catch (const std::exception &e)
-                {
-                    logger.log(
-                        trace_level::errors,
-                        utility::string_t(_XPLATSTR("error sending data: "))
-                        .append(utility::conversions::to_string_t(e.what())));
+        return log_send_errors(transport->send(data), logger);
+    }
 
-                    throw;
-                }
-            });
+    pplx::task<void> connection_impl::send(std::vector<uint8_t>&& data)
+    {
+        pplx::task<void> error;
+        auto transport = get_transport_for_send(error);
+        if (!transport)
+        {
+            return error;
+        }
+
+        auto logger = m_logger;
+
+        if (logger.is_enabled(trace_level::info))
+        {
+            logger.log(trace_level::info, utility::string_t(_XPLATSTR("sending data: "))
+                .append(utility::conversions::to_string_t(std::string(data.begin(), data.end()))));
+        }
+
+        return log_send_errors(transport->send(std::move(data)), logger);
     }
 
     pplx::task<void> connection_impl::stop()
@@ -403,7 +1018,7 @@ namespace signalr
                     if (connection->change_state(connection_state::disconnecting, connection_state::disconnected))
                     {
                         // we do let the exception through (especially the task_canceled exception)
-                        connection->m_transport = nullptr;
+                        std::atomic_store(&connection->m_transport, std::shared_ptr<transport>());
                     }
                 }
 
@@ -427,9 +1042,12 @@ namespace signalr
             });
     }
 
-    // This function is called from the dtor so you must not use `shared_from_this` here (it will throw).
+    // Cancels the ongoing start (if any) and disconnects the transport once the start has completed. Waiting for the
+    // start is a continuation so stopping never blocks the calling thread.
     pplx::task<void> connection_impl::shutdown()
     {
+        pplx::task_completion_event<void> start_completed_tce;
+
         {
             std::lock_guard<std::mutex> lock(m_stop_lock);
             m_logger.log(trace_level::info, _XPLATSTR("acquired lock in shutdown()"));
@@ -450,28 +1068,50 @@ namespace signalr
                 return pplx::create_task([]() noexcept {}, cts.get_token());
             }
 
-            // we request a cancellation of the ongoing start (if any) and wait until it is canceled
+            // we request a cancellation of the ongoing start (if any) and continue once it was canceled
             m_disconnect_cts.cancel();
+            start_completed_tce = m_start_completed_tce;
+        }
 
-            while (m_start_completed_event.wait(60000) != 0)
-            {
-                m_logger.log(trace_level::errors,
-                    _XPLATSTR("internal error - stopping the connection is still waiting for the start operation to finish which should have already finished or timed out"));
-            }
+        auto weak_connection = std::weak_ptr<connection_impl>(shared_from_this());
 
-            // at this point we are either in the connected or disconnected state. If we are in the disconnected state
-            // we must break because the transport has already been nulled out.
-            if (m_connection_state == connection_state::disconnected)
+        return pplx::create_task(start_completed_tce)
+            .then([weak_connection]()
             {
-                return pplx::task_from_result();
-            }
+                auto connection = weak_connection.lock();
+                if (!connection)
+                {
+                    // the dtor closes the transport
+                    return pplx::task_from_result();
+                }
 
-            _ASSERTE(m_connection_state == connection_state::connected);
+                std::shared_ptr<transport> transport;
 
-            change_state(connection_state::disconnecting);
-        }
+                {
+                    std::lock_guard<std::mutex> lock(connection->m_stop_lock);
+
+                    // at this point the start has completed. If we are in the disconnected state we must break because
+                    // the transport has already been nulled out.
+                    const auto current_state = connection->get_connection_state();
+                    if (current_state == connection_state::disconnecting)
+                    {
+                        // another `stop` which was waiting for the same start is already disconnecting
+                        auto cts = pplx::cancellation_token_source();
+                        cts.cancel();
+                        return pplx::create_task([]() noexcept {}, cts.get_token());
+                    }
+
+                    if (current_state != connection_state::connected)
+                    {
+                        return pplx::task_from_result();
+                    }
+
+                    connection->change_state(connection_state::disconnecting);
+                    transport = std::atomic_load(&connection->m_transport);
+                }
 
-        return m_transport->disconnect();
+                return transport->disconnect();
+            });
     }
 
     connection_state connection_impl::get_connection_state() const noexcept
@@ -486,6 +1126,7 @@ namespace signalr
             return _XPLATSTR("");
         }
 
+        std::lock_guard<std::mutex> lock(m_stop_lock);
         return m_connection_id;
     }
 
@@ -495,25 +1136,62 @@ namespace signalr
         m_message_received = message_received;
     }
 
+    void connection_impl::set_raw_message_received(const std::function<void(const uint8_t*, size_t)>& raw_message_received)
+    {
+        ensure_disconnected(_XPLATSTR("cannot set the callback when the connection is not in the disconnected state. "));
+        m_raw_message_received = raw_message_received;
+    }
+
+    void connection_impl::set_reconnected(const std::function<void()>& reconnected)
+    {
+        ensure_disconnected(_XPLATSTR("cannot set the reconnected callback when the connection is not in the disconnected state. "));
+        m_reconnected = reconnected;
+    }
+
+    void connection_impl::set_failed_over(const std::function<void()>& failed_over)
+    {
+        ensure_disconnected(_XPLATSTR("cannot set the failed over callback when the connection is not in the disconnected state. "));
+        m_failed_over = failed_over;
+    }
+
+    bool connection_impl::is_stateful_reconnect_enabled() const noexcept
+    {
+        return m_stateful_reconnect;
+    }
+
+    // the base url of the endpoint the connection is using or was last using
+    utility::string_t connection_impl::get_endpoint_url() const
+    {
+        return m_base_urls[m_current_endpoint].to_string();
+    }
+
     void connection_impl::set_client_config(const signalr_client_config& config)
     {
+        std::lock_guard<std::mutex> lock(m_stop_lock);
         ensure_disconnected(_XPLATSTR("cannot set client config when the connection is not in the disconnected state. "));
         m_signalr_client_config = config;
     }
 
+    signalr_client_config connection_impl::get_client_config() const
+    {
+        std::lock_guard<std::mutex> lock(m_stop_lock);
+        return m_signalr_client_config;
+    }
+
     void connection_impl::set_disconnected(const std::function<void()>& disconnected)
     {
         ensure_disconnected(_XPLATSTR("cannot set the disconnected callback when the connection is not in the disconnected state. "));
         m_disconnected = disconnected;
     }
 
-    void connection_impl::ensure_disconnected(const utility::string_t& error_message)
+    // takes the message as a literal so that the message is only allocated when the check fails
+    void connection_impl::ensure_disconnected(const utility::char_t* error_message)
     {
         const auto state = get_connection_state();
         if (state != connection_state::disconnected)
         {
-            throw signalr_exception(
-                error_message + _XPLATSTR("current connection state: ") + translate_connection_state(state));
+            throw signalr_exception(utility::string_t(error_message)
+                .append(_XPLATSTR("current connection state: ")).append(translate_connection_state(state)));
         }
     }
 
@@ -570,4 +1248,29 @@ namespace signalr
             return _XPLATSTR("(unknown)");
         }
     }
+
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        static bool supports_websockets(const negotiation_response& negotiation_response)
+        {
+            for (const auto& available_transport : negotiation_response.availableTransports)
+            {
+                if (available_transport.transport == _XPLATSTR("WebSockets"))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        static signalr_client_config with_access_token(signalr_client_config signalr_client_config, const utility::string_t& access_token)
+        {
+            auto headers = signalr_client_config.get_http_headers();
+            headers[_XPLATSTR("Authorization")] = _XPLATSTR("Bearer ") + access_token;
+            signalr_client_config.set_http_headers(headers);
+            return signalr_client_config;
+        }
+    }
 }
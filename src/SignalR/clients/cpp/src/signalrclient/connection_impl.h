@@ -5,10 +5,12 @@
 
 #include <atomic>
 #include <mutex>
+#include <vector>
 #include "cpprest/http_client.h"
 #include "signalrclient/trace_level.h"
 #include "signalrclient/connection_state.h"
 #include "signalrclient/signalr_client_config.h"
+#include "signalrclient/connect_timings.h"
 #include "web_request_factory.h"
 #include "transport_factory.h"
 #include "logger.h"
@@ -30,6 +32,13 @@ namespace signalr
         static std::shared_ptr<connection_impl> create(const utility::string_t& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
             std::unique_ptr<web_request_factory> web_request_factory, std::unique_ptr<transport_factory> transport_factory);
 
+        static std::shared_ptr<connection_impl> create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+            const std::shared_ptr<log_writer>& log_writer);
+
+        static std::shared_ptr<connection_impl> create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+            const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
+            std::unique_ptr<transport_factory> transport_factory);
+
         connection_impl(const connection_impl&) = delete;
 
         connection_impl& operator=(const connection_impl&) = delete;
@@ -38,44 +47,110 @@ namespace signalr
 
         pplx::task<void> start();
         pplx::task<void> send(const utility::string_t &data);
+        pplx::task<void> send(std::vector<uint8_t>&& data);
         pplx::task<void> stop();
 
         connection_state get_connection_state() const noexcept;
         utility::string_t get_connection_id() const;
 
         void set_message_received(const std::function<void(const utility::string_t&)>& message_received);
+        void set_raw_message_received(const std::function<void(const uint8_t*, size_t)>& raw_message_received);
         void set_disconnected(const std::function<void()>& disconnected);
+        void set_reconnected(const std::function<void()>& reconnected);
+        void set_failed_over(const std::function<void()>& failed_over);
         void set_client_config(const signalr_client_config& config);
 
+        bool is_stateful_reconnect_enabled() const noexcept;
+        utility::string_t get_endpoint_url() const;
+
+        connect_timings get_connect_timings() const;
+        // records that the phase, which began at `started`, just completed
+        void record_connect_phase(connect_phase phase, std::chrono::steady_clock::time_point started);
+
     private:
-        web::uri m_base_url;
+        // the result of negotiating with one of the endpoints, after following redirects
+        struct negotiation_result
+        {
+            size_t endpoint;
+            web::uri url;
+            negotiation_response response;
+            utility::string_t access_token;
+            // the client config with the access token used to negotiate
+            signalr_client_config client_config;
+            // when the first negotiate response was received and how many redirects were followed after it
+            std::chrono::steady_clock::time_point first_response;
+            int redirect_count;
+        };
+
+        // endpoints in the order in which they answered the negotiate requests sent when the connection was started
+        struct endpoint_ranking
+        {
+            std::mutex lock;
+            std::vector<size_t> endpoints;
+        };
+
+        std::vector<web::uri> m_base_urls;
         std::atomic<connection_state> m_connection_state;
         logger m_logger;
+        // replaced by reconnects and fail overs while the connection is connected so it is only accessed with
+        // std::atomic_load and std::atomic_store
         std::shared_ptr<transport> m_transport;
         std::unique_ptr<web_request_factory> m_web_request_factory;
         std::unique_ptr<transport_factory> m_transport_factory;
 
         std::function<void(const utility::string_t&)> m_message_received;
+        std::function<void(const uint8_t*, size_t)> m_raw_message_received;
         std::function<void()> m_disconnected;
+        std::function<void()> m_reconnected;
+        std::function<void()> m_failed_over;
         signalr_client_config m_signalr_client_config;
 
         pplx::cancellation_token_source m_disconnect_cts;
-        std::mutex m_stop_lock;
-        event m_start_completed_event;
+        mutable std::mutex m_stop_lock;
+        pplx::task_completion_event<void> m_start_completed_tce;
         utility::string_t m_connection_id;
+        utility::string_t m_connection_token;
+        web::uri m_transport_url;
+        std::atomic<bool> m_stateful_reconnect;
+        std::atomic<bool> m_reconnecting;
+        std::atomic<int> m_transport_generation;
+        std::atomic<size_t> m_current_endpoint;
+        std::shared_ptr<endpoint_ranking> m_endpoint_ranking;
         utility::string_t m_connection_data;
         utility::string_t m_message_id;
         utility::string_t m_groups_token;
 
-        connection_impl(const utility::string_t& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
+        // the timings of the last start measured from when it began
+        mutable std::mutex m_connect_timings_lock;
+        connect_timings m_connect_timings;
+        std::chrono::steady_clock::time_point m_connect_started;
+
+        connection_impl(const std::vector<utility::string_t>& urls, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
             std::unique_ptr<web_request_factory> web_request_factory, std::unique_ptr<transport_factory> transport_factory);
 
-        pplx::task<std::shared_ptr<transport>> start_transport(const web::uri& url);
-        pplx::task<void> send_connect_request(const std::shared_ptr<transport>& transport,
-            const web::uri& url, const pplx::task_completion_event<void>& connect_request_tce);
-        pplx::task<void> start_negotiate(const web::uri& url, int redirect_count);
+        pplx::task<std::shared_ptr<transport>> start_transport(const web::uri& url, const signalr_client_config& client_config,
+            const utility::string_t& connection_token);
+        pplx::task<std::shared_ptr<transport>> start_transport(const negotiation_result& negotiation_result);
+        pplx::task<void> send_connect_request(const std::shared_ptr<transport>& transport, const web::uri& url,
+            const utility::string_t& connection_token, const pplx::task_completion_event<void>& connect_request_tce);
+        pplx::task<void> start_negotiate();
+        pplx::task<negotiation_result> negotiate(const web::uri& url, int redirect_count, const utility::string_t& access_token);
+        pplx::task<negotiation_result> negotiate_endpoints();
+
+        void record_negotiate_timings(const negotiation_result& negotiation_result);
+        // makes the endpoint, ids and config of the negotiation the transport in use was started with the ones of
+        // the connection. Once the connection is connected they are read by other threads so the caller must hold
+        // m_stop_lock
+        void use_negotiation_result(const negotiation_result& negotiation_result);
+        signalr_client_config get_client_config() const;
 
         void process_response(const utility::string_t& response);
+        void process_response(const uint8_t* data, size_t length);
+        void handle_transport_error(int transport_generation, const std::exception& e);
+        void reconnect_transport();
+        void fail_over();
+        void fail_over(const std::shared_ptr<std::vector<size_t>>& endpoints, size_t index);
+        void handle_connection_lost();
 
         pplx::task<void> shutdown();
 
@@ -83,8 +158,10 @@ namespace signalr
         connection_state change_state(connection_state new_state);
         void handle_connection_state_change(connection_state old_state, connection_state new_state);
         void invoke_message_received(const utility::string_t& message);
+        void invoke_raw_message_received(const uint8_t* data, size_t length);
+        std::shared_ptr<transport> get_transport_for_send(pplx::task<void>& error) const;
 
         static utility::string_t translate_connection_state(connection_state state);
-        void ensure_disconnected(const utility::string_t& error_message);
+        void ensure_disconnected(const utility::char_t* error_message);
     };
 }
@@ -3,26 +3,36 @@
 
 #include "stdafx.h"
 #include "default_websocket_client.h"
+#include "tls_session_cache.h"
+#include "cpprest/rawptrstream.h"
 
 namespace signalr
 {
     namespace
     {
-        static web::websockets::client::websocket_client_config create_client_config(const signalr_client_config& signalr_client_config) noexcept
+        static web::websockets::client::websocket_client_config create_client_config(const signalr_client_config& signalr_client_config, const web::uri& url)
         {
             auto websocket_client_config = signalr_client_config.get_websocket_client_config();
             websocket_client_config.headers() = signalr_client_config.get_http_headers();
 
+            if (signalr_client_config.get_tls_session_resumption())
+            {
+                websocket_client_config = tls_session_cache::get_default()->attach(websocket_client_config, url,
+                    tls_session_cache::get_config_id(signalr_client_config));
+            }
+
             return websocket_client_config;
         }
     }
 
     default_websocket_client::default_websocket_client(const signalr_client_config& signalr_client_config) noexcept
-        : m_underlying_client(create_client_config(signalr_client_config))
+        : m_signalr_client_config(signalr_client_config)
     { }
 
+    // the client is created when connecting since the sessions it resumes are cached by the origin of the url
     pplx::task<void> default_websocket_client::connect(const web::uri &url)
     {
+        m_underlying_client = web::websockets::client::websocket_client(create_client_config(m_signalr_client_config, url));
         return m_underlying_client.connect(url);
     }
 
@@ -33,6 +43,24 @@ namespace signalr
         return m_underlying_client.send(msg);
     }
 
+    pplx::task<void> default_websocket_client::send(const uint8_t* data, size_t length, websocket_message_type message_type)
+    {
+        // the message reads the bytes from the caller's buffer while it is being sent
+        concurrency::streams::rawptr_buffer<uint8_t> buffer(data, length, std::ios::in);
+
+        web::websockets::client::websocket_outgoing_message msg;
+        if (message_type == websocket_message_type::binary)
+        {
+            msg.set_binary_message(buffer.create_istream(), length);
+        }
+        else
+        {
+            msg.set_utf8_message(buffer.create_istream(), length);
+        }
+
+        return m_underlying_client.send(msg);
+    }
+
     pplx::task<std::string> default_websocket_client::receive()
     {
         // the caller is responsible for observing exceptions
@@ -43,6 +71,57 @@ namespace signalr
             });
     }
 
+    pplx::task<websocket_message_type> default_websocket_client::receive(std::vector<uint8_t>& buffer)
+    {
+        auto destination = &buffer;
+
+        // the caller is responsible for observing exceptions
+        return m_underlying_client.receive()
+            .then([destination](web::websockets::client::websocket_incoming_message msg)
+            {
+                const auto message_type = msg.message_type() == web::websockets::client::websocket_message_type::binary_message
+                    ? websocket_message_type::binary
+                    : websocket_message_type::text;
+
+                // see the callback based receive
+                destination->resize(msg.length());
+                destination->resize(msg.body().streambuf().scopy(destination->data(), destination->size()));
+                return message_type;
+            });
+    }
+
+    // The body of a message cpprest hands out is already complete so it is copied into the buffer without the task
+    // `getn` would create. The task of the underlying receive and its continuation are the only allocations left.
+    void default_websocket_client::receive(std::vector<uint8_t>& buffer,
+        const std::function<void(websocket_message_type, std::exception_ptr)>& received)
+    {
+        auto destination = &buffer;
+        auto handler = &received;
+
+        m_underlying_client.receive()
+            .then([destination, handler](pplx::task<web::websockets::client::websocket_incoming_message> receive_task)
+            {
+                websocket_message_type message_type;
+                try
+                {
+                    auto msg = receive_task.get();
+                    message_type = msg.message_type() == web::websockets::client::websocket_message_type::binary_message
+                        ? websocket_message_type::binary
+                        : websocket_message_type::text;
+
+                    destination->resize(msg.length());
+                    destination->resize(msg.body().streambuf().scopy(destination->data(), destination->size()));
+                }
+                catch (...)
+                {
+                    (*handler)(websocket_message_type::text, std::current_exception());
+                    return;
+                }
+
+                (*handler)(message_type, nullptr);
+            });
+    }
+
     pplx::task<void> default_websocket_client::close()
     {
         return m_underlying_client.close();
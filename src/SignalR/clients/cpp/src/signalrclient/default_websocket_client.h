@@ -18,11 +18,19 @@ namespace signalr
 
         pplx::task<void> send(const utility::string_t &message) override;
 
+        pplx::task<void> send(const uint8_t* data, size_t length, websocket_message_type message_type) override;
+
         pplx::task<std::string> receive() override;
 
+        pplx::task<websocket_message_type> receive(std::vector<uint8_t>& buffer) override;
+
+        void receive(std::vector<uint8_t>& buffer,
+            const std::function<void(websocket_message_type, std::exception_ptr)>& received) override;
+
         pplx::task<void> close() override;
 
     private:
+        signalr_client_config m_signalr_client_config;
         web::websockets::client::websocket_client m_underlying_client;
     };
 }
@@ -0,0 +1,521 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "durable_outbox.h"
+#include "signalrclient/signalr_exception.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        const char segment_magic[] = { 'S', 'R', 'O', 'B' };
+        const uint32_t segment_version = 1;
+
+        // magic number, version and the offset of the oldest message that was not consumed
+        const size_t version_offset = 4;
+        const size_t read_offset_offset = 8;
+        const size_t segment_header_size = 16;
+
+        // records are aligned to their headers so that a header is written with a single store
+        typedef uint32_t record_header;
+        const record_header record_written = 0x80000000;
+        const record_header record_length_mask = 0x7fffffff;
+
+        const utility::char_t segment_prefix[] = _XPLATSTR("outbox-");
+        const utility::char_t segment_suffix[] = _XPLATSTR(".seg");
+
+        size_t record_size(size_t length)
+        {
+            return (sizeof(record_header) + length + sizeof(record_header) - 1) & ~(sizeof(record_header) - 1);
+        }
+
+        utility::string_t segment_error(const utility::string_t& message, const utility::string_t& path)
+        {
+            return utility::string_t(message).append(path);
+        }
+
+        bool ends_with(const utility::string_t& value, const utility::string_t& suffix)
+        {
+            return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+
+#ifdef _WIN32
+        void create_directory(const utility::string_t& directory)
+        {
+            if (!CreateDirectoryW(directory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+            {
+                throw signalr_exception(segment_error(_XPLATSTR("could not create the outbox directory: "), directory));
+            }
+        }
+
+        std::vector<utility::string_t> list_files(const utility::string_t& directory)
+        {
+            std::vector<utility::string_t> files;
+
+            WIN32_FIND_DATAW find_data;
+            const auto find_handle = FindFirstFileW(utility::string_t(directory).append(_XPLATSTR("/*")).c_str(), &find_data);
+            if (find_handle == INVALID_HANDLE_VALUE)
+            {
+                return files;
+            }
+
+            do
+            {
+                files.push_back(find_data.cFileName);
+            } while (FindNextFileW(find_handle, &find_data));
+
+            FindClose(find_handle);
+            return files;
+        }
+
+        void remove_file(const utility::string_t& path)
+        {
+            DeleteFileW(path.c_str());
+        }
+#else
+        void create_directory(const utility::string_t& directory)
+        {
+            if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                throw signalr_exception(segment_error(_XPLATSTR("could not create the outbox directory: "), directory));
+            }
+        }
+
+        std::vector<utility::string_t> list_files(const utility::string_t& directory)
+        {
+            std::vector<utility::string_t> files;
+
+            auto dir = opendir(directory.c_str());
+            if (!dir)
+            {
+                return files;
+            }
+
+            while (auto entry = readdir(dir))
+            {
+                files.push_back(entry->d_name);
+            }
+
+            closedir(dir);
+            return files;
+        }
+
+        void remove_file(const utility::string_t& path)
+        {
+            unlink(path.c_str());
+        }
+#endif
+    }
+
+    // A file mapped into memory in its entirety. The file is created if it does not exist and grown to the given
+    // size if it is smaller; the bytes it is grown by are zero.
+    class mapped_file
+    {
+    public:
+        mapped_file(const utility::string_t& path, size_t minimum_size);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        uint8_t* data() const noexcept { return m_data; }
+        size_t size() const noexcept { return m_size; }
+
+    private:
+        void close() noexcept;
+
+        uint8_t* m_data;
+        size_t m_size;
+#ifdef _WIN32
+        HANDLE m_file;
+        HANDLE m_mapping;
+#else
+        int m_file;
+#endif
+    };
+
+#ifdef _WIN32
+    mapped_file::mapped_file(const utility::string_t& path, size_t minimum_size)
+        : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+    {
+        m_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        LARGE_INTEGER file_size;
+        if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &file_size))
+        {
+            close();
+            throw signalr_exception(segment_error(_XPLATSTR("could not open the outbox segment file: "), path));
+        }
+
+        m_size = std::max(static_cast<size_t>(file_size.QuadPart), minimum_size);
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(m_size) >> 32),
+            static_cast<DWORD>(m_size), nullptr);
+        m_data = m_mapping ? static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_size)) : nullptr;
+        if (!m_data)
+        {
+            close();
+            throw signalr_exception(segment_error(_XPLATSTR("could not map the outbox segment file: "), path));
+        }
+    }
+
+    mapped_file::~mapped_file()
+    {
+        close();
+    }
+
+    void mapped_file::close() noexcept
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+        }
+    }
+#else
+    mapped_file::mapped_file(const utility::string_t& path, size_t minimum_size)
+        : m_data(nullptr), m_size(0), m_file(open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644))
+    {
+        struct stat file_stat;
+        if (m_file < 0 || fstat(m_file, &file_stat) != 0)
+        {
+            close();
+            throw signalr_exception(segment_error(_XPLATSTR("could not open the outbox segment file: "), path));
+        }
+
+        m_size = std::max(static_cast<size_t>(file_stat.st_size), minimum_size);
+        if (static_cast<size_t>(file_stat.st_size) < m_size && ftruncate(m_file, static_cast<off_t>(m_size)) != 0)
+        {
+            close();
+            throw signalr_exception(segment_error(_XPLATSTR("could not grow the outbox segment file: "), path));
+        }
+
+        auto data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+        if (data == MAP_FAILED)
+        {
+            close();
+            throw signalr_exception(segment_error(_XPLATSTR("could not map the outbox segment file: "), path));
+        }
+
+        m_data = static_cast<uint8_t*>(data);
+    }
+
+    mapped_file::~mapped_file()
+    {
+        close();
+    }
+
+    void mapped_file::close() noexcept
+    {
+        if (m_data)
+        {
+            munmap(m_data, m_size);
+        }
+
+        if (m_file >= 0)
+        {
+            ::close(m_file);
+        }
+    }
+#endif
+
+    const size_t durable_outbox::default_segment_size = 1024 * 1024;
+
+    // segments are never larger than half the outbox. With a single segment no message could be appended once the
+    // segment is full until all messages were consumed and the segment was removed
+    durable_outbox::durable_outbox(const utility::string_t& directory, size_t max_size, size_t segment_size)
+        : m_directory(directory), m_max_size(max_size), m_segment_size(std::min(segment_size, max_size / 2)),
+        m_max_segments(m_segment_size > 0 ? max_size / m_segment_size : 0), m_count(0), m_size_in_bytes(0)
+    {
+        if (m_segment_size < segment_header_size + record_size(1))
+        {
+            throw std::invalid_argument("the outbox is too small to hold a message");
+        }
+
+        create_directory(m_directory);
+        open_segments();
+    }
+
+    durable_outbox::~durable_outbox() = default;
+
+    bool durable_outbox::append(const utility::string_t& message)
+    {
+        const auto utf8_message = utility::conversions::to_utf8string(message);
+        const auto size = record_size(utf8_message.size());
+        if (size > m_segment_size - segment_header_size || utf8_message.size() > record_length_mask)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_segments.empty() || m_segments.back().write_offset + size > m_segments.back().file->size())
+        {
+            // the last segment is full; if all of its messages were consumed it is not needed anymore
+            if (m_segments.size() == 1 && m_segments.back().read_offset == m_segments.back().write_offset)
+            {
+                remove_segment();
+            }
+
+            if (m_segments.size() >= m_max_segments)
+            {
+                return false;
+            }
+
+            add_segment();
+        }
+
+        auto& segment = m_segments.back();
+        auto record = segment.file->data() + segment.write_offset;
+
+        // the header marks the record as written so it goes last. The header slot of the next record is cleared
+        // before it since it may hold the message of a longer record that was being appended over it when the
+        // process died, which would otherwise be taken for a written record when the outbox is opened again
+        std::memcpy(record + sizeof(record_header), utf8_message.data(), utf8_message.size());
+        if (segment.write_offset + size + sizeof(record_header) <= segment.file->size())
+        {
+            std::memset(record + size, 0, sizeof(record_header));
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+        const auto header = static_cast<record_header>(utf8_message.size()) | record_written;
+        std::memcpy(record, &header, sizeof(header));
+
+        segment.write_offset += size;
+        m_count++;
+        m_size_in_bytes += utf8_message.size();
+
+        return true;
+    }
+
+    size_t durable_outbox::read(utility::string_t& batch, size_t max_batch_size) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        std::string utf8_batch;
+        size_t count = 0;
+        for (const auto& segment : m_segments)
+        {
+            for (auto offset = segment.read_offset; offset < segment.write_offset;)
+            {
+                record_header header;
+                std::memcpy(&header, segment.file->data() + offset, sizeof(header));
+                const auto length = static_cast<size_t>(header & record_length_mask);
+
+                if (count > 0 && utf8_batch.size() + length > max_batch_size)
+                {
+                    batch.append(utility::conversions::to_string_t(utf8_batch));
+                    return count;
+                }
+
+                utf8_batch.append(reinterpret_cast<const char*>(segment.file->data() + offset + sizeof(header)), length);
+                count++;
+                offset += record_size(length);
+            }
+        }
+
+        batch.append(utility::conversions::to_string_t(utf8_batch));
+        return count;
+    }
+
+    // the offset of the oldest message is persisted in the header of its segment so consumed messages are not
+    // read again after a restart
+    void durable_outbox::consume(size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        while (count > 0 && !m_segments.empty())
+        {
+            auto& segment = m_segments.front();
+            if (segment.read_offset == segment.write_offset)
+            {
+                if (m_segments.size() == 1)
+                {
+                    break;
+                }
+
+                remove_segment();
+                continue;
+            }
+
+            record_header header;
+            std::memcpy(&header, segment.file->data() + segment.read_offset, sizeof(header));
+            const auto length = static_cast<size_t>(header & record_length_mask);
+
+            segment.read_offset += record_size(length);
+            const auto read_offset = static_cast<uint64_t>(segment.read_offset);
+            std::memcpy(segment.file->data() + read_offset_offset, &read_offset, sizeof(read_offset));
+
+            m_count--;
+            m_size_in_bytes -= length;
+            count--;
+        }
+
+        // only the last segment is kept once all of its messages were consumed since messages are appended to it
+        while (m_segments.size() > 1 && m_segments.front().read_offset == m_segments.front().write_offset)
+        {
+            remove_segment();
+        }
+    }
+
+    size_t durable_outbox::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_count;
+    }
+
+    size_t durable_outbox::size_in_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_size_in_bytes;
+    }
+
+    const utility::string_t& durable_outbox::get_directory() const noexcept
+    {
+        return m_directory;
+    }
+
+    size_t durable_outbox::get_max_size() const noexcept
+    {
+        return m_max_size;
+    }
+
+    // Opens the segments left behind by a previous outbox in the directory, oldest first. A segment whose header was
+    // never written is deleted, a record that was not completely written ends the records of its segment.
+    void durable_outbox::open_segments()
+    {
+        std::vector<uint64_t> sequence_numbers;
+        const utility::string_t prefix(segment_prefix);
+        for (const auto& file_name : list_files(m_directory))
+        {
+            if (file_name.compare(0, prefix.size(), prefix) == 0 && ends_with(file_name, segment_suffix) &&
+                file_name.size() > prefix.size() + utility::string_t(segment_suffix).size())
+            {
+                try
+                {
+                    sequence_numbers.push_back(std::stoull(file_name.substr(prefix.size()), nullptr, 16));
+                }
+                catch (const std::exception&)
+                { }
+            }
+        }
+
+        std::sort(sequence_numbers.begin(), sequence_numbers.end());
+
+        for (auto sequence_number : sequence_numbers)
+        {
+            const auto path = segment_path(sequence_number);
+            std::unique_ptr<mapped_file> file(new mapped_file(path, segment_header_size));
+            const auto data = file->data();
+
+            if (std::all_of(data, data + segment_header_size, [](uint8_t byte) { return byte == 0; }))
+            {
+                file.reset();
+                remove_file(path);
+                continue;
+            }
+
+            uint32_t version;
+            uint64_t read_offset;
+            std::memcpy(&version, data + version_offset, sizeof(version));
+            std::memcpy(&read_offset, data + read_offset_offset, sizeof(read_offset));
+            if (std::memcmp(data, segment_magic, sizeof(segment_magic)) != 0 || version != segment_version ||
+                read_offset < segment_header_size || read_offset > file->size())
+            {
+                throw signalr_exception(segment_error(_XPLATSTR("invalid outbox segment file: "), path));
+            }
+
+            auto offset = static_cast<size_t>(segment_header_size);
+            while (offset + sizeof(record_header) <= file->size())
+            {
+                record_header header;
+                std::memcpy(&header, data + offset, sizeof(header));
+                const auto length = static_cast<size_t>(header & record_length_mask);
+                if ((header & record_written) == 0 || offset + record_size(length) > file->size())
+                {
+                    break;
+                }
+
+                if (offset >= read_offset)
+                {
+                    m_count++;
+                    m_size_in_bytes += length;
+                }
+
+                offset += record_size(length);
+            }
+
+            if (read_offset > offset)
+            {
+                throw signalr_exception(segment_error(_XPLATSTR("invalid outbox segment file: "), path));
+            }
+
+            m_segments.push_back(segment{ sequence_number, std::move(file), static_cast<size_t>(read_offset), offset });
+        }
+
+        while (m_segments.size() > 1 && m_segments.front().read_offset == m_segments.front().write_offset)
+        {
+            remove_segment();
+        }
+    }
+
+    // adds a segment after the last one. The segment is created with all bytes zero and the header written last
+    void durable_outbox::add_segment()
+    {
+        const auto sequence_number = m_segments.empty() ? 0 : m_segments.back().sequence_number + 1;
+        std::unique_ptr<mapped_file> file(new mapped_file(segment_path(sequence_number), m_segment_size));
+
+        const uint64_t read_offset = segment_header_size;
+        std::memcpy(file->data() + version_offset, &segment_version, sizeof(segment_version));
+        std::memcpy(file->data() + read_offset_offset, &read_offset, sizeof(read_offset));
+        std::memcpy(file->data(), segment_magic, sizeof(segment_magic));
+
+        m_segments.push_back(segment{ sequence_number, std::move(file), segment_header_size, segment_header_size });
+    }
+
+    // removes the oldest segment, whose messages must all have been consumed
+    void durable_outbox::remove_segment()
+    {
+        const auto sequence_number = m_segments.front().sequence_number;
+        m_segments.pop_front();
+        remove_file(segment_path(sequence_number));
+    }
+
+    utility::string_t durable_outbox::segment_path(uint64_t sequence_number) const
+    {
+        utility::char_t name[17];
+        static const utility::char_t digits[] = _XPLATSTR("0123456789abcdef");
+        for (auto i = 15; i >= 0; i--)
+        {
+            name[i] = digits[sequence_number & 0xf];
+            sequence_number >>= 4;
+        }
+        name[16] = 0;
+
+        return utility::string_t(m_directory).append(_XPLATSTR("/")).append(segment_prefix).append(name).append(segment_suffix);
+    }
+}
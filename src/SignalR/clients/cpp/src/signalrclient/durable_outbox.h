@@ -0,0 +1,84 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    class mapped_file;
+
+    // A bounded log of messages waiting to be sent, persisted in memory-mapped segment files in a directory so that
+    // the messages survive restarts of the process and don't take up memory of the process while the connection is
+    // down. Messages are appended to the newest segment and read from the oldest one; a segment is deleted once all
+    // its messages were consumed.
+    //
+    // A segment file starts with a magic number, a version and the offset of its first message that was not
+    // consumed, followed by one record per message: a 4 byte header holding the UTF-8 encoded length of the message
+    // and a flag marking the record as written, and the message itself. The header is written after the message, and
+    // after the header of the next record was cleared, so a record that was being appended when the process died,
+    // and anything left after it, is ignored when the outbox is opened again. Messages
+    // read but not consumed before the process died are read again, i.e. messages are delivered at least once.
+    // Records are written to the mapped files only and never flushed to disk explicitly, so they survive the process
+    // dying but messages appended shortly before the operating system crashed or the machine lost power can be lost.
+    // The outbox is thread safe.
+    class durable_outbox
+    {
+    public:
+        static const size_t default_segment_size;
+
+        // opens the outbox in the given directory, creating the directory if it does not exist. `max_size` bounds
+        // the size of the segment files in bytes; segments are made smaller than `segment_size` if needed so that
+        // the outbox has at least two of them
+        durable_outbox(const utility::string_t& directory, size_t max_size, size_t segment_size = default_segment_size);
+        ~durable_outbox();
+
+        durable_outbox(const durable_outbox&) = delete;
+        durable_outbox& operator=(const durable_outbox&) = delete;
+
+        // returns false if the outbox is full in which case the message is not appended
+        bool append(const utility::string_t& message);
+
+        // appends the oldest messages that were not consumed to the batch, stopping before a message that would
+        // make the batch larger than `max_batch_size` bytes unless the batch would be empty. Returns the number of
+        // messages appended; the messages stay in the outbox until they are consumed
+        size_t read(utility::string_t& batch, size_t max_batch_size) const;
+
+        // removes the oldest `count` messages
+        void consume(size_t count);
+
+        size_t size() const;
+        size_t size_in_bytes() const;
+        const utility::string_t& get_directory() const noexcept;
+        size_t get_max_size() const noexcept;
+
+    private:
+        struct segment
+        {
+            uint64_t sequence_number;
+            std::unique_ptr<mapped_file> file;
+            // the offset of the oldest message that was not consumed and the offset the next message is written to
+            size_t read_offset;
+            size_t write_offset;
+        };
+
+        mutable std::mutex m_lock;
+        const utility::string_t m_directory;
+        const size_t m_max_size;
+        const size_t m_segment_size;
+        const size_t m_max_segments;
+        std::deque<segment> m_segments;
+        size_t m_count;
+        size_t m_size_in_bytes;
+
+        void open_segments();
+        void add_segment();
+        void remove_segment();
+        utility::string_t segment_path(uint64_t sequence_number) const;
+    };
+}
@@ -0,0 +1,76 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "http_client_pool.h"
+#include "tls_session_cache.h"
+
+namespace signalr
+{
+    http_client_pool::http_client_pool(size_t max_clients)
+        : m_max_clients(max_clients), m_use_count(0)
+    {
+        if (max_clients == 0)
+        {
+            throw std::invalid_argument("max_clients must be greater than zero");
+        }
+    }
+
+    std::shared_ptr<web::http::client::http_client> http_client_pool::get_client(const web::uri& url, const signalr_client_config& signalr_client_config)
+    {
+        const auto origin = url.authority();
+        const client_key key(origin.to_string(), signalr_client_config.http_client_config_id());
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto iter = m_clients.find(key);
+        if (iter != m_clients.end())
+        {
+            iter->second.last_used = ++m_use_count;
+            return iter->second.client;
+        }
+
+        if (m_clients.size() >= m_max_clients)
+        {
+            auto least_recently_used = m_clients.begin();
+            for (auto i = m_clients.begin(); i != m_clients.end(); ++i)
+            {
+                if (i->second.last_used < least_recently_used->second.last_used)
+                {
+                    least_recently_used = i;
+                }
+            }
+
+            m_clients.erase(least_recently_used);
+        }
+
+        auto http_client_config = signalr_client_config.http_client_config();
+        if (signalr_client_config.get_tls_session_resumption())
+        {
+            http_client_config = tls_session_cache::get_default()->attach(http_client_config, url,
+                tls_session_cache::get_config_id(signalr_client_config));
+        }
+
+        pooled_client pooled
+        {
+            std::make_shared<web::http::client::http_client>(origin, http_client_config),
+            ++m_use_count
+        };
+
+        m_clients.insert(std::make_pair(key, pooled));
+        return pooled.client;
+    }
+
+    size_t http_client_pool::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return m_clients.size();
+    }
+
+    std::shared_ptr<http_client_pool> http_client_pool::get_default()
+    {
+        static const auto default_pool = std::make_shared<http_client_pool>();
+        return default_pool;
+    }
+}
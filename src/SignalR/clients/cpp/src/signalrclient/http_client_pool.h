@@ -0,0 +1,47 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include "cpprest/http_client.h"
+#include "signalrclient/signalr_client_config.h"
+
+namespace signalr
+{
+    // Shares http clients between requests to the same origin so that the connections (and TLS sessions) opened
+    // by an http client are reused instead of being established for each request. Clients are keyed by the origin
+    // and by the http client config they were created with and the least recently used client is dropped once the
+    // pool is full. Clients that are dropped remain valid for the requests still using them.
+    class http_client_pool
+    {
+    public:
+        explicit http_client_pool(size_t max_clients = 16);
+
+        http_client_pool(const http_client_pool&) = delete;
+        http_client_pool& operator=(const http_client_pool&) = delete;
+
+        std::shared_ptr<web::http::client::http_client> get_client(const web::uri& url, const signalr_client_config& signalr_client_config);
+
+        size_t size() const;
+
+        // the pool shared by all connections in the process
+        static std::shared_ptr<http_client_pool> get_default();
+
+    private:
+        typedef std::pair<utility::string_t, uint64_t> client_key;
+
+        struct pooled_client
+        {
+            std::shared_ptr<web::http::client::http_client> client;
+            uint64_t last_used;
+        };
+
+        const size_t m_max_clients;
+        mutable std::mutex m_lock;
+        std::map<client_key, pooled_client> m_clients;
+        uint64_t m_use_count;
+    };
+}
@@ -13,6 +13,11 @@ namespace signalr
         : m_pImpl(hub_connection_impl::create(url, trace_level, std::move(log_writer)))
     {}
 
+    hub_connection::hub_connection(const std::vector<utility::string_t>& urls,
+        trace_level trace_level, std::shared_ptr<log_writer> log_writer)
+        : m_pImpl(hub_connection_impl::create(urls, trace_level, std::move(log_writer)))
+    {}
+
     // Do NOT remove this destructor. Letting the compiler generate and inline the default dtor may lead to
     // undefinded behavior since we are using an incomplete type. More details here:  http://herbsutter.com/gotw/_100/
     hub_connection::~hub_connection() = default;
@@ -37,6 +42,77 @@ namespace signalr
         return m_pImpl->on(event_name, handler);
     }
 
+    void hub_connection::on(const utility::string_t& event_name, const method_invoked_view_handler& handler)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("on() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        return m_pImpl->on(event_name, handler);
+    }
+
+    void hub_connection::on(const utility::string_t& event_name, const method_invoked_handler& handler,
+        const inbound_queue_config& queue_config)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("on() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        return m_pImpl->on(event_name, handler, queue_config);
+    }
+
+    inbound_queue_stats hub_connection::get_inbound_queue_stats(const utility::string_t& event_name) const
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("get_inbound_queue_stats() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        return m_pImpl->get_inbound_queue_stats(event_name);
+    }
+
+    void hub_connection::coalesce_invocations(const utility::string_t& method_name)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("coalesce_invocations() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        m_pImpl->coalesce_invocations(method_name);
+    }
+
+    void hub_connection::cache_results(const utility::string_t& method_name, const result_cache_config& cache_config)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("cache_results() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        m_pImpl->cache_results(method_name, cache_config);
+    }
+
+    result_cache_stats hub_connection::get_result_cache_stats(const utility::string_t& method_name) const
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("get_result_cache_stats() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        return m_pImpl->get_result_cache_stats(method_name);
+    }
+
+    void hub_connection::invalidate_cached_results(const utility::string_t& method_name)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("invalidate_cached_results() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        m_pImpl->invalidate_cached_results(method_name);
+    }
+
     pplx::task<web::json::value> hub_connection::invoke(const utility::string_t& method_name, const web::json::value& arguments)
     {
         if (!m_pImpl)
@@ -47,6 +123,33 @@ namespace signalr
         return m_pImpl->invoke(method_name, arguments);
     }
 
+    pplx::task<web::json::value> hub_connection::invoke(const utility::string_t& method_name, const web::json::value& arguments,
+        const pplx::cancellation_token& cancellation_token)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("invoke() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        return m_pImpl->invoke(invocation_envelope(method_name), arguments, m_pImpl->get_invocation_timeout(), cancellation_token);
+    }
+
+    pplx::task<web::json::value> hub_connection::invoke(const utility::string_t& method_name, const web::json::value& arguments,
+        std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("invoke() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        if (timeout.count() < 0)
+        {
+            throw std::invalid_argument("timeout cannot be negative");
+        }
+
+        return m_pImpl->invoke(invocation_envelope(method_name), arguments, timeout, cancellation_token);
+    }
+
     pplx::task<void> hub_connection::send(const utility::string_t& method_name, const web::json::value& arguments)
     {
         if (!m_pImpl)
@@ -57,6 +160,48 @@ namespace signalr
         return m_pImpl->send(method_name, arguments);
     }
 
+    void hub_connection::invoke(const utility::string_t& method_name, const web::json::value& arguments,
+        const invocation_completed_handler& invocation_completed)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("invoke() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        if (!invocation_completed)
+        {
+            throw std::invalid_argument("invocation_completed cannot be empty");
+        }
+
+        m_pImpl->invoke(invocation_envelope(method_name), arguments, invocation_completed);
+    }
+
+    void hub_connection::send(const utility::string_t& method_name, const web::json::value& arguments,
+        const send_completed_handler& send_completed)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("send() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        if (!send_completed)
+        {
+            throw std::invalid_argument("send_completed cannot be empty");
+        }
+
+        m_pImpl->send(invocation_envelope(method_name), arguments, send_completed);
+    }
+
+    prepared_method hub_connection::prepare(const utility::string_t& method_name)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("prepare() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        return prepared_method(m_pImpl, m_pImpl->prepare(method_name));
+    }
+
     connection_state hub_connection::get_connection_state() const
     {
         return m_pImpl->get_connection_state();
@@ -67,6 +212,11 @@ namespace signalr
         return m_pImpl->get_connection_id();
     }
 
+    connect_timings hub_connection::get_connect_timings() const
+    {
+        return m_pImpl->get_connect_timings();
+    }
+
     void hub_connection::set_disconnected(const std::function<void()>& disconnected_callback)
     {
         m_pImpl->set_disconnected(disconnected_callback);
@@ -76,4 +226,16 @@ namespace signalr
     {
         m_pImpl->set_client_config(config);
     }
+
+    // sets the timeout applied to invocations that don't specify one. A timeout of zero (the default) means
+    // invocations wait for the server indefinitely.
+    void hub_connection::set_invocation_timeout(std::chrono::milliseconds timeout)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception(_XPLATSTR("set_invocation_timeout() cannot be called on uninitialized hub_connection instance"));
+        }
+
+        m_pImpl->set_invocation_timeout(timeout);
+    }
 }
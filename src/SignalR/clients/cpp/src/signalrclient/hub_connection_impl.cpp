@@ -7,6 +7,8 @@
 #include "trace_log_writer.h"
 #include "make_unique.h"
 #include "signalrclient/signalr_exception.h"
+#include <algorithm>
+#include <condition_variable>
 
 using namespace web;
 
@@ -15,9 +17,271 @@ namespace signalr
     // unnamed namespace makes it invisble outside this translation unit
     namespace
     {
-        static std::function<void(const json::value&)> create_hub_invocation_callback(const logger& logger,
-            const std::function<void(const json::value&)>& set_result,
-            const std::function<void(const std::exception_ptr e)>& set_exception);
+        // how long received messages are collected before acknowledging them when using stateful reconnect
+        const std::chrono::milliseconds ack_interval(1000);
+
+        // the maximum size of a frame of messages sent from the outbox
+        const size_t outbox_batch_size = 64 * 1024;
+
+        // An invocation waiting for its result. Tracks the timeout timer and the cancellation token registration
+        // of the invocation so that they can be released as soon as the invocation completes in any way and
+        // makes sure that the completion handler is invoked exactly once.
+        class pending_invocation
+        {
+        public:
+            pending_invocation(const std::function<void(const json::value&, std::exception_ptr)>& completion,
+                const std::shared_ptr<traced_invocation>& trace)
+                : m_completion(completion), m_trace(trace), m_completed(false), m_has_timer(false), m_timer_id(0), m_has_registration(false),
+                m_send_state(send_state::not_sent)
+            { }
+
+            // returns false if the invocation must not be sent since it was abandoned before it was sent
+            bool try_send()
+            {
+                auto expected = send_state::not_sent;
+                return m_send_state.compare_exchange_strong(expected, send_state::sent);
+            }
+
+            // returns whether the invocation was sent, an invocation that was not sent yet is never sent
+            bool abandon()
+            {
+                return m_send_state.exchange(send_state::abandoned) == send_state::sent;
+            }
+
+            void set_timer(const std::shared_ptr<timer_wheel>& timer_wheel, timer_wheel::timer_id timer_id)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    if (!m_completed)
+                    {
+                        m_timer_wheel = timer_wheel;
+                        m_timer_id = timer_id;
+                        m_has_timer = true;
+                        return;
+                    }
+                }
+
+                timer_wheel->cancel(timer_id);
+            }
+
+            void set_registration(const pplx::cancellation_token& token, const pplx::cancellation_token_registration& registration)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    if (!m_completed)
+                    {
+                        m_token = token;
+                        m_registration = registration;
+                        m_has_registration = true;
+                        return;
+                    }
+                }
+
+                token.deregister_callback(registration);
+            }
+
+            // the timer and the registration are released outside the lock since deregistering a callback waits
+            // for the callback to finish if it is running
+            void complete(const json::value& result, std::exception_ptr exception, bool release_timer, bool release_registration)
+            {
+                std::function<void(const json::value&, std::exception_ptr)> completion;
+                std::weak_ptr<timer_wheel> weak_timer_wheel;
+                timer_wheel::timer_id timer_id = 0;
+                auto token = pplx::cancellation_token::none();
+                pplx::cancellation_token_registration registration;
+                bool has_timer, has_registration;
+
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    if (m_completed)
+                    {
+                        return;
+                    }
+
+                    m_completed = true;
+                    completion.swap(m_completion);
+                    has_timer = m_has_timer && release_timer;
+                    has_registration = m_has_registration && release_registration;
+                    weak_timer_wheel = m_timer_wheel;
+                    timer_id = m_timer_id;
+                    token = m_token;
+                    registration = m_registration;
+                    m_has_timer = m_has_registration = false;
+                }
+
+                if (has_timer)
+                {
+                    auto timer_wheel = weak_timer_wheel.lock();
+                    if (timer_wheel)
+                    {
+                        timer_wheel->cancel(timer_id);
+                    }
+                }
+
+                if (has_registration)
+                {
+                    token.deregister_callback(registration);
+                }
+
+                if (!m_trace)
+                {
+                    completion(result, exception);
+                    return;
+                }
+
+                m_trace->mark(invocation_stage::completion_received);
+                completion(result, exception);
+                m_trace->mark(invocation_stage::callback_completed);
+                m_trace->set_succeeded(!exception);
+                m_trace->release();
+            }
+
+        private:
+            std::mutex m_lock;
+            std::function<void(const json::value&, std::exception_ptr)> m_completion;
+            // only accessed by the thread that completes the invocation
+            const std::shared_ptr<traced_invocation> m_trace;
+            bool m_completed;
+            std::weak_ptr<timer_wheel> m_timer_wheel;
+            bool m_has_timer;
+            timer_wheel::timer_id m_timer_id;
+            pplx::cancellation_token m_token = pplx::cancellation_token::none();
+            pplx::cancellation_token_registration m_registration;
+            bool m_has_registration;
+            enum class send_state { not_sent, sent, abandoned };
+            std::atomic<send_state> m_send_state;
+        };
+
+        // The permit of an invocation made while invocations are limited. The permit is taken when the invocation is
+        // sent and released, together with the latency of the invocation, when the invocation completes. An invocation
+        // that completes while it is queued (i.e. it timed out, was canceled or the connection stopped) is not sent and
+        // gives the permit back as soon as it gets one.
+        class limited_invocation
+        {
+        public:
+            enum class outcome { completed, timed_out, canceled };
+
+            explicit limited_invocation(const std::shared_ptr<invocation_limiter>& limiter)
+                : m_limiter(limiter), m_state(state::queued)
+            { }
+
+            // returns false if the invocation must not be sent since it completed while it was queued
+            bool start()
+            {
+                m_start_time = std::chrono::steady_clock::now();
+
+                auto expected = state::queued;
+                if (m_state.compare_exchange_strong(expected, state::started))
+                {
+                    return true;
+                }
+
+                m_limiter->release();
+                return false;
+            }
+
+            void complete(outcome result)
+            {
+                if (m_state.exchange(state::completed) != state::started)
+                {
+                    return;
+                }
+
+                if (result == outcome::canceled)
+                {
+                    m_limiter->release();
+                }
+                else
+                {
+                    m_limiter->release(std::chrono::steady_clock::now() - m_start_time, result == outcome::timed_out);
+                }
+            }
+
+        private:
+            enum class state { queued, started, completed };
+
+            const std::shared_ptr<invocation_limiter> m_limiter;
+            std::atomic<state> m_state;
+            // written before the invocation is started and read after it completed
+            std::chrono::steady_clock::time_point m_start_time;
+        };
+
+        static std::function<void(const json::value&)> create_hub_invocation_callback(const std::shared_ptr<pending_invocation>& invocation);
+
+        int64_t get_sequence_id(const json::value& message)
+        {
+            return message.at(_XPLATSTR("sequenceId")).as_number().to_int64();
+        }
+
+        int64_t get_sequence_id(const json_view& message)
+        {
+            return message.at(_XPLATSTR("sequenceId")).as_int64();
+        }
+
+        // the number of records a thread claims at a time when records are parsed in parallel
+        const size_t parse_batch_size = 8;
+
+        // The records of a message parsed in parallel. Records are claimed in batches by the thread processing the
+        // message and by tasks scheduled on the thread pool. The thread processing the message parses records
+        // until none is left and then only waits for the batches claimed by other threads, so it never waits for
+        // a task which has not started yet and parsing completes even if the pool is busy.
+        struct parallel_parse
+        {
+            struct record
+            {
+                size_t offset;
+                size_t length;
+                json::value value;
+                std::exception_ptr error;
+            };
+
+            const utility::string_t* message;
+            std::vector<record> records;
+            std::atomic<size_t> next_record;
+
+            std::mutex lock;
+            std::condition_variable records_parsed;
+            size_t parsed_count;
+        };
+
+        // the message is only accessed while records are left to parse so it has to outlive `wait_parsed` only
+        void parse_claimed_records(parallel_parse& parse)
+        {
+            for (;;)
+            {
+                const auto first = parse.next_record.fetch_add(parse_batch_size);
+                if (first >= parse.records.size())
+                {
+                    return;
+                }
+
+                const auto last = std::min(first + parse_batch_size, parse.records.size());
+                for (auto i = first; i < last; ++i)
+                {
+                    auto& record = parse.records[i];
+                    try
+                    {
+                        record.value = json::value::parse(parse.message->substr(record.offset, record.length));
+                    }
+                    catch (...)
+                    {
+                        record.error = std::current_exception();
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(parse.lock);
+                    parse.parsed_count += last - first;
+                }
+                parse.records_parsed.notify_all();
+            }
+        }
+
+        void wait_parsed(parallel_parse& parse)
+        {
+            std::unique_lock<std::mutex> lock(parse.lock);
+            parse.records_parsed.wait(lock, [&parse]() { return parse.parsed_count == parse.records.size(); });
+        }
     }
 
     std::shared_ptr<hub_connection_impl> hub_connection_impl::create(const utility::string_t& url, trace_level trace_level,
@@ -31,7 +295,22 @@ namespace signalr
         const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
         std::unique_ptr<transport_factory> transport_factory)
     {
-        auto connection = std::shared_ptr<hub_connection_impl>(new hub_connection_impl(url, trace_level,
+        return hub_connection_impl::create(std::vector<utility::string_t>{ url }, trace_level, log_writer,
+            std::move(web_request_factory), std::move(transport_factory));
+    }
+
+    std::shared_ptr<hub_connection_impl> hub_connection_impl::create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+        const std::shared_ptr<log_writer>& log_writer)
+    {
+        return hub_connection_impl::create(urls, trace_level, log_writer,
+            std::make_unique<web_request_factory>(), std::make_unique<transport_factory>());
+    }
+
+    std::shared_ptr<hub_connection_impl> hub_connection_impl::create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+        const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
+        std::unique_ptr<transport_factory> transport_factory)
+    {
+        auto connection = std::shared_ptr<hub_connection_impl>(new hub_connection_impl(urls, trace_level,
             log_writer ? log_writer : std::make_shared<trace_log_writer>(), std::move(web_request_factory), std::move(transport_factory)));
 
         connection->initialize();
@@ -39,13 +318,16 @@ namespace signalr
         return connection;
     }
 
-    hub_connection_impl::hub_connection_impl(const utility::string_t& url, trace_level trace_level,
+    hub_connection_impl::hub_connection_impl(const std::vector<utility::string_t>& urls, trace_level trace_level,
         const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
         std::unique_ptr<transport_factory> transport_factory)
-        : m_connection(connection_impl::create(url, trace_level, log_writer,
+        : m_connection(connection_impl::create(urls, trace_level, log_writer,
         std::move(web_request_factory), std::move(transport_factory))),m_logger(log_writer, trace_level),
         m_callback_manager(json::value::parse(_XPLATSTR("{ \"error\" : \"connection went out of scope before invocation result was received\"}"))),
-        m_disconnected([]() noexcept {}), m_handshakeReceived(false)
+        m_disconnected([]() noexcept {}), m_handshakeReceived(false),
+        m_timer_wheel(timer_wheel::get_default()), m_invocation_timeout(0),
+        m_stateful_reconnect(false), m_received_sequence_id(0), m_next_received_sequence_id(1), m_ack_scheduled(false),
+        m_message_parsing(message_parsing::dom), m_parallel_parsing_threshold(0), m_draining_outbox(false)
     { }
 
     void hub_connection_impl::initialize()
@@ -69,13 +351,127 @@ namespace signalr
             auto connection = weak_hub_connection.lock();
             if (connection)
             {
-                connection->m_handshakeTask.set_exception(signalr_exception(_XPLATSTR("connection closed while handshake was in progress.")));
+                {
+                    std::lock_guard<std::mutex> lock(connection->m_handshake_lock);
+                    connection->m_handshakeTask.set_exception(signalr_exception(_XPLATSTR("connection closed while handshake was in progress.")));
+                }
+                connection->m_callback_manager.clear(json::value::parse(_XPLATSTR("{ \"error\" : \"connection was stopped before invocation result was received\"}")));
                 connection->m_disconnected();
             }
         });
+
+        m_connection->set_reconnected([weak_hub_connection]()
+        {
+            auto connection = weak_hub_connection.lock();
+            if (connection)
+            {
+                connection->replay_messages();
+                connection->drain_outbox();
+            }
+        });
+
+        m_connection->set_failed_over([weak_hub_connection]()
+        {
+            auto connection = weak_hub_connection.lock();
+            if (connection)
+            {
+                connection->handle_failed_over();
+            }
+        });
     }
 
     void hub_connection_impl::on(const utility::string_t& event_name, const std::function<void(const json::value &)>& handler)
+    {
+        add_subscription(event_name, subscription{ handler, nullptr });
+    }
+
+    void hub_connection_impl::on(const utility::string_t& event_name, const std::function<void(const json_view&)>& handler)
+    {
+        add_subscription(event_name, subscription{ nullptr, handler });
+    }
+
+    void hub_connection_impl::on(const utility::string_t& event_name, const std::function<void(const json::value &)>& handler,
+        const inbound_queue_config& queue_config)
+    {
+        add_subscription(event_name, subscription{ nullptr, nullptr, std::make_shared<inbound_queue>(queue_config, handler, m_logger) });
+    }
+
+    inbound_queue_stats hub_connection_impl::get_inbound_queue_stats(const utility::string_t& event_name) const
+    {
+        auto event = m_subscriptions.find(event_name);
+        if (event == m_subscriptions.end() || !event->second.queue)
+        {
+            throw signalr_exception(
+                _XPLATSTR("no handler with a queue has been registered for the event. event name: ") + event_name);
+        }
+
+        return event->second.queue->get_stats();
+    }
+
+    void hub_connection_impl::coalesce_invocations(const utility::string_t& method_name)
+    {
+        if (method_name.length() == 0)
+        {
+            throw std::invalid_argument("method_name cannot be empty");
+        }
+
+        if (get_connection_state() != connection_state::disconnected)
+        {
+            throw signalr_exception(_XPLATSTR("invocations can only be coalesced while the connection is in the disconnected state"));
+        }
+
+        m_coalesced_methods.insert(method_name);
+    }
+
+    void hub_connection_impl::cache_results(const utility::string_t& method_name, const result_cache_config& cache_config)
+    {
+        if (method_name.length() == 0)
+        {
+            throw std::invalid_argument("method_name cannot be empty");
+        }
+
+        if (get_connection_state() != connection_state::disconnected)
+        {
+            throw signalr_exception(_XPLATSTR("results can only be cached while the connection is in the disconnected state"));
+        }
+
+        if (m_result_caches.find(method_name) != m_result_caches.end())
+        {
+            throw signalr_exception(
+                _XPLATSTR("the results of this method are already cached. method name: ") + method_name);
+        }
+
+        auto cache = std::make_shared<result_cache>(cache_config);
+        m_result_caches.insert(std::make_pair(method_name, cache));
+        if (!cache_config.get_invalidation_event().empty())
+        {
+            m_cache_invalidations[cache_config.get_invalidation_event()].push_back(cache);
+        }
+    }
+
+    result_cache_stats hub_connection_impl::get_result_cache_stats(const utility::string_t& method_name) const
+    {
+        auto cache = m_result_caches.find(method_name);
+        if (cache == m_result_caches.end())
+        {
+            throw signalr_exception(_XPLATSTR("the results of this method are not cached. method name: ") + method_name);
+        }
+
+        return cache->second->get_stats();
+    }
+
+    void hub_connection_impl::invalidate_cached_results(const utility::string_t& method_name)
+    {
+        auto cache = m_result_caches.find(method_name);
+        if (cache == m_result_caches.end())
+        {
+            throw signalr_exception(_XPLATSTR("the results of this method are not cached. method name: ") + method_name);
+        }
+
+        cache->second->clear();
+    }
+
+    void hub_connection_impl::add_subscription(const utility::string_t& event_name, const subscription& subscription)
     {
         if (event_name.length() == 0)
         {
@@ -95,7 +491,7 @@ namespace signalr
                 _XPLATSTR("an action for this event has already been registered. event name: ") + event_name);
         }
 
-        m_subscriptions.insert(std::pair<utility::string_t, std::function<void(const json::value &)>> {event_name, handler});
+        m_subscriptions.insert(std::make_pair(event_name, subscription));
     }
 
     pplx::task<void> hub_connection_impl::start()
@@ -107,8 +503,26 @@ namespace signalr
         }
 
         m_connection->set_client_config(m_signalr_client_config);
-        m_handshakeTask = pplx::task_completion_event<void>();
-        m_handshakeReceived = false;
+        m_message_parsing = m_signalr_client_config.get_message_parsing();
+        m_invocation_trace_sink = m_signalr_client_config.get_invocation_trace_sink();
+        m_parallel_parsing_threshold = m_signalr_client_config.get_parallel_parsing_threshold();
+        std::shared_ptr<partitioned_dispatch> dispatch;
+        if (m_signalr_client_config.get_partition_key_extractor())
+        {
+            dispatch = std::make_shared<partitioned_dispatch>();
+            dispatch->key_extractor = m_signalr_client_config.get_partition_key_extractor();
+            dispatch->dispatcher = partitioned_dispatcher::get_shared(m_signalr_client_config.get_dispatch_concurrency());
+        }
+        std::atomic_store(&m_partitioned_dispatch, std::shared_ptr<const partitioned_dispatch>(dispatch));
+        m_invocation_limiter = m_signalr_client_config.get_max_concurrent_invocations() > 0
+            ? std::make_shared<invocation_limiter>(m_signalr_client_config.get_max_concurrent_invocations(),
+                m_signalr_client_config.get_adaptive_concurrency_limit())
+            : nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_handshake_lock);
+            m_handshakeTask = pplx::task_completion_event<void>();
+            m_handshakeReceived = false;
+        }
         auto weak_connection = weak_from_this();
         return m_connection->start()
             .then([weak_connection](pplx::task<void> startTask)
@@ -120,23 +534,26 @@ namespace signalr
                     // The connection has been destructed
                     return pplx::task_from_exception<void>(signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
                 }
-                return connection->m_connection->send(_XPLATSTR("{\"protocol\":\"json\",\"version\":1}\x1e"))
-                    .then([weak_connection](pplx::task<void> previous_task)
-                    {
-                        auto connection = weak_connection.lock();
-                        if (!connection)
-                        {
-                            // The connection has been destructed
-                            return pplx::task_from_exception<void>(signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
-                        }
-                        previous_task.get();
-                        return pplx::task<void>(connection->m_handshakeTask);
-                    })
-                    .then([weak_connection](pplx::task<void> previous_task)
+
+                const auto handshake_started = std::chrono::steady_clock::now();
+                return connection->send_handshake()
+                    .then([weak_connection, handshake_started](pplx::task<void> previous_task)
                     {
                         try
                         {
                             previous_task.get();
+
+                            auto connection = weak_connection.lock();
+                            if (connection)
+                            {
+                                connection->m_connection->record_connect_phase(connect_phase::handshake, handshake_started);
+                                connection->m_logger.log(trace_level::events, utility::string_t(_XPLATSTR("hub connection started. "))
+                                    .append(connection->get_connect_timings().to_string()));
+
+                                // messages sent while the connection was down are waiting in the outbox
+                                connection->drain_outbox();
+                            }
+
                             return previous_task;
                         }
                         catch (std::exception e)
@@ -155,6 +572,92 @@ namespace signalr
             });
     }
 
+    // Sends the handshake request after setting up message sequencing for the negotiated protocol. The returned task
+    // completes once the handshake response has been received.
+    pplx::task<void> hub_connection_impl::send_handshake()
+    {
+        const auto stateful_reconnect = m_connection->is_stateful_reconnect_enabled();
+        {
+            std::lock_guard<std::mutex> lock(m_sequence_lock);
+            m_replay_buffer = stateful_reconnect
+                ? std::make_unique<replay_buffer>(m_signalr_client_config.get_stateful_reconnect_buffer_size())
+                : nullptr;
+            m_received_sequence_id = 0;
+            m_next_received_sequence_id = 1;
+            m_stateful_reconnect = stateful_reconnect;
+        }
+
+        if (stateful_reconnect)
+        {
+            m_timer_wheel->start();
+        }
+
+        auto weak_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+
+        // version 2 of the protocol adds the Ack and Sequence messages used by stateful reconnect
+        return m_connection->send(stateful_reconnect
+            ? _XPLATSTR("{\"protocol\":\"json\",\"version\":2}\x1e")
+            : _XPLATSTR("{\"protocol\":\"json\",\"version\":1}\x1e"))
+            .then([weak_connection](pplx::task<void> previous_task)
+            {
+                auto connection = weak_connection.lock();
+                if (!connection)
+                {
+                    // The connection has been destructed
+                    return pplx::task_from_exception<void>(signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
+                }
+                previous_task.get();
+                std::lock_guard<std::mutex> lock(connection->m_handshake_lock);
+                return pplx::task<void>(connection->m_handshakeTask);
+            });
+    }
+
+    // The connection failed over to a different endpoint and therefore to a different server side connection which
+    // does not know about the invocations sent before. Pending invocations are failed and the handshake is repeated.
+    void hub_connection_impl::handle_failed_over()
+    {
+        m_callback_manager.clear(json::value::parse(_XPLATSTR("{ \"error\" : \"the connection failed over to a different endpoint before invocation result was received\"}")));
+
+        {
+            std::lock_guard<std::mutex> lock(m_handshake_lock);
+            m_handshakeTask = pplx::task_completion_event<void>();
+            m_handshakeReceived = false;
+        }
+
+        auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+        send_handshake()
+            .then([weak_hub_connection](pplx::task<void> handshake_task)
+            {
+                auto connection = weak_hub_connection.lock();
+                if (!connection)
+                {
+                    return;
+                }
+
+                try
+                {
+                    handshake_task.get();
+                    connection->drain_outbox();
+                }
+                catch (const std::exception& e)
+                {
+                    connection->m_logger.log(trace_level::errors,
+                        utility::string_t(_XPLATSTR("handshake failed after failing over, stopping the connection. error: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+
+                    connection->stop().then([](pplx::task<void> stop_task)
+                    {
+                        try
+                        {
+                            stop_task.get();
+                        }
+                        catch (...)
+                        { }
+                    });
+                }
+            });
+    }
+
     pplx::task<void> hub_connection_impl::stop()
     {
         m_callback_manager.clear(json::value::parse(_XPLATSTR("{ \"error\" : \"connection was stopped before invocation result was received\"}")));
@@ -170,99 +673,465 @@ namespace signalr
         CancelInvocation,
         Ping,
         Close,
+        Ack,
+        Sequence,
     };
 
     void hub_connection_impl::process_message(const utility::string_t& response)
     {
         try
         {
-            auto pos = response.find('\x1e');
+            if (m_parallel_parsing_threshold > 0 &&
+                static_cast<size_t>(std::count(response.begin(), response.end(), _XPLATSTR('\x1e'))) >= m_parallel_parsing_threshold)
+            {
+                process_message_in_parallel(response);
+                return;
+            }
+
             std::size_t lastPos = 0;
-            while (pos != utility::string_t::npos)
+            for (auto pos = response.find('\x1e'); pos != utility::string_t::npos; lastPos = pos + 1, pos = response.find('\x1e', lastPos))
             {
-                auto message = response.substr(lastPos, pos - lastPos);
-                const auto result = web::json::value::parse(message);
+                // views of the previous record are no longer in use so its nodes can be released
+                m_json_parser.reset();
 
-                if (!result.is_object())
+                const auto text = response.data() + lastPos;
+                const auto length = pos - lastPos;
+                bool processed;
+                if (m_message_parsing == message_parsing::dom)
                 {
-                    m_logger.log(trace_level::info, utility::string_t(_XPLATSTR("unexpected response received from the server: "))
-                        .append(message));
-
-                    return;
+                    processed = process_record(web::json::value::parse(response.substr(lastPos, length)), text, length);
+                }
+                else
+                {
+                    // the arguments of lazily parsed invocations are only parsed if the target has a handler
+                    processed = process_record(m_message_parsing == message_parsing::lazy
+                        ? m_json_parser.parse_lazy(text, text + length)
+                        : m_json_parser.parse(text, text + length), text, length);
                 }
 
-                if (!m_handshakeReceived)
+                if (!processed)
                 {
-                    if (result.has_field(_XPLATSTR("error")))
-                    {
-                        auto error = result.at(_XPLATSTR("error")).as_string();
-                        m_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("handshake error: "))
-                            .append(error));
-                        m_handshakeTask.set_exception(signalr_exception(utility::string_t(_XPLATSTR("Received an error during handshake: ")).append(error)));
-                        return;
-                    }
-                    else
-                    {
-                        if (result.has_field(_XPLATSTR("type")))
-                        {
-                            m_handshakeTask.set_exception(signalr_exception(utility::string_t(_XPLATSTR("Received unexpected message while waiting for the handshake response."))));
-                        }
-                        m_handshakeReceived = true;
-                        m_handshakeTask.set();
-                        return;
-                    }
+                    return;
                 }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            m_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("error occured when parsing response: "))
+                .append(utility::conversions::to_string_t(e.what()))
+                .append(_XPLATSTR(". response: "))
+                .append(response));
+        }
+    }
+
+    // Parses the records of the message concurrently and processes them in order once all of them are parsed.
+    // Records are always parsed into web::json::values since these don't share an arena.
+    void hub_connection_impl::process_message_in_parallel(const utility::string_t& response)
+    {
+        auto parse = std::make_shared<parallel_parse>();
+        parse->message = &response;
+        parse->next_record = 0;
+        parse->parsed_count = 0;
+
+        std::size_t lastPos = 0;
+        for (auto pos = response.find('\x1e'); pos != utility::string_t::npos; lastPos = pos + 1, pos = response.find('\x1e', lastPos))
+        {
+            parse->records.push_back(parallel_parse::record{ lastPos, pos - lastPos, json::value(), nullptr });
+        }
+
+        const auto batch_count = (parse->records.size() + parse_batch_size - 1) / parse_batch_size;
+        const auto helper_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U) - 1, batch_count - 1);
+        for (size_t i = 0; i < helper_count; ++i)
+        {
+            pplx::create_task([parse]() { parse_claimed_records(*parse); });
+        }
+
+        parse_claimed_records(*parse);
+        wait_parsed(*parse);
+
+        for (const auto& record : parse->records)
+        {
+            if (record.error)
+            {
+                // records after a record which can't be parsed are ignored like when parsing sequentially
+                std::rethrow_exception(record.error);
+            }
+
+            // views of the previous record are no longer in use so its nodes can be released
+            m_json_parser.reset();
+
+            if (!process_record(record.value, response.data() + record.offset, record.length))
+            {
+                return;
+            }
+        }
+    }
 
-                auto messageType = result.at(_XPLATSTR("type"));
-                switch (messageType.as_integer())
+    // processes a single record of a received message, `Message` is either a web::json::value or a json_view.
+    // Returns false if the remaining records of the message should be ignored.
+    template <typename Message>
+    bool hub_connection_impl::process_record(const Message& result, const utility::char_t* text, size_t length)
+    {
+        if (!result.is_object())
+        {
+            m_logger.log(trace_level::info, utility::string_t(_XPLATSTR("unexpected response received from the server: "))
+                .append(text, length));
+
+            return false;
+        }
+
+        if (!m_handshakeReceived)
+        {
+            std::lock_guard<std::mutex> lock(m_handshake_lock);
+            if (result.has_field(_XPLATSTR("error")))
+            {
+                auto error = result.at(_XPLATSTR("error")).as_string();
+                m_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("handshake error: "))
+                    .append(error));
+                m_handshakeTask.set_exception(signalr_exception(utility::string_t(_XPLATSTR("Received an error during handshake: ")).append(error)));
+                return false;
+            }
+            else
+            {
+                if (result.has_field(_XPLATSTR("type")))
                 {
-                case MessageType::Invocation:
+                    m_handshakeTask.set_exception(signalr_exception(utility::string_t(_XPLATSTR("Received unexpected message while waiting for the handshake response."))));
+                }
+                m_handshakeReceived = true;
+                m_handshakeTask.set();
+                return true;
+            }
+        }
+
+        const auto messageType = result.at(_XPLATSTR("type")).as_integer();
+
+        // messages replayed by the server after the transport reconnected which were already processed
+        // are skipped
+        if (m_stateful_reconnect && messageType >= MessageType::Invocation &&
+            messageType <= MessageType::CancelInvocation && !track_received_message())
+        {
+            return true;
+        }
+
+        switch (messageType)
+        {
+        case MessageType::Invocation:
+        {
+            auto method = result.at(_XPLATSTR("target")).as_string();
+            if (!m_cache_invalidations.empty())
+            {
+                auto invalidated = m_cache_invalidations.find(method);
+                if (invalidated != m_cache_invalidations.end())
                 {
-                    auto method = result.at(_XPLATSTR("target")).as_string();
-                    auto event = m_subscriptions.find(method);
-                    if (event != m_subscriptions.end())
+                    for (const auto& cache : invalidated->second)
                     {
-                        event->second(result.at(_XPLATSTR("arguments")));
+                        cache->clear();
                     }
-                    break;
                 }
-                case MessageType::StreamInvocation:
-                    // Sent to server only, should not be received by client
-                    throw std::runtime_error("Received unexpected message type 'StreamInvocation'.");
-                case MessageType::StreamItem:
-                    // TODO
-                    break;
-                case MessageType::Completion:
+            }
+
+            auto event = m_subscriptions.find(method);
+            if (event != m_subscriptions.end())
+            {
+                auto dispatch = std::atomic_load(&m_partitioned_dispatch);
+                if (event->second.queue)
                 {
-                    if (result.has_field(_XPLATSTR("error")) && result.has_field(_XPLATSTR("result")))
-                    {
-                        // TODO: error
-                    }
-                    invoke_callback(result);
-                    break;
+                    enqueue_subscription(event->second, result.at(_XPLATSTR("arguments")));
+                }
+                else if (dispatch)
+                {
+                    dispatch_subscription(*dispatch, event->second, method, result.at(_XPLATSTR("arguments")));
                 }
-                case MessageType::CancelInvocation:
-                    // Sent to server only, should not be received by client
-                    throw std::runtime_error("Received unexpected message type 'CancelInvocation'.");
-                case MessageType::Ping:
-                    // TODO
-                    break;
-                case MessageType::Close:
-                    // TODO
-                    break;
+                else
+                {
+                    invoke_subscription(event->second, result.at(_XPLATSTR("arguments")));
                 }
+            }
+            break;
+        }
+        case MessageType::StreamInvocation:
+            // Sent to server only, should not be received by client
+            throw std::runtime_error("Received unexpected message type 'StreamInvocation'.");
+        case MessageType::StreamItem:
+            // TODO
+            break;
+        case MessageType::Completion:
+        {
+            if (result.has_field(_XPLATSTR("error")) && result.has_field(_XPLATSTR("result")))
+            {
+                // TODO: error
+            }
+            invoke_callback(result);
+            break;
+        }
+        case MessageType::CancelInvocation:
+            // Sent to server only, should not be received by client
+            throw std::runtime_error("Received unexpected message type 'CancelInvocation'.");
+        case MessageType::Ping:
+            // TODO
+            break;
+        case MessageType::Close:
+            // TODO
+            break;
+        case MessageType::Ack:
+        {
+            std::lock_guard<std::mutex> lock(m_sequence_lock);
+            if (m_replay_buffer)
+            {
+                m_replay_buffer->acknowledge(get_sequence_id(result));
+            }
+            break;
+        }
+        case MessageType::Sequence:
+            process_sequence(get_sequence_id(result));
+            break;
+        }
+
+        return true;
+    }
 
-                lastPos = pos + 1;
-                pos = response.find('\x1e', lastPos);
+    void hub_connection_impl::invoke_subscription(const subscription& subscription, const json::value& arguments)
+    {
+        if (subscription.handler)
+        {
+            subscription.handler(arguments);
+        }
+        else
+        {
+            subscription.view_handler(m_json_parser.import(arguments));
+        }
+    }
+
+    void hub_connection_impl::invoke_subscription(const subscription& subscription, const json_view& arguments)
+    {
+        if (subscription.view_handler)
+        {
+            subscription.view_handler(arguments);
+        }
+        else
+        {
+            subscription.handler(arguments.to_value());
+        }
+    }
+
+    // the queue keeps a copy of the arguments since the message is gone by the time the handler gets them
+    void hub_connection_impl::enqueue_subscription(const subscription& subscription, const json::value& arguments)
+    {
+        subscription.queue->push(arguments);
+    }
+
+    void hub_connection_impl::enqueue_subscription(const subscription& subscription, const json_view& arguments)
+    {
+        subscription.queue->push(arguments.to_value());
+    }
+
+    // The handler is invoked on a dispatch thread after the message has been processed so it gets a copy of the
+    // arguments. Subscriptions can't be changed unless the connection is disconnected so the subscription outlives
+    // the dispatch as long as the connection does.
+    void hub_connection_impl::dispatch_subscription(const partitioned_dispatch& dispatch, const subscription& subscription,
+        const utility::string_t& target, const json::value& arguments)
+    {
+        auto shared_arguments = std::make_shared<const json::value>(arguments);
+        const auto key = dispatch.key_extractor(target, *shared_arguments);
+
+        auto weak_connection = weak_from_this();
+        auto dispatched_subscription = &subscription;
+        dispatch.dispatcher->dispatch(key, [weak_connection, dispatched_subscription, shared_arguments]()
+        {
+            auto connection = weak_connection.lock();
+            if (!connection)
+            {
+                return;
             }
+
+            try
+            {
+                if (dispatched_subscription->handler)
+                {
+                    dispatched_subscription->handler(*shared_arguments);
+                }
+                else
+                {
+                    json_arena_parser parser;
+                    dispatched_subscription->view_handler(parser.import(*shared_arguments));
+                }
+            }
+            catch (const std::exception& e)
+            {
+                connection->m_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("dispatched handler threw an exception: "))
+                    .append(utility::conversions::to_string_t(e.what())));
+            }
+            catch (...)
+            {
+                connection->m_logger.log(trace_level::errors, _XPLATSTR("dispatched handler threw an unknown exception"));
+            }
+        });
+    }
+
+    void hub_connection_impl::dispatch_subscription(const partitioned_dispatch& dispatch, const subscription& subscription,
+        const utility::string_t& target, const json_view& arguments)
+    {
+        dispatch_subscription(dispatch, subscription, target, arguments.to_value());
+    }
+
+    // returns false if the message was already received before the transport reconnected
+    bool hub_connection_impl::track_received_message()
+    {
+        const auto sequence_id = m_next_received_sequence_id++;
+        if (sequence_id <= m_received_sequence_id)
+        {
+            return false;
         }
-        catch (const std::exception &e)
+
+        m_received_sequence_id = sequence_id;
+        schedule_ack();
+        return true;
+    }
+
+    // the server sends the sequence id of the first message it is going to (re)send after the transport reconnected
+    void hub_connection_impl::process_sequence(int64_t sequence_id)
+    {
+        if (sequence_id > m_received_sequence_id + 1)
         {
-            m_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("error occured when parsing response: "))
-                .append(utility::conversions::to_string_t(e.what()))
-                .append(_XPLATSTR(". response: "))
-                .append(response));
+            m_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("messages were lost while the transport was reconnecting. expected sequence id: "))
+                .append(utility::conversions::to_string_t(std::to_string(m_received_sequence_id + 1)))
+                .append(_XPLATSTR(", received sequence id: "))
+                .append(utility::conversions::to_string_t(std::to_string(sequence_id))));
+
+            stop();
+            return;
+        }
+
+        m_next_received_sequence_id = sequence_id;
+    }
+
+    void hub_connection_impl::schedule_ack()
+    {
+        if (m_ack_scheduled.exchange(true))
+        {
+            return;
+        }
+
+        auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+        m_timer_wheel->schedule(ack_interval, [weak_hub_connection]()
+        {
+            auto hub_connection = weak_hub_connection.lock();
+            if (hub_connection)
+            {
+                hub_connection->send_ack();
+            }
+        });
+    }
+
+    void hub_connection_impl::send_ack()
+    {
+        m_ack_scheduled = false;
+
+        if (get_connection_state() != connection_state::connected)
+        {
+            return;
+        }
+
+        json::value ack;
+        ack[_XPLATSTR("type")] = json::value(MessageType::Ack);
+        ack[_XPLATSTR("sequenceId")] = json::value::number(m_received_sequence_id.load());
+
+        auto logger = m_logger;
+        m_connection->send(ack.serialize() + _XPLATSTR('\x1e'))
+            .then([logger](pplx::task<void> send_task)
+            {
+                try
+                {
+                    send_task.get();
+                }
+                catch (const std::exception& e)
+                {
+                    logger.log(trace_level::info, utility::string_t(_XPLATSTR("failed to send Ack: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+                }
+            });
+    }
+
+    // sends all messages the server has not acknowledged on the reconnected transport, preceded by the sequence id
+    // of the first of them so that the server can skip the ones it already received
+    void hub_connection_impl::replay_messages()
+    {
+        std::lock_guard<std::mutex> lock(m_sequence_lock);
+
+        if (!m_replay_buffer)
+        {
+            return;
         }
+
+        m_logger.log(trace_level::info, utility::string_t(_XPLATSTR("replaying "))
+            .append(utility::conversions::to_string_t(std::to_string(m_replay_buffer->size())))
+            .append(_XPLATSTR(" unacknowledged message(s)")));
+
+        json::value sequence;
+        sequence[_XPLATSTR("type")] = json::value(MessageType::Sequence);
+        sequence[_XPLATSTR("sequenceId")] = json::value::number(m_replay_buffer->get_first_sequence_id());
+
+        auto logger = m_logger;
+        auto observe_send = [logger](pplx::task<void> send_task)
+        {
+            try
+            {
+                send_task.get();
+            }
+            catch (const std::exception& e)
+            {
+                logger.log(trace_level::info, utility::string_t(_XPLATSTR("failed to replay message: "))
+                    .append(utility::conversions::to_string_t(e.what())));
+            }
+        };
+
+        m_connection->send(sequence.serialize() + _XPLATSTR('\x1e')).then(observe_send);
+
+        auto connection = m_connection;
+        m_replay_buffer->for_each([&connection, &observe_send](const utility::string_t& message)
+        {
+            connection->send(message).then(observe_send);
+        });
+    }
+
+    // Messages sent when using stateful reconnect are retained until the server acknowledges them, each record of
+    // the message with a sequence id of its own. A failed send does not fail the operation since the message will
+    // be replayed once the transport reconnects, unless `fail_if_not_sent` is set for callers that need to know
+    // whether the transport sent the message.
+    pplx::task<void> hub_connection_impl::send_sequenced(const utility::string_t& message, bool fail_if_not_sent)
+    {
+        if (!m_stateful_reconnect || get_connection_state() != connection_state::connected)
+        {
+            return m_connection->send(message);
+        }
+
+        std::lock_guard<std::mutex> lock(m_sequence_lock);
+
+        if (!m_replay_buffer->append_records(message))
+        {
+            return pplx::task_from_exception<void>(signalr_exception(
+                _XPLATSTR("the message cannot be sent because the stateful reconnect buffer is full. messages are released when the server acknowledges them.")));
+        }
+
+        if (fail_if_not_sent)
+        {
+            return m_connection->send(message);
+        }
+
+        auto logger = m_logger;
+        return m_connection->send(message)
+            .then([logger](pplx::task<void> send_task)
+            {
+                try
+                {
+                    send_task.get();
+                }
+                catch (const std::exception& e)
+                {
+                    logger.log(trace_level::info, utility::string_t(_XPLATSTR("message will be replayed after the transport reconnects. send failed due to: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+                }
+            });
     }
 
     bool hub_connection_impl::invoke_callback(const web::json::value& message)
@@ -277,76 +1146,501 @@ namespace signalr
         return true;
     }
 
+    // the result of an invocation outlives the received message so the completion message is copied
+    bool hub_connection_impl::invoke_callback(const json_view& message)
+    {
+        return invoke_callback(message.to_value());
+    }
+
     pplx::task<json::value> hub_connection_impl::invoke(const utility::string_t& method_name, const json::value& arguments)
     {
-        _ASSERTE(arguments.is_array());
+        return invoke(invocation_envelope(method_name), arguments);
+    }
 
-        pplx::task_completion_event<json::value> tce;
+    pplx::task<void> hub_connection_impl::send(const utility::string_t& method_name, const json::value& arguments)
+    {
+        return send(invocation_envelope(method_name), arguments);
+    }
+
+    std::shared_ptr<const invocation_envelope> hub_connection_impl::prepare(const utility::string_t& method_name)
+    {
+        if (method_name.length() == 0)
+        {
+            throw std::invalid_argument("method_name cannot be empty");
+        }
+
+        return std::make_shared<const invocation_envelope>(method_name);
+    }
+
+    pplx::task<json::value> hub_connection_impl::invoke(const invocation_envelope& envelope, const json::value& arguments)
+    {
+        return invoke(envelope, arguments, get_invocation_timeout(), pplx::cancellation_token::none());
+    }
+
+    // a timeout of zero means the invocation does not time out
+    pplx::task<json::value> hub_connection_impl::invoke(const invocation_envelope& envelope, const json::value& arguments,
+        std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token)
+    {
+        if (cancellation_token.is_canceled())
+        {
+            return pplx::task_from_exception<json::value>(pplx::task_canceled());
+        }
 
-        const auto callback_id = m_callback_manager.register_callback(
-            create_hub_invocation_callback(m_logger, [tce](const json::value& result) { tce.set(result); },
-                [tce](const std::exception_ptr e) { tce.set_exception(e); }));
+        pplx::task_completion_event<json::value> tce;
 
-        invoke_hub_method(method_name, arguments, callback_id, nullptr,
-            [tce](const std::exception_ptr e){ tce.set_exception(e); });
+        invoke(envelope, arguments, timeout, cancellation_token, [tce](const json::value& result, std::exception_ptr exception)
+        {
+            if (exception)
+            {
+                tce.set_exception(exception);
+            }
+            else
+            {
+                tce.set(result);
+            }
+        });
 
         return pplx::create_task(tce);
     }
 
-    pplx::task<void> hub_connection_impl::send(const utility::string_t& method_name, const json::value& arguments)
+    void hub_connection_impl::invoke(const invocation_envelope& envelope, const json::value& arguments,
+        const std::function<void(const json::value&, std::exception_ptr)>& completion)
+    {
+        invoke(envelope, arguments, get_invocation_timeout(), pplx::cancellation_token::none(), completion);
+    }
+
+    // the completion handler is invoked exactly once, either with the result of the invocation or with the error
+    // that made the invocation fail. It may be invoked before this function returns.
+    void hub_connection_impl::invoke(const invocation_envelope& envelope, const json::value& arguments,
+        std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token,
+        const std::function<void(const json::value&, std::exception_ptr)>& completion)
     {
         _ASSERTE(arguments.is_array());
 
+        if (cancellation_token.is_canceled())
+        {
+            completion(json::value::null(), std::make_exception_ptr(pplx::task_canceled()));
+            return;
+        }
+
+        const auto cache = m_result_caches.empty()
+            ? m_result_caches.end()
+            : m_result_caches.find(envelope.get_method_name());
+        const auto coalesced_method = m_coalesced_methods.empty() || cancellation_token.is_cancelable()
+            ? m_coalesced_methods.end()
+            : m_coalesced_methods.find(envelope.get_method_name());
+        if (cache == m_result_caches.end() && coalesced_method == m_coalesced_methods.end())
+        {
+            make_invocation(envelope, arguments, timeout, cancellation_token, completion);
+            return;
+        }
+
+        // results are cached and invocations are coalesced by the serialized arguments
+        const auto serialized_arguments = arguments.serialize();
+        if (cache == m_result_caches.end())
+        {
+            coalesce_invocation(*coalesced_method, envelope, arguments, serialized_arguments, timeout, cancellation_token, completion);
+            return;
+        }
+
+        json::value cached_result;
+        uint64_t generation = 0;
+        if (cache->second->try_get(serialized_arguments, cached_result, generation))
+        {
+            completion(cached_result, nullptr);
+            return;
+        }
+
+        auto result_cache = cache->second;
+        auto caching_completion = [result_cache, serialized_arguments, generation, completion](const json::value& result, std::exception_ptr exception)
+        {
+            if (!exception)
+            {
+                result_cache->add(serialized_arguments, result, generation);
+            }
+
+            completion(result, exception);
+        };
+
+        if (coalesced_method == m_coalesced_methods.end())
+        {
+            make_invocation(envelope, arguments, timeout, cancellation_token, caching_completion);
+        }
+        else
+        {
+            coalesce_invocation(*coalesced_method, envelope, arguments, serialized_arguments, timeout, cancellation_token, caching_completion);
+        }
+    }
+
+    // sends the invocation unless an invocation with the same arguments is in flight in which case the invocation
+    // completes when the one in flight completes
+    void hub_connection_impl::coalesce_invocation(const utility::string_t& method_name, const invocation_envelope& envelope,
+        const json::value& arguments, const utility::string_t& serialized_arguments, std::chrono::milliseconds timeout,
+        const pplx::cancellation_token& cancellation_token, const std::function<void(const json::value&, std::exception_ptr)>& completion)
+    {
+        // the record separator does not occur in serialized json so keys of different methods can't collide
+        auto key = utility::string_t(method_name).append(1, _XPLATSTR('\x1e')).append(serialized_arguments);
+        auto joined = std::make_shared<std::vector<std::function<void(const json::value&, std::exception_ptr)>>>();
+
+        {
+            std::lock_guard<std::mutex> lock(m_coalesced_invocations_lock);
+            auto invocation = m_coalesced_invocations.find(key);
+            if (invocation != m_coalesced_invocations.end())
+            {
+                invocation->second->push_back(completion);
+                return;
+            }
+
+            m_coalesced_invocations.insert(std::make_pair(key, joined));
+        }
+
+        auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+        make_invocation(envelope, arguments, timeout, cancellation_token,
+            [weak_hub_connection, key, joined, completion](const json::value& result, std::exception_ptr exception)
+            {
+                // invocations join only while the connection is alive, after that the completions can be taken as is
+                std::vector<std::function<void(const json::value&, std::exception_ptr)>> completions;
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection)
+                {
+                    std::lock_guard<std::mutex> lock(hub_connection->m_coalesced_invocations_lock);
+                    hub_connection->m_coalesced_invocations.erase(key);
+                    completions.swap(*joined);
+                }
+                else
+                {
+                    completions.swap(*joined);
+                }
+
+                completion(result, exception);
+                for (const auto& joined_completion : completions)
+                {
+                    joined_completion(result, exception);
+                }
+            });
+    }
+
+    void hub_connection_impl::make_invocation(const invocation_envelope& envelope, const json::value& arguments,
+        std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token,
+        const std::function<void(const json::value&, std::exception_ptr)>& completion)
+    {
+        std::shared_ptr<traced_invocation> trace;
+        if (m_invocation_trace_sink)
+        {
+            trace = std::make_shared<traced_invocation>(m_invocation_trace_sink);
+        }
+
+        std::shared_ptr<limited_invocation> limited;
+        std::shared_ptr<pending_invocation> invocation;
+        if (m_invocation_limiter)
+        {
+            limited = std::make_shared<limited_invocation>(m_invocation_limiter);
+            invocation = std::make_shared<pending_invocation>([limited, completion](const json::value& result, std::exception_ptr exception)
+            {
+                limited->complete(limited_invocation::outcome::completed);
+                completion(result, exception);
+            }, trace);
+        }
+        else
+        {
+            invocation = std::make_shared<pending_invocation>(completion, trace);
+        }
+
+        const auto callback_id = m_callback_manager.register_callback(create_hub_invocation_callback(invocation));
+
+        auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+
+        if (timeout.count() > 0)
+        {
+            m_timer_wheel->start();
+            const auto timer_id = m_timer_wheel->schedule(timeout, [weak_hub_connection, callback_id, invocation, limited, timeout]()
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection && hub_connection->abandon_invocation(callback_id, invocation->abandon()))
+                {
+                    if (limited)
+                    {
+                        limited->complete(limited_invocation::outcome::timed_out);
+                    }
+
+                    invocation->complete(json::value::null(),
+                        std::make_exception_ptr(signalr_exception(utility::string_t(_XPLATSTR("the invocation timed out after "))
+                            .append(utility::conversions::to_string_t(std::to_string(timeout.count())))
+                            .append(_XPLATSTR(" ms")))), false, true);
+                }
+            });
+
+            invocation->set_timer(m_timer_wheel, timer_id);
+        }
+
+        if (cancellation_token.is_cancelable())
+        {
+            const auto registration = cancellation_token.register_callback([weak_hub_connection, callback_id, invocation, limited]()
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection && hub_connection->abandon_invocation(callback_id, invocation->abandon()))
+                {
+                    if (limited)
+                    {
+                        limited->complete(limited_invocation::outcome::canceled);
+                    }
+
+                    invocation->complete(json::value::null(), std::make_exception_ptr(pplx::task_canceled()), true, false);
+                }
+            });
+
+            invocation->set_registration(cancellation_token, registration);
+        }
+
+        auto send_completed = [invocation](std::exception_ptr exception) { invocation->complete(json::value::null(), exception, true, true); };
+
+        if (!limited)
+        {
+            if (invocation->try_send())
+            {
+                invoke_hub_method(envelope, arguments, callback_id, trace, send_completed);
+            }
+            return;
+        }
+
+        if (m_invocation_limiter->try_acquire())
+        {
+            if (limited->start() && invocation->try_send())
+            {
+                invoke_hub_method(envelope, arguments, callback_id, trace, send_completed);
+            }
+            return;
+        }
+
+        // the invocation is queued so it needs its own copy of the envelope and the arguments
+        const invocation_envelope queued_envelope(envelope);
+        const json::value queued_arguments(arguments);
+        m_invocation_limiter->enqueue([weak_hub_connection, queued_envelope, queued_arguments, callback_id, trace, invocation, limited, send_completed]()
+        {
+            // if the connection is gone the invocation is completed, and the permit released, by the callback manager
+            auto hub_connection = weak_hub_connection.lock();
+            if (hub_connection && limited->start() && invocation->try_send())
+            {
+                hub_connection->invoke_hub_method(queued_envelope, queued_arguments, callback_id, trace, send_completed);
+            }
+        });
+    }
+
+    pplx::task<void> hub_connection_impl::send(const invocation_envelope& envelope, const json::value& arguments)
+    {
         pplx::task_completion_event<void> tce;
 
-        invoke_hub_method(method_name, arguments, _XPLATSTR(""),
-            [tce]() { tce.set(); },
-            [tce](const std::exception_ptr e){ tce.set_exception(e); });
+        send(envelope, arguments, [tce](std::exception_ptr exception)
+        {
+            if (exception)
+            {
+                tce.set_exception(exception);
+            }
+            else
+            {
+                tce.set();
+            }
+        });
 
         return pplx::create_task(tce);
     }
 
-    void hub_connection_impl::invoke_hub_method(const utility::string_t& method_name, const json::value& arguments,
-        const utility::string_t& callback_id, std::function<void()> set_completion, std::function<void(const std::exception_ptr)> set_exception)
+    void hub_connection_impl::send(const invocation_envelope& envelope, const json::value& arguments,
+        const std::function<void(std::exception_ptr)>& completion)
+    {
+        _ASSERTE(arguments.is_array());
+
+        auto outbox = std::atomic_load(&m_outbox);
+        if (outbox)
+        {
+            send_through_outbox(outbox, envelope, arguments, completion);
+            return;
+        }
+
+        invoke_hub_method(envelope, arguments, _XPLATSTR(""), nullptr, completion);
+    }
+
+    // The message is sent once the messages appended to the outbox before it were sent. The send completes once the
+    // message was persisted in the outbox, regardless of the state of the connection.
+    void hub_connection_impl::send_through_outbox(const std::shared_ptr<durable_outbox>& outbox, const invocation_envelope& envelope,
+        const json::value& arguments, const std::function<void(std::exception_ptr)>& completion)
+    {
+        auto message = m_send_buffers.acquire();
+        envelope.write(message, _XPLATSTR(""), arguments);
+        const auto appended = outbox->append(message);
+        m_send_buffers.release(std::move(message));
+
+        if (!appended)
+        {
+            completion(std::make_exception_ptr(signalr_exception(
+                _XPLATSTR("the message cannot be sent because the outbox is full. messages are removed from the outbox once they were sent."))));
+            return;
+        }
+
+        completion(nullptr);
+        drain_outbox();
+    }
+
+    // Sends the oldest messages in the outbox as a single frame and removes them from the outbox once the transport
+    // sent the frame, then sends the next batch until the outbox is empty. Messages stay in the outbox if the
+    // connection is not connected or the frame could not be sent and are sent the next time the connection
+    // connects, even if stateful reconnect retained them for replay, since the replay buffer does not survive the
+    // connection.
+    void hub_connection_impl::drain_outbox()
     {
-        json::value request;
-        request[_XPLATSTR("type")] = json::value::value(1);
-        if (!callback_id.empty())
+        auto outbox = std::atomic_load(&m_outbox);
+        if (!outbox || !m_handshakeReceived || get_connection_state() != connection_state::connected ||
+            m_draining_outbox.exchange(true))
         {
-            request[_XPLATSTR("invocationId")] = json::value::string(callback_id);
+            return;
+        }
+
+        utility::string_t batch;
+        const auto count = outbox->read(batch, outbox_batch_size);
+        if (count == 0)
+        {
+            m_draining_outbox = false;
+
+            // a message appended after the outbox was read would otherwise not be sent until the next message is
+            if (outbox->size() > 0)
+            {
+                drain_outbox();
+            }
+
+            return;
+        }
+
+        auto weak_hub_connection = weak_from_this();
+        auto logger = m_logger;
+        send_sequenced(batch, /* fail_if_not_sent */ true)
+            .then([weak_hub_connection, outbox, count, logger](pplx::task<void> send_task)
+            {
+                auto sent = false;
+                try
+                {
+                    send_task.get();
+                    outbox->consume(count);
+                    sent = true;
+                }
+                catch (const std::exception& e)
+                {
+                    logger.log(trace_level::info, utility::string_t(_XPLATSTR("messages will be sent from the outbox after the connection connects. send failed due to: "))
+                        .append(utility::conversions::to_string_t(e.what())));
+                }
+
+                auto connection = weak_hub_connection.lock();
+                if (connection)
+                {
+                    connection->m_draining_outbox = false;
+                    if (sent)
+                    {
+                        connection->drain_outbox();
+                    }
+                }
+            });
+    }
+
+    // `send_completed` is invoked with the error if the message could not be sent. Messages that don't expect a
+    // result (i.e. the callback_id is empty) also invoke it with a null exception_ptr once the message was sent.
+    void hub_connection_impl::invoke_hub_method(const invocation_envelope& envelope, const json::value& arguments,
+        const utility::string_t& callback_id, const std::shared_ptr<traced_invocation>& trace,
+        const std::function<void(std::exception_ptr)>& send_completed)
+    {
+        auto request = m_send_buffers.acquire();
+        if (trace)
+        {
+            envelope.write(request, callback_id, arguments, trace->get_traceparent());
+            trace->mark(invocation_stage::serialized);
+        }
+        else
+        {
+            envelope.write(request, callback_id, arguments);
         }
-        request[_XPLATSTR("target")] = json::value::string(method_name);
-        request[_XPLATSTR("arguments")] = arguments;
 
         auto this_hub_connection = shared_from_this();
 
         // weak_ptr prevents a circular dependency leading to memory leak and other problems
         auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(this_hub_connection);
 
-        m_connection->send(request.serialize() + _XPLATSTR('\x1e'))
-            .then([set_completion, set_exception, weak_hub_connection, callback_id](pplx::task<void> send_task)
+        auto send_task = send_sequenced(request);
+        if (trace)
+        {
+            trace->mark(invocation_stage::enqueued);
+        }
+
+        // the transport copies the message before `send` returns so the buffer can be reused for the next message
+        m_send_buffers.release(std::move(request));
+
+        send_task.then([send_completed, weak_hub_connection, callback_id, trace](pplx::task<void> send_task)
             {
                 try
                 {
                     send_task.get();
+                    if (trace)
+                    {
+                        trace->mark(invocation_stage::frame_written);
+                    }
+
                     if (callback_id.empty())
                     {
                         // complete nonBlocking call
-                        set_completion();
+                        send_completed(nullptr);
                     }
                 }
                 catch (const std::exception&)
                 {
-                    set_exception(std::current_exception());
+                    send_completed(std::current_exception());
                     auto hub_connection = weak_hub_connection.lock();
                     if (hub_connection)
                     {
                         hub_connection->m_callback_manager.remove_callback(callback_id);
                     }
                 }
+
+                if (trace)
+                {
+                    trace->release();
+                }
             });
     }
 
+    // stops tracking an invocation whose result is no longer awaited and, if the invocation was sent, lets the
+    // server know that it can abandon the invocation. Returns false if the invocation has already completed.
+    bool hub_connection_impl::abandon_invocation(const utility::string_t& callback_id, bool sent)
+    {
+        if (!m_callback_manager.remove_callback(callback_id))
+        {
+            return false;
+        }
+
+        // an invocation still queued by the invocation limiter never reached the server
+        if (sent && get_connection_state() == connection_state::connected)
+        {
+            json::value cancel_invocation;
+            cancel_invocation[_XPLATSTR("type")] = json::value(MessageType::CancelInvocation);
+            cancel_invocation[_XPLATSTR("invocationId")] = json::value::string(callback_id);
+
+            auto logger = m_logger;
+            send_sequenced(cancel_invocation.serialize() + _XPLATSTR('\x1e'))
+                .then([logger, callback_id](pplx::task<void> send_task)
+                {
+                    try
+                    {
+                        send_task.get();
+                    }
+                    catch (const std::exception& e)
+                    {
+                        logger.log(trace_level::info, utility::string_t(_XPLATSTR("failed to send CancelInvocation for id: "))
+                            .append(callback_id)
+                            .append(_XPLATSTR(". error: "))
+                            .append(utility::conversions::to_string_t(e.what())));
+                    }
+                });
+        }
+
+        return true;
+    }
+
     connection_state hub_connection_impl::get_connection_state() const noexcept
     {
         return m_connection->get_connection_state();
@@ -357,10 +1651,64 @@ namespace signalr
         return m_connection->get_connection_id();
     }
 
+    connect_timings hub_connection_impl::get_connect_timings() const
+    {
+        return m_connection->get_connect_timings();
+    }
+
+    // The outbox can only be replaced while no batch is being sent from it, which can still be the case right after
+    // the connection stopped, since the batch would otherwise be consumed from an outbox that was closed. Claiming
+    // the drain flag keeps batches from being sent while the outbox is replaced.
     void hub_connection_impl::set_client_config(const signalr_client_config& config)
     {
+        auto outbox = std::atomic_load(&m_outbox);
+        const auto outbox_directory = config.get_outbox_directory();
+        const auto outbox_changed = outbox_directory.empty() ? static_cast<bool>(outbox)
+            : !outbox || outbox->get_directory() != outbox_directory || outbox->get_max_size() != config.get_outbox_size();
+
+        if (outbox_changed && m_draining_outbox.exchange(true))
+        {
+            throw signalr_exception(_XPLATSTR("cannot change the outbox while messages are being sent from it."));
+        }
+
+        try
+        {
+            m_connection->set_client_config(config);
+        }
+        catch (...)
+        {
+            if (outbox_changed)
+            {
+                m_draining_outbox = false;
+            }
+
+            throw;
+        }
+
         m_signalr_client_config = config;
-        m_connection->set_client_config(config);
+
+        // the outbox is opened right away since messages can be sent through it before the connection is started
+        if (outbox_changed)
+        {
+            // the segments of the current outbox have to be closed before they can be opened again
+            std::atomic_store(&m_outbox, std::shared_ptr<durable_outbox>());
+            outbox.reset();
+
+            try
+            {
+                if (!outbox_directory.empty())
+                {
+                    std::atomic_store(&m_outbox, std::make_shared<durable_outbox>(outbox_directory, config.get_outbox_size()));
+                }
+            }
+            catch (...)
+            {
+                m_draining_outbox = false;
+                throw;
+            }
+
+            m_draining_outbox = false;
+        }
     }
 
     void hub_connection_impl::set_disconnected(const std::function<void()>& disconnected)
@@ -368,27 +1716,42 @@ namespace signalr
         m_disconnected = disconnected;
     }
 
+    void hub_connection_impl::set_invocation_timeout(std::chrono::milliseconds timeout)
+    {
+        if (timeout.count() < 0)
+        {
+            throw std::invalid_argument("timeout cannot be negative");
+        }
+
+        m_invocation_timeout = timeout.count();
+    }
+
+    std::chrono::milliseconds hub_connection_impl::get_invocation_timeout() const noexcept
+    {
+        return std::chrono::milliseconds(m_invocation_timeout.load());
+    }
+
     // unnamed namespace makes it invisble outside this translation unit
     namespace
     {
-        static std::function<void(const json::value&)> create_hub_invocation_callback(const logger& logger,
-            const std::function<void(const json::value&)>& set_result,
-            const std::function<void(const std::exception_ptr)>& set_exception)
+        static std::function<void(const json::value&)> create_hub_invocation_callback(const std::shared_ptr<pending_invocation>& invocation)
         {
-            return [logger, set_result, set_exception](const json::value& message)
+            return [invocation](const json::value& message)
             {
                 if (message.has_field(_XPLATSTR("result")))
                 {
-                    set_result(message.at(_XPLATSTR("result")));
+                    invocation->complete(message.at(_XPLATSTR("result")), nullptr, true, true);
                 }
                 else if (message.has_field(_XPLATSTR("error")))
                 {
-                    set_exception(
+                    invocation->complete(json::value::null(),
                         std::make_exception_ptr(
-                            hub_exception(message.at(_XPLATSTR("error")).serialize())));
+                            hub_exception(message.at(_XPLATSTR("error")).serialize())), true, true);
+                }
+                else
+                {
+                    invocation->complete(json::value::null(), nullptr, true, true);
                 }
-
-                set_result(json::value::null());
             };
         }
     }
@@ -3,11 +3,24 @@
 
 #pragma once
 
+#include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include "cpprest/details/basic_types.h"
 #include "connection_impl.h"
 #include "callback_manager.h"
 #include "case_insensitive_comparison_utils.h"
+#include "invocation_envelope.h"
+#include "string_buffer_pool.h"
+#include "timer_wheel.h"
+#include "replay_buffer.h"
+#include "json_arena_parser.h"
+#include "traced_invocation.h"
+#include "partitioned_dispatcher.h"
+#include "inbound_queue.h"
+#include "invocation_limiter.h"
+#include "result_cache.h"
+#include "durable_outbox.h"
 
 using namespace web;
 
@@ -28,42 +41,168 @@ namespace signalr
             const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
             std::unique_ptr<transport_factory> transport_factory);
 
+        static std::shared_ptr<hub_connection_impl> create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+            const std::shared_ptr<log_writer>& log_writer);
+
+        static std::shared_ptr<hub_connection_impl> create(const std::vector<utility::string_t>& urls, trace_level trace_level,
+            const std::shared_ptr<log_writer>& log_writer, std::unique_ptr<web_request_factory> web_request_factory,
+            std::unique_ptr<transport_factory> transport_factory);
+
         hub_connection_impl(const hub_connection_impl&) = delete;
         hub_connection_impl& operator=(const hub_connection_impl&) = delete;
 
         void on(const utility::string_t& event_name, const std::function<void(const json::value &)>& handler);
+        void on(const utility::string_t& event_name, const std::function<void(const json_view&)>& handler);
+        void on(const utility::string_t& event_name, const std::function<void(const json::value &)>& handler,
+            const inbound_queue_config& queue_config);
+        inbound_queue_stats get_inbound_queue_stats(const utility::string_t& event_name) const;
+        void coalesce_invocations(const utility::string_t& method_name);
+        void cache_results(const utility::string_t& method_name, const result_cache_config& cache_config);
+        result_cache_stats get_result_cache_stats(const utility::string_t& method_name) const;
+        void invalidate_cached_results(const utility::string_t& method_name);
 
         pplx::task<json::value> invoke(const utility::string_t& method_name, const json::value& arguments);
         pplx::task<void> send(const utility::string_t& method_name, const json::value& arguments);
 
+        std::shared_ptr<const invocation_envelope> prepare(const utility::string_t& method_name);
+        pplx::task<json::value> invoke(const invocation_envelope& envelope, const json::value& arguments);
+        pplx::task<json::value> invoke(const invocation_envelope& envelope, const json::value& arguments,
+            std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token);
+        pplx::task<void> send(const invocation_envelope& envelope, const json::value& arguments);
+
+        // callback based variants used by the awaitables; they don't create pplx tasks to return the result
+        void invoke(const invocation_envelope& envelope, const json::value& arguments,
+            const std::function<void(const json::value&, std::exception_ptr)>& completion);
+        void invoke(const invocation_envelope& envelope, const json::value& arguments, std::chrono::milliseconds timeout,
+            const pplx::cancellation_token& cancellation_token, const std::function<void(const json::value&, std::exception_ptr)>& completion);
+        void send(const invocation_envelope& envelope, const json::value& arguments, const std::function<void(std::exception_ptr)>& completion);
+
         pplx::task<void> start();
         pplx::task<void> stop();
 
         connection_state get_connection_state() const noexcept;
         utility::string_t get_connection_id() const;
+        connect_timings get_connect_timings() const;
 
         void set_client_config(const signalr_client_config& config);
         void set_disconnected(const std::function<void()>& disconnected);
+        void set_invocation_timeout(std::chrono::milliseconds timeout);
+        std::chrono::milliseconds get_invocation_timeout() const noexcept;
 
     private:
-        hub_connection_impl(const utility::string_t& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
+        // a subscription has either a handler that gets a copy of the arguments, one that gets a view of them or a
+        // queue which passes a copy of the arguments to the handler on the thread of the queue
+        struct subscription
+        {
+            std::function<void(const json::value&)> handler;
+            std::function<void(const json_view&)> view_handler;
+            std::shared_ptr<inbound_queue> queue;
+        };
+
+        hub_connection_impl(const std::vector<utility::string_t>& urls, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
             std::unique_ptr<web_request_factory> web_request_factory, std::unique_ptr<transport_factory> transport_factory);
 
         std::shared_ptr<connection_impl> m_connection;
         logger m_logger;
         callback_manager m_callback_manager;
-        std::unordered_map<utility::string_t, std::function<void(const json::value &)>, case_insensitive_hash, case_insensitive_equals> m_subscriptions;
-        bool m_handshakeReceived;
+        std::unordered_map<utility::string_t, subscription, case_insensitive_hash, case_insensitive_equals> m_subscriptions;
+        std::atomic<bool> m_handshakeReceived;
+        // the handshake is repeated with a new tce when the connection fails over, which may happen while the
+        // handshake response of the previous transport is being processed, so the tce is guarded by the lock
+        std::mutex m_handshake_lock;
         pplx::task_completion_event<void> m_handshakeTask;
         std::function<void()> m_disconnected;
         signalr_client_config m_signalr_client_config;
+        string_buffer_pool m_send_buffers;
+        // the wheel shared by all connections, invocation timeouts are accurate to a tick of the wheel
+        std::shared_ptr<timer_wheel> m_timer_wheel;
+        std::atomic<std::chrono::milliseconds::rep> m_invocation_timeout;
+
+        // stateful reconnect - outgoing messages are retained in the replay buffer until acknowledged by the
+        // server, incoming messages are counted to acknowledge them and to skip the ones replayed by the server
+        std::atomic<bool> m_stateful_reconnect;
+        std::mutex m_sequence_lock;
+        std::unique_ptr<replay_buffer> m_replay_buffer;
+        std::atomic<int64_t> m_received_sequence_id;
+        int64_t m_next_received_sequence_id;
+        std::atomic<bool> m_ack_scheduled;
+
+        // received messages are parsed into (or, when parsed into a web::json::value, imported to) the arena of
+        // the parser when using message_parsing::arena or when dispatching to a handler that takes a view
+        message_parsing m_message_parsing;
+        json_arena_parser m_json_parser;
+        // messages with at least this many records are parsed in parallel, 0 if messages are never parsed in parallel
+        size_t m_parallel_parsing_threshold;
+
+        // null unless invocations are traced
+        std::shared_ptr<invocation_trace_sink> m_invocation_trace_sink;
+
+        // how handlers are dispatched by partition key, see signalr_client_config::set_partition_key_extractor
+        struct partitioned_dispatch
+        {
+            signalr_client_config::partition_key_extractor key_extractor;
+            std::shared_ptr<partitioned_dispatcher> dispatcher;
+        };
+
+        // null unless handlers are dispatched by partition key. Replaced when the connection starts, which the
+        // receive thread of the previous start can race with, so it is loaded and stored atomically
+        std::shared_ptr<const partitioned_dispatch> m_partitioned_dispatch;
+
+        // null unless the number of invocations in flight is limited, see signalr_client_config::set_max_concurrent_invocations
+        std::shared_ptr<invocation_limiter> m_invocation_limiter;
+
+        // invocations of these methods are coalesced; an invocation in flight is keyed by the method name and the
+        // serialized arguments and holds the completions of the invocations that joined it
+        std::unordered_set<utility::string_t, case_insensitive_hash, case_insensitive_equals> m_coalesced_methods;
+        std::mutex m_coalesced_invocations_lock;
+        std::unordered_map<utility::string_t, std::shared_ptr<std::vector<std::function<void(const json::value&, std::exception_ptr)>>>> m_coalesced_invocations;
+
+        // the caches of the methods whose results are cached and the caches invalidated by each invalidation event
+        std::unordered_map<utility::string_t, std::shared_ptr<result_cache>, case_insensitive_hash, case_insensitive_equals> m_result_caches;
+        std::unordered_map<utility::string_t, std::vector<std::shared_ptr<result_cache>>, case_insensitive_hash, case_insensitive_equals> m_cache_invalidations;
+
+        // null unless messages are sent through a durable outbox, see signalr_client_config::set_outbox_directory.
+        // Only one batch of messages from the outbox is sent at a time
+        std::shared_ptr<durable_outbox> m_outbox;
+        std::atomic<bool> m_draining_outbox;
 
         void initialize();
 
         void process_message(const utility::string_t& message);
-
-        void invoke_hub_method(const utility::string_t& method_name, const json::value& arguments, const utility::string_t& callback_id,
-            std::function<void()> set_completion, std::function<void(const std::exception_ptr)> set_exception);
+        void process_message_in_parallel(const utility::string_t& message);
+        template <typename Message>
+        bool process_record(const Message& message, const utility::char_t* text, size_t length);
+        void invoke_subscription(const subscription& subscription, const json::value& arguments);
+        void invoke_subscription(const subscription& subscription, const json_view& arguments);
+        void dispatch_subscription(const partitioned_dispatch& dispatch, const subscription& subscription,
+            const utility::string_t& target, const json::value& arguments);
+        void dispatch_subscription(const partitioned_dispatch& dispatch, const subscription& subscription,
+            const utility::string_t& target, const json_view& arguments);
+        void enqueue_subscription(const subscription& subscription, const json::value& arguments);
+        void enqueue_subscription(const subscription& subscription, const json_view& arguments);
+        void add_subscription(const utility::string_t& event_name, const subscription& subscription);
+
+        void coalesce_invocation(const utility::string_t& method_name, const invocation_envelope& envelope, const json::value& arguments,
+            const utility::string_t& serialized_arguments, std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token,
+            const std::function<void(const json::value&, std::exception_ptr)>& completion);
+        void make_invocation(const invocation_envelope& envelope, const json::value& arguments, std::chrono::milliseconds timeout,
+            const pplx::cancellation_token& cancellation_token, const std::function<void(const json::value&, std::exception_ptr)>& completion);
+        void invoke_hub_method(const invocation_envelope& envelope, const json::value& arguments, const utility::string_t& callback_id,
+            const std::shared_ptr<traced_invocation>& trace, const std::function<void(std::exception_ptr)>& send_completed);
         bool invoke_callback(const web::json::value& message);
+        bool invoke_callback(const json_view& message);
+
+        pplx::task<void> send_sequenced(const utility::string_t& message, bool fail_if_not_sent = false);
+        void send_through_outbox(const std::shared_ptr<durable_outbox>& outbox, const invocation_envelope& envelope,
+            const json::value& arguments, const std::function<void(std::exception_ptr)>& completion);
+        void drain_outbox();
+        bool track_received_message();
+        void process_sequence(int64_t sequence_id);
+        void schedule_ack();
+        void send_ack();
+        void replay_messages();
+        pplx::task<void> send_handshake();
+        void handle_failed_over();
+        bool abandon_invocation(const utility::string_t& callback_id, bool sent);
     };
 }
@@ -0,0 +1,268 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "inbound_queue.h"
+#include <stdexcept>
+
+namespace signalr
+{
+    inbound_queue_config::inbound_queue_config()
+        : m_capacity(1000), m_overflow_policy(queue_overflow_policy::block)
+    { }
+
+    size_t inbound_queue_config::get_capacity() const noexcept
+    {
+        return m_capacity;
+    }
+
+    void inbound_queue_config::set_capacity(size_t capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("capacity must be greater than zero");
+        }
+
+        m_capacity = capacity;
+    }
+
+    queue_overflow_policy inbound_queue_config::get_overflow_policy() const noexcept
+    {
+        return m_overflow_policy;
+    }
+
+    void inbound_queue_config::set_overflow_policy(queue_overflow_policy overflow_policy)
+    {
+        m_overflow_policy = overflow_policy;
+    }
+
+    inbound_queue_config::conflation_key_extractor inbound_queue_config::get_conflation_key_extractor() const
+    {
+        return m_conflation_key_extractor;
+    }
+
+    void inbound_queue_config::set_conflation_key_extractor(const conflation_key_extractor& conflation_key_extractor)
+    {
+        m_conflation_key_extractor = conflation_key_extractor;
+    }
+
+    inbound_queue::shared_state::shared_state(const inbound_queue_config& config,
+        const std::function<void(const web::json::value&)>& handler, const logger& logger)
+        : config(config), handler(handler), queue_logger(logger), dropped(0), conflated(0), stopped(false), draining(false)
+    { }
+
+    inbound_queue::inbound_queue(const inbound_queue_config& config, const std::function<void(const web::json::value&)>& handler,
+        const logger& logger)
+    {
+        if (config.get_overflow_policy() == queue_overflow_policy::conflate && !config.get_conflation_key_extractor())
+        {
+            throw std::invalid_argument("a conflation key extractor is required to conflate invocations");
+        }
+
+        m_state = std::make_shared<shared_state>(config, handler, logger);
+        if (config.get_overflow_policy() == queue_overflow_policy::block)
+        {
+            m_thread = std::thread(&inbound_queue::run_thread, m_state);
+        }
+    }
+
+    inbound_queue::~inbound_queue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            m_state->stopped = true;
+        }
+        m_state->not_empty.notify_all();
+        m_state->not_full.notify_all();
+
+        // the thread exits once the handler it may be running returned, it holds on to the state until then
+        if (m_thread.joinable())
+        {
+            m_thread.detach();
+        }
+    }
+
+    void inbound_queue::push(web::json::value arguments)
+    {
+        auto& state = *m_state;
+        const auto conflate = state.config.get_overflow_policy() == queue_overflow_policy::conflate;
+
+        // the key is extracted outside of the lock since it runs user code. An invocation whose key cannot be
+        // extracted is queued without being conflated rather than failing the processing of the received message
+        utility::string_t key;
+        auto keyed = false;
+        if (conflate)
+        {
+            try
+            {
+                key = state.config.get_conflation_key_extractor()(arguments);
+                keyed = true;
+            }
+            catch (const std::exception& e)
+            {
+                state.queue_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("conflation key extractor threw an exception, the invocation is not conflated: "))
+                    .append(utility::conversions::to_string_t(e.what())));
+            }
+            catch (...)
+            {
+                state.queue_logger.log(trace_level::errors, _XPLATSTR("conflation key extractor threw an unknown exception, the invocation is not conflated"));
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(state.lock);
+
+            if (keyed)
+            {
+                auto queued = state.entries_by_key.find(key);
+                if (queued != state.entries_by_key.end())
+                {
+                    queued->second->arguments = std::move(arguments);
+                    ++state.conflated;
+                    return;
+                }
+            }
+
+            if (state.entries.size() >= state.config.get_capacity())
+            {
+                if (state.config.get_overflow_policy() == queue_overflow_policy::block)
+                {
+                    state.not_full.wait(lock, [&state]()
+                    {
+                        return state.stopped || state.entries.size() < state.config.get_capacity();
+                    });
+
+                    if (state.stopped)
+                    {
+                        return;
+                    }
+                }
+                else
+                {
+                    drop_oldest(state);
+                }
+            }
+
+            state.entries.push_back(entry{ std::move(key), std::move(arguments), keyed });
+            if (keyed)
+            {
+                state.entries_by_key.insert(std::make_pair(state.entries.back().key, std::prev(state.entries.end())));
+            }
+
+            if (!m_thread.joinable())
+            {
+                if (state.draining)
+                {
+                    return;
+                }
+
+                state.draining = true;
+            }
+        }
+
+        if (m_thread.joinable())
+        {
+            state.not_empty.notify_one();
+        }
+        else
+        {
+            auto shared_state = m_state;
+            pplx::create_task([shared_state]() { drain(shared_state); });
+        }
+    }
+
+    inbound_queue_stats inbound_queue::get_stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_state->lock);
+
+        inbound_queue_stats stats;
+        stats.depth = m_state->entries.size();
+        stats.dropped = m_state->dropped;
+        stats.conflated = m_state->conflated;
+        return stats;
+    }
+
+    void inbound_queue::drop_oldest(shared_state& state)
+    {
+        if (state.entries.front().keyed)
+        {
+            state.entries_by_key.erase(state.entries.front().key);
+        }
+
+        state.entries.pop_front();
+        ++state.dropped;
+    }
+
+    web::json::value inbound_queue::pop_oldest(shared_state& state)
+    {
+        if (state.entries.front().keyed)
+        {
+            state.entries_by_key.erase(state.entries.front().key);
+        }
+
+        auto arguments = std::move(state.entries.front().arguments);
+        state.entries.pop_front();
+        return arguments;
+    }
+
+    void inbound_queue::invoke_handler(shared_state& state, const web::json::value& arguments)
+    {
+        try
+        {
+            state.handler(arguments);
+        }
+        catch (const std::exception& e)
+        {
+            state.queue_logger.log(trace_level::errors, utility::string_t(_XPLATSTR("queued handler threw an exception: "))
+                .append(utility::conversions::to_string_t(e.what())));
+        }
+        catch (...)
+        {
+            state.queue_logger.log(trace_level::errors, _XPLATSTR("queued handler threw an unknown exception"));
+        }
+    }
+
+    void inbound_queue::run_thread(std::shared_ptr<shared_state> state)
+    {
+        for (;;)
+        {
+            web::json::value arguments;
+
+            {
+                std::unique_lock<std::mutex> lock(state->lock);
+                state->not_empty.wait(lock, [&state]() { return state->stopped || !state->entries.empty(); });
+                if (state->stopped)
+                {
+                    return;
+                }
+
+                arguments = pop_oldest(*state);
+            }
+
+            state->not_full.notify_one();
+
+            invoke_handler(*state, arguments);
+        }
+    }
+
+    void inbound_queue::drain(std::shared_ptr<shared_state> state)
+    {
+        for (;;)
+        {
+            web::json::value arguments;
+
+            {
+                std::lock_guard<std::mutex> lock(state->lock);
+                if (state->stopped || state->entries.empty())
+                {
+                    state->draining = false;
+                    return;
+                }
+
+                arguments = pop_oldest(*state);
+            }
+
+            invoke_handler(*state, arguments);
+        }
+    }
+}
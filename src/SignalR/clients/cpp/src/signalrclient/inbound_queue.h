@@ -0,0 +1,88 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "signalrclient/inbound_queue.h"
+#include "logger.h"
+
+namespace signalr
+{
+    // A bounded queue of the invocations of a subscription. Invocations are pushed by the thread receiving messages
+    // and passed to the handler one at a time, in the order they were pushed. What happens when the queue is full
+    // depends on the queue_overflow_policy of the config.
+    //
+    // Queued invocations are drained by a task on the pplx thread pool that is started when an invocation is pushed
+    // to an empty queue and ends once the queue is empty, so idle subscriptions don't hold a thread. Only a queue
+    // with queue_overflow_policy::block drains on a thread of its own: its push blocks the receiving thread, which
+    // may be a pool thread itself, until the handler made room and the handler must not wait for a pool thread then.
+    //
+    // Invocations still queued when the queue is destroyed are dropped. The destructor only stops the queue and does
+    // not wait for a running handler, which may run on a pool thread, to return; the drain task and the thread share
+    // the state of the queue and finish on their own.
+    class inbound_queue
+    {
+    public:
+        inbound_queue(const inbound_queue_config& config, const std::function<void(const web::json::value&)>& handler,
+            const logger& logger);
+
+        inbound_queue(const inbound_queue&) = delete;
+        inbound_queue& operator=(const inbound_queue&) = delete;
+
+        ~inbound_queue();
+
+        // blocks while the queue is full if the overflow policy is queue_overflow_policy::block
+        void push(web::json::value arguments);
+
+        inbound_queue_stats get_stats() const;
+
+    private:
+        struct entry
+        {
+            utility::string_t key;
+            web::json::value arguments;
+            // whether the entry is in `entries_by_key`, entries whose key could not be extracted are not conflated
+            bool keyed;
+        };
+
+        // shared with the thread so that a thread which destroys the queue (and is therefore detached) never
+        // touches the queue after it was destroyed
+        struct shared_state
+        {
+            shared_state(const inbound_queue_config& config, const std::function<void(const web::json::value&)>& handler,
+                const logger& logger);
+
+            const inbound_queue_config config;
+            const std::function<void(const web::json::value&)> handler;
+            logger queue_logger;
+
+            mutable std::mutex lock;
+            std::condition_variable not_empty;
+            std::condition_variable not_full;
+            std::list<entry> entries;
+            // the queued entry of each conflation key, only used by queue_overflow_policy::conflate
+            std::unordered_map<utility::string_t, std::list<entry>::iterator> entries_by_key;
+            uint64_t dropped;
+            uint64_t conflated;
+            bool stopped;
+            // whether a drain task is scheduled or running, not used with a thread
+            bool draining;
+        };
+
+        std::shared_ptr<shared_state> m_state;
+        std::thread m_thread;
+
+        static void drop_oldest(shared_state& state);
+        // takes the arguments of the oldest invocation, called with the lock held
+        static web::json::value pop_oldest(shared_state& state);
+        static void invoke_handler(shared_state& state, const web::json::value& arguments);
+        static void run_thread(std::shared_ptr<shared_state> state);
+        static void drain(std::shared_ptr<shared_state> state);
+    };
+}
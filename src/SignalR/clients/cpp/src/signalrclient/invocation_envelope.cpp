@@ -0,0 +1,94 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "invocation_envelope.h"
+#include <ostream>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        // a stream buffer that appends everything written to it to a string, used to serialize the arguments straight
+        // into the pooled buffer the message is built in
+        class string_append_buffer : public std::basic_streambuf<utility::char_t>
+        {
+        public:
+            explicit string_append_buffer(utility::string_t& buffer)
+                : m_buffer(buffer)
+            { }
+
+        protected:
+            int_type overflow(int_type ch) override
+            {
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                {
+                    m_buffer.push_back(traits_type::to_char_type(ch));
+                }
+
+                return traits_type::not_eof(ch);
+            }
+
+            std::streamsize xsputn(const char_type* s, std::streamsize count) override
+            {
+                m_buffer.append(s, static_cast<size_t>(count));
+                return count;
+            }
+
+        private:
+            utility::string_t& m_buffer;
+        };
+    }
+
+    invocation_envelope::invocation_envelope(const utility::string_t& method_name)
+        : m_method_name(method_name)
+    {
+        // serializing the method name as a json string takes care of escaping
+        m_suffix.append(_XPLATSTR(",\"target\":"))
+            .append(web::json::value::string(method_name).serialize())
+            .append(_XPLATSTR(",\"type\":1}\x1e"));
+    }
+
+    const utility::string_t& invocation_envelope::get_method_name() const noexcept
+    {
+        return m_method_name;
+    }
+
+    // clears the buffer and writes the complete invocation message, including the record separator, to it. An empty
+    // invocation id means that no result is expected and the invocationId field is omitted.
+    void invocation_envelope::write(utility::string_t& buffer, const utility::string_t& invocation_id, const web::json::value& arguments) const
+    {
+        write(buffer, invocation_id, arguments, utility::string_t());
+    }
+
+    // a non-empty traceparent is sent in the headers of the invocation
+    void invocation_envelope::write(utility::string_t& buffer, const utility::string_t& invocation_id, const web::json::value& arguments,
+        const utility::string_t& traceparent) const
+    {
+        buffer.clear();
+        buffer.append(_XPLATSTR("{\"arguments\":"));
+
+        string_append_buffer append_buffer(buffer);
+        utility::ostream_t stream(&append_buffer);
+        arguments.serialize(stream);
+
+        if (!traceparent.empty())
+        {
+            // traceparent values consist of hex digits and dashes only so don't need escaping
+            buffer.append(_XPLATSTR(",\"headers\":{\"traceparent\":\""))
+                .append(traceparent)
+                .append(_XPLATSTR("\"}"));
+        }
+
+        if (!invocation_id.empty())
+        {
+            // invocation ids are generated by the callback_manager and consist of digits only so don't need escaping
+            buffer.append(_XPLATSTR(",\"invocationId\":\""))
+                .append(invocation_id)
+                .append(_XPLATSTR("\""));
+        }
+
+        buffer.append(m_suffix);
+    }
+}
@@ -0,0 +1,29 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "cpprest/details/basic_types.h"
+#include "cpprest/json.h"
+
+namespace signalr
+{
+    // Holds the parts of a serialized hub invocation message that do not change from call to call. The message is
+    // written in the same form `web::json::value::serialize()` produces for the invocation object (i.e. with the
+    // fields ordered alphabetically) so only the arguments and the invocation id need to be serialized per call.
+    class invocation_envelope
+    {
+    public:
+        explicit invocation_envelope(const utility::string_t& method_name);
+
+        const utility::string_t& get_method_name() const noexcept;
+
+        void write(utility::string_t& buffer, const utility::string_t& invocation_id, const web::json::value& arguments) const;
+        void write(utility::string_t& buffer, const utility::string_t& invocation_id, const web::json::value& arguments,
+            const utility::string_t& traceparent) const;
+
+    private:
+        utility::string_t m_method_name;
+        utility::string_t m_suffix;
+    };
+}
@@ -0,0 +1,150 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "invocation_limiter.h"
+#include <algorithm>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        const double decrease_factor = 0.9;
+        // the fraction of the difference between a higher latency and the baseline the baseline moves up by
+        const int baseline_drift_divisor = 256;
+    }
+
+    const double invocation_limiter::latency_tolerance = 2.0;
+
+    // the first window is treated as complete so that the limit reacts to the first overload right away
+    invocation_limiter::invocation_limiter(size_t max_limit, bool adaptive)
+        : m_max_limit(max_limit), m_adaptive(adaptive), m_limit(static_cast<double>(max_limit)), m_in_flight(0),
+        m_starting(false), m_baseline_latency(0), m_completed_in_window(max_limit), m_overloaded_in_window(false)
+    {
+        if (max_limit == 0)
+        {
+            throw std::invalid_argument("max_limit must be greater than zero");
+        }
+    }
+
+    bool invocation_limiter::try_acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_queue.empty() && m_in_flight < current_limit())
+        {
+            ++m_in_flight;
+            return true;
+        }
+
+        return false;
+    }
+
+    // a permit may have been released after `try_acquire` failed and before the invocation is queued so the
+    // invocation is started right away if there is room
+    void invocation_limiter::enqueue(const std::function<void()>& start)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_queue.push_back(start);
+        start_queued(lock);
+    }
+
+    void invocation_limiter::release(std::chrono::steady_clock::duration latency, bool timed_out)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        --m_in_flight;
+        if (m_adaptive)
+        {
+            adjust_limit(latency, timed_out);
+        }
+
+        start_queued(lock);
+    }
+
+    void invocation_limiter::release()
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        --m_in_flight;
+        start_queued(lock);
+    }
+
+    size_t invocation_limiter::get_limit() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return current_limit();
+    }
+
+    size_t invocation_limiter::get_in_flight() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_in_flight;
+    }
+
+    size_t invocation_limiter::get_queued() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_queue.size();
+    }
+
+    size_t invocation_limiter::current_limit() const noexcept
+    {
+        return std::max(static_cast<size_t>(m_limit), static_cast<size_t>(1));
+    }
+
+    void invocation_limiter::adjust_limit(std::chrono::steady_clock::duration latency, bool timed_out)
+    {
+        const auto overloaded = timed_out ||
+            (m_baseline_latency.count() > 0 && latency.count() > m_baseline_latency.count() * latency_tolerance);
+
+        if (m_baseline_latency.count() == 0 || latency < m_baseline_latency)
+        {
+            m_baseline_latency = latency;
+        }
+        else if (!timed_out)
+        {
+            m_baseline_latency += (latency - m_baseline_latency) / baseline_drift_divisor;
+        }
+
+        m_overloaded_in_window = m_overloaded_in_window || overloaded;
+        ++m_completed_in_window;
+        if (m_completed_in_window < current_limit())
+        {
+            return;
+        }
+
+        if (m_overloaded_in_window)
+        {
+            m_limit = std::max(m_limit * decrease_factor, 1.0);
+        }
+        else
+        {
+            m_limit = std::min(m_limit + 1, static_cast<double>(m_max_limit));
+        }
+
+        m_completed_in_window = 0;
+        m_overloaded_in_window = false;
+    }
+
+    // starts queued invocations while there is room, unless another thread is already doing so. The lock is
+    // released while an invocation is started since starting it may release the permit again
+    void invocation_limiter::start_queued(std::unique_lock<std::mutex>& lock)
+    {
+        if (m_starting)
+        {
+            return;
+        }
+
+        m_starting = true;
+        while (!m_queue.empty() && m_in_flight < current_limit())
+        {
+            auto start = std::move(m_queue.front());
+            m_queue.pop_front();
+            ++m_in_flight;
+
+            lock.unlock();
+            start();
+            lock.lock();
+        }
+        m_starting = false;
+    }
+}
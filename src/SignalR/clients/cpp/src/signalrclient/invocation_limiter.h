@@ -0,0 +1,71 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace signalr
+{
+    // Limits the number of invocations in flight. An invocation takes a permit before it is sent and releases it
+    // once it completed; invocations that can't take a permit wait in a queue and are started in the order they
+    // were queued as permits are released.
+    //
+    // When adaptive, the limit starts at the maximum and is adjusted with AIMD based on the latency of completed
+    // invocations. Completed invocations are counted in windows of a limit's worth of invocations; the limit grows
+    // by one after a window in which all invocations completed within `latency_tolerance` times the baseline
+    // latency and shrinks by 10% after a window in which an invocation took longer or timed out. The baseline is
+    // the lowest latency seen and drifts slowly towards higher latencies so that it follows a lasting change of
+    // the network rather than an outlier.
+    class invocation_limiter
+    {
+    public:
+        static const double latency_tolerance;
+
+        invocation_limiter(size_t max_limit, bool adaptive);
+
+        invocation_limiter(const invocation_limiter&) = delete;
+        invocation_limiter& operator=(const invocation_limiter&) = delete;
+
+        // takes a permit if one is available and no invocation is queued
+        bool try_acquire();
+
+        // runs `start` once it took a permit, which may be before this function returns. `start` must not throw
+        // and the permit must be released exactly once
+        void enqueue(const std::function<void()>& start);
+
+        // releases a permit and adjusts the limit based on the `latency` of the invocation that held it;
+        // `timed_out` invocations always count as overload
+        void release(std::chrono::steady_clock::duration latency, bool timed_out);
+        // releases a permit without adjusting the limit, e.g. for canceled invocations
+        void release();
+
+        size_t get_limit() const;
+        size_t get_in_flight() const;
+        size_t get_queued() const;
+
+    private:
+        mutable std::mutex m_lock;
+        const size_t m_max_limit;
+        const bool m_adaptive;
+        double m_limit;
+        size_t m_in_flight;
+        std::deque<std::function<void()>> m_queue;
+        // set while a thread starts queued invocations; threads releasing permits in the meantime leave starting
+        // the invocations they make room for to that thread so that invocations completing synchronously don't
+        // grow the stack
+        bool m_starting;
+
+        std::chrono::steady_clock::duration m_baseline_latency;
+        // invocations completed in the current window and whether any of them indicated overload
+        size_t m_completed_in_window;
+        bool m_overloaded_in_window;
+
+        size_t current_limit() const noexcept;
+        void adjust_limit(std::chrono::steady_clock::duration latency, bool timed_out);
+        void start_queued(std::unique_lock<std::mutex>& lock);
+    };
+}
@@ -0,0 +1,165 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/invocation_trace.h"
+#include "signalrclient/signalr_exception.h"
+#include <fstream>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        size_t round_up_to_power_of_two(size_t capacity)
+        {
+            size_t result = 1;
+            while (result < capacity)
+            {
+                result <<= 1;
+            }
+
+            return result;
+        }
+
+        void append_hex(utility::string_t& buffer, const uint8_t* bytes, size_t length)
+        {
+            static const char digits[] = "0123456789abcdef";
+            for (size_t i = 0; i < length; ++i)
+            {
+                buffer.push_back(static_cast<utility::char_t>(digits[bytes[i] >> 4]));
+                buffer.push_back(static_cast<utility::char_t>(digits[bytes[i] & 0x0F]));
+            }
+        }
+    }
+
+    std::chrono::nanoseconds invocation_span::get_stage(invocation_stage stage) const noexcept
+    {
+        return stages[static_cast<size_t>(stage)];
+    }
+
+    // version 00, the sampled flag is set since the client records every invocation it traces
+    utility::string_t invocation_span::traceparent() const
+    {
+        utility::string_t traceparent(_XPLATSTR("00-"));
+        append_hex(traceparent, trace_id, sizeof(trace_id));
+        traceparent.push_back(_XPLATSTR('-'));
+        append_hex(traceparent, span_id, sizeof(span_id));
+        traceparent.append(_XPLATSTR("-01"));
+        return traceparent;
+    }
+
+    // each slot has a sequence number which tells producers and the consumer whether the slot is free to be
+    // written for the given position or holds a span recorded at the given position (bounded MPMC queue)
+    struct ring_buffer_trace_sink::slot
+    {
+        std::atomic<size_t> sequence;
+        invocation_span span;
+    };
+
+    ring_buffer_trace_sink::ring_buffer_trace_sink(size_t capacity)
+        : m_slots(new slot[round_up_to_power_of_two(capacity)]), m_mask(round_up_to_power_of_two(capacity) - 1),
+        m_enqueue_position(0), m_dequeue_position(0), m_dropped_count(0)
+    {
+        for (size_t i = 0; i <= m_mask; ++i)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ring_buffer_trace_sink::~ring_buffer_trace_sink()
+    { }
+
+    void ring_buffer_trace_sink::record(const invocation_span& span)
+    {
+        auto position = m_enqueue_position.load(std::memory_order_relaxed);
+        slot* target;
+
+        for (;;)
+        {
+            target = &m_slots[position & m_mask];
+            const auto sequence = target->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (difference == 0)
+            {
+                if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // the slot still holds a span from the previous round that was not drained yet
+                m_dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->span = span;
+        target->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    size_t ring_buffer_trace_sink::drain(std::vector<invocation_span>& spans)
+    {
+        size_t count = 0;
+        auto position = m_dequeue_position.load(std::memory_order_relaxed);
+
+        for (;; ++position, ++count)
+        {
+            auto& source = m_slots[position & m_mask];
+            if (source.sequence.load(std::memory_order_acquire) != position + 1)
+            {
+                // the span at this position has not been recorded (completely) yet
+                break;
+            }
+
+            spans.push_back(source.span);
+            source.sequence.store(position + m_mask + 1, std::memory_order_release);
+        }
+
+        m_dequeue_position.store(position, std::memory_order_relaxed);
+        return count;
+    }
+
+    size_t ring_buffer_trace_sink::flush(const utility::string_t& path)
+    {
+        std::ofstream stream(path, std::ios::app);
+        if (!stream)
+        {
+            throw signalr_exception(utility::string_t(_XPLATSTR("could not open the trace file: ")).append(path));
+        }
+
+        std::vector<invocation_span> spans;
+        drain(spans);
+
+        for (const auto& span : spans)
+        {
+            stream << utility::conversions::to_utf8string(span.traceparent()) << ','
+                << std::chrono::duration_cast<std::chrono::microseconds>(span.start_time.time_since_epoch()).count();
+
+            for (const auto& stage : span.stages)
+            {
+                stream << ',' << (stage.count() < 0 ? -1 : std::chrono::duration_cast<std::chrono::microseconds>(stage).count());
+            }
+
+            stream << ',' << (span.succeeded ? 1 : 0) << '\n';
+        }
+
+        return spans.size();
+    }
+
+    size_t ring_buffer_trace_sink::get_capacity() const noexcept
+    {
+        return m_mask + 1;
+    }
+
+    uint64_t ring_buffer_trace_sink::get_dropped_count() const noexcept
+    {
+        return m_dropped_count.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,64 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "json_arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace signalr
+{
+    json_arena::json_arena(size_t block_size)
+        : m_offset(0), m_block_size(block_size)
+    {
+        if (block_size == 0)
+        {
+            throw std::invalid_argument("block_size must be greater than 0");
+        }
+    }
+
+    void* json_arena::allocate(size_t size, size_t alignment)
+    {
+        if (!m_blocks.empty())
+        {
+            auto& current = m_blocks.back();
+            const auto address = reinterpret_cast<uintptr_t>(current.data.get()) + m_offset;
+            const auto padding = (alignment - address % alignment) % alignment;
+            if (m_offset + padding + size <= current.size)
+            {
+                m_offset += padding + size;
+                return current.data.get() + m_offset - size;
+            }
+        }
+
+        // blocks come from operator new[] and are therefore suitably aligned for any fundamental type
+        const auto block_size = std::max(m_block_size, size);
+        m_blocks.push_back(block{ std::unique_ptr<char[]>(new char[block_size]), block_size });
+        m_offset = size;
+        return m_blocks.back().data.get();
+    }
+
+    void json_arena::reset()
+    {
+        if (m_blocks.size() > 1)
+        {
+            const auto capacity = get_capacity();
+            m_blocks.clear();
+            m_blocks.push_back(block{ std::unique_ptr<char[]>(new char[capacity]), capacity });
+            m_block_size = std::max(m_block_size, capacity);
+        }
+
+        m_offset = 0;
+    }
+
+    size_t json_arena::get_capacity() const noexcept
+    {
+        size_t capacity = 0;
+        for (const auto& b : m_blocks)
+        {
+            capacity += b.size;
+        }
+
+        return capacity;
+    }
+}
@@ -0,0 +1,46 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace signalr
+{
+    // A bump allocator for objects that are released all at once. Memory is not returned to the heap on reset so
+    // that reusing the arena for objects of similar size does not allocate.
+    class json_arena
+    {
+    public:
+        explicit json_arena(size_t block_size = 4096);
+
+        json_arena(const json_arena&) = delete;
+        json_arena& operator=(const json_arena&) = delete;
+
+        void* allocate(size_t size, size_t alignment);
+
+        template <typename T>
+        T* allocate_array(size_t count)
+        {
+            return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        // releases all allocations. If the allocations did not fit in a single block the blocks are replaced with
+        // one block large enough to hold all of them so that the arena settles on a single block
+        void reset();
+
+        size_t get_capacity() const noexcept;
+
+    private:
+        struct block
+        {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        std::vector<block> m_blocks;
+        size_t m_offset;
+        size_t m_block_size;
+    };
+}
@@ -0,0 +1,650 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "json_arena_parser.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        const int max_depth = 128;
+
+        void skip_whitespace(const utility::char_t*& p, const utility::char_t* end)
+        {
+            while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            {
+                ++p;
+            }
+        }
+
+        bool is_digit(utility::char_t c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        void expect_literal(const utility::char_t*& p, const utility::char_t* end, const char* literal)
+        {
+            for (; *literal != '\0'; ++literal, ++p)
+            {
+                if (p == end || *p != static_cast<utility::char_t>(*literal))
+                {
+                    throw web::json::json_exception("invalid JSON - unexpected token");
+                }
+            }
+        }
+
+        uint32_t parse_hex4(const utility::char_t*& p, const utility::char_t* end)
+        {
+            if (end - p < 4)
+            {
+                throw web::json::json_exception("invalid JSON - incomplete unicode escape sequence");
+            }
+
+            uint32_t value = 0;
+            for (int i = 0; i < 4; ++i, ++p)
+            {
+                const auto c = *p;
+                value <<= 4;
+                if (c >= '0' && c <= '9')
+                {
+                    value |= c - '0';
+                }
+                else if (c >= 'a' && c <= 'f')
+                {
+                    value |= c - 'a' + 10;
+                }
+                else if (c >= 'A' && c <= 'F')
+                {
+                    value |= c - 'A' + 10;
+                }
+                else
+                {
+                    throw web::json::json_exception("invalid JSON - invalid unicode escape sequence");
+                }
+            }
+
+            return value;
+        }
+
+        void append_code_point(utility::char_t*& out, uint32_t code_point)
+        {
+#ifdef _UTF16_STRINGS
+            if (code_point >= 0x10000)
+            {
+                code_point -= 0x10000;
+                *out++ = static_cast<utility::char_t>(0xD800 + (code_point >> 10));
+                *out++ = static_cast<utility::char_t>(0xDC00 + (code_point & 0x3FF));
+            }
+            else
+            {
+                *out++ = static_cast<utility::char_t>(code_point);
+            }
+#else
+            if (code_point < 0x80)
+            {
+                *out++ = static_cast<utility::char_t>(code_point);
+            }
+            else if (code_point < 0x800)
+            {
+                *out++ = static_cast<utility::char_t>(0xC0 | (code_point >> 6));
+                *out++ = static_cast<utility::char_t>(0x80 | (code_point & 0x3F));
+            }
+            else if (code_point < 0x10000)
+            {
+                *out++ = static_cast<utility::char_t>(0xE0 | (code_point >> 12));
+                *out++ = static_cast<utility::char_t>(0x80 | ((code_point >> 6) & 0x3F));
+                *out++ = static_cast<utility::char_t>(0x80 | (code_point & 0x3F));
+            }
+            else
+            {
+                *out++ = static_cast<utility::char_t>(0xF0 | (code_point >> 18));
+                *out++ = static_cast<utility::char_t>(0x80 | ((code_point >> 12) & 0x3F));
+                *out++ = static_cast<utility::char_t>(0x80 | ((code_point >> 6) & 0x3F));
+                *out++ = static_cast<utility::char_t>(0x80 | (code_point & 0x3F));
+            }
+#endif
+        }
+    }
+
+    json_arena_parser::json_arena_parser()
+    { }
+
+    namespace details
+    {
+        const json_node& expand(const json_node& node)
+        {
+            if (node.is_lazy)
+            {
+                // the node lives in the arena of the parser which owns it so it can be completed in place
+                node.parser->expand(const_cast<json_node&>(node));
+            }
+
+            return node;
+        }
+    }
+
+    json_view json_arena_parser::parse(const utility::char_t* begin, const utility::char_t* end)
+    {
+        return parse(begin, end, false);
+    }
+
+    json_view json_arena_parser::parse_lazy(const utility::char_t* begin, const utility::char_t* end)
+    {
+        return parse(begin, end, true);
+    }
+
+    json_view json_arena_parser::parse(const utility::char_t* begin, const utility::char_t* end, bool lazy)
+    {
+        m_pending_nodes.clear();
+
+        auto p = begin;
+        details::json_node root = {};
+        skip_whitespace(p, end);
+        parse_value(p, end, root, 0, lazy);
+        skip_whitespace(p, end);
+
+        if (p != end)
+        {
+            throw web::json::json_exception("invalid JSON - unexpected data after the value");
+        }
+
+        auto node = m_arena.allocate_array<details::json_node>(1);
+        *node = root;
+        return json_view(node);
+    }
+
+    void json_arena_parser::expand(details::json_node& node)
+    {
+        const auto value = parse(node.string, node.string + node.length, false);
+        node.children = value.m_node->children;
+        node.length = value.m_node->length;
+        node.string = nullptr;
+        node.is_lazy = false;
+    }
+
+    json_view json_arena_parser::import(const web::json::value& value)
+    {
+        auto node = m_arena.allocate_array<details::json_node>(1);
+        *node = details::json_node();
+        import_value(value, *node);
+        return json_view(node);
+    }
+
+    void json_arena_parser::reset()
+    {
+        m_arena.reset();
+    }
+
+    size_t json_arena_parser::get_capacity() const noexcept
+    {
+        return m_arena.get_capacity();
+    }
+
+    void json_arena_parser::parse_value(const utility::char_t*& p, const utility::char_t* end, details::json_node& node, int depth, bool lazy)
+    {
+        if (p == end)
+        {
+            throw web::json::json_exception("invalid JSON - unexpected end of input");
+        }
+
+        if (lazy && depth > 0 && (*p == '{' || *p == '['))
+        {
+            skip_container(p, end, node);
+            return;
+        }
+
+        switch (*p)
+        {
+        case '{':
+            parse_object(p, end, node, depth + 1, lazy);
+            break;
+        case '[':
+            parse_array(p, end, node, depth + 1, lazy);
+            break;
+        case '"':
+            node.type = web::json::value::String;
+            parse_string(p, end, node.string, node.length);
+            break;
+        case 't':
+            expect_literal(p, end, "true");
+            node.type = web::json::value::Boolean;
+            node.boolean = true;
+            break;
+        case 'f':
+            expect_literal(p, end, "false");
+            node.type = web::json::value::Boolean;
+            node.boolean = false;
+            break;
+        case 'n':
+            expect_literal(p, end, "null");
+            node.type = web::json::value::Null;
+            break;
+        default:
+            parse_number(p, end, node);
+            break;
+        }
+    }
+
+    void json_arena_parser::parse_array(const utility::char_t*& p, const utility::char_t* end, details::json_node& node, int depth, bool lazy)
+    {
+        if (depth > max_depth)
+        {
+            throw web::json::json_exception("invalid JSON - the value is nested too deeply");
+        }
+
+        ++p;
+        const auto first_pending_node = m_pending_nodes.size();
+        skip_whitespace(p, end);
+
+        if (p != end && *p == ']')
+        {
+            ++p;
+        }
+        else
+        {
+            for (;;)
+            {
+                // the element is parsed into a local since parsing nested values may reallocate the pending nodes
+                details::json_node element = {};
+                parse_value(p, end, element, depth, lazy);
+                m_pending_nodes.push_back(element);
+
+                skip_whitespace(p, end);
+                if (p != end && *p == ',')
+                {
+                    ++p;
+                    skip_whitespace(p, end);
+                }
+                else if (p != end && *p == ']')
+                {
+                    ++p;
+                    break;
+                }
+                else
+                {
+                    throw web::json::json_exception("invalid JSON - expected ',' or ']'");
+                }
+            }
+        }
+
+        node.type = web::json::value::Array;
+        complete_container(node, first_pending_node);
+    }
+
+    void json_arena_parser::parse_object(const utility::char_t*& p, const utility::char_t* end, details::json_node& node, int depth, bool lazy)
+    {
+        if (depth > max_depth)
+        {
+            throw web::json::json_exception("invalid JSON - the value is nested too deeply");
+        }
+
+        ++p;
+        const auto first_pending_node = m_pending_nodes.size();
+        skip_whitespace(p, end);
+
+        if (p != end && *p == '}')
+        {
+            ++p;
+        }
+        else
+        {
+            for (;;)
+            {
+                if (p == end || *p != '"')
+                {
+                    throw web::json::json_exception("invalid JSON - expected a field name");
+                }
+
+                details::json_node field = {};
+                parse_string(p, end, field.name, field.name_length);
+
+                skip_whitespace(p, end);
+                if (p == end || *p != ':')
+                {
+                    throw web::json::json_exception("invalid JSON - expected ':'");
+                }
+
+                ++p;
+                skip_whitespace(p, end);
+                parse_value(p, end, field, depth, lazy);
+                m_pending_nodes.push_back(field);
+
+                skip_whitespace(p, end);
+                if (p != end && *p == ',')
+                {
+                    ++p;
+                    skip_whitespace(p, end);
+                }
+                else if (p != end && *p == '}')
+                {
+                    ++p;
+                    break;
+                }
+                else
+                {
+                    throw web::json::json_exception("invalid JSON - expected ',' or '}'");
+                }
+            }
+        }
+
+        node.type = web::json::value::Object;
+        complete_container(node, first_pending_node);
+    }
+
+    void json_arena_parser::skip_container(const utility::char_t*& p, const utility::char_t* end, details::json_node& node)
+    {
+        // only finds the end of the value, brackets in strings are skipped but nothing else is validated
+        const auto start = p;
+        node.type = *p == '{' ? web::json::value::Object : web::json::value::Array;
+
+        size_t depth = 0;
+        for (; p != end; ++p)
+        {
+            if (*p == '"')
+            {
+                for (++p; p != end && *p != '"'; ++p)
+                {
+                    if (*p == '\\' && ++p == end)
+                    {
+                        break;
+                    }
+                }
+
+                if (p == end)
+                {
+                    break;
+                }
+            }
+            else if (*p == '{' || *p == '[')
+            {
+                ++depth;
+            }
+            else if ((*p == '}' || *p == ']') && --depth == 0)
+            {
+                ++p;
+                node.string = start;
+                node.length = p - start;
+                node.is_lazy = true;
+                node.parser = this;
+                return;
+            }
+        }
+
+        throw web::json::json_exception("invalid JSON - unexpected end of input");
+    }
+
+    void json_arena_parser::complete_container(details::json_node& node, size_t first_pending_node)
+    {
+        node.length = m_pending_nodes.size() - first_pending_node;
+        node.children = nullptr;
+
+        if (node.length > 0)
+        {
+            auto children = m_arena.allocate_array<details::json_node>(node.length);
+            std::copy(m_pending_nodes.begin() + first_pending_node, m_pending_nodes.end(), children);
+            m_pending_nodes.resize(first_pending_node);
+            node.children = children;
+        }
+    }
+
+    void json_arena_parser::parse_string(const utility::char_t*& p, const utility::char_t* end, const utility::char_t*& string, size_t& length)
+    {
+        ++p;
+        const auto start = p;
+
+        bool has_escapes = false;
+        for (;; ++p)
+        {
+            if (p == end)
+            {
+                throw web::json::json_exception("invalid JSON - unterminated string");
+            }
+
+            if (*p == '"')
+            {
+                break;
+            }
+
+            if (*p == '\\')
+            {
+                has_escapes = true;
+                if (++p == end)
+                {
+                    throw web::json::json_exception("invalid JSON - unterminated string");
+                }
+            }
+            else if (static_cast<unsigned>(*p) < 0x20)
+            {
+                throw web::json::json_exception("invalid JSON - control character in string");
+            }
+        }
+
+        const auto closing_quote = p++;
+
+        if (!has_escapes)
+        {
+            string = start;
+            length = closing_quote - start;
+            return;
+        }
+
+        // unescaping never makes a string longer
+        auto buffer = m_arena.allocate_array<utility::char_t>(closing_quote - start);
+        auto out = buffer;
+
+        for (auto in = start; in != closing_quote;)
+        {
+            if (*in != '\\')
+            {
+                *out++ = *in++;
+                continue;
+            }
+
+            ++in;
+            switch (*in++)
+            {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u':
+            {
+                auto code_point = parse_hex4(in, closing_quote);
+                if (code_point >= 0xD800 && code_point <= 0xDBFF && closing_quote - in >= 6 && in[0] == '\\' && in[1] == 'u')
+                {
+                    auto low_surrogate_start = in + 2;
+                    const auto low_surrogate = parse_hex4(low_surrogate_start, closing_quote);
+                    if (low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF)
+                    {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                        in = low_surrogate_start;
+                    }
+                }
+
+                append_code_point(out, code_point);
+                break;
+            }
+            default:
+                throw web::json::json_exception("invalid JSON - invalid escape sequence");
+            }
+        }
+
+        string = buffer;
+        length = out - buffer;
+    }
+
+    void json_arena_parser::parse_number(const utility::char_t*& p, const utility::char_t* end, details::json_node& node)
+    {
+        const auto start = p;
+        const bool negative = *p == '-';
+        if (negative)
+        {
+            ++p;
+        }
+
+        if (p == end || !is_digit(*p))
+        {
+            throw web::json::json_exception("invalid JSON - unexpected token");
+        }
+
+        // the magnitude of integers is accumulated while validating, a value that does not fit an int64_t is
+        // parsed as a double
+        uint64_t magnitude = 0;
+        bool fits_integer = true;
+        const uint64_t max_magnitude = negative
+            ? static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1
+            : static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+
+        if (*p == '0')
+        {
+            ++p;
+        }
+        else
+        {
+            for (; p != end && is_digit(*p); ++p)
+            {
+                const uint64_t digit = *p - '0';
+                if (magnitude > (max_magnitude - digit) / 10)
+                {
+                    fits_integer = false;
+                }
+                else
+                {
+                    magnitude = magnitude * 10 + digit;
+                }
+            }
+        }
+
+        bool is_integer = true;
+        if (p != end && *p == '.')
+        {
+            is_integer = false;
+            if (++p == end || !is_digit(*p))
+            {
+                throw web::json::json_exception("invalid JSON - invalid number");
+            }
+
+            while (p != end && is_digit(*p))
+            {
+                ++p;
+            }
+        }
+
+        if (p != end && (*p == 'e' || *p == 'E'))
+        {
+            is_integer = false;
+            if (++p != end && (*p == '+' || *p == '-'))
+            {
+                ++p;
+            }
+
+            if (p == end || !is_digit(*p))
+            {
+                throw web::json::json_exception("invalid JSON - invalid number");
+            }
+
+            while (p != end && is_digit(*p))
+            {
+                ++p;
+            }
+        }
+
+        node.type = web::json::value::Number;
+
+        if (is_integer && fits_integer)
+        {
+            node.is_integer = true;
+            node.integer = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+            node.number = static_cast<double>(node.integer);
+            return;
+        }
+
+        // the number only contains ASCII characters so it can be narrowed without conversion
+        char buffer[64];
+        std::string long_number;
+        const auto length = static_cast<size_t>(p - start);
+        const char* text = buffer;
+        if (length < sizeof(buffer))
+        {
+            std::transform(start, p, buffer, [](utility::char_t c) { return static_cast<char>(c); });
+            buffer[length] = '\0';
+        }
+        else
+        {
+            long_number.resize(length);
+            std::transform(start, p, long_number.begin(), [](utility::char_t c) { return static_cast<char>(c); });
+            text = long_number.c_str();
+        }
+
+        node.is_integer = false;
+        node.number = std::strtod(text, nullptr);
+        node.integer = static_cast<int64_t>(node.number);
+    }
+
+    void json_arena_parser::import_value(const web::json::value& value, details::json_node& node)
+    {
+        node.type = value.type();
+
+        switch (value.type())
+        {
+        case web::json::value::Boolean:
+            node.boolean = value.as_bool();
+            break;
+        case web::json::value::Number:
+            node.is_integer = value.is_integer();
+            node.number = value.as_double();
+            node.integer = node.is_integer ? value.as_number().to_int64() : static_cast<int64_t>(node.number);
+            break;
+        case web::json::value::String:
+            node.string = copy_string(value.as_string());
+            node.length = value.as_string().length();
+            break;
+        case web::json::value::Array:
+        {
+            node.length = value.size();
+            auto children = m_arena.allocate_array<details::json_node>(node.length);
+            for (size_t i = 0; i < node.length; ++i)
+            {
+                children[i] = details::json_node();
+                import_value(value.at(i), children[i]);
+            }
+            node.children = children;
+            break;
+        }
+        case web::json::value::Object:
+        {
+            node.length = value.size();
+            auto children = m_arena.allocate_array<details::json_node>(node.length);
+            size_t i = 0;
+            for (const auto& field : value.as_object())
+            {
+                children[i] = details::json_node();
+                children[i].name = copy_string(field.first);
+                children[i].name_length = field.first.length();
+                import_value(field.second, children[i]);
+                ++i;
+            }
+            node.children = children;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    const utility::char_t* json_arena_parser::copy_string(const utility::string_t& string)
+    {
+        auto copy = m_arena.allocate_array<utility::char_t>(string.length());
+        std::copy(string.begin(), string.end(), copy);
+        return copy;
+    }
+}
@@ -0,0 +1,88 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <vector>
+#include "cpprest/json.h"
+#include "signalrclient/json_view.h"
+#include "json_arena.h"
+
+namespace signalr
+{
+    class json_arena_parser;
+
+    namespace details
+    {
+        struct json_node
+        {
+            web::json::value::value_type type;
+            bool boolean;
+            bool is_integer;
+            int64_t integer;
+            double number;
+            // the characters of a string or the elements (fields) of an array (object) and their count
+            const utility::char_t* string;
+            const json_node* children;
+            size_t length;
+            // the name of the field if the node is a field of an object
+            const utility::char_t* name;
+            size_t name_length;
+            // an array or object which has not been parsed yet; `string` and `length` are its text and `parser`
+            // parses it when the elements are accessed
+            bool is_lazy;
+            json_arena_parser* parser;
+        };
+
+        // parses the text of a lazy node if it has not been parsed yet
+        const json_node& expand(const json_node& node);
+    }
+
+    // Parses JSON into nodes allocated in an arena. Nodes of all the documents parsed since the last reset stay
+    // valid until the parser is reset or destroyed. Not thread safe.
+    class json_arena_parser
+    {
+    public:
+        json_arena_parser();
+
+        json_arena_parser(const json_arena_parser&) = delete;
+        json_arena_parser& operator=(const json_arena_parser&) = delete;
+
+        // strings that don't contain escape sequences point into the parsed text so the text has to outlive the view
+        json_view parse(const utility::char_t* begin, const utility::char_t* end);
+
+        // parses the fields of the top level object but not the arrays and objects they contain. These are only
+        // scanned for their end and parsed the first time their elements are accessed so invalid JSON in them is
+        // not detected until then
+        json_view parse_lazy(const utility::char_t* begin, const utility::char_t* end);
+
+        // copies the value into the arena
+        json_view import(const web::json::value& value);
+
+        void reset();
+
+        size_t get_capacity() const noexcept;
+
+    private:
+        friend const details::json_node& details::expand(const details::json_node& node);
+
+        json_arena m_arena;
+        // elements of the arrays and objects being parsed, they are moved to the arena once the array or
+        // object is complete and its size is known
+        std::vector<details::json_node> m_pending_nodes;
+
+        json_view parse(const utility::char_t* begin, const utility::char_t* end, bool lazy);
+        void expand(details::json_node& node);
+
+        void parse_value(const utility::char_t*& p, const utility::char_t* end, details::json_node& node, int depth, bool lazy);
+        void parse_array(const utility::char_t*& p, const utility::char_t* end, details::json_node& node, int depth, bool lazy);
+        void parse_object(const utility::char_t*& p, const utility::char_t* end, details::json_node& node, int depth, bool lazy);
+        void skip_container(const utility::char_t*& p, const utility::char_t* end, details::json_node& node);
+        void parse_string(const utility::char_t*& p, const utility::char_t* end, const utility::char_t*& string, size_t& length);
+        void parse_number(const utility::char_t*& p, const utility::char_t* end, details::json_node& node);
+        void complete_container(details::json_node& node, size_t first_pending_node);
+
+        void import_value(const web::json::value& value, details::json_node& node);
+        const utility::char_t* copy_string(const utility::string_t& string);
+    };
+}
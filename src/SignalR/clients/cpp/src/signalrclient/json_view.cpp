@@ -0,0 +1,219 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/json_view.h"
+#include "json_arena_parser.h"
+#include <algorithm>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        const details::json_node null_node = { web::json::value::Null };
+
+        const details::json_node& check(const details::json_node* node, web::json::value::value_type type)
+        {
+            if (node->type != type)
+            {
+                throw web::json::json_exception("the JSON value is not of the requested type");
+            }
+
+            return *node;
+        }
+
+        const details::json_node* find_field(const details::json_node* node, const utility::string_t& key)
+        {
+            if (node->type != web::json::value::Object)
+            {
+                return nullptr;
+            }
+
+            details::expand(*node);
+            for (size_t i = 0; i < node->length; ++i)
+            {
+                const auto& field = node->children[i];
+                if (field.name_length == key.length() && std::equal(key.begin(), key.end(), field.name))
+                {
+                    return &field;
+                }
+            }
+
+            return nullptr;
+        }
+    }
+
+    json_view::json_view() noexcept
+        : m_node(&null_node)
+    { }
+
+    json_view::json_view(const details::json_node* node) noexcept
+        : m_node(node)
+    { }
+
+    web::json::value::value_type json_view::type() const noexcept
+    {
+        return m_node->type;
+    }
+
+    bool json_view::is_null() const noexcept
+    {
+        return m_node->type == web::json::value::Null;
+    }
+
+    bool json_view::is_boolean() const noexcept
+    {
+        return m_node->type == web::json::value::Boolean;
+    }
+
+    bool json_view::is_number() const noexcept
+    {
+        return m_node->type == web::json::value::Number;
+    }
+
+    bool json_view::is_integer() const noexcept
+    {
+        return m_node->type == web::json::value::Number && m_node->is_integer;
+    }
+
+    bool json_view::is_string() const noexcept
+    {
+        return m_node->type == web::json::value::String;
+    }
+
+    bool json_view::is_array() const noexcept
+    {
+        return m_node->type == web::json::value::Array;
+    }
+
+    bool json_view::is_object() const noexcept
+    {
+        return m_node->type == web::json::value::Object;
+    }
+
+    bool json_view::as_bool() const
+    {
+        return check(m_node, web::json::value::Boolean).boolean;
+    }
+
+    double json_view::as_double() const
+    {
+        return check(m_node, web::json::value::Number).number;
+    }
+
+    int json_view::as_integer() const
+    {
+        return static_cast<int>(check(m_node, web::json::value::Number).integer);
+    }
+
+    int64_t json_view::as_int64() const
+    {
+        return check(m_node, web::json::value::Number).integer;
+    }
+
+    utility::string_t json_view::as_string() const
+    {
+        const auto& node = check(m_node, web::json::value::String);
+        return utility::string_t(node.string, node.length);
+    }
+
+    const utility::char_t* json_view::string_data() const
+    {
+        return check(m_node, web::json::value::String).string;
+    }
+
+    size_t json_view::string_length() const
+    {
+        return check(m_node, web::json::value::String).length;
+    }
+
+    size_t json_view::size() const
+    {
+        return m_node->type == web::json::value::Array || m_node->type == web::json::value::Object ? details::expand(*m_node).length : 0;
+    }
+
+    json_view json_view::operator[](size_t index) const
+    {
+        if (index >= size())
+        {
+            throw web::json::json_exception("index out of bounds");
+        }
+
+        return json_view(m_node->children + index);
+    }
+
+    utility::string_t json_view::field_name(size_t index) const
+    {
+        const auto& node = details::expand(check(m_node, web::json::value::Object));
+        if (index >= node.length)
+        {
+            throw web::json::json_exception("index out of bounds");
+        }
+
+        return utility::string_t(node.children[index].name, node.children[index].name_length);
+    }
+
+    bool json_view::has_field(const utility::string_t& key) const
+    {
+        return find_field(m_node, key) != nullptr;
+    }
+
+    json_view json_view::at(const utility::string_t& key) const
+    {
+        const auto field = find_field(&check(m_node, web::json::value::Object), key);
+        if (field == nullptr)
+        {
+            throw web::json::json_exception("the field does not exist");
+        }
+
+        return json_view(field);
+    }
+
+    web::json::value json_view::to_value() const
+    {
+        switch (m_node->type)
+        {
+        case web::json::value::Boolean:
+            return web::json::value::boolean(m_node->boolean);
+        case web::json::value::Number:
+            return m_node->is_integer
+                ? web::json::value::number(m_node->integer)
+                : web::json::value::number(m_node->number);
+        case web::json::value::String:
+            return web::json::value::string(utility::string_t(m_node->string, m_node->length));
+        case web::json::value::Array:
+        {
+            details::expand(*m_node);
+            std::vector<web::json::value> elements;
+            elements.reserve(m_node->length);
+            for (size_t i = 0; i < m_node->length; ++i)
+            {
+                elements.push_back(json_view(m_node->children + i).to_value());
+            }
+
+            return web::json::value::array(std::move(elements));
+        }
+        case web::json::value::Object:
+        {
+            details::expand(*m_node);
+            std::vector<std::pair<utility::string_t, web::json::value>> fields;
+            fields.reserve(m_node->length);
+            for (size_t i = 0; i < m_node->length; ++i)
+            {
+                const auto& field = m_node->children[i];
+                fields.push_back(std::make_pair(utility::string_t(field.name, field.name_length), json_view(&field).to_value()));
+            }
+
+            return web::json::value::object(std::move(fields));
+        }
+        default:
+            return web::json::value::null();
+        }
+    }
+
+    utility::string_t json_view::serialize() const
+    {
+        return to_value().serialize();
+    }
+}
@@ -12,9 +12,14 @@ namespace signalr
         : m_log_writer(log_writer), m_trace_level(trace_level)
     { }
 
+    bool logger::is_enabled(trace_level level) const noexcept
+    {
+        return (level & m_trace_level) != trace_level::none;
+    }
+
     void logger::log(trace_level level, const utility::string_t& entry) const
     {
-        if ((level & m_trace_level) != trace_level::none)
+        if (is_enabled(level))
         {
             try
             {
@@ -16,6 +16,9 @@ namespace signalr
 
         void log(trace_level level, const utility::string_t& entry) const;
 
+        // allows skipping building entries that would not be logged
+        bool is_enabled(trace_level level) const noexcept;
+
     private:
         std::shared_ptr<log_writer> m_log_writer;
         trace_level m_trace_level;
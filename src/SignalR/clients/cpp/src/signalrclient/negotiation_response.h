@@ -15,10 +15,16 @@ namespace signalr
 
     struct negotiation_response
     {
+        negotiation_response()
+            : useStatefulReconnect(false)
+        { }
+
         utility::string_t connectionId;
+        utility::string_t connectionToken;
         std::vector<available_transport> availableTransports;
         utility::string_t url;
         utility::string_t accessToken;
         utility::string_t error;
+        bool useStatefulReconnect;
     };
 }
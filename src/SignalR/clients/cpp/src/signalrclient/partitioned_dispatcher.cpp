@@ -0,0 +1,238 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "partitioned_dispatcher.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        // the number of work items a thread runs before it moves on to the next partition
+        const size_t batch_size = 32;
+    }
+
+    partitioned_dispatcher::partitioned_dispatcher(size_t thread_count, size_t partition_count)
+        : m_state(std::make_shared<shared_state>())
+    {
+        if (thread_count == 0)
+        {
+            thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+
+        if (partition_count == 0)
+        {
+            throw std::invalid_argument("partition_count must be greater than zero");
+        }
+
+        for (size_t i = 0; i < partition_count; ++i)
+        {
+            m_state->partitions.push_back(std::unique_ptr<partition>(new partition()));
+        }
+
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            m_state->run_queues.push_back(std::unique_ptr<run_queue>(new run_queue()));
+        }
+
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            m_threads.push_back(std::thread(&partitioned_dispatcher::run_thread, m_state, i));
+        }
+    }
+
+    partitioned_dispatcher::~partitioned_dispatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            m_state->stopped = true;
+        }
+        m_state->work_available.notify_all();
+
+        for (auto& thread : m_threads)
+        {
+            // the last reference to the dispatcher can be released by work run by the dispatcher in which case
+            // the dispatcher is destroyed on one of its threads and that thread cannot be joined
+            if (thread.get_id() == std::this_thread::get_id())
+            {
+                thread.detach();
+            }
+            else
+            {
+                thread.join();
+            }
+        }
+    }
+
+    std::shared_ptr<partitioned_dispatcher> partitioned_dispatcher::get_shared(size_t thread_count)
+    {
+        if (thread_count == 0)
+        {
+            thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+
+        // the dispatchers are leaked so that their threads are never joined by static destructors, which would
+        // deadlock under the loader lock when the library is unloaded on Windows and race with late work at exit
+        static auto shared_dispatchers_lock = new std::mutex();
+        static auto shared_dispatchers = new std::map<size_t, std::shared_ptr<partitioned_dispatcher>>();
+
+        std::lock_guard<std::mutex> lock(*shared_dispatchers_lock);
+
+        auto& dispatcher = (*shared_dispatchers)[thread_count];
+        if (!dispatcher)
+        {
+            dispatcher = std::make_shared<partitioned_dispatcher>(thread_count, thread_count * 16);
+        }
+
+        return dispatcher;
+    }
+
+    void partitioned_dispatcher::dispatch(size_t key, const std::function<void()>& work)
+    {
+        const auto partition_index = key % m_state->partitions.size();
+        auto& partition = *m_state->partitions[partition_index];
+
+        {
+            std::lock_guard<std::mutex> lock(partition.lock);
+            partition.work.push_back(work);
+            if (partition.scheduled)
+            {
+                // the thread running the partition picks the work up
+                return;
+            }
+
+            partition.scheduled = true;
+        }
+
+        queue_partition(*m_state, partition_index, partition_index % m_state->run_queues.size());
+    }
+
+    size_t partitioned_dispatcher::get_thread_count() const noexcept
+    {
+        return m_state->run_queues.size();
+    }
+
+    size_t partitioned_dispatcher::get_partition_count() const noexcept
+    {
+        return m_state->partitions.size();
+    }
+
+    void partitioned_dispatcher::run_thread(std::shared_ptr<shared_state> state, size_t thread_index)
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(state->lock);
+                state->work_available.wait(lock, [&state]() { return state->stopped || state->queued_partitions > 0; });
+                if (state->stopped)
+                {
+                    return;
+                }
+            }
+
+            size_t partition_index;
+            if (take_partition(*state, thread_index, partition_index))
+            {
+                run_partition(*state, partition_index, thread_index);
+            }
+        }
+    }
+
+    // takes the next partition of the thread or, if it has none, steals the partition queued last on another thread
+    bool partitioned_dispatcher::take_partition(shared_state& state, size_t thread_index, size_t& partition_index)
+    {
+        const auto thread_count = state.run_queues.size();
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            auto& queue = *state.run_queues[(thread_index + i) % thread_count];
+
+            {
+                std::lock_guard<std::mutex> lock(queue.lock);
+                if (queue.partitions.empty())
+                {
+                    continue;
+                }
+
+                if (i == 0)
+                {
+                    partition_index = queue.partitions.front();
+                    queue.partitions.pop_front();
+                }
+                else
+                {
+                    partition_index = queue.partitions.back();
+                    queue.partitions.pop_back();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state.lock);
+            --state.queued_partitions;
+            return true;
+        }
+
+        return false;
+    }
+
+    void partitioned_dispatcher::run_partition(shared_state& state, size_t partition_index, size_t thread_index)
+    {
+        auto& partition = *state.partitions[partition_index];
+
+        for (size_t i = 0; i < batch_size; ++i)
+        {
+            std::function<void()> work;
+
+            {
+                std::lock_guard<std::mutex> lock(partition.lock);
+                if (partition.work.empty())
+                {
+                    partition.scheduled = false;
+                    return;
+                }
+
+                work = std::move(partition.work.front());
+                partition.work.pop_front();
+            }
+
+            try
+            {
+                work();
+            }
+            catch (...) // work must not throw, an exception must not stop the thread though
+            { }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(partition.lock);
+            if (partition.work.empty())
+            {
+                partition.scheduled = false;
+                return;
+            }
+        }
+
+        // the partition stays scheduled and is queued behind the other partitions of the thread
+        queue_partition(state, partition_index, thread_index);
+    }
+
+    // the partition is counted before it is published since a thread may take it, and uncount it, as soon as it
+    // is in the run queue
+    void partitioned_dispatcher::queue_partition(shared_state& state, size_t partition_index, size_t thread_index)
+    {
+        {
+            std::lock_guard<std::mutex> lock(state.lock);
+            ++state.queued_partitions;
+        }
+
+        {
+            auto& queue = *state.run_queues[thread_index];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.partitions.push_back(partition_index);
+        }
+
+        state.work_available.notify_one();
+    }
+}
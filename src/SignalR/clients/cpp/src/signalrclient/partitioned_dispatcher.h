@@ -0,0 +1,84 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace signalr
+{
+    // Runs work on a pool of threads while keeping the work dispatched with the same key in order. Keys are hashed
+    // into partitions; the work of a partition is run by one thread at a time in the order it was dispatched while
+    // different partitions run concurrently. A partition that has work is queued on the thread its index maps to and
+    // threads that run out of partitions steal them from the other threads so that a few busy partitions keep all
+    // the threads busy. A thread runs a bounded batch of work of a partition before it moves on to the next one so
+    // that a busy partition does not starve the others.
+    //
+    // Work must not throw. Work that has not started when the dispatcher is destroyed is dropped.
+    class partitioned_dispatcher
+    {
+    public:
+        // a `thread_count` of 0 starts a thread per processor
+        partitioned_dispatcher(size_t thread_count, size_t partition_count);
+
+        partitioned_dispatcher(const partitioned_dispatcher&) = delete;
+        partitioned_dispatcher& operator=(const partitioned_dispatcher&) = delete;
+
+        ~partitioned_dispatcher();
+
+        void dispatch(size_t key, const std::function<void()>& work);
+
+        size_t get_thread_count() const noexcept;
+        size_t get_partition_count() const noexcept;
+
+        // The dispatcher with `thread_count` threads (a thread per processor if 0) shared by all connections in the
+        // process, so that the number of dispatch threads does not grow with the number of connections. It has 16
+        // partitions per thread so that threads have partitions to steal when a few keys are busy. Shared
+        // dispatchers are created on first use and live until the process exits.
+        static std::shared_ptr<partitioned_dispatcher> get_shared(size_t thread_count);
+
+    private:
+        struct partition
+        {
+            std::mutex lock;
+            std::deque<std::function<void()>> work;
+            // whether the partition is queued on (or being run by) a thread
+            bool scheduled = false;
+        };
+
+        // the partitions a thread is going to run, the thread takes them from the front and others steal them
+        // from the back
+        struct run_queue
+        {
+            std::mutex lock;
+            std::deque<size_t> partitions;
+        };
+
+        // shared with the threads so that a thread which destroys the dispatcher (and is therefore detached)
+        // never touches the dispatcher after it was destroyed
+        struct shared_state
+        {
+            std::vector<std::unique_ptr<partition>> partitions;
+            std::vector<std::unique_ptr<run_queue>> run_queues;
+
+            std::mutex lock;
+            std::condition_variable work_available;
+            size_t queued_partitions = 0;
+            bool stopped = false;
+        };
+
+        std::shared_ptr<shared_state> m_state;
+        std::vector<std::thread> m_threads;
+
+        static void run_thread(std::shared_ptr<shared_state> state, size_t thread_index);
+        static bool take_partition(shared_state& state, size_t thread_index, size_t& partition_index);
+        static void run_partition(shared_state& state, size_t partition_index, size_t thread_index);
+        static void queue_partition(shared_state& state, size_t partition_index, size_t thread_index);
+    };
+}
@@ -0,0 +1,113 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/prepared_method.h"
+#include "hub_connection_impl.h"
+#include "invocation_envelope.h"
+#include "signalrclient/signalr_exception.h"
+
+namespace signalr
+{
+    prepared_method::prepared_method(const std::weak_ptr<hub_connection_impl>& hub_connection,
+        const std::shared_ptr<const invocation_envelope>& envelope)
+        : m_hub_connection(hub_connection), m_envelope(envelope)
+    {}
+
+    pplx::task<web::json::value> prepared_method::invoke(const web::json::value& arguments) const
+    {
+        auto hub_connection = m_hub_connection.lock();
+        if (!hub_connection)
+        {
+            return pplx::task_from_exception<web::json::value>(
+                signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
+        }
+
+        return hub_connection->invoke(*m_envelope, arguments);
+    }
+
+    pplx::task<web::json::value> prepared_method::invoke(const web::json::value& arguments,
+        const pplx::cancellation_token& cancellation_token) const
+    {
+        auto hub_connection = m_hub_connection.lock();
+        if (!hub_connection)
+        {
+            return pplx::task_from_exception<web::json::value>(
+                signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
+        }
+
+        return hub_connection->invoke(*m_envelope, arguments, hub_connection->get_invocation_timeout(), cancellation_token);
+    }
+
+    pplx::task<web::json::value> prepared_method::invoke(const web::json::value& arguments,
+        std::chrono::milliseconds timeout, const pplx::cancellation_token& cancellation_token) const
+    {
+        if (timeout.count() < 0)
+        {
+            throw std::invalid_argument("timeout cannot be negative");
+        }
+
+        auto hub_connection = m_hub_connection.lock();
+        if (!hub_connection)
+        {
+            return pplx::task_from_exception<web::json::value>(
+                signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
+        }
+
+        return hub_connection->invoke(*m_envelope, arguments, timeout, cancellation_token);
+    }
+
+    pplx::task<void> prepared_method::send(const web::json::value& arguments) const
+    {
+        auto hub_connection = m_hub_connection.lock();
+        if (!hub_connection)
+        {
+            return pplx::task_from_exception<void>(
+                signalr_exception(_XPLATSTR("the hub connection has been deconstructed")));
+        }
+
+        return hub_connection->send(*m_envelope, arguments);
+    }
+
+    void prepared_method::invoke(const web::json::value& arguments,
+        const std::function<void(const web::json::value&, std::exception_ptr)>& invocation_completed) const
+    {
+        if (!invocation_completed)
+        {
+            throw std::invalid_argument("invocation_completed cannot be empty");
+        }
+
+        auto hub_connection = m_hub_connection.lock();
+        if (!hub_connection)
+        {
+            invocation_completed(web::json::value::null(), std::make_exception_ptr(
+                signalr_exception(_XPLATSTR("the hub connection has been deconstructed"))));
+            return;
+        }
+
+        hub_connection->invoke(*m_envelope, arguments, invocation_completed);
+    }
+
+    void prepared_method::send(const web::json::value& arguments, const std::function<void(std::exception_ptr)>& send_completed) const
+    {
+        if (!send_completed)
+        {
+            throw std::invalid_argument("send_completed cannot be empty");
+        }
+
+        auto hub_connection = m_hub_connection.lock();
+        if (!hub_connection)
+        {
+            send_completed(std::make_exception_ptr(
+                signalr_exception(_XPLATSTR("the hub connection has been deconstructed"))));
+            return;
+        }
+
+        hub_connection->send(*m_envelope, arguments, send_completed);
+    }
+
+    const utility::string_t& prepared_method::get_method_name() const
+    {
+        return m_envelope->get_method_name();
+    }
+}
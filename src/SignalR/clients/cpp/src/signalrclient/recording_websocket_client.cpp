@@ -0,0 +1,64 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "recording_websocket_client.h"
+
+namespace signalr
+{
+    recording_websocket_client::recording_websocket_client(const std::shared_ptr<websocket_client>& websocket_client,
+        const std::shared_ptr<traffic_capture_writer>& capture_writer)
+        : m_websocket_client(websocket_client), m_capture_writer(capture_writer)
+    { }
+
+    pplx::task<void> recording_websocket_client::connect(const web::uri &url)
+    {
+        return m_websocket_client->connect(url);
+    }
+
+    pplx::task<void> recording_websocket_client::send(const utility::string_t &message)
+    {
+        m_capture_writer->write(frame_direction::sent, utility::conversions::to_utf8string(message));
+        return m_websocket_client->send(message);
+    }
+
+    pplx::task<void> recording_websocket_client::send(const uint8_t* data, size_t length, websocket_message_type message_type)
+    {
+        m_capture_writer->write(frame_direction::sent, std::string(reinterpret_cast<const char*>(data), length));
+        return m_websocket_client->send(data, length, message_type);
+    }
+
+    pplx::task<std::string> recording_websocket_client::receive()
+    {
+        auto capture_writer = m_capture_writer;
+        return m_websocket_client->receive()
+            .then([capture_writer](std::string message)
+            {
+                capture_writer->write(frame_direction::received, message);
+                return message;
+            });
+    }
+
+    pplx::task<websocket_message_type> recording_websocket_client::receive(std::vector<uint8_t>& buffer)
+    {
+        auto capture_writer = m_capture_writer;
+        auto destination = &buffer;
+        return m_websocket_client->receive(buffer)
+            .then([capture_writer, destination](websocket_message_type message_type)
+            {
+                capture_writer->write(frame_direction::received, std::string(destination->begin(), destination->end()));
+                return message_type;
+            });
+    }
+
+    pplx::task<void> recording_websocket_client::close()
+    {
+        auto capture_writer = m_capture_writer;
+        return m_websocket_client->close()
+            .then([capture_writer](pplx::task<void> close_task)
+            {
+                capture_writer->flush();
+                close_task.get();
+            });
+    }
+}
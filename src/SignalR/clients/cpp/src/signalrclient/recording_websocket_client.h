@@ -0,0 +1,36 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <memory>
+#include "websocket_client.h"
+#include "traffic_capture.h"
+
+namespace signalr
+{
+    // Decorates a websocket client and writes the frames it sends and receives to a traffic capture so that
+    // real traffic can be replayed later.
+    class recording_websocket_client : public websocket_client
+    {
+    public:
+        recording_websocket_client(const std::shared_ptr<websocket_client>& websocket_client,
+            const std::shared_ptr<traffic_capture_writer>& capture_writer);
+
+        pplx::task<void> connect(const web::uri &url) override;
+
+        pplx::task<void> send(const utility::string_t &message) override;
+
+        pplx::task<void> send(const uint8_t* data, size_t length, websocket_message_type message_type) override;
+
+        pplx::task<std::string> receive() override;
+
+        pplx::task<websocket_message_type> receive(std::vector<uint8_t>& buffer) override;
+
+        pplx::task<void> close() override;
+
+    private:
+        std::shared_ptr<websocket_client> m_websocket_client;
+        std::shared_ptr<traffic_capture_writer> m_capture_writer;
+    };
+}
@@ -0,0 +1,164 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include <algorithm>
+#include <cstring>
+#include "replay_buffer.h"
+
+namespace signalr
+{
+    replay_buffer::replay_buffer(size_t capacity)
+        : m_storage(capacity), m_head(0), m_used(0), m_count(0), m_first_sequence_id(1)
+    { }
+
+    // retains the message and assigns it the next sequence id. Returns false if there is not enough room left
+    // in which case the message is not retained.
+    bool replay_buffer::append(const utility::string_t& message)
+    {
+        const auto message_size = message.size() * sizeof(utility::char_t);
+        const auto record_size = sizeof(record_length) + message_size;
+
+        if (record_size > m_storage.size() - m_used)
+        {
+            return false;
+        }
+
+        retain(message.data(), message.size());
+        return true;
+    }
+
+    // each record gets a sequence id. Returns false if there is not enough room left for all records in which case
+    // none of them is retained.
+    bool replay_buffer::append_records(const utility::string_t& message)
+    {
+        const auto records = static_cast<size_t>(std::count(message.begin(), message.end(), _XPLATSTR('\x1e')));
+        const auto trailing = !message.empty() && message.back() != _XPLATSTR('\x1e') ? 1 : 0;
+        const auto size = (records + trailing) * sizeof(record_length) + message.size() * sizeof(utility::char_t);
+
+        if (size > m_storage.size() - m_used)
+        {
+            return false;
+        }
+
+        size_t record_start = 0;
+        while (record_start < message.size())
+        {
+            auto record_end = message.find(_XPLATSTR('\x1e'), record_start);
+            record_end = record_end == utility::string_t::npos ? message.size() : record_end + 1;
+            retain(message.data() + record_start, record_end - record_start);
+            record_start = record_end;
+        }
+
+        return true;
+    }
+
+    void replay_buffer::retain(const utility::char_t* message, size_t length)
+    {
+        const auto message_size = length * sizeof(utility::char_t);
+        const auto record_size = sizeof(record_length) + message_size;
+
+        const auto stored_length = static_cast<record_length>(message_size);
+        const auto tail = (m_head + m_used) % m_storage.size();
+        write(tail, &stored_length, sizeof(stored_length));
+        write((tail + sizeof(stored_length)) % m_storage.size(), message, message_size);
+
+        m_used += record_size;
+        m_count++;
+    }
+
+    // releases all messages up to and including the given sequence id
+    void replay_buffer::acknowledge(int64_t sequence_id)
+    {
+        while (m_count > 0 && m_first_sequence_id <= sequence_id)
+        {
+            const auto record_size = sizeof(record_length) + read_length(m_head);
+
+            m_head = (m_head + record_size) % m_storage.size();
+            m_used -= record_size;
+            m_count--;
+            m_first_sequence_id++;
+        }
+
+        if (m_count == 0)
+        {
+            m_head = 0;
+        }
+    }
+
+    // invokes the callback for each retained message starting from the oldest
+    void replay_buffer::for_each(const std::function<void(const utility::string_t&)>& callback) const
+    {
+        utility::string_t message;
+        auto offset = m_head;
+
+        for (size_t i = 0; i < m_count; i++)
+        {
+            const auto length = read_length(offset);
+            offset = (offset + sizeof(record_length)) % m_storage.size();
+
+            message.resize(length / sizeof(utility::char_t));
+            if (length > 0)
+            {
+                read(offset, &message[0], length);
+            }
+
+            offset = (offset + length) % m_storage.size();
+
+            callback(message);
+        }
+    }
+
+    // the sequence id of the oldest retained message or, if no messages are retained, of the next message
+    int64_t replay_buffer::get_first_sequence_id() const noexcept
+    {
+        return m_first_sequence_id;
+    }
+
+    int64_t replay_buffer::get_next_sequence_id() const noexcept
+    {
+        return m_first_sequence_id + static_cast<int64_t>(m_count);
+    }
+
+    size_t replay_buffer::size() const noexcept
+    {
+        return m_count;
+    }
+
+    size_t replay_buffer::size_in_bytes() const noexcept
+    {
+        return m_used;
+    }
+
+    size_t replay_buffer::capacity() const noexcept
+    {
+        return m_storage.size();
+    }
+
+    void replay_buffer::write(size_t offset, const void* data, size_t length)
+    {
+        const auto first_part = std::min(length, m_storage.size() - offset);
+        std::memcpy(&m_storage[offset], data, first_part);
+        if (first_part < length)
+        {
+            std::memcpy(&m_storage[0], static_cast<const uint8_t*>(data) + first_part, length - first_part);
+        }
+    }
+
+    void replay_buffer::read(size_t offset, void* data, size_t length) const
+    {
+        const auto first_part = std::min(length, m_storage.size() - offset);
+        std::memcpy(data, &m_storage[offset], first_part);
+        if (first_part < length)
+        {
+            std::memcpy(static_cast<uint8_t*>(data) + first_part, &m_storage[0], length - first_part);
+        }
+    }
+
+    replay_buffer::record_length replay_buffer::read_length(size_t offset) const
+    {
+        record_length length;
+        read(offset, &length, sizeof(length));
+        return length;
+    }
+}
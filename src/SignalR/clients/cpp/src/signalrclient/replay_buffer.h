@@ -0,0 +1,52 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    // A ring buffer of sent messages retained until the server acknowledges them. Messages are numbered with
+    // consecutive sequence ids starting at 1 and stored as length-prefixed records in a fixed-size byte ring so
+    // retaining a message does not allocate. The buffer is not thread safe.
+    class replay_buffer
+    {
+    public:
+        explicit replay_buffer(size_t capacity);
+
+        replay_buffer(const replay_buffer&) = delete;
+        replay_buffer& operator=(const replay_buffer&) = delete;
+
+        bool append(const utility::string_t& message);
+        // retains each record of a message made of records terminated by the record separator as a message of its
+        // own, the way the server numbers them
+        bool append_records(const utility::string_t& message);
+        void acknowledge(int64_t sequence_id);
+        void for_each(const std::function<void(const utility::string_t&)>& callback) const;
+
+        int64_t get_first_sequence_id() const noexcept;
+        int64_t get_next_sequence_id() const noexcept;
+
+        size_t size() const noexcept;
+        size_t size_in_bytes() const noexcept;
+        size_t capacity() const noexcept;
+
+    private:
+        typedef uint32_t record_length;
+
+        std::vector<uint8_t> m_storage;
+        size_t m_head;
+        size_t m_used;
+        size_t m_count;
+        int64_t m_first_sequence_id;
+
+        void retain(const utility::char_t* message, size_t length);
+        void write(size_t offset, const void* data, size_t length);
+        void read(size_t offset, void* data, size_t length) const;
+        record_length read_length(size_t offset) const;
+    };
+}
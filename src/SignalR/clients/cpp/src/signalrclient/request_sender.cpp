@@ -16,6 +16,15 @@ namespace signalr
         {
             auto negotiate_url = url_builder::build_negotiate(base_url);
 
+            if (signalr_client_config.get_stateful_reconnect())
+            {
+                // stateful reconnect relies on the connection token which is only returned for negotiate version 1
+                negotiate_url = web::uri_builder(negotiate_url)
+                    .append_query(_XPLATSTR("negotiateVersion=1"))
+                    .append_query(_XPLATSTR("useStatefulReconnect=true"))
+                    .to_uri();
+            }
+
             return http_sender::post(request_factory, negotiate_url, signalr_client_config)
                 .then([](utility::string_t body)
             {
@@ -34,6 +43,16 @@ namespace signalr
                     response.connectionId = negotiation_response_json[_XPLATSTR("connectionId")].as_string();
                 }
 
+                if (negotiation_response_json.has_field(_XPLATSTR("connectionToken")))
+                {
+                    response.connectionToken = negotiation_response_json[_XPLATSTR("connectionToken")].as_string();
+                }
+
+                if (negotiation_response_json.has_field(_XPLATSTR("useStatefulReconnect")))
+                {
+                    response.useStatefulReconnect = negotiation_response_json[_XPLATSTR("useStatefulReconnect")].as_bool();
+                }
+
                 if (negotiation_response_json.has_field(_XPLATSTR("availableTransports")))
                 {
                     for (auto transportData : negotiation_response_json[_XPLATSTR("availableTransports")].as_array())
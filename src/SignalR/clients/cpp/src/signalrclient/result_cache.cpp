@@ -0,0 +1,124 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "result_cache.h"
+
+namespace signalr
+{
+    result_cache_config::result_cache_config()
+        : m_time_to_live(1000), m_max_entries(1000)
+    { }
+
+    std::chrono::milliseconds result_cache_config::get_time_to_live() const noexcept
+    {
+        return m_time_to_live;
+    }
+
+    void result_cache_config::set_time_to_live(std::chrono::milliseconds time_to_live)
+    {
+        if (time_to_live.count() <= 0)
+        {
+            throw std::invalid_argument("time_to_live must be greater than zero");
+        }
+
+        m_time_to_live = time_to_live;
+    }
+
+    size_t result_cache_config::get_max_entries() const noexcept
+    {
+        return m_max_entries;
+    }
+
+    void result_cache_config::set_max_entries(size_t max_entries)
+    {
+        if (max_entries == 0)
+        {
+            throw std::invalid_argument("max_entries must be greater than zero");
+        }
+
+        m_max_entries = max_entries;
+    }
+
+    utility::string_t result_cache_config::get_invalidation_event() const
+    {
+        return m_invalidation_event;
+    }
+
+    void result_cache_config::set_invalidation_event(const utility::string_t& event_name)
+    {
+        m_invalidation_event = event_name;
+    }
+
+    result_cache::result_cache(const result_cache_config& config)
+        : m_config(config), m_generation(0), m_hits(0), m_misses(0)
+    { }
+
+    bool result_cache::try_get(const utility::string_t& arguments, web::json::value& result, uint64_t& generation)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto cached = m_index.find(arguments);
+        if (cached != m_index.end())
+        {
+            if (cached->second->expires_at > std::chrono::steady_clock::now())
+            {
+                m_entries.splice(m_entries.begin(), m_entries, cached->second);
+                result = cached->second->result;
+                ++m_hits;
+                return true;
+            }
+
+            m_entries.erase(cached->second);
+            m_index.erase(cached);
+        }
+
+        ++m_misses;
+        generation = m_generation;
+        return false;
+    }
+
+    void result_cache::add(const utility::string_t& arguments, const web::json::value& result, uint64_t generation)
+    {
+        const auto expires_at = std::chrono::steady_clock::now() + m_config.get_time_to_live();
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (generation != m_generation)
+        {
+            return;
+        }
+
+        // concurrent invocations with the same arguments may add the result more than once
+        auto cached = m_index.find(arguments);
+        if (cached != m_index.end())
+        {
+            cached->second->result = result;
+            cached->second->expires_at = expires_at;
+            m_entries.splice(m_entries.begin(), m_entries, cached->second);
+            return;
+        }
+
+        if (m_entries.size() >= m_config.get_max_entries())
+        {
+            m_index.erase(m_entries.back().arguments);
+            m_entries.pop_back();
+        }
+
+        m_entries.push_front(entry{ arguments, result, expires_at });
+        m_index.insert(std::make_pair(arguments, m_entries.begin()));
+    }
+
+    void result_cache::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_entries.clear();
+        m_index.clear();
+        ++m_generation;
+    }
+
+    result_cache_stats result_cache::get_stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return result_cache_stats{ m_hits, m_misses, m_entries.size() };
+    }
+}
@@ -0,0 +1,53 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "signalrclient/result_cache.h"
+#include "cpprest/json.h"
+
+namespace signalr
+{
+    // An LRU bounded cache of the results of a hub method keyed by the serialized arguments of the invocation.
+    // Expired results are evicted when they are looked up or when they are the least recently used result.
+    //
+    // A result is only added if the cache was not cleared since the lookup that missed it so that the result of an
+    // invocation that was in flight while the cache was invalidated is not cached.
+    class result_cache
+    {
+    public:
+        explicit result_cache(const result_cache_config& config);
+
+        result_cache(const result_cache&) = delete;
+        result_cache& operator=(const result_cache&) = delete;
+
+        // returns true and sets `result` if an unexpired result is cached for the arguments, otherwise sets
+        // `generation` to the generation the result of the invocation has to be added with
+        bool try_get(const utility::string_t& arguments, web::json::value& result, uint64_t& generation);
+        void add(const utility::string_t& arguments, const web::json::value& result, uint64_t generation);
+        void clear();
+
+        result_cache_stats get_stats() const;
+
+    private:
+        struct entry
+        {
+            utility::string_t arguments;
+            web::json::value result;
+            std::chrono::steady_clock::time_point expires_at;
+        };
+
+        const result_cache_config m_config;
+
+        mutable std::mutex m_lock;
+        // most recently used first
+        std::list<entry> m_entries;
+        std::unordered_map<utility::string_t, std::list<entry>::iterator> m_index;
+        uint64_t m_generation;
+        uint64_t m_hits;
+        uint64_t m_misses;
+    };
+}
@@ -2,51 +2,272 @@
 // Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
 
 #include "stdafx.h"
+#include <atomic>
 #include "signalrclient/signalr_client_config.h"
 #include "cpprest/http_client.h"
 #include "cpprest/ws_client.h"
 
 namespace signalr
 {
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        uint64_t next_http_client_config_id()
+        {
+            static std::atomic<uint64_t> http_client_config_id(0);
+            return ++http_client_config_id;
+        }
+
+        uint64_t next_tls_config_id()
+        {
+            static std::atomic<uint64_t> tls_config_id(0);
+            return ++tls_config_id;
+        }
+    }
+
+    struct signalr_client_config::settings
+    {
+        web::http::client::http_client_config http_client_config;
+        // identifies the http client config so that http clients can be shared by configs that were copied from
+        // each other. 0 is the default http client config, any change to the http client config assigns a new id
+        uint64_t http_client_config_id = 0;
+        web::websockets::client::websocket_client_config websocket_client_config;
+        // identifies the http and websocket client configs, which carry the ssl context callbacks and the
+        // certificate validation settings, so that TLS sessions are only resumed by connections made with the same
+        // TLS settings. 0 is the default, any change to either client config assigns a new id
+        uint64_t tls_config_id = 0;
+        web::http::http_headers http_headers;
+        bool stateful_reconnect = false;
+        size_t stateful_reconnect_buffer_size = 100000;
+        utility::string_t traffic_capture_path;
+        message_parsing message_parsing_mode = message_parsing::dom;
+        size_t parallel_parsing_threshold = 0;
+        std::shared_ptr<invocation_trace_sink> trace_sink;
+        partition_key_extractor key_extractor;
+        size_t dispatch_concurrency = 0;
+        size_t max_concurrent_invocations = 0;
+        bool adaptive_concurrency_limit = false;
+        utility::string_t outbox_directory;
+        size_t outbox_size = 16 * 1024 * 1024;
+        bool tls_session_resumption = true;
+    };
+
+    // all default constructed configs share the same snapshot
+    signalr_client_config::signalr_client_config()
+    {
+        static const std::shared_ptr<const settings> default_settings = std::make_shared<settings>();
+        m_settings = default_settings;
+    }
+
+    // the snapshot may be shared with copies of this config so it is copied rather than modified
+    signalr_client_config::settings& signalr_client_config::update_settings()
+    {
+        auto updated_settings = std::make_shared<settings>(*m_settings);
+        m_settings = updated_settings;
+        return *updated_settings;
+    }
+
+    const web::http::client::http_client_config& signalr_client_config::http_client_config() const noexcept
+    {
+        return m_settings->http_client_config;
+    }
+
+    uint64_t signalr_client_config::http_client_config_id() const noexcept
+    {
+        return m_settings->http_client_config_id;
+    }
+
+    uint64_t signalr_client_config::tls_config_id() const noexcept
+    {
+        return m_settings->tls_config_id;
+    }
+
     void signalr_client_config::set_proxy(const web::web_proxy &proxy)
     {
-        m_http_client_config.set_proxy(proxy);
-        m_websocket_client_config.set_proxy(proxy);
+        auto& settings = update_settings();
+        settings.http_client_config.set_proxy(proxy);
+        settings.http_client_config_id = next_http_client_config_id();
+        settings.websocket_client_config.set_proxy(proxy);
     }
 
     void signalr_client_config::set_credentials(const web::credentials &credentials)
     {
-        m_http_client_config.set_credentials(credentials);
-        m_websocket_client_config.set_credentials(credentials);
+        auto& settings = update_settings();
+        settings.http_client_config.set_credentials(credentials);
+        settings.http_client_config_id = next_http_client_config_id();
+        settings.websocket_client_config.set_credentials(credentials);
     }
 
     web::http::client::http_client_config signalr_client_config::get_http_client_config() const
     {
-        return m_http_client_config;
+        return m_settings->http_client_config;
     }
 
     void signalr_client_config::set_http_client_config(const web::http::client::http_client_config& http_client_config)
     {
-        m_http_client_config = http_client_config;
+        auto& settings = update_settings();
+        settings.http_client_config = http_client_config;
+        settings.http_client_config_id = next_http_client_config_id();
+        settings.tls_config_id = next_tls_config_id();
     }
 
     web::websockets::client::websocket_client_config signalr_client_config::get_websocket_client_config() const noexcept
     {
-        return m_websocket_client_config;
+        return m_settings->websocket_client_config;
     }
 
     void signalr_client_config::set_websocket_client_config(const web::websockets::client::websocket_client_config& websocket_client_config)
     {
-        m_websocket_client_config = websocket_client_config;
+        auto& settings = update_settings();
+        settings.websocket_client_config = websocket_client_config;
+        settings.tls_config_id = next_tls_config_id();
     }
 
     web::http::http_headers signalr_client_config::get_http_headers() const noexcept
     {
-        return m_http_headers;
+        return m_settings->http_headers;
     }
 
     void signalr_client_config::set_http_headers(const web::http::http_headers& http_headers)
     {
-        m_http_headers = http_headers;
+        update_settings().http_headers = http_headers;
+    }
+
+    bool signalr_client_config::get_stateful_reconnect() const noexcept
+    {
+        return m_settings->stateful_reconnect;
+    }
+
+    void signalr_client_config::set_stateful_reconnect(bool stateful_reconnect)
+    {
+        update_settings().stateful_reconnect = stateful_reconnect;
+    }
+
+    size_t signalr_client_config::get_stateful_reconnect_buffer_size() const noexcept
+    {
+        return m_settings->stateful_reconnect_buffer_size;
+    }
+
+    void signalr_client_config::set_stateful_reconnect_buffer_size(size_t buffer_size)
+    {
+        if (buffer_size == 0)
+        {
+            throw std::invalid_argument("buffer_size must be greater than zero");
+        }
+
+        update_settings().stateful_reconnect_buffer_size = buffer_size;
+    }
+
+    utility::string_t signalr_client_config::get_traffic_capture_path() const
+    {
+        return m_settings->traffic_capture_path;
+    }
+
+    void signalr_client_config::set_traffic_capture_path(const utility::string_t& path)
+    {
+        update_settings().traffic_capture_path = path;
+    }
+
+    message_parsing signalr_client_config::get_message_parsing() const noexcept
+    {
+        return m_settings->message_parsing_mode;
+    }
+
+    void signalr_client_config::set_message_parsing(message_parsing message_parsing)
+    {
+        update_settings().message_parsing_mode = message_parsing;
+    }
+
+    size_t signalr_client_config::get_parallel_parsing_threshold() const noexcept
+    {
+        return m_settings->parallel_parsing_threshold;
+    }
+
+    void signalr_client_config::set_parallel_parsing_threshold(size_t record_count)
+    {
+        update_settings().parallel_parsing_threshold = record_count;
+    }
+
+    std::shared_ptr<invocation_trace_sink> signalr_client_config::get_invocation_trace_sink() const noexcept
+    {
+        return m_settings->trace_sink;
+    }
+
+    void signalr_client_config::set_invocation_trace_sink(const std::shared_ptr<invocation_trace_sink>& sink)
+    {
+        update_settings().trace_sink = sink;
+    }
+
+    signalr_client_config::partition_key_extractor signalr_client_config::get_partition_key_extractor() const
+    {
+        return m_settings->key_extractor;
+    }
+
+    void signalr_client_config::set_partition_key_extractor(const partition_key_extractor& partition_key_extractor)
+    {
+        update_settings().key_extractor = partition_key_extractor;
+    }
+
+    size_t signalr_client_config::get_dispatch_concurrency() const noexcept
+    {
+        return m_settings->dispatch_concurrency;
+    }
+
+    void signalr_client_config::set_dispatch_concurrency(size_t dispatch_concurrency)
+    {
+        update_settings().dispatch_concurrency = dispatch_concurrency;
+    }
+
+    size_t signalr_client_config::get_max_concurrent_invocations() const noexcept
+    {
+        return m_settings->max_concurrent_invocations;
+    }
+
+    void signalr_client_config::set_max_concurrent_invocations(size_t max_concurrent_invocations)
+    {
+        update_settings().max_concurrent_invocations = max_concurrent_invocations;
+    }
+
+    bool signalr_client_config::get_adaptive_concurrency_limit() const noexcept
+    {
+        return m_settings->adaptive_concurrency_limit;
+    }
+
+    void signalr_client_config::set_adaptive_concurrency_limit(bool adaptive_concurrency_limit)
+    {
+        update_settings().adaptive_concurrency_limit = adaptive_concurrency_limit;
+    }
+
+    utility::string_t signalr_client_config::get_outbox_directory() const
+    {
+        return m_settings->outbox_directory;
+    }
+
+    void signalr_client_config::set_outbox_directory(const utility::string_t& directory)
+    {
+        update_settings().outbox_directory = directory;
+    }
+
+    size_t signalr_client_config::get_outbox_size() const noexcept
+    {
+        return m_settings->outbox_size;
+    }
+
+    void signalr_client_config::set_outbox_size(size_t outbox_size)
+    {
+        update_settings().outbox_size = outbox_size;
+    }
+
+    bool signalr_client_config::get_tls_session_resumption() const noexcept
+    {
+        return m_settings->tls_session_resumption;
+    }
+
+    // http clients are shared by configs with the same http client config id, so the id changes with the setting
+    void signalr_client_config::set_tls_session_resumption(bool tls_session_resumption)
+    {
+        auto& settings = update_settings();
+        settings.tls_session_resumption = tls_session_resumption;
+        settings.http_client_config_id = next_http_client_config_id();
     }
 }
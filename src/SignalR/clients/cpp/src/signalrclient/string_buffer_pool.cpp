@@ -0,0 +1,56 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "string_buffer_pool.h"
+
+namespace signalr
+{
+    string_buffer_pool::string_buffer_pool(size_t max_pooled_buffers, size_t max_pooled_capacity)
+        : m_max_pooled_buffers(max_pooled_buffers), m_max_pooled_capacity(max_pooled_capacity)
+    {
+        m_buffers.reserve(max_pooled_buffers);
+    }
+
+    // returns an empty buffer - a pooled one if available, a new one otherwise
+    utility::string_t string_buffer_pool::acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (!m_buffers.empty())
+            {
+                auto buffer = std::move(m_buffers.back());
+                m_buffers.pop_back();
+                return buffer;
+            }
+        }
+
+        return utility::string_t();
+    }
+
+    void string_buffer_pool::release(utility::string_t&& buffer)
+    {
+        if (buffer.capacity() > m_max_pooled_capacity)
+        {
+            return;
+        }
+
+        buffer.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_buffers.size() < m_max_pooled_buffers)
+            {
+                m_buffers.push_back(std::move(buffer));
+            }
+        }
+    }
+
+    size_t string_buffer_pool::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_buffers.size();
+    }
+}
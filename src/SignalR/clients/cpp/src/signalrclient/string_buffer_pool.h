@@ -0,0 +1,34 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    // Keeps strings that were used to build outgoing messages so that their capacity can be reused and sending
+    // a message does not have to grow a new buffer each time. Buffers larger than the max pooled capacity are
+    // not returned to the pool to avoid holding on to memory after sending an unusually large message.
+    class string_buffer_pool
+    {
+    public:
+        explicit string_buffer_pool(size_t max_pooled_buffers = 4, size_t max_pooled_capacity = 64 * 1024);
+
+        string_buffer_pool(const string_buffer_pool&) = delete;
+        string_buffer_pool& operator=(const string_buffer_pool&) = delete;
+
+        utility::string_t acquire();
+        void release(utility::string_t&& buffer);
+
+        size_t size() const;
+
+    private:
+        const size_t m_max_pooled_buffers;
+        const size_t m_max_pooled_capacity;
+        mutable std::mutex m_lock;
+        std::vector<utility::string_t> m_buffers;
+    };
+}
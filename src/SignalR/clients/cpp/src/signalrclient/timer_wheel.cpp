@@ -0,0 +1,191 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "timer_wheel.h"
+
+namespace signalr
+{
+    std::shared_ptr<timer_wheel> timer_wheel::create(std::chrono::milliseconds tick_duration, size_t slot_count)
+    {
+        return std::shared_ptr<timer_wheel>(new timer_wheel(tick_duration, slot_count));
+    }
+
+    timer_wheel::timer_wheel(std::chrono::milliseconds tick_duration, size_t slot_count)
+        : m_tick_duration(tick_duration.count() > 0 ? tick_duration : std::chrono::milliseconds(1)),
+        m_slots(slot_count > 0 ? slot_count : 1), m_current_slot(0), m_next_id(1)
+    { }
+
+    timer_wheel::~timer_wheel()
+    {
+        if (m_ticker_state)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_ticker_state->lock);
+                m_ticker_state->stopped = true;
+            }
+            m_ticker_state->stop_requested.notify_all();
+
+            // the last reference to the wheel can be released by a timer callback in which case the wheel is
+            // destroyed on the ticker thread and the thread cannot be joined
+            if (m_ticker.get_id() == std::this_thread::get_id())
+            {
+                m_ticker.detach();
+            }
+            else
+            {
+                m_ticker.join();
+            }
+        }
+    }
+
+    timer_wheel::timer_id timer_wheel::schedule(std::chrono::milliseconds timeout, const std::function<void()>& callback)
+    {
+        // round up so that a timer never fires before its timeout elapsed
+        const uint64_t ticks = timeout.count() <= 0
+            ? 1
+            : static_cast<uint64_t>((timeout.count() + m_tick_duration.count() - 1) / m_tick_duration.count());
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        const auto id = m_next_id++;
+        const auto slot_index = static_cast<size_t>((m_current_slot + ticks) % m_slots.size());
+        // a timer expires when the wheel reaches its slot for the rounds + 1 time
+        const auto rounds = (ticks - 1) / m_slots.size();
+
+        auto& slot = m_slots[slot_index];
+        slot.push_back(timer{ id, rounds, callback });
+        m_timers.insert(std::make_pair(id, timer_location{ slot_index, std::prev(slot.end()) }));
+
+        return id;
+    }
+
+    // returns false if the timer already fired or was cancelled
+    bool timer_wheel::cancel(timer_id id)
+    {
+        std::function<void()> callback;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto iter = m_timers.find(id);
+            if (iter == m_timers.end())
+            {
+                return false;
+            }
+
+            // the callback may hold the last reference to objects that must not be destroyed under the lock
+            callback = std::move(iter->second.position->callback);
+            m_slots[iter->second.slot_index].erase(iter->second.position);
+            m_timers.erase(iter);
+        }
+
+        return true;
+    }
+
+    void timer_wheel::advance(uint64_t ticks)
+    {
+        for (uint64_t i = 0; i < ticks; i++)
+        {
+            std::vector<std::function<void()>> expired;
+
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                m_current_slot = (m_current_slot + 1) % m_slots.size();
+
+                auto& slot = m_slots[m_current_slot];
+                for (auto timer = slot.begin(); timer != slot.end();)
+                {
+                    if (timer->rounds > 0)
+                    {
+                        timer->rounds--;
+                        ++timer;
+                    }
+                    else
+                    {
+                        expired.push_back(std::move(timer->callback));
+                        m_timers.erase(timer->id);
+                        timer = slot.erase(timer);
+                    }
+                }
+            }
+
+            // invoked outside the lock so that callbacks can schedule and cancel timers
+            for (auto& callback : expired)
+            {
+                callback();
+            }
+        }
+    }
+
+    // starts a background thread advancing the wheel in real time. Calling `start` more than once has no effect.
+    void timer_wheel::start()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_ticker_state)
+        {
+            return;
+        }
+
+        m_ticker_state = std::make_shared<ticker_state>();
+        m_ticker_state->stopped = false;
+        m_ticker = std::thread(&timer_wheel::run_ticker, std::weak_ptr<timer_wheel>(shared_from_this()),
+            m_ticker_state, m_tick_duration);
+    }
+
+    size_t timer_wheel::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_timers.size();
+    }
+
+    std::chrono::milliseconds timer_wheel::get_tick_duration() const noexcept
+    {
+        return m_tick_duration;
+    }
+
+    std::shared_ptr<timer_wheel> timer_wheel::get_default()
+    {
+        // leaked so that the ticker thread is never joined by a static destructor, which would deadlock under the
+        // loader lock when the library is unloaded on Windows and race with timers firing at exit
+        static const auto default_timer_wheel = new std::shared_ptr<timer_wheel>(timer_wheel::create(std::chrono::milliseconds(100), 512));
+        return *default_timer_wheel;
+    }
+
+    void timer_wheel::run_ticker(std::weak_ptr<timer_wheel> weak_timer_wheel, std::shared_ptr<ticker_state> state,
+        std::chrono::milliseconds tick_duration)
+    {
+        // ticks are derived from the elapsed time rather than counted so that the wheel does not drift when
+        // advancing it takes a while
+        const auto started = std::chrono::steady_clock::now();
+        uint64_t ticks_processed = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(state->lock);
+                const auto next_tick = started + tick_duration * (ticks_processed + 1);
+                if (state->stop_requested.wait_until(lock, next_tick, [&state]() { return state->stopped; }))
+                {
+                    return;
+                }
+            }
+
+            auto wheel = weak_timer_wheel.lock();
+            if (!wheel)
+            {
+                return;
+            }
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+            const auto ticks_elapsed = static_cast<uint64_t>(elapsed.count() / tick_duration.count());
+            if (ticks_elapsed > ticks_processed)
+            {
+                wheel->advance(ticks_elapsed - ticks_processed);
+                ticks_processed = ticks_elapsed;
+            }
+        }
+    }
+}
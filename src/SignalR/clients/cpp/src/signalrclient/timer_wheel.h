@@ -0,0 +1,95 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace signalr
+{
+    // A hashed timer wheel. Timers are hashed into slots by their expiration tick so scheduling and cancelling a
+    // timer are O(1) regardless of how many timers are outstanding; advancing the wheel by one tick only visits
+    // the timers in the current slot. Timers longer than a full revolution of the wheel wait the corresponding
+    // number of rounds in their slot. Expiration is accurate to a single tick.
+    //
+    // The wheel can be advanced manually with `advance()` or by a background thread started with `start()`.
+    // Callbacks are invoked on the thread advancing the wheel and must not throw.
+    //
+    // Note:
+    // Factory methods and private constructors prevent from using this class incorrectly. The background thread
+    // only holds a `std::weak_ptr` to the wheel so the instance has to be owned by a `std::shared_ptr`.
+    class timer_wheel : public std::enable_shared_from_this<timer_wheel>
+    {
+    public:
+        typedef uint64_t timer_id;
+
+        static std::shared_ptr<timer_wheel> create(std::chrono::milliseconds tick_duration, size_t slot_count);
+
+        timer_wheel(const timer_wheel&) = delete;
+        timer_wheel& operator=(const timer_wheel&) = delete;
+
+        ~timer_wheel();
+
+        timer_id schedule(std::chrono::milliseconds timeout, const std::function<void()>& callback);
+        bool cancel(timer_id id);
+
+        void advance(uint64_t ticks = 1);
+        void start();
+
+        size_t size() const;
+        std::chrono::milliseconds get_tick_duration() const noexcept;
+
+        // the wheel shared by all connections in the process so that the number of ticker threads does not grow with
+        // the number of connections. It has a tick of 100 ms and a revolution of ~51 seconds, longer timeouts wait
+        // additional rounds, and its ticker is started by the first `start()`
+        static std::shared_ptr<timer_wheel> get_default();
+
+    private:
+        struct timer
+        {
+            timer_id id;
+            uint64_t rounds;
+            std::function<void()> callback;
+        };
+
+        typedef std::list<timer> slot;
+
+        struct timer_location
+        {
+            size_t slot_index;
+            slot::iterator position;
+        };
+
+        // shared with the background thread so that the thread never touches the wheel after it was destroyed
+        struct ticker_state
+        {
+            std::mutex lock;
+            std::condition_variable stop_requested;
+            bool stopped;
+        };
+
+        timer_wheel(std::chrono::milliseconds tick_duration, size_t slot_count);
+
+        const std::chrono::milliseconds m_tick_duration;
+        mutable std::mutex m_lock;
+        std::vector<slot> m_slots;
+        std::unordered_map<timer_id, timer_location> m_timers;
+        size_t m_current_slot;
+        timer_id m_next_id;
+
+        std::shared_ptr<ticker_state> m_ticker_state;
+        std::thread m_ticker;
+
+        static void run_ticker(std::weak_ptr<timer_wheel> weak_timer_wheel, std::shared_ptr<ticker_state> state,
+            std::chrono::milliseconds tick_duration);
+    };
+}
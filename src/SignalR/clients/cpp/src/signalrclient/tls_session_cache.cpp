@@ -0,0 +1,268 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "tls_session_cache.h"
+#include <algorithm>
+#include <cctype>
+
+#ifndef _WIN32
+#include "boost/asio/ssl.hpp"
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#endif
+
+namespace signalr
+{
+#ifndef _WIN32
+    // the callbacks OpenSSL invokes on the connections of the contexts the cache is attached to
+    struct tls_session_cache_callbacks
+    {
+        // stored in the ex data of an attached context and freed with the context
+        struct binding
+        {
+            std::shared_ptr<tls_session_cache> cache;
+            std::string key;
+            void(*info_callback)(const SSL*, int, int);
+        };
+
+        static void free_binding(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+        {
+            delete static_cast<binding*>(ptr);
+        }
+
+        // the index, and its free callback, are allocated once per process and deliberately never released since
+        // contexts using them may outlive any point at which they could be
+        static int binding_index()
+        {
+            static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, &free_binding);
+            return index;
+        }
+
+        static binding* get_binding(const SSL* ssl)
+        {
+            return static_cast<binding*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), binding_index()));
+        }
+
+        // invoked before the client hello of the first handshake is written, which is the last chance to set the
+        // session to resume since the context is configured before the connection is created
+        static void info(const SSL* ssl, int where, int ret)
+        {
+            auto binding = get_binding(ssl);
+            if (binding == nullptr)
+            {
+                return;
+            }
+
+            if ((where & SSL_CB_HANDSHAKE_START) != 0 && !SSL_is_server(ssl) && SSL_get_session(ssl) == nullptr)
+            {
+                auto session = binding->cache->get(binding->key);
+                if (session != nullptr)
+                {
+                    SSL_set_session(const_cast<SSL*>(ssl), session);
+                    SSL_SESSION_free(session);
+                }
+            }
+
+            if (binding->info_callback != nullptr)
+            {
+                binding->info_callback(ssl, where, ret);
+            }
+        }
+
+        // sessions of servers that were not verified are not cached since a connection that verifies the server
+        // would otherwise resume them without verifying the server
+        static int new_session(SSL* ssl, SSL_SESSION* session)
+        {
+            auto binding = get_binding(ssl);
+            if (binding == nullptr || (SSL_get_verify_mode(ssl) & SSL_VERIFY_PEER) == 0 || SSL_get_verify_result(ssl) != X509_V_OK)
+            {
+                return 0;
+            }
+
+            binding->cache->add(binding->key, session);
+            return 1;
+        }
+    };
+#endif
+
+    tls_session_cache::tls_session_cache(size_t max_sessions)
+        : m_max_sessions(max_sessions), m_use_count(0)
+    {
+        if (max_sessions == 0)
+        {
+            throw std::invalid_argument("max_sessions must be greater than zero");
+        }
+    }
+
+    tls_session_cache::~tls_session_cache()
+    {
+#ifndef _WIN32
+        for (auto& session : m_sessions)
+        {
+            SSL_SESSION_free(session.second.session);
+        }
+#endif
+    }
+
+    void tls_session_cache::attach(ssl_ctx_st* context, const web::uri& url, uint64_t config_id)
+    {
+#ifndef _WIN32
+        auto binding = new tls_session_cache_callbacks::binding{ shared_from_this(), get_key(url, config_id), SSL_CTX_get_info_callback(context) };
+        if (!SSL_CTX_set_ex_data(context, tls_session_cache_callbacks::binding_index(), binding))
+        {
+            delete binding;
+            return;
+        }
+
+        // the sessions are only kept in this cache since each connection gets its own context
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(context, &tls_session_cache_callbacks::new_session);
+        SSL_CTX_set_info_callback(context, &tls_session_cache_callbacks::info);
+#else
+        (void)context;
+        (void)url;
+        (void)config_id;
+#endif
+    }
+
+    web::http::client::http_client_config tls_session_cache::attach(const web::http::client::http_client_config& config, const web::uri& url,
+        uint64_t config_id)
+    {
+        auto attached_config = config;
+#ifndef _WIN32
+        auto ssl_context_callback = config.get_ssl_context_callback();
+        auto cache = shared_from_this();
+        attached_config.set_ssl_context_callback([cache, url, config_id, ssl_context_callback](boost::asio::ssl::context& context)
+        {
+            if (ssl_context_callback)
+            {
+                ssl_context_callback(context);
+            }
+
+            cache->attach(context.native_handle(), url, config_id);
+        });
+#else
+        (void)url;
+        (void)config_id;
+#endif
+        return attached_config;
+    }
+
+    web::websockets::client::websocket_client_config tls_session_cache::attach(const web::websockets::client::websocket_client_config& config,
+        const web::uri& url, uint64_t config_id)
+    {
+        auto attached_config = config;
+#ifndef _WIN32
+        auto ssl_context_callback = config.get_ssl_context_callback();
+        auto cache = shared_from_this();
+        attached_config.set_ssl_context_callback([cache, url, config_id, ssl_context_callback](boost::asio::ssl::context& context)
+        {
+            if (ssl_context_callback)
+            {
+                ssl_context_callback(context);
+            }
+
+            cache->attach(context.native_handle(), url, config_id);
+        });
+#else
+        (void)url;
+        (void)config_id;
+#endif
+        return attached_config;
+    }
+
+    size_t tls_session_cache::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return m_sessions.size();
+    }
+
+    std::shared_ptr<tls_session_cache> tls_session_cache::get_default()
+    {
+        // leaked so that the cached sessions are not freed by a static destructor after OpenSSL was cleaned up
+        static const auto default_cache = new std::shared_ptr<tls_session_cache>(std::make_shared<tls_session_cache>());
+        return *default_cache;
+    }
+
+    uint64_t tls_session_cache::get_config_id(const signalr_client_config& config) noexcept
+    {
+        return config.tls_config_id();
+    }
+
+    std::string tls_session_cache::get_origin(const web::uri& url)
+    {
+        auto origin = utility::conversions::to_utf8string(url.host());
+        std::transform(origin.begin(), origin.end(), origin.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+
+        auto port = url.port();
+        if (port <= 0)
+        {
+            const auto scheme = utility::conversions::to_utf8string(url.scheme());
+            port = scheme == "https" || scheme == "wss" ? 443 : 80;
+        }
+
+        return origin.append(":").append(std::to_string(port));
+    }
+
+    std::string tls_session_cache::get_key(const web::uri& url, uint64_t config_id)
+    {
+        return get_origin(url).append("#").append(std::to_string(config_id));
+    }
+
+    void tls_session_cache::add(const std::string& key, ssl_session_st* session)
+    {
+#ifndef _WIN32
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto iter = m_sessions.find(key);
+        if (iter != m_sessions.end())
+        {
+            SSL_SESSION_free(iter->second.session);
+            iter->second = cached_session{ session, ++m_use_count };
+            return;
+        }
+
+        if (m_sessions.size() >= m_max_sessions)
+        {
+            auto least_recently_used = m_sessions.begin();
+            for (auto i = m_sessions.begin(); i != m_sessions.end(); ++i)
+            {
+                if (i->second.last_used < least_recently_used->second.last_used)
+                {
+                    least_recently_used = i;
+                }
+            }
+
+            SSL_SESSION_free(least_recently_used->second.session);
+            m_sessions.erase(least_recently_used);
+        }
+
+        m_sessions.insert(std::make_pair(key, cached_session{ session, ++m_use_count }));
+#else
+        (void)key;
+        (void)session;
+#endif
+    }
+
+    ssl_session_st* tls_session_cache::get(const std::string& key)
+    {
+#ifndef _WIN32
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto iter = m_sessions.find(key);
+        if (iter == m_sessions.end())
+        {
+            return nullptr;
+        }
+
+        iter->second.last_used = ++m_use_count;
+        SSL_SESSION_up_ref(iter->second.session);
+        return iter->second.session;
+#else
+        (void)key;
+        return nullptr;
+#endif
+    }
+}
@@ -0,0 +1,86 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "cpprest/http_client.h"
+#include "cpprest/ws_client.h"
+#include "signalrclient/signalr_client_config.h"
+
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+namespace signalr
+{
+    // Caches the TLS session last established with each origin so that new TLS connections to the origin resume it
+    // instead of performing a full handshake, which saves a round trip and the key exchange. The cache is shared by
+    // the http clients sending negotiate requests and the websocket clients, so that reconnects and new connections
+    // to a server resume the session of any earlier connection to it. Sessions are cached by the origin and the TLS
+    // settings of the signalr_client_config of the connection, so that a connection never resumes a session that
+    // was established with another client certificate or certificate validation. Only sessions whose server
+    // certificate was verified are cached. The least recently used key is dropped once the cache is full.
+    //
+    // The cache is attached to the OpenSSL contexts the http and websocket clients create for their connections
+    // through the ssl context callback of their configs. It is not attached on Windows: the http client uses
+    // WinHTTP, which resumes sessions on its own, and the library is not linked against the OpenSSL the websocket
+    // client uses there.
+    class tls_session_cache : public std::enable_shared_from_this<tls_session_cache>
+    {
+    public:
+        explicit tls_session_cache(size_t max_sessions = 64);
+        ~tls_session_cache();
+
+        tls_session_cache(const tls_session_cache&) = delete;
+        tls_session_cache& operator=(const tls_session_cache&) = delete;
+
+        // Sets up a context the TLS connections to the origin of the url made with the TLS settings identified by
+        // `config_id` are created with to resume the session cached for them and to cache the sessions established
+        // by them. Info callbacks already set on the context are still invoked.
+        void attach(ssl_ctx_st* context, const web::uri& url, uint64_t config_id);
+
+        // the config with an ssl context callback that attaches the cache after invoking the callback of the
+        // config, if any
+        web::http::client::http_client_config attach(const web::http::client::http_client_config& config, const web::uri& url,
+            uint64_t config_id);
+        web::websockets::client::websocket_client_config attach(const web::websockets::client::websocket_client_config& config,
+            const web::uri& url, uint64_t config_id);
+
+        size_t size() const;
+
+        // the cache shared by all connections in the process
+        static std::shared_ptr<tls_session_cache> get_default();
+
+        // identifies the TLS settings of the config, which change with its http and websocket client configs. Copies
+        // of a config share the id and default configs have id 0
+        static uint64_t get_config_id(const signalr_client_config& config) noexcept;
+
+        // the origin of the url, http and websocket urls of an origin have the same origin
+        static std::string get_origin(const web::uri& url);
+
+        // the key the sessions of connections to the origin of the url made with the TLS settings are cached by
+        static std::string get_key(const web::uri& url, uint64_t config_id);
+
+    private:
+        struct cached_session
+        {
+            ssl_session_st* session;
+            uint64_t last_used;
+        };
+
+        const size_t m_max_sessions;
+        mutable std::mutex m_lock;
+        std::map<std::string, cached_session> m_sessions;
+        uint64_t m_use_count;
+
+        friend struct tls_session_cache_callbacks;
+
+        // takes over the reference to the session
+        void add(const std::string& key, ssl_session_st* session);
+        // a new reference to the session cached by the key or nullptr
+        ssl_session_st* get(const std::string& key);
+    };
+}
@@ -0,0 +1,66 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "traced_invocation.h"
+#include <random>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        void generate_id(uint8_t* id, size_t length)
+        {
+            thread_local std::mt19937_64 generator(std::random_device{}());
+
+            for (size_t i = 0; i < length; i += sizeof(uint64_t))
+            {
+                auto random = generator();
+                for (size_t j = i; j < length && j < i + sizeof(uint64_t); ++j, random >>= 8)
+                {
+                    id[j] = static_cast<uint8_t>(random);
+                }
+            }
+        }
+    }
+
+    traced_invocation::traced_invocation(const std::shared_ptr<invocation_trace_sink>& sink)
+        : m_sink(sink), m_start(std::chrono::steady_clock::now()), m_pending_releases(2)
+    {
+        generate_id(m_span.trace_id, sizeof(m_span.trace_id));
+        generate_id(m_span.span_id, sizeof(m_span.span_id));
+        m_span.start_time = std::chrono::system_clock::now();
+        for (auto& stage : m_span.stages)
+        {
+            stage = std::chrono::nanoseconds(-1);
+        }
+        m_span.succeeded = false;
+
+        m_traceparent = m_span.traceparent();
+    }
+
+    const utility::string_t& traced_invocation::get_traceparent() const noexcept
+    {
+        return m_traceparent;
+    }
+
+    void traced_invocation::mark(invocation_stage stage) noexcept
+    {
+        m_span.stages[static_cast<size_t>(stage)] = std::chrono::steady_clock::now() - m_start;
+    }
+
+    void traced_invocation::set_succeeded(bool succeeded) noexcept
+    {
+        m_span.succeeded = succeeded;
+    }
+
+    // the last release observes the stages marked by the other thread before its release
+    void traced_invocation::release()
+    {
+        if (m_pending_releases.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            m_sink->record(m_span);
+        }
+    }
+}
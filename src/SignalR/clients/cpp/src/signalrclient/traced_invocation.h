@@ -0,0 +1,37 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "signalrclient/invocation_trace.h"
+
+namespace signalr
+{
+    // Collects the span of an invocation while it runs. Stages are marked from the threads the invocation
+    // progresses on; each stage is only marked once and by one thread. The span is passed to the sink once both
+    // the send and the completion of the invocation released the trace since they may finish in either order.
+    class traced_invocation
+    {
+    public:
+        explicit traced_invocation(const std::shared_ptr<invocation_trace_sink>& sink);
+
+        traced_invocation(const traced_invocation&) = delete;
+        traced_invocation& operator=(const traced_invocation&) = delete;
+
+        const utility::string_t& get_traceparent() const noexcept;
+
+        void mark(invocation_stage stage) noexcept;
+        void set_succeeded(bool succeeded) noexcept;
+        void release();
+
+    private:
+        std::shared_ptr<invocation_trace_sink> m_sink;
+        invocation_span m_span;
+        std::chrono::steady_clock::time_point m_start;
+        utility::string_t m_traceparent;
+        std::atomic<int> m_pending_releases;
+    };
+}
@@ -0,0 +1,167 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include <algorithm>
+#include "traffic_capture.h"
+#include "signalrclient/signalr_exception.h"
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        const char capture_magic[] = { 'S', 'R', 'T', 'C' };
+        const char capture_version = 1;
+
+        void write_varint(std::string& buffer, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+
+            buffer.push_back(static_cast<char>(value));
+        }
+
+        bool read_varint(std::istream& stream, uint64_t& value)
+        {
+            value = 0;
+            for (auto shift = 0; shift < 64; shift += 7)
+            {
+                const auto byte = stream.get();
+                if (byte == std::char_traits<char>::eof())
+                {
+                    return false;
+                }
+
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+
+            throw signalr_exception(_XPLATSTR("invalid traffic capture - malformed varint"));
+        }
+
+        utility::string_t invalid_capture(const utility::string_t& reason)
+        {
+            return utility::string_t(_XPLATSTR("invalid traffic capture - ")).append(reason);
+        }
+    }
+
+    traffic_capture_writer::traffic_capture_writer(const utility::string_t& path)
+        : m_stream(path, std::ios::binary | std::ios::trunc), m_start(std::chrono::steady_clock::now()), m_last_timestamp(0)
+    {
+        if (!m_stream)
+        {
+            throw signalr_exception(utility::string_t(_XPLATSTR("could not open the traffic capture file: ")).append(path));
+        }
+
+        m_stream.write(capture_magic, sizeof(capture_magic));
+        m_stream.put(capture_version);
+    }
+
+    void traffic_capture_writer::write(frame_direction direction, const std::string& payload)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // the timestamp is taken under the lock so that timestamps in the file are monotonic
+        const auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+
+        m_record.clear();
+        m_record.push_back(static_cast<char>(direction));
+        write_varint(m_record, static_cast<uint64_t>((timestamp - m_last_timestamp).count()));
+        write_varint(m_record, payload.size());
+        m_last_timestamp = timestamp;
+
+        m_stream.write(m_record.data(), m_record.size());
+        m_stream.write(payload.data(), payload.size());
+    }
+
+    void traffic_capture_writer::flush()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_stream.flush();
+    }
+
+    traffic_capture_reader::traffic_capture_reader(const utility::string_t& path)
+        : m_stream(path, std::ios::binary), m_size(0), m_last_timestamp(0)
+    {
+        if (!m_stream)
+        {
+            throw signalr_exception(utility::string_t(_XPLATSTR("could not open the traffic capture file: ")).append(path));
+        }
+
+        m_stream.seekg(0, std::ios::end);
+        m_size = m_stream.tellg();
+        m_stream.seekg(0, std::ios::beg);
+
+        char header[sizeof(capture_magic) + 1];
+        if (!m_stream.read(header, sizeof(header)) || !std::equal(capture_magic, capture_magic + sizeof(capture_magic), header))
+        {
+            throw signalr_exception(invalid_capture(_XPLATSTR("unrecognized file format")));
+        }
+
+        if (header[sizeof(capture_magic)] != capture_version)
+        {
+            throw signalr_exception(invalid_capture(_XPLATSTR("unsupported version")));
+        }
+    }
+
+    bool traffic_capture_reader::read(captured_frame& frame)
+    {
+        const auto direction = m_stream.get();
+        if (direction == std::char_traits<char>::eof())
+        {
+            return false;
+        }
+
+        if (direction != static_cast<int>(frame_direction::received) && direction != static_cast<int>(frame_direction::sent))
+        {
+            throw signalr_exception(invalid_capture(_XPLATSTR("unknown frame direction")));
+        }
+
+        uint64_t delta, length;
+        if (!read_varint(m_stream, delta) || !read_varint(m_stream, length))
+        {
+            throw signalr_exception(invalid_capture(_XPLATSTR("truncated frame")));
+        }
+
+        frame.direction = static_cast<frame_direction>(direction);
+        m_last_timestamp += std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(delta));
+        frame.timestamp = m_last_timestamp;
+
+        // a corrupt length must not make the reader allocate more than the file holds
+        const auto position = m_stream.tellg();
+        if (position < 0 || length > static_cast<uint64_t>(m_size - position))
+        {
+            throw signalr_exception(invalid_capture(_XPLATSTR("truncated frame")));
+        }
+
+        frame.payload.resize(static_cast<size_t>(length));
+        if (length > 0 && !m_stream.read(&frame.payload[0], static_cast<std::streamsize>(length)))
+        {
+            throw signalr_exception(invalid_capture(_XPLATSTR("truncated frame")));
+        }
+
+        return true;
+    }
+
+    std::vector<captured_frame> traffic_capture_reader::read_all(const utility::string_t& path)
+    {
+        traffic_capture_reader reader(path);
+
+        std::vector<captured_frame> frames;
+        captured_frame frame;
+        while (reader.read(frame))
+        {
+            frames.push_back(std::move(frame));
+        }
+
+        return frames;
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "cpprest/details/basic_types.h"
+
+namespace signalr
+{
+    enum class frame_direction : uint8_t
+    {
+        received = 0,
+        sent = 1
+    };
+
+    struct captured_frame
+    {
+        frame_direction direction;
+        // time elapsed since the capture was started
+        std::chrono::microseconds timestamp;
+        std::string payload;
+    };
+
+    // Writes websocket frames to a capture file. The file starts with a magic number and a version followed by one
+    // record per frame: the direction (1 byte), the time elapsed since the previous frame in microseconds and the
+    // payload length (both varint encoded) and the payload itself. Frames can be written from multiple threads.
+    class traffic_capture_writer
+    {
+    public:
+        explicit traffic_capture_writer(const utility::string_t& path);
+
+        traffic_capture_writer(const traffic_capture_writer&) = delete;
+        traffic_capture_writer& operator=(const traffic_capture_writer&) = delete;
+
+        void write(frame_direction direction, const std::string& payload);
+        void flush();
+
+    private:
+        std::mutex m_lock;
+        std::ofstream m_stream;
+        std::string m_record;
+        const std::chrono::steady_clock::time_point m_start;
+        std::chrono::microseconds m_last_timestamp;
+    };
+
+    class traffic_capture_reader
+    {
+    public:
+        explicit traffic_capture_reader(const utility::string_t& path);
+
+        traffic_capture_reader(const traffic_capture_reader&) = delete;
+        traffic_capture_reader& operator=(const traffic_capture_reader&) = delete;
+
+        // returns false once all frames were read
+        bool read(captured_frame& frame);
+
+        static std::vector<captured_frame> read_all(const utility::string_t& path);
+
+    private:
+        std::ifstream m_stream;
+        // the size of the file, frame lengths are checked against it before anything is allocated for the frame
+        std::streamoff m_size;
+        std::chrono::microseconds m_last_timestamp;
+    };
+}
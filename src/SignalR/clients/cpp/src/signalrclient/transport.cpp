@@ -22,6 +22,23 @@ namespace signalr
         m_process_response_callback(message);
     }
 
+    void transport::process_response(const uint8_t* data, size_t length)
+    {
+        if (m_process_raw_response_callback)
+        {
+            m_process_raw_response_callback(data, length);
+        }
+        else
+        {
+            m_process_response_callback(utility::conversions::to_string_t(std::string(data, data + length)));
+        }
+    }
+
+    void transport::set_process_raw_response_callback(const std::function<void(const uint8_t*, size_t)>& process_raw_response_callback)
+    {
+        m_process_raw_response_callback = process_raw_response_callback;
+    }
+
     void transport::error(const std::exception& e)
     {
         m_error_callback(e);
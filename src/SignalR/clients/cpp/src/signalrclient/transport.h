@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
 #include "pplx/pplxtasks.h"
 #include "cpprest/base_uri.h"
 #include "signalrclient/transport_type.h"
@@ -17,10 +19,18 @@ namespace signalr
 
         virtual pplx::task<void> send(const utility::string_t &data) = 0;
 
+        // sends the UTF-8 encoded data without copying it, the transport owns the buffer until the send completes
+        virtual pplx::task<void> send(std::vector<uint8_t>&& data) = 0;
+
         virtual pplx::task<void> disconnect() = 0;
 
         virtual transport_type get_transport_type() const = 0;
 
+        // When set, received messages are passed to the callback as the UTF-8 encoded bytes which are only valid
+        // until the callback returns instead of being converted to strings for the process response callback.
+        // Must be set before the transport is connected.
+        void set_process_raw_response_callback(const std::function<void(const uint8_t*, size_t)>& process_raw_response_callback);
+
         virtual ~transport();
 
     protected:
@@ -28,6 +38,7 @@ namespace signalr
             std::function<void(const std::exception&)> error_callback);
 
         void process_response(const utility::string_t &message);
+        void process_response(const uint8_t* data, size_t length);
         void error(const std::exception &e);
 
         logger m_logger;
@@ -35,6 +46,8 @@ namespace signalr
     private:
         std::function<void(const utility::string_t &)> m_process_response_callback;
 
+        std::function<void(const uint8_t*, size_t)> m_process_raw_response_callback;
+
         std::function<void(const std::exception&)> m_error_callback;
     };
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "stdafx.h"
 #include "transport_factory.h"
 #include "websocket_transport.h"
+#include "recording_websocket_client.h"
 
 namespace signalr
 {
@@ -14,6 +15,19 @@ namespace signalr
     {
         if (transport_type == signalr::transport_type::websockets)
         {
+            const auto capture_path = signalr_client_config.get_traffic_capture_path();
+            if (!capture_path.empty())
+            {
+                auto capture_writer = get_capture_writer(capture_path);
+                return websocket_transport::create(
+                    [signalr_client_config, capture_writer]()
+                    {
+                        return std::make_shared<recording_websocket_client>(
+                            std::make_shared<default_websocket_client>(signalr_client_config), capture_writer);
+                    },
+                    logger, process_response_callback, error_callback);
+            }
+
             return websocket_transport::create(
                 [signalr_client_config](){ return std::make_shared<default_websocket_client>(signalr_client_config); },
                 logger, process_response_callback, error_callback);
@@ -24,4 +38,18 @@ namespace signalr
 
     transport_factory::~transport_factory()
     { }
+
+    // all transports created for a connection write to the same capture so that reconnects are captured too
+    std::shared_ptr<traffic_capture_writer> transport_factory::get_capture_writer(const utility::string_t& path)
+    {
+        std::lock_guard<std::mutex> lock(m_capture_writer_lock);
+
+        if (!m_capture_writer || m_capture_path != path)
+        {
+            m_capture_writer = std::make_shared<traffic_capture_writer>(path);
+            m_capture_path = path;
+        }
+
+        return m_capture_writer;
+    }
 }
\ No newline at end of file
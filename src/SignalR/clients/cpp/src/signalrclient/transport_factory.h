@@ -4,9 +4,11 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include "signalrclient/signalr_client_config.h"
 #include "signalrclient/transport_type.h"
 #include "transport.h"
+#include "traffic_capture.h"
 
 namespace signalr
 {
@@ -19,5 +21,12 @@ namespace signalr
             std::function<void(const std::exception&)> error_callback);
 
         virtual ~transport_factory();
+
+    private:
+        std::mutex m_capture_writer_lock;
+        utility::string_t m_capture_path;
+        std::shared_ptr<traffic_capture_writer> m_capture_writer;
+
+        std::shared_ptr<traffic_capture_writer> get_capture_writer(const utility::string_t& path);
     };
 }
\ No newline at end of file
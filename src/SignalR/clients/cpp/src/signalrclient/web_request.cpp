@@ -4,11 +4,16 @@
 #include "stdafx.h"
 #include "cpprest/http_client.h"
 #include "web_request.h"
+#include "http_client_pool.h"
 
 namespace signalr
 {
     web_request::web_request(const web::uri &url)
-        : m_url(url)
+        : web_request(url, http_client_pool::get_default())
+    { }
+
+    web_request::web_request(const web::uri &url, const std::shared_ptr<http_client_pool>& http_client_pool)
+        : m_url(url), m_http_client_pool(http_client_pool)
     { }
 
     void web_request::set_method(const utility::string_t &method)
@@ -28,7 +33,9 @@ namespace signalr
 
     pplx::task<web_response> web_request::get_response()
     {
-        web::http::client::http_client client(m_url, m_signalr_client_config.get_http_client_config());
+        // the client is shared with other requests to the same origin so the request uri is relative to the origin
+        auto client = m_http_client_pool->get_client(m_url, m_signalr_client_config);
+        m_request.set_request_uri(m_url.resource());
 
         m_request.headers() = m_signalr_client_config.get_http_headers();
         if (!m_user_agent_string.empty())
@@ -36,7 +43,7 @@ namespace signalr
             m_request.headers()[_XPLATSTR("User-Agent")] = m_user_agent_string;
         }
 
-        return client.request(m_request)
+        return client->request(m_request)
             .then([](web::http::http_response response)
         {
             return web_response
@@ -8,10 +8,13 @@
 
 namespace signalr
 {
+    class http_client_pool;
+
     class web_request
     {
     public:
         explicit web_request(const web::uri &url);
+        web_request(const web::uri &url, const std::shared_ptr<http_client_pool>& http_client_pool);
 
         virtual void set_method(const utility::string_t &method);
         virtual void set_user_agent(const utility::string_t &user_agent_string);
@@ -28,5 +31,6 @@ namespace signalr
         web::http::http_request m_request;
         utility::string_t m_user_agent_string;
         signalr_client_config m_signalr_client_config;
+        std::shared_ptr<http_client_pool> m_http_client_pool;
     };
 }
\ No newline at end of file
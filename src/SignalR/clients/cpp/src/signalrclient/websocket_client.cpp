@@ -0,0 +1,52 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "websocket_client.h"
+#include "signalrclient/signalr_exception.h"
+
+namespace signalr
+{
+    pplx::task<void> websocket_client::send(const uint8_t* data, size_t length, websocket_message_type message_type)
+    {
+        if (message_type == websocket_message_type::binary)
+        {
+            return pplx::task_from_exception<void>(signalr_exception(_XPLATSTR("the websocket client does not support binary frames")));
+        }
+
+        return send(utility::conversions::to_string_t(std::string(reinterpret_cast<const char*>(data), length)));
+    }
+
+    pplx::task<websocket_message_type> websocket_client::receive(std::vector<uint8_t>& buffer)
+    {
+        auto destination = &buffer;
+        return receive()
+            .then([destination](const std::string& message)
+            {
+                destination->assign(message.begin(), message.end());
+                return websocket_message_type::text;
+            });
+    }
+
+    void websocket_client::receive(std::vector<uint8_t>& buffer,
+        const std::function<void(websocket_message_type, std::exception_ptr)>& received)
+    {
+        auto handler = &received;
+        receive(buffer)
+            .then([handler](pplx::task<websocket_message_type> receive_task)
+            {
+                websocket_message_type message_type;
+                try
+                {
+                    message_type = receive_task.get();
+                }
+                catch (...)
+                {
+                    (*handler)(websocket_message_type::text, std::current_exception());
+                    return;
+                }
+
+                (*handler)(message_type, nullptr);
+            });
+    }
+}
@@ -3,22 +3,51 @@
 
 #pragma once
 
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <vector>
 #include "pplx/pplxtasks.h"
 #include "cpprest/base_uri.h"
 
 namespace signalr
 {
+    enum class websocket_message_type
+    {
+        text,
+        binary
+    };
+
     class websocket_client
     {
     public:
         virtual pplx::task<void> connect(const web::uri &url) = 0;
 
+        // implementations must not hold on to the message after `send` returns - callers reuse the buffer
         virtual pplx::task<void> send(const utility::string_t &message) = 0;
 
+        // sends the bytes as a single frame without copying them into a string first. The bytes are owned by the
+        // caller and must stay valid until the returned task completes. Text frames must contain UTF-8. The
+        // default implementation sends text frames with `send` and fails for binary frames.
+        virtual pplx::task<void> send(const uint8_t* data, size_t length, websocket_message_type message_type);
+
         virtual pplx::task<std::string> receive() = 0;
 
+        // receives a frame into the buffer, replacing its contents but reusing its capacity, and returns the type
+        // of the frame. The buffer is owned by the caller and must stay valid until the returned task completes.
+        // The default implementation copies the text frame returned by `receive`.
+        virtual pplx::task<websocket_message_type> receive(std::vector<uint8_t>& buffer);
+
+        // Receives a frame into the buffer and invokes the handler with the type of the frame or the error that
+        // made the receive fail, possibly before returning. The buffer and the handler are owned by the caller and
+        // must stay valid until the handler is invoked, which lets callers receive in a loop without allocating
+        // anything beyond what the client allocates to receive a frame. The default implementation continues the
+        // task returned by `receive(buffer)`.
+        virtual void receive(std::vector<uint8_t>& buffer,
+            const std::function<void(websocket_message_type, std::exception_ptr)>& received);
+
         virtual pplx::task<void> close() = 0;
 
         virtual ~websocket_client() {};
     };
-}
\ No newline at end of file
+}
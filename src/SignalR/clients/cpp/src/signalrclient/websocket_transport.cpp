@@ -5,9 +5,187 @@
 #include "websocket_transport.h"
 #include "logger.h"
 #include "signalrclient/signalr_exception.h"
+#include <atomic>
 
 namespace signalr
 {
+    // Receives the frames of a connection until it is closed. The buffer the frames are received into, the handler
+    // passed to the callback based `websocket_client::receive` and the rest of the state are created once per
+    // connection so that receiving a frame does not allocate in the transport. What the websocket client allocates to
+    // receive a frame is up to the client, `default_websocket_client` allocates the task of the cpprest receive and
+    // its continuation. A frame received before `receive` returns is processed by the loop in `receive_frames`
+    // instead of recursively so that clients completing synchronously don't grow the stack.
+    // Note that the connection assumes that the error callback won't be fired when the result is being processed. This
+    // may no longer be true when we replace the pump with "on_message_received" and "on_close" events if they
+    // can be fired on different threads in which case we will have to lock before setting groups token and message id.
+    class websocket_transport::receive_pump : public std::enable_shared_from_this<receive_pump>
+    {
+    public:
+        // Holding the `std::weak_ptr<websocket_transport>` prevents from a memory leak where the pump would keep the
+        // transport alive as long as the connection is open.
+        receive_pump(const std::shared_ptr<websocket_transport>& transport, const std::shared_ptr<websocket_client>& websocket_client,
+            const pplx::cancellation_token_source& cts)
+            : m_transport(transport), m_websocket_client(websocket_client), m_cts(cts), m_logger(transport->m_logger),
+            m_state(state::receiving), m_exception(nullptr)
+        {
+            m_received = [this](websocket_message_type, std::exception_ptr exception) { on_received(exception); };
+        }
+
+        receive_pump(const receive_pump&) = delete;
+        receive_pump& operator=(const receive_pump&) = delete;
+
+        void start()
+        {
+            // the pump, and with it the buffer the client receives into, is kept alive while a receive is outstanding
+            m_self = shared_from_this();
+            receive_frames();
+        }
+
+    private:
+        enum class state { receiving, pending, completed_inline };
+
+        std::weak_ptr<websocket_transport> m_transport;
+        std::shared_ptr<websocket_client> m_websocket_client;
+        pplx::cancellation_token_source m_cts;
+        logger m_logger;
+        std::vector<uint8_t> m_buffer;
+        std::function<void(websocket_message_type, std::exception_ptr)> m_received;
+        std::atomic<state> m_state;
+        std::exception_ptr m_exception;
+        std::shared_ptr<receive_pump> m_self;
+
+        void receive_frames()
+        {
+            for (;;)
+            {
+                m_state = state::receiving;
+                m_websocket_client->receive(m_buffer, m_received);
+
+                auto expected = state::receiving;
+                if (m_state.compare_exchange_strong(expected, state::pending))
+                {
+                    // the frame is processed by `on_received` once it was received
+                    return;
+                }
+
+                if (!process_frame())
+                {
+                    stop();
+                    return;
+                }
+            }
+        }
+
+        void on_received(std::exception_ptr exception)
+        {
+            m_exception = exception;
+
+            auto expected = state::receiving;
+            if (m_state.compare_exchange_strong(expected, state::completed_inline))
+            {
+                // `receive_frames` is still on the stack and processes the frame
+                return;
+            }
+
+            if (process_frame())
+            {
+                receive_frames();
+            }
+            else
+            {
+                stop();
+            }
+        }
+
+        // returns false if no more frames should be received
+        bool process_frame()
+        {
+            if (m_exception)
+            {
+                auto exception = m_exception;
+                m_exception = nullptr;
+                handle_error(exception);
+                return false;
+            }
+
+            if (m_cts.get_token().is_canceled())
+            {
+                m_logger.log(trace_level::info,
+                    utility::string_t(_XPLATSTR("[websocket transport] receive task canceled.")));
+                return false;
+            }
+
+            auto transport = m_transport.lock();
+            if (!transport)
+            {
+                return false;
+            }
+
+            transport->process_response(m_buffer.data(), m_buffer.size());
+            return !m_cts.get_token().is_canceled();
+        }
+
+        void handle_error(std::exception_ptr exception)
+        {
+            m_cts.cancel();
+
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (const pplx::task_canceled&)
+            {
+                m_logger.log(trace_level::info,
+                    utility::string_t(_XPLATSTR("[websocket transport] receive task canceled.")));
+            }
+            catch (const std::exception& e)
+            {
+                m_logger.log(
+                    trace_level::errors,
+                    utility::string_t(_XPLATSTR("[websocket transport] error receiving response from websocket: "))
+                    .append(utility::conversions::to_string_t(e.what())));
+
+                close_websocket_client();
+
+                auto transport = m_transport.lock();
+                if (transport)
+                {
+                    transport->error(e);
+                }
+            }
+            catch (...)
+            {
+                m_logger.log(
+                    trace_level::errors,
+                    utility::string_t(_XPLATSTR("[websocket transport] unknown error occurred when receiving response from websocket")));
+
+                close_websocket_client();
+
+                auto transport = m_transport.lock();
+                if (transport)
+                {
+                    transport->error(signalr_exception(_XPLATSTR("unknown error")));
+                }
+            }
+        }
+
+        void close_websocket_client()
+        {
+            m_websocket_client->close()
+                .then([](pplx::task<void> task)
+                {
+                    try { task.get(); }
+                    catch (...) {}
+                });
+        }
+
+        // must be the last thing the pump does since it may destroy the pump
+        void stop()
+        {
+            auto self = std::move(m_self);
+        }
+    };
+
     std::shared_ptr<transport> websocket_transport::create(const std::function<std::shared_ptr<websocket_client>()>& websocket_client_factory,
         const logger& logger, const std::function<void(const utility::string_t &)>& process_response_callback,
         std::function<void(const std::exception&)> error_callback)
@@ -30,7 +208,8 @@ namespace signalr
     {
         try
         {
-            disconnect().get();
+            // the dtor may run on a pool thread so the websocket is closed without waiting for the close to complete
+            disconnect();
         }
         catch (...) // must not throw from the destructor
         {}
@@ -75,7 +254,7 @@ namespace signalr
                     try
                     {
                         connect_task.get();
-                        transport->receive_loop(receive_loop_cts);
+                        std::make_shared<receive_pump>(transport, transport->safe_get_websocket_client(), receive_loop_cts)->start();
                         connect_tce.set();
                     }
                     catch (const std::exception &e)
@@ -102,6 +281,18 @@ namespace signalr
         return safe_get_websocket_client()->send(data);
     }
 
+    pplx::task<void> websocket_transport::send(std::vector<uint8_t>&& data)
+    {
+        auto buffer = std::make_shared<std::vector<uint8_t>>(std::move(data));
+
+        // send will return a faulted task if client has disconnected
+        return safe_get_websocket_client()->send(buffer->data(), buffer->size(), websocket_message_type::text)
+            .then([buffer](pplx::task<void> send_task)
+            {
+                send_task.get();
+            });
+    }
+
     pplx::task<void> websocket_transport::disconnect()
     {
         std::shared_ptr<websocket_client> websocket_client = nullptr;
@@ -121,8 +312,9 @@ namespace signalr
 
         auto logger = m_logger;
 
+        // the client is kept alive until it was closed since the transport may be destroyed in the meantime
         return websocket_client->close()
-            .then([logger](pplx::task<void> close_task)
+            .then([logger, websocket_client](pplx::task<void> close_task)
             mutable {
                 try
                 {
@@ -138,101 +330,6 @@ namespace signalr
             });
     }
 
-    // Note that the connection assumes that the error callback won't be fired when the result is being processed. This
-    // may no longer be true when we replace the `receive_loop` with "on_message_received" and "on_close" events if they
-    // can be fired on different threads in which case we will have to lock before setting groups token and message id.
-    void websocket_transport::receive_loop(pplx::cancellation_token_source cts)
-    {
-        auto this_transport = shared_from_this();
-        auto logger = this_transport->m_logger;
-
-        // Passing the `std::weak_ptr<websocket_transport>` prevents from a memory leak where we would capture the shared_ptr to
-        // the transport in the continuation lambda and as a result as long as the loop runs the ref count would never get to
-        // zero. Now we capture the weak pointer and get the shared pointer only when the continuation runs so the ref count is
-        // incremented when the shared pointer is acquired and then decremented when it goes out of scope of the continuation.
-        auto weak_transport = std::weak_ptr<websocket_transport>(this_transport);
-
-        auto websocket_client = this_transport->safe_get_websocket_client();
-
-        websocket_client->receive()
-            // There are two cases when we exit the loop. The first case is implicit - we pass the cancellation_token
-            // to `then` (note this is after the lambda body) and if the token is cancelled the continuation will not
-            // run at all. The second - explicit - case happens if the token gets cancelled after the continuation has
-            // been started in which case we just stop the loop by not scheduling another receive task.
-            .then([weak_transport, cts](std::string message)
-            {
-                auto transport = weak_transport.lock();
-                if (transport)
-                {
-                    transport->process_response(utility::conversions::to_string_t(message));
-
-                    if (!cts.get_token().is_canceled())
-                    {
-                        transport->receive_loop(cts);
-                    }
-                }
-            }, cts.get_token())
-            // this continuation is used to observe exceptions from the previous tasks. It will run always - even if one of
-            // the previous continuations throws or was not scheduled due to the cancellation token being set to cancelled
-            .then([weak_transport, logger, websocket_client, cts](pplx::task<void> task)
-            mutable {
-                try
-                {
-                    task.get();
-                }
-                catch (const pplx::task_canceled&)
-                {
-                    cts.cancel();
-
-                    logger.log(trace_level::info,
-                        utility::string_t(_XPLATSTR("[websocket transport] receive task canceled.")));
-                }
-                catch (const std::exception& e)
-                {
-                    cts.cancel();
-
-                    logger.log(
-                        trace_level::errors,
-                        utility::string_t(_XPLATSTR("[websocket transport] error receiving response from websocket: "))
-                        .append(utility::conversions::to_string_t(e.what())));
-
-                    websocket_client->close()
-                        .then([](pplx::task<void> task)
-                    {
-                        try { task.get(); }
-                        catch (...) {}
-                    });
-
-                    auto transport = weak_transport.lock();
-                    if (transport)
-                    {
-                        transport->error(e);
-                    }
-                }
-                catch (...)
-                {
-                    cts.cancel();
-
-                    logger.log(
-                        trace_level::errors,
-                        utility::string_t(_XPLATSTR("[websocket transport] unknown error occurred when receiving response from websocket")));
-
-                    websocket_client->close()
-                        .then([](pplx::task<void> task)
-                    {
-                        try { task.get(); }
-                        catch (...) {}
-                    });
-
-                    auto transport = weak_transport.lock();
-                    if (transport)
-                    {
-                        transport->error(signalr_exception(_XPLATSTR("unknown error")));
-                    }
-                }
-            });
-    }
-
     std::shared_ptr<websocket_client> websocket_transport::safe_get_websocket_client()
     {
         {
@@ -29,6 +29,8 @@ namespace signalr
 
         pplx::task<void> send(const utility::string_t &data) override;
 
+        pplx::task<void> send(std::vector<uint8_t>&& data) override;
+
         pplx::task<void> disconnect() override;
 
         transport_type get_transport_type() const noexcept override;
@@ -45,10 +47,7 @@ namespace signalr
 
         pplx::cancellation_token_source m_receive_loop_cts;
 
-        void receive_loop(pplx::cancellation_token_source cts);
-
-        void handle_receive_error(const std::exception &e, pplx::cancellation_token_source cts,
-            logger logger, std::weak_ptr<transport> weak_transport);
+        class receive_pump;
 
         std::shared_ptr<websocket_client> safe_get_websocket_client();
     };
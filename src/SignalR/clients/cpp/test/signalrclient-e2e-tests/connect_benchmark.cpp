@@ -0,0 +1,105 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "connect_benchmark.h"
+#include "hub_connection.h"
+
+namespace
+{
+    // the value at the given percentile of sorted samples, using the nearest rank
+    double percentile(const std::vector<double>& sorted_samples, double percentile)
+    {
+        const auto rank = static_cast<size_t>(percentile / 100 * sorted_samples.size() + 0.5);
+        return sorted_samples[std::min(std::max(rank, static_cast<size_t>(1)), sorted_samples.size()) - 1];
+    }
+
+    void print_distribution(const char* name, std::vector<double>& samples)
+    {
+        if (samples.empty())
+        {
+            std::printf("%-18s %8s\n", name, "-");
+            return;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        std::printf("%-18s %8.2f %8.2f %8.2f %8.2f %8.2f\n", name, samples.front(), percentile(samples, 50),
+            percentile(samples, 90), percentile(samples, 99), samples.back());
+    }
+
+    double to_milliseconds(std::chrono::nanoseconds duration)
+    {
+        return duration.count() / 1000000.0;
+    }
+}
+
+int get_benchmark_cycles(int argc, utility::char_t* argv[])
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        utility::string_t str = argv[i];
+
+        auto pos = str.find(U("benchmark="));
+        if (pos != std::string::npos)
+        {
+            return std::stoi(str.substr(pos + 10));
+        }
+    }
+
+    return 0;
+}
+
+// The first cycle sets up the server side of the test host and is left out of the results. Phases that were not
+// reached in a cycle, e.g. because it failed, don't contribute samples.
+int run_connect_benchmark(const utility::string_t& url, int cycles)
+{
+    signalr::hub_connection hub_connection(url, signalr::trace_level::errors);
+
+    std::vector<double> phases[signalr::connect_timings::phase_count];
+    std::vector<double> totals;
+    auto failures = 0;
+
+    for (auto cycle = 0; cycle <= cycles; ++cycle)
+    {
+        try
+        {
+            hub_connection.start().get();
+            hub_connection.stop().get();
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("cycle %d failed: %s\n", cycle, e.what());
+            failures++;
+            continue;
+        }
+
+        if (cycle == 0)
+        {
+            continue;
+        }
+
+        const auto timings = hub_connection.get_connect_timings();
+        for (size_t phase = 0; phase < signalr::connect_timings::phase_count; ++phase)
+        {
+            if (timings.phases[phase].count() >= 0)
+            {
+                phases[phase].push_back(to_milliseconds(timings.phases[phase]));
+            }
+        }
+
+        totals.push_back(to_milliseconds(timings.total));
+    }
+
+    std::printf("%d start/stop cycles, %d failed, times in ms\n", cycles, failures);
+    std::printf("%-18s %8s %8s %8s %8s %8s\n", "phase", "min", "p50", "p90", "p99", "max");
+    print_distribution("negotiate", phases[static_cast<size_t>(signalr::connect_phase::negotiate)]);
+    print_distribution("redirects", phases[static_cast<size_t>(signalr::connect_phase::redirects)]);
+    print_distribution("websocket connect", phases[static_cast<size_t>(signalr::connect_phase::websocket_connect)]);
+    print_distribution("handshake", phases[static_cast<size_t>(signalr::connect_phase::handshake)]);
+    print_distribution("total", totals);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include "cpprest/details/basic_types.h"
+
+// the number of start/stop cycles passed with the `benchmark=<cycles>` argument, 0 if the argument is not present
+int get_benchmark_cycles(int argc, utility::char_t* argv[]);
+
+// Starts and stops a hub connection to the test host `cycles` times and prints the distribution of the time each
+// connect phase took. Returns the exit code of the test run.
+int run_connect_benchmark(const utility::string_t& url, int cycles);
@@ -4,6 +4,9 @@
 #include "stdafx.h"
 #include <vector>
 #include "test_utils.h"
+#include "connect_benchmark.h"
+
+extern utility::string_t url;
 
 #if defined(_WIN32)
 int wmain(int argc, wchar_t* argv[])
@@ -13,6 +16,13 @@ int main(int argc, char* argv[])
 {
     get_url(argc, argv);
 
+    // benchmark=<cycles> runs start/stop cycles against the test host instead of the tests
+    const auto benchmark_cycles = get_benchmark_cycles(argc, argv);
+    if (benchmark_cycles > 0)
+    {
+        return run_connect_benchmark(url, benchmark_cycles);
+    }
+
     ::testing::InitGoogleTest(&argc, argv);
     RUN_ALL_TESTS();
     return 0;
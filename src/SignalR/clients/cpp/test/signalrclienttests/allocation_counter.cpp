@@ -0,0 +1,59 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "allocation_counter.h"
+#include <cstdlib>
+#include <new>
+
+// unnamed namespace makes it invisble outside this translation unit
+namespace
+{
+    thread_local bool counting_enabled = false;
+    thread_local size_t allocation_count = 0;
+    thread_local size_t allocated_bytes = 0;
+}
+
+allocation_counter::allocation_counter()
+{
+    allocation_count = 0;
+    allocated_bytes = 0;
+    counting_enabled = true;
+}
+
+allocation_counter::~allocation_counter()
+{
+    counting_enabled = false;
+}
+
+size_t allocation_counter::get_count() const
+{
+    return allocation_count;
+}
+
+size_t allocation_counter::get_bytes() const
+{
+    return allocated_bytes;
+}
+
+void* operator new(std::size_t size)
+{
+    if (counting_enabled)
+    {
+        ++allocation_count;
+        allocated_bytes += size;
+    }
+
+    auto p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
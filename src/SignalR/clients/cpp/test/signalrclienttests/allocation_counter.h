@@ -0,0 +1,25 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+
+// Counts the heap allocations, and the bytes allocated, made by the current thread while the instance is alive. The test executable replaces
+// the global operator new to do the counting. Instances must not be nested.
+//
+// On Windows the replacement only applies to the test executable and the signalrclient static library linked into it; allocations made
+// inside DLLs, e.g. by cpprest, use the operator new of their own CRT and are not counted. Tests asserting that code does not allocate
+// therefore only cover signalrclient's own allocations there.
+class allocation_counter
+{
+public:
+    allocation_counter();
+    ~allocation_counter();
+
+    allocation_counter(const allocation_counter&) = delete;
+    allocation_counter& operator=(const allocation_counter&) = delete;
+
+    size_t get_count() const;
+    size_t get_bytes() const;
+};
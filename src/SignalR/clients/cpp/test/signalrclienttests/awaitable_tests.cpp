@@ -0,0 +1,163 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/awaitable.h"
+
+// The awaitables need C++20, the tests are built by the signalrclientcoroutinetests target which is enabled with the
+// SIGNALRCLIENT_COROUTINE_TESTS CMake option. The file is empty in builds of the other tests.
+#if defined(__cpp_impl_coroutine)
+
+#include "test_utils.h"
+#include "test_transport_factory.h"
+#include "test_web_request_factory.h"
+#include "hub_connection_impl.h"
+#include "trace_log_writer.h"
+#include "signalrclient/signalr_exception.h"
+
+using namespace signalr;
+
+// unnamed namespace makes it invisble outside this translation unit
+namespace
+{
+    struct detached_coroutine
+    {
+        struct promise_type
+        {
+            detached_coroutine get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    std::shared_ptr<hub_connection_impl> create_hub_connection(std::shared_ptr<websocket_client> websocket_client)
+    {
+        return hub_connection_impl::create(create_uri(), trace_level::all, std::make_shared<trace_log_writer>(),
+            create_test_web_request_factory(), std::make_unique<test_transport_factory>(websocket_client));
+    }
+
+    detached_coroutine invoke_and_await(std::shared_ptr<hub_connection_impl> hub_connection,
+        std::shared_ptr<json::value> result, std::shared_ptr<event> completed)
+    {
+        *result = co_await details::invoke_awaiter([hub_connection](const hub_connection::invocation_completed_handler& invocation_completed)
+        {
+            hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(), invocation_completed);
+        });
+
+        completed->set();
+    }
+
+    // completes the invocation before `await_suspend` returns so the coroutine must not be suspended
+    detached_coroutine await_completed_invocation(std::exception_ptr exception, std::shared_ptr<json::value> result,
+        std::shared_ptr<std::exception_ptr> error)
+    {
+        try
+        {
+            *result = co_await details::invoke_awaiter([exception](const hub_connection::invocation_completed_handler& invocation_completed)
+            {
+                invocation_completed(json::value::number(7), exception);
+            });
+        }
+        catch (...)
+        {
+            *error = std::current_exception();
+        }
+    }
+
+    detached_coroutine await_completed_send(std::exception_ptr exception, std::shared_ptr<std::exception_ptr> error,
+        std::shared_ptr<bool> resumed)
+    {
+        try
+        {
+            co_await details::send_awaiter([exception](const hub_connection::send_completed_handler& send_completed)
+            {
+                send_completed(exception);
+            });
+        }
+        catch (...)
+        {
+            *error = std::current_exception();
+        }
+
+        *resumed = true;
+    }
+}
+
+TEST(awaitable_invoke, invocation_can_be_awaited)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\", \"result\": 42 }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        if (call_number > 0)
+        {
+            callback_registered_event->wait();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    auto result = std::make_shared<json::value>();
+    auto completed = std::make_shared<event>();
+    invoke_and_await(hub_connection, result, completed);
+    callback_registered_event->set();
+
+    ASSERT_FALSE(completed->wait(5000));
+    ASSERT_EQ(_XPLATSTR("42"), result->serialize());
+}
+
+TEST(awaitable_invoke, invocation_completed_synchronously_not_suspended)
+{
+    auto result = std::make_shared<json::value>();
+    auto error = std::make_shared<std::exception_ptr>();
+
+    // the coroutine runs to completion before returning since it is never suspended
+    await_completed_invocation(nullptr, result, error);
+
+    ASSERT_EQ(_XPLATSTR("7"), result->serialize());
+    ASSERT_FALSE(*error);
+}
+
+TEST(awaitable_invoke, error_of_invocation_rethrown)
+{
+    auto result = std::make_shared<json::value>();
+    auto error = std::make_shared<std::exception_ptr>();
+
+    await_completed_invocation(std::make_exception_ptr(signalr_exception(_XPLATSTR("invocation failed"))), result, error);
+
+    ASSERT_TRUE(*error);
+    ASSERT_THROW(std::rethrow_exception(*error), signalr_exception);
+    ASSERT_TRUE(result->is_null());
+}
+
+TEST(awaitable_send, error_of_send_rethrown)
+{
+    auto error = std::make_shared<std::exception_ptr>();
+    auto resumed = std::make_shared<bool>(false);
+
+    await_completed_send(nullptr, error, resumed);
+    ASSERT_TRUE(*resumed);
+    ASSERT_FALSE(*error);
+
+    *resumed = false;
+    await_completed_send(std::make_exception_ptr(signalr_exception(_XPLATSTR("send failed"))), error, resumed);
+    ASSERT_TRUE(*resumed);
+    ASSERT_THROW(std::rethrow_exception(*error), signalr_exception);
+}
+
+#endif
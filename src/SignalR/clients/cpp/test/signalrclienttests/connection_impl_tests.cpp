@@ -525,6 +525,67 @@ TEST(connection_impl_start, negotiate_follows_redirect)
     ASSERT_EQ(_XPLATSTR("ws://redirected/?id=f7707523-307d-4cba-9abf-3eef701241e8"), connectUrl);
 }
 
+TEST(connection_impl_start, connect_timings_recorded_for_each_phase)
+{
+    auto web_request_factory = std::make_unique<test_web_request_factory>([](const web::uri & url)
+    {
+        utility::string_t response_body = _XPLATSTR("");
+        if (url.path() == _XPLATSTR("/negotiate"))
+        {
+            if (url.host() == _XPLATSTR("redirected"))
+            {
+                response_body = _XPLATSTR("{\"connectionId\" : \"f7707523-307d-4cba-9abf-3eef701241e8\", ")
+                    _XPLATSTR("\"availableTransports\" : [ { \"transport\": \"WebSockets\", \"transferFormats\": [ \"Text\", \"Binary\" ] } ] }");
+            }
+            else
+            {
+                response_body = _XPLATSTR("{ \"url\": \"http://redirected\" }");
+            }
+        }
+
+        return std::unique_ptr<web_request>(new web_request_stub((unsigned short)200, _XPLATSTR("OK"), response_body));
+    });
+
+    auto websocket_client = std::make_shared<test_websocket_client>();
+    websocket_client->set_connect_function([](const web::uri&)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return pplx::task_from_result();
+    });
+
+    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
+    auto connection =
+        connection_impl::create(create_uri(), trace_level::events, writer,
+            std::move(web_request_factory), std::make_unique<test_transport_factory>(websocket_client));
+
+    ASSERT_GT(0, connection->get_connect_timings().get_phase(connect_phase::negotiate).count());
+
+    connection->start().get();
+
+    const auto timings = connection->get_connect_timings();
+    ASSERT_LE(0, timings.get_phase(connect_phase::negotiate).count());
+    ASSERT_LE(0, timings.get_phase(connect_phase::redirects).count());
+    ASSERT_EQ(1, timings.redirect_count);
+    ASSERT_LE(std::chrono::nanoseconds(std::chrono::milliseconds(20)).count(), timings.get_phase(connect_phase::websocket_connect).count());
+    // the handshake is only made by hub connections
+    ASSERT_GT(0, timings.get_phase(connect_phase::handshake).count());
+    ASSERT_LE(timings.get_phase(connect_phase::websocket_connect).count(), timings.total.count());
+
+    auto log_entries = std::dynamic_pointer_cast<memory_log_writer>(writer)->get_log_entries();
+    ASSERT_FALSE(filter_vector(log_entries, _XPLATSTR("connection started. negotiate: ")).empty()) << dump_vector(log_entries);
+}
+
+TEST(connect_timings, phases_not_reached_left_out_of_string)
+{
+    connect_timings timings;
+    timings.phases[static_cast<size_t>(connect_phase::negotiate)] = std::chrono::microseconds(12500);
+    timings.phases[static_cast<size_t>(connect_phase::redirects)] = std::chrono::milliseconds(3);
+    timings.redirect_count = 2;
+    timings.total = std::chrono::microseconds(15600);
+
+    ASSERT_EQ(_XPLATSTR("negotiate: 12.5 ms, redirects: 3.0 ms (2), total: 15.6 ms"), timings.to_string());
+}
+
 TEST(connection_impl_start, negotiate_redirect_uses_accessToken)
 {
     std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
@@ -796,6 +857,46 @@ TEST(connection_impl_send, message_sent)
     ASSERT_EQ(message, actual_message);
 }
 
+TEST(connection_impl_send, bytes_sent)
+{
+    utility::string_t actual_message;
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */ [&actual_message](const utility::string_t& message)
+    {
+        actual_message = message;
+        return pplx::task_from_result();
+    });
+
+    auto connection = create_connection(websocket_client);
+
+    connection->start()
+        .then([connection]()
+        {
+            const std::string message = "Test message";
+            return connection->send(std::vector<uint8_t>(message.begin(), message.end()));
+        }).get();
+
+    ASSERT_EQ(_XPLATSTR("Test message"), actual_message);
+}
+
+TEST(connection_impl_send, send_bytes_throws_if_connection_not_connected)
+{
+    auto connection =
+        connection_impl::create(create_uri(), trace_level::none, std::make_shared<trace_log_writer>());
+
+    try
+    {
+        connection->send(std::vector<uint8_t>{ 'a' }).get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception &e)
+    {
+        ASSERT_STREQ("cannot send data when the connection is not in the connected state. current connection state: disconnected", e.what());
+    }
+}
+
 TEST(connection_impl_send, send_throws_if_connection_not_connected)
 {
     auto connection =
@@ -892,6 +993,75 @@ TEST(connection_impl_set_message_received, callback_invoked_when_message_receive
     ASSERT_EQ(_XPLATSTR("Test"), *message);
 }
 
+TEST(connection_impl_set_raw_message_received, callback_invoked_instead_of_message_received_callback)
+{
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number]()
+        mutable {
+        std::string responses[]
+        {
+            "Test",
+            "release",
+            "{}"
+        };
+
+        call_number = std::min(call_number + 1, 2);
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto connection = create_connection(websocket_client);
+
+    auto message = std::make_shared<std::string>();
+    auto message_received_invoked = std::make_shared<bool>(false);
+
+    auto message_received_event = std::make_shared<event>();
+    connection->set_message_received([message_received_invoked](const utility::string_t&)
+    {
+        *message_received_invoked = true;
+    });
+
+    connection->set_raw_message_received([message, message_received_event](const uint8_t* data, size_t length)
+    {
+        const std::string m(data, data + length);
+        if (m == "Test")
+        {
+            *message = m;
+        }
+
+        if (m == "release")
+        {
+            message_received_event->set();
+        }
+    });
+
+    connection->start().get();
+
+    ASSERT_FALSE(message_received_event->wait(5000));
+
+    ASSERT_EQ("Test", *message);
+    ASSERT_FALSE(*message_received_invoked);
+}
+
+TEST(connection_impl_set_raw_message_received, callback_can_be_set_only_in_disconnected_state)
+{
+    auto connection = create_connection(create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); }));
+
+    connection->start().get();
+
+    try
+    {
+        connection->set_raw_message_received([](const uint8_t*, size_t) {});
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception &e)
+    {
+        ASSERT_STREQ("cannot set the callback when the connection is not in the disconnected state. current connection state: connected", e.what());
+    }
+}
+
 TEST(connection_impl_set_message_received, exception_from_callback_caught_and_logged)
 {
     int call_number = -1;
@@ -1292,6 +1462,42 @@ TEST(connection_impl_stop, stop_cancels_ongoing_start_request)
     ASSERT_EQ(_XPLATSTR("[state change] connecting -> disconnected\n"), remove_date_from_log_entry(log_entries[4]));
 }
 
+TEST(connection_impl_stop, stop_does_not_wait_for_ongoing_start_to_complete)
+{
+    auto connect_called_event = std::make_shared<event>();
+    pplx::task_completion_event<void> connect_tce;
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */ [](const utility::string_t){ return pplx::task_from_result(); },
+        /* connect function */ [connect_called_event, connect_tce](const web::uri&)
+        {
+            connect_called_event->set();
+            return pplx::create_task(connect_tce);
+        });
+
+    auto connection = create_connection(websocket_client);
+
+    auto start_task = connection->start();
+    ASSERT_FALSE(connect_called_event->wait(5000));
+
+    auto stop_task = connection->stop();
+    ASSERT_FALSE(stop_task.is_done());
+
+    connect_tce.set();
+    stop_task.get();
+
+    try
+    {
+        // the start completes or is canceled depending on whether the cancellation was observed before connecting
+        start_task.get();
+    }
+    catch (const pplx::task_canceled &)
+    { }
+
+    ASSERT_EQ(connection_state::disconnected, connection->get_connection_state());
+}
+
 TEST(connection_impl_stop, ongoing_start_request_canceled_if_connection_stopped_before_init_message_received)
 {
     auto web_request_factory = std::make_unique<test_web_request_factory>([](const web::uri& url)
@@ -1615,3 +1821,362 @@ TEST(connection_id, connection_id_reset_when_starting_connection)
 
     ASSERT_EQ(_XPLATSTR(""), connection->get_connection_id());
 }
+
+static std::shared_ptr<connection_impl> create_stateful_reconnect_connection(std::shared_ptr<websocket_client> websocket_client)
+{
+    auto connection = connection_impl::create(create_uri(), trace_level::all, std::make_shared<trace_log_writer>(),
+        create_stateful_reconnect_web_request_factory(), std::make_unique<test_transport_factory>(websocket_client));
+
+    signalr_client_config config;
+    config.set_stateful_reconnect(true);
+    connection->set_client_config(config);
+    return connection;
+}
+
+TEST(connection_impl_stateful_reconnect, transport_reconnected_after_transport_error)
+{
+    event connection_started;
+    auto call_number = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, &connection_started]()
+        {
+            if ((*call_number)++ == 0)
+            {
+                connection_started.wait();
+                return pplx::task_from_exception<std::string>(std::runtime_error("connection dropped"));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string(""));
+        });
+
+    auto connect_urls = std::make_shared<std::vector<web::uri>>();
+    auto connect_urls_lock = std::make_shared<std::mutex>();
+    std::dynamic_pointer_cast<test_websocket_client>(websocket_client)->set_connect_function(
+        [connect_urls, connect_urls_lock](const web::uri& url)
+        {
+            std::lock_guard<std::mutex> lock(*connect_urls_lock);
+            connect_urls->push_back(url);
+            return pplx::task_from_result();
+        });
+
+    auto connection = create_stateful_reconnect_connection(websocket_client);
+
+    event reconnected;
+    auto disconnected_invoked = false;
+    connection->set_reconnected([&reconnected]() { reconnected.set(); });
+    connection->set_disconnected([&disconnected_invoked]() { disconnected_invoked = true; });
+
+    connection->start().get();
+    ASSERT_TRUE(connection->is_stateful_reconnect_enabled());
+    connection_started.set();
+
+    ASSERT_FALSE(reconnected.wait(5000));
+    ASSERT_EQ(connection_state::connected, connection->get_connection_state());
+    ASSERT_FALSE(disconnected_invoked);
+
+    {
+        std::lock_guard<std::mutex> lock(*connect_urls_lock);
+        ASSERT_EQ(2U, connect_urls->size());
+        ASSERT_EQ((*connect_urls)[0], (*connect_urls)[1]);
+        ASSERT_NE(utility::string_t::npos, (*connect_urls)[1].query().find(_XPLATSTR("id=connection-token")));
+    }
+
+    connection->stop().get();
+}
+
+TEST(connection_impl_stateful_reconnect, connection_lost_if_transport_cannot_be_reconnected)
+{
+    event connection_started;
+    auto call_number = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, &connection_started]()
+        {
+            if ((*call_number)++ == 0)
+            {
+                connection_started.wait();
+                return pplx::task_from_exception<std::string>(std::runtime_error("connection dropped"));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string(""));
+        });
+
+    auto connect_count = std::make_shared<std::atomic<int>>(0);
+    std::dynamic_pointer_cast<test_websocket_client>(websocket_client)->set_connect_function(
+        [connect_count](const web::uri&)
+        {
+            return (*connect_count)++ == 0
+                ? pplx::task_from_result()
+                : pplx::task_from_exception<void>(std::runtime_error("server unreachable"));
+        });
+
+    auto connection = create_stateful_reconnect_connection(websocket_client);
+
+    event disconnected;
+    auto reconnected_invoked = false;
+    connection->set_reconnected([&reconnected_invoked]() { reconnected_invoked = true; });
+    connection->set_disconnected([&disconnected]() { disconnected.set(); });
+
+    connection->start().get();
+    connection_started.set();
+
+    ASSERT_FALSE(disconnected.wait(5000));
+    ASSERT_EQ(connection_state::disconnected, connection->get_connection_state());
+    ASSERT_FALSE(reconnected_invoked);
+}
+
+TEST(connection_impl_stateful_reconnect, not_enabled_if_not_requested)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+
+    auto connection = connection_impl::create(create_uri(), trace_level::none, std::make_shared<trace_log_writer>(),
+        create_stateful_reconnect_web_request_factory(), std::make_unique<test_transport_factory>(websocket_client));
+
+    connection->start().get();
+
+    ASSERT_FALSE(connection->is_stateful_reconnect_enabled());
+}
+
+TEST(connection_impl_endpoints, first_endpoint_to_respond_used)
+{
+    auto connect_url = std::make_shared<web::uri>();
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */ [](const utility::string_t&) { return pplx::task_from_result(); },
+        /* connect function */ [connect_url](const web::uri& url)
+        {
+            *connect_url = url;
+            return pplx::task_from_result();
+        });
+
+    auto connection = connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://slow"), _XPLATSTR("http://fast") }, trace_level::none,
+        std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory(
+        {
+            { _XPLATSTR("slow"), std::chrono::milliseconds(300) },
+            { _XPLATSTR("fast"), std::chrono::milliseconds(0) }
+        }),
+        std::make_unique<test_transport_factory>(websocket_client));
+
+    connection->start().get();
+
+    ASSERT_EQ(connection_state::connected, connection->get_connection_state());
+    ASSERT_EQ(_XPLATSTR("fast"), connection->get_connection_id());
+    ASSERT_EQ(_XPLATSTR("fast"), connect_url->host());
+    ASSERT_EQ(_XPLATSTR("fast"), web::uri(connection->get_endpoint_url()).host());
+}
+
+TEST(connection_impl_endpoints, endpoints_failing_negotiate_skipped)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+
+    auto connection = connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://down"), _XPLATSTR("http://up") }, trace_level::none,
+        std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory({ { _XPLATSTR("up"), std::chrono::milliseconds(100) } }),
+        std::make_unique<test_transport_factory>(websocket_client));
+
+    connection->start().get();
+
+    ASSERT_EQ(_XPLATSTR("up"), connection->get_connection_id());
+}
+
+TEST(connection_impl_endpoints, start_fails_if_no_endpoint_responds)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+
+    auto connection = connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://down1"), _XPLATSTR("http://down2") }, trace_level::none,
+        std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory({}),
+        std::make_unique<test_transport_factory>(websocket_client));
+
+    try
+    {
+        connection->start().get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const web_exception& e)
+    {
+        ASSERT_STREQ("web exception - 503 Service Unavailable", e.what());
+    }
+
+    ASSERT_EQ(connection_state::disconnected, connection->get_connection_state());
+}
+
+TEST(connection_impl_endpoints, connection_cannot_be_created_without_endpoints)
+{
+    try
+    {
+        connection_impl::create(std::vector<utility::string_t>{}, trace_level::none, std::make_shared<trace_log_writer>());
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("urls cannot be empty", e.what());
+    }
+}
+
+TEST(connection_impl_endpoints, connection_fails_over_to_next_fastest_endpoint)
+{
+    event drop_transport;
+    auto call_number = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, &drop_transport]()
+        {
+            if ((*call_number)++ == 0)
+            {
+                drop_transport.wait();
+                return pplx::task_from_exception<std::string>(std::runtime_error("connection dropped"));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string(""));
+        });
+
+    auto negotiated_hosts = std::make_shared<std::vector<utility::string_t>>();
+    auto negotiated_hosts_lock = std::make_shared<std::mutex>();
+
+    auto connection = connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://third"), _XPLATSTR("http://second"), _XPLATSTR("http://first") },
+        trace_level::all, std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory(
+        {
+            { _XPLATSTR("first"), std::chrono::milliseconds(0) },
+            { _XPLATSTR("second"), std::chrono::milliseconds(100) },
+            { _XPLATSTR("third"), std::chrono::milliseconds(200) }
+        },
+        [negotiated_hosts, negotiated_hosts_lock](const web::uri& url)
+        {
+            std::lock_guard<std::mutex> lock(*negotiated_hosts_lock);
+            negotiated_hosts->push_back(url.host());
+        }),
+        std::make_unique<test_transport_factory>(websocket_client));
+
+    event failed_over;
+    auto disconnected_invoked = false;
+    connection->set_failed_over([&failed_over]() { failed_over.set(); });
+    connection->set_disconnected([&disconnected_invoked]() { disconnected_invoked = true; });
+
+    connection->start().get();
+    ASSERT_EQ(_XPLATSTR("first"), connection->get_connection_id());
+
+    // wait for the slower endpoints to respond so that they are ranked
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    drop_transport.set();
+
+    ASSERT_FALSE(failed_over.wait(5000));
+    ASSERT_EQ(connection_state::connected, connection->get_connection_state());
+    ASSERT_EQ(_XPLATSTR("second"), connection->get_connection_id());
+    ASSERT_FALSE(disconnected_invoked);
+
+    {
+        std::lock_guard<std::mutex> lock(*negotiated_hosts_lock);
+        ASSERT_EQ(4U, negotiated_hosts->size());
+        ASSERT_EQ(_XPLATSTR("second"), negotiated_hosts->back());
+    }
+
+    connection->stop().get();
+}
+
+TEST(connection_impl_endpoints, connection_id_of_current_endpoint_kept_until_failed_over)
+{
+    event drop_transport;
+    auto call_number = std::make_shared<std::atomic<int>>(0);
+    auto connect_number = std::make_shared<std::atomic<int>>(0);
+    event connecting_to_second;
+    event second_connect_released;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, &drop_transport]()
+        {
+            if ((*call_number)++ == 0)
+            {
+                drop_transport.wait();
+                return pplx::task_from_exception<std::string>(std::runtime_error("connection dropped"));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string(""));
+        },
+        /* send function */ [](const utility::string_t&) { return pplx::task_from_result(); },
+        /* connect function */ [connect_number, &connecting_to_second, &second_connect_released](const web::uri&)
+        {
+            if ((*connect_number)++ == 1)
+            {
+                connecting_to_second.set();
+                second_connect_released.wait();
+            }
+
+            return pplx::task_from_result();
+        });
+
+    auto connection = connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://second"), _XPLATSTR("http://first") },
+        trace_level::all, std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory(
+        {
+            { _XPLATSTR("first"), std::chrono::milliseconds(0) },
+            { _XPLATSTR("second"), std::chrono::milliseconds(100) }
+        }),
+        std::make_unique<test_transport_factory>(websocket_client));
+
+    event failed_over;
+    connection->set_failed_over([&failed_over]() { failed_over.set(); });
+
+    connection->start().get();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    drop_transport.set();
+
+    // the new endpoint was negotiated with but its transport is not connected yet
+    ASSERT_FALSE(connecting_to_second.wait(5000));
+    ASSERT_EQ(_XPLATSTR("first"), connection->get_connection_id());
+    ASSERT_EQ(_XPLATSTR("first"), web::uri(connection->get_endpoint_url()).host());
+    second_connect_released.set();
+
+    ASSERT_FALSE(failed_over.wait(5000));
+    ASSERT_EQ(_XPLATSTR("second"), connection->get_connection_id());
+    ASSERT_EQ(_XPLATSTR("second"), web::uri(connection->get_endpoint_url()).host());
+
+    connection->stop().get();
+}
+
+TEST(connection_impl_endpoints, connection_lost_if_no_endpoint_to_fail_over_to)
+{
+    event drop_transport;
+    auto call_number = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, &drop_transport]()
+        {
+            if ((*call_number)++ == 0)
+            {
+                drop_transport.wait();
+                return pplx::task_from_exception<std::string>(std::runtime_error("connection dropped"));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string(""));
+        });
+
+    auto connection = connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://up"), _XPLATSTR("http://down") }, trace_level::all,
+        std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory({ { _XPLATSTR("up"), std::chrono::milliseconds(0) } }),
+        std::make_unique<test_transport_factory>(websocket_client));
+
+    event disconnected;
+    auto failed_over_invoked = false;
+    connection->set_failed_over([&failed_over_invoked]() { failed_over_invoked = true; });
+    connection->set_disconnected([&disconnected]() { disconnected.set(); });
+
+    connection->start().get();
+    drop_transport.set();
+
+    ASSERT_FALSE(disconnected.wait(5000));
+    ASSERT_EQ(connection_state::disconnected, connection->get_connection_state());
+    ASSERT_FALSE(failed_over_invoked);
+}
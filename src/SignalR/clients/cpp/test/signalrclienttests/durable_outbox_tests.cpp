@@ -0,0 +1,227 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include <cstdio>
+#include <fstream>
+#include "test_utils.h"
+#include "durable_outbox.h"
+#include "signalrclient/signalr_exception.h"
+
+using namespace signalr;
+
+namespace
+{
+    const size_t segment_header_size = 16;
+
+    std::vector<utility::string_t> read_all(const durable_outbox& outbox)
+    {
+        std::vector<utility::string_t> messages;
+        utility::string_t batch;
+        outbox.read(batch, SIZE_MAX);
+
+        size_t start = 0;
+        for (auto end = batch.find(_XPLATSTR('\x1e')); end != utility::string_t::npos; start = end + 1, end = batch.find(_XPLATSTR('\x1e'), start))
+        {
+            messages.push_back(batch.substr(start, end + 1 - start));
+        }
+
+        return messages;
+    }
+}
+
+TEST(durable_outbox, messages_read_in_order_until_consumed)
+{
+    outbox_directory directory;
+    durable_outbox outbox(directory.path(), 4096);
+
+    ASSERT_TRUE(outbox.append(_XPLATSTR("first\x1e")));
+    ASSERT_TRUE(outbox.append(_XPLATSTR("second\x1e")));
+    ASSERT_TRUE(outbox.append(_XPLATSTR("third\x1e")));
+
+    ASSERT_EQ(3U, outbox.size());
+    ASSERT_EQ(19U, outbox.size_in_bytes());
+
+    utility::string_t batch;
+    ASSERT_EQ(3U, outbox.read(batch, 1024));
+    ASSERT_EQ(_XPLATSTR("first\x1esecond\x1ethird\x1e"), batch);
+
+    outbox.consume(2);
+
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("third\x1e") }, read_all(outbox));
+    ASSERT_EQ(1U, outbox.size());
+    ASSERT_EQ(6U, outbox.size_in_bytes());
+}
+
+TEST(durable_outbox, read_stops_before_message_exceeding_batch_size)
+{
+    outbox_directory directory;
+    durable_outbox outbox(directory.path(), 4096);
+
+    ASSERT_TRUE(outbox.append(_XPLATSTR("0123456789\x1e")));
+    ASSERT_TRUE(outbox.append(_XPLATSTR("0123456789\x1e")));
+
+    utility::string_t batch;
+    ASSERT_EQ(1U, outbox.read(batch, 15));
+    ASSERT_EQ(_XPLATSTR("0123456789\x1e"), batch);
+
+    // a message larger than the batch size is read on its own
+    batch.clear();
+    ASSERT_EQ(1U, outbox.read(batch, 5));
+    ASSERT_EQ(_XPLATSTR("0123456789\x1e"), batch);
+}
+
+TEST(durable_outbox, append_fails_when_full_and_succeeds_once_messages_consumed)
+{
+    outbox_directory directory;
+    // two segments holding three records of 12 bytes each
+    const size_t segment_size = segment_header_size + 3 * 12;
+    durable_outbox outbox(directory.path(), segment_size * 2, segment_size);
+
+    for (auto i = 0; i < 6; i++)
+    {
+        ASSERT_TRUE(outbox.append(_XPLATSTR("0123456\x1e")));
+    }
+
+    ASSERT_FALSE(outbox.append(_XPLATSTR("0123456\x1e")));
+    ASSERT_EQ(6U, outbox.size());
+
+    // the first segment is removed once its messages were consumed
+    outbox.consume(3);
+    ASSERT_TRUE(outbox.append(_XPLATSTR("0123456\x1e")));
+    ASSERT_EQ(4U, outbox.size());
+}
+
+TEST(durable_outbox, outbox_has_at_least_two_segments)
+{
+    outbox_directory directory;
+    // the segments are shrunk to hold three records of 12 bytes each
+    const size_t max_size = 2 * (segment_header_size + 3 * 12);
+    durable_outbox outbox(directory.path(), max_size, max_size);
+
+    for (auto i = 0; i < 6; i++)
+    {
+        ASSERT_TRUE(outbox.append(_XPLATSTR("0123456\x1e")));
+    }
+
+    ASSERT_FALSE(outbox.append(_XPLATSTR("0123456\x1e")));
+
+    // messages can be appended again before all of them were consumed
+    outbox.consume(3);
+    ASSERT_TRUE(outbox.append(_XPLATSTR("0123456\x1e")));
+    ASSERT_EQ(4U, outbox.size());
+}
+
+TEST(durable_outbox, append_fails_for_message_larger_than_segment)
+{
+    outbox_directory directory;
+    durable_outbox outbox(directory.path(), 1024, 32);
+
+    ASSERT_FALSE(outbox.append(utility::string_t(32, _XPLATSTR('a'))));
+    ASSERT_TRUE(outbox.append(_XPLATSTR("a\x1e")));
+}
+
+TEST(durable_outbox, messages_not_consumed_read_after_reopening)
+{
+    outbox_directory directory;
+    const size_t segment_size = segment_header_size + 3 * 12;
+
+    {
+        durable_outbox outbox(directory.path(), 4096, segment_size);
+        for (auto i = 0; i < 5; i++)
+        {
+            ASSERT_TRUE(outbox.append(utility::string_t(_XPLATSTR("message")).append(utility::conversions::to_string_t(std::to_string(i))).append(_XPLATSTR("\x1e"))));
+        }
+
+        outbox.consume(2);
+    }
+
+    durable_outbox outbox(directory.path(), 4096, segment_size);
+
+    ASSERT_EQ(3U, outbox.size());
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("message2\x1e"), _XPLATSTR("message3\x1e"), _XPLATSTR("message4\x1e") }),
+        read_all(outbox));
+
+    ASSERT_TRUE(outbox.append(_XPLATSTR("message5\x1e")));
+    outbox.consume(3);
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("message5\x1e") }, read_all(outbox));
+}
+
+TEST(durable_outbox, message_not_completely_written_ignored_when_reopening)
+{
+    outbox_directory directory;
+
+    {
+        durable_outbox outbox(directory.path(), 4096);
+        ASSERT_TRUE(outbox.append(_XPLATSTR("a\x1e")));
+        ASSERT_TRUE(outbox.append(_XPLATSTR("b\x1e")));
+    }
+
+    // clears the header of the second record as if the process died while appending it
+    {
+        std::fstream segment(utility::conversions::to_utf8string(directory.path()) + "/outbox-0000000000000000.seg",
+            std::ios::in | std::ios::out | std::ios::binary);
+        segment.seekp(segment_header_size + 8);
+        const char header[4] = { 0, 0, 0, 0 };
+        segment.write(header, sizeof(header));
+    }
+
+    durable_outbox outbox(directory.path(), 4096);
+
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("a\x1e") }, read_all(outbox));
+
+    ASSERT_TRUE(outbox.append(_XPLATSTR("c\x1e")));
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("a\x1e"), _XPLATSTR("c\x1e") }), read_all(outbox));
+}
+
+TEST(durable_outbox, rest_of_message_not_completely_written_ignored_when_appended_over)
+{
+    outbox_directory directory;
+
+    {
+        durable_outbox outbox(directory.path(), 4096);
+        ASSERT_TRUE(outbox.append(_XPLATSTR("a\x1e")));
+    }
+
+    // writes the message of a second record but not its header as if the process died while appending it. Where
+    // a shorter record appended over it ends, the message looks like the header of a written record
+    {
+        std::fstream segment(utility::conversions::to_utf8string(directory.path()) + "/outbox-0000000000000000.seg",
+            std::ios::in | std::ios::out | std::ios::binary);
+        segment.seekp(segment_header_size + 12);
+        const char message[12] = { 'x', 'x', 'x', 'x', 2, 0, 0, static_cast<char>(0x80), 'z', '\x1e', 0, 0 };
+        segment.write(message, sizeof(message));
+    }
+
+    {
+        durable_outbox outbox(directory.path(), 4096);
+        ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("a\x1e") }, read_all(outbox));
+        ASSERT_TRUE(outbox.append(_XPLATSTR("c\x1e")));
+    }
+
+    durable_outbox outbox(directory.path(), 4096);
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("a\x1e"), _XPLATSTR("c\x1e") }), read_all(outbox));
+}
+
+TEST(durable_outbox, invalid_segment_file_throws)
+{
+    outbox_directory directory;
+    {
+        durable_outbox outbox(directory.path(), 4096);
+        ASSERT_TRUE(outbox.append(_XPLATSTR("a\x1e")));
+    }
+
+    {
+        std::fstream segment(utility::conversions::to_utf8string(directory.path()) + "/outbox-0000000000000000.seg",
+            std::ios::in | std::ios::out | std::ios::binary);
+        segment.write("XXXX", 4);
+    }
+
+    ASSERT_THROW(durable_outbox(directory.path(), 4096), signalr_exception);
+}
+
+TEST(durable_outbox, outbox_too_small_for_a_message_throws)
+{
+    outbox_directory directory;
+    ASSERT_THROW(durable_outbox(directory.path(), 16), std::invalid_argument);
+}
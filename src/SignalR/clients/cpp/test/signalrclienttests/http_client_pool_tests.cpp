@@ -0,0 +1,101 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "http_client_pool.h"
+
+using namespace signalr;
+
+TEST(http_client_pool_get_client, client_reused_for_same_origin)
+{
+    http_client_pool pool;
+    signalr_client_config config;
+
+    auto client1 = pool.get_client(web::uri(_XPLATSTR("http://fake:8080/signalr/negotiate?id=1")), config);
+    auto client2 = pool.get_client(web::uri(_XPLATSTR("http://fake:8080/other/path")), config);
+
+    ASSERT_EQ(client1, client2);
+    ASSERT_EQ(web::uri(_XPLATSTR("http://fake:8080")), client1->base_uri());
+    ASSERT_EQ(1U, pool.size());
+}
+
+TEST(http_client_pool_get_client, separate_clients_for_different_origins)
+{
+    http_client_pool pool;
+    signalr_client_config config;
+
+    auto client1 = pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), config);
+    auto client2 = pool.get_client(web::uri(_XPLATSTR("https://fake/signalr")), config);
+    auto client3 = pool.get_client(web::uri(_XPLATSTR("http://fake:8080/signalr")), config);
+    auto client4 = pool.get_client(web::uri(_XPLATSTR("http://other/signalr")), config);
+
+    ASSERT_NE(client1, client2);
+    ASSERT_NE(client1, client3);
+    ASSERT_NE(client1, client4);
+    ASSERT_EQ(4U, pool.size());
+}
+
+TEST(http_client_pool_get_client, client_shared_by_copied_configs)
+{
+    http_client_pool pool;
+    signalr_client_config config;
+    config.set_proxy(web::web_proxy(web::uri(_XPLATSTR("http://proxy"))));
+    auto config_copy = config;
+
+    ASSERT_EQ(pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), config),
+        pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), config_copy));
+}
+
+TEST(http_client_pool_get_client, client_not_shared_if_http_client_config_differs)
+{
+    http_client_pool pool;
+    signalr_client_config default_config;
+    signalr_client_config proxy_config;
+    proxy_config.set_proxy(web::web_proxy(web::uri(_XPLATSTR("http://proxy"))));
+    signalr_client_config credentials_config;
+    credentials_config.set_credentials(web::credentials(_XPLATSTR("user"), _XPLATSTR("password")));
+
+    auto default_client = pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), default_config);
+    auto proxy_client = pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), proxy_config);
+    auto credentials_client = pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), credentials_config);
+
+    ASSERT_NE(default_client, proxy_client);
+    ASSERT_NE(default_client, credentials_client);
+    ASSERT_NE(proxy_client, credentials_client);
+    ASSERT_EQ(_XPLATSTR("user"), credentials_client->client_config().credentials().username());
+}
+
+TEST(http_client_pool_get_client, client_shared_if_only_headers_differ)
+{
+    http_client_pool pool;
+    signalr_client_config config1;
+    signalr_client_config config2;
+    web::http::http_headers headers;
+    headers[_XPLATSTR("Authorization")] = _XPLATSTR("Bearer token");
+    config2.set_http_headers(headers);
+
+    ASSERT_EQ(pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), config1),
+        pool.get_client(web::uri(_XPLATSTR("http://fake/signalr")), config2));
+}
+
+TEST(http_client_pool_get_client, least_recently_used_client_dropped_when_pool_full)
+{
+    http_client_pool pool(2);
+    signalr_client_config config;
+
+    auto client1 = pool.get_client(web::uri(_XPLATSTR("http://fake1")), config);
+    auto client2 = pool.get_client(web::uri(_XPLATSTR("http://fake2")), config);
+    ASSERT_EQ(client1, pool.get_client(web::uri(_XPLATSTR("http://fake1")), config));
+
+    auto client3 = pool.get_client(web::uri(_XPLATSTR("http://fake3")), config);
+
+    ASSERT_EQ(2U, pool.size());
+    ASSERT_EQ(client1, pool.get_client(web::uri(_XPLATSTR("http://fake1")), config));
+    ASSERT_EQ(client3, pool.get_client(web::uri(_XPLATSTR("http://fake3")), config));
+    ASSERT_NE(client2, pool.get_client(web::uri(_XPLATSTR("http://fake2")), config));
+}
+
+TEST(http_client_pool_get_default, default_pool_shared)
+{
+    ASSERT_EQ(http_client_pool::get_default(), http_client_pool::get_default());
+}
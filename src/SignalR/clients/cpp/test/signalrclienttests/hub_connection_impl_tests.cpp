@@ -6,10 +6,12 @@
 #include "test_transport_factory.h"
 #include "test_web_request_factory.h"
 #include "hub_connection_impl.h"
+#include "signalrclient/hub_connection.h"
 #include "trace_log_writer.h"
 #include "memory_log_writer.h"
 #include "signalrclient/hub_exception.h"
 #include "signalrclient/signalr_exception.h"
+#include "allocation_counter.h"
 
 using namespace signalr;
 
@@ -309,168 +311,314 @@ TEST(hub_invocation, hub_connection_invokes_users_code_on_hub_invocations)
     ASSERT_EQ(_XPLATSTR("[\"message\",1]"), *payload);
 }
 
-TEST(send, creates_correct_payload)
+std::shared_ptr<websocket_client> create_broadcast_websocket_client()
 {
-    utility::string_t payload;
-    bool handshakeReceived = false;
-
-    auto websocket_client = create_test_websocket_client(
-        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
-        /* send function */[&payload, &handshakeReceived](const utility::string_t& m)
+    int call_number = -1;
+    return create_test_websocket_client(
+        /* receive function */ [call_number]()
+    mutable {
+        std::string responses[]
         {
-            if (handshakeReceived)
-            {
-                payload = m;
-                return pplx::task_from_result();
-            }
-            handshakeReceived = true;
-            return pplx::task_from_result();
-        });
+            "{ }\x1e",
+            "{ \"type\": 1, \"target\": \"BROADcast\", \"arguments\": [ \"message\\n\", 1, { \"a\": [ 2.5, null ] } ] }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+}
+
+void assert_view_handler_invoked(message_parsing message_parsing)
+{
+    auto hub_connection = create_hub_connection(create_broadcast_websocket_client());
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing);
+    hub_connection->set_client_config(config);
+
+    auto payload = std::make_shared<utility::string_t>();
+    auto first_argument = std::make_shared<utility::string_t>();
+    auto on_broadcast_event = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("broadCAST"), [on_broadcast_event, payload, first_argument](const json_view& arguments)
+    {
+        *first_argument = arguments[0].as_string();
+        *payload = arguments.serialize();
+        on_broadcast_event->set();
+    });
 
-    auto hub_connection = create_hub_connection(websocket_client);
     hub_connection->start().get();
+    ASSERT_FALSE(on_broadcast_event->wait(5000));
 
-    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
+    ASSERT_EQ(_XPLATSTR("message\n"), *first_argument);
+    ASSERT_EQ(_XPLATSTR("[\"message\\n\",1,{\"a\":[2.5,null]}]"), *payload);
+}
 
-    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e"), payload);
+TEST(hub_invocation, view_handler_invoked_when_parsing_into_arena)
+{
+    assert_view_handler_invoked(message_parsing::arena);
 }
 
-TEST(send, does_not_wait_for_server_response)
+TEST(hub_invocation, view_handler_invoked_when_parsing_into_json_values)
 {
-    int call_number = -1;
-    pplx::task_completion_event<void> waitForSend;
+    assert_view_handler_invoked(message_parsing::dom);
+}
 
-    auto websocket_client = create_test_websocket_client(
-    /* receive function */ [waitForSend, call_number]() mutable
+TEST(hub_invocation, view_handler_invoked_when_parsing_lazily)
+{
+    assert_view_handler_invoked(message_parsing::lazy);
+}
+
+TEST(hub_invocation, dispatched_handlers_invoked_in_order_per_partition_key)
+{
+    const int symbol_count = 3;
+    const int ticks_per_symbol = 30;
+
+    std::string ticks;
+    for (auto tick = 0; tick < ticks_per_symbol; tick++)
     {
+        for (auto symbol = 0; symbol < symbol_count; symbol++)
+        {
+            ticks.append("{ \"type\": 1, \"target\": \"tick\", \"arguments\": [ \"symbol")
+                .append(std::to_string(symbol)).append("\", ").append(std::to_string(tick)).append(" ] }\x1e");
+        }
+    }
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, ticks]()
+        mutable {
         std::string responses[]
         {
             "{ }\x1e",
-            "{}"
+            ticks,
+            "{ \"type\": 6 }\x1e"
         };
 
-        call_number = std::min(call_number + 1, 1);
-
-        if (call_number == 1)
-        {
-            pplx::task<void>(waitForSend).get();
-        }
+        call_number = std::min(call_number + 1, 2);
 
         return pplx::task_from_result(responses[call_number]);
     });
 
     auto hub_connection = create_hub_connection(websocket_client);
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing::arena);
+    config.set_dispatch_concurrency(4);
+    config.set_partition_key_extractor([](const utility::string_t&, const json::value& arguments)
+    {
+        return std::hash<utility::string_t>()(arguments.at(0).as_string());
+    });
+    hub_connection->set_client_config(config);
+
+    std::mutex lock;
+    std::map<utility::string_t, std::vector<int>> received;
+    auto received_count = 0;
+    auto all_received = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("tick"), [&lock, &received, &received_count, all_received, symbol_count, ticks_per_symbol](const json_view& arguments)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        received[arguments[0].as_string()].push_back(arguments[1].as_integer());
+        if (++received_count == symbol_count * ticks_per_symbol)
+        {
+            all_received->set();
+        }
+    });
+
     hub_connection->start().get();
+    ASSERT_FALSE(all_received->wait(5000));
+    hub_connection->stop().get();
 
-    // wont block waiting for server response
-    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
-    waitForSend.set();
+    std::lock_guard<std::mutex> guard(lock);
+    ASSERT_EQ(static_cast<size_t>(symbol_count), received.size());
+    for (const auto& symbol : received)
+    {
+        ASSERT_EQ(static_cast<size_t>(ticks_per_symbol), symbol.second.size());
+        for (auto tick = 0; tick < ticks_per_symbol; tick++)
+        {
+            ASSERT_EQ(tick, symbol.second[tick]);
+        }
+    }
 }
 
-TEST(invoke, creates_correct_payload)
+TEST(hub_invocation, queued_handler_invoked_with_arguments)
 {
-    utility::string_t payload;
-    bool handshakeReceived = false;
+    auto hub_connection = create_hub_connection(create_broadcast_websocket_client());
 
-    auto websocket_client = create_test_websocket_client(
-        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
-        /* send function */[&payload, &handshakeReceived](const utility::string_t& m)
+    auto payload = std::make_shared<utility::string_t>();
+    auto on_broadcast_event = std::make_shared<event>();
+    inbound_queue_config queue_config;
+    queue_config.set_overflow_policy(queue_overflow_policy::drop_oldest);
+    hub_connection->on(_XPLATSTR("broadcast"), [on_broadcast_event, payload](const json::value& arguments)
     {
-        if (handshakeReceived)
-        {
-            payload = m;
-            return pplx::task_from_exception<void>(std::runtime_error("error"));
-        }
-        handshakeReceived = true;
-        return pplx::task_from_result();
-    });
+        *payload = arguments.serialize();
+        on_broadcast_event->set();
+    }, queue_config);
 
-    auto hub_connection = create_hub_connection(websocket_client);
     hub_connection->start().get();
+    ASSERT_FALSE(on_broadcast_event->wait(5000));
+    hub_connection->stop().get();
+
+    ASSERT_EQ(_XPLATSTR("[\"message\\n\",1,{\"a\":[2.5,null]}]"), *payload);
+    ASSERT_EQ(0U, hub_connection->get_inbound_queue_stats(_XPLATSTR("BROADCAST")).conflated);
 
     try
     {
-        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
+        hub_connection->get_inbound_queue_stats(_XPLATSTR("unknown"));
+        ASSERT_TRUE(false); // exception expected but not thrown
     }
-    catch (...)
+    catch (const signalr_exception& e)
     {
-        // the invoke is not setup to succeed because it's not needed in this test
+        ASSERT_STREQ("no handler with a queue has been registered for the event. event name: unknown", e.what());
     }
+}
 
-    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"invocationId\":\"0\",\"target\":\"method\",\"type\":1}\x1e"), payload);
+std::shared_ptr<websocket_client> create_batched_websocket_client(const std::string& batch)
+{
+    int call_number = -1;
+    return create_test_websocket_client(
+        /* receive function */ [call_number, batch]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            batch,
+            "{ \"type\": 6 }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 2);
+
+        return pplx::task_from_result(responses[call_number]);
+    });
 }
 
-TEST(invoke, callback_not_called_if_send_throws)
+TEST(hub_invocation, records_parsed_in_parallel_processed_in_order)
 {
-    bool handshakeReceived = false;
-    auto websocket_client = create_test_websocket_client(
-        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
-        /* send function */[handshakeReceived](const utility::string_t&) mutable
+    const int record_count = 200;
+
+    std::string batch;
+    for (auto i = 0; i < record_count; i++)
+    {
+        batch.append("{ \"type\": 1, \"target\": \"tick\", \"arguments\": [ ").append(std::to_string(i)).append(" ] }\x1e");
+    }
+
+    auto hub_connection = create_hub_connection(create_batched_websocket_client(batch));
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing::arena);
+    config.set_parallel_parsing_threshold(10);
+    hub_connection->set_client_config(config);
+
+    std::vector<int> received;
+    auto all_received = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("tick"), [&received, all_received, record_count](const json_view& arguments)
+    {
+        received.push_back(arguments[0].as_integer());
+        if (received.size() == static_cast<size_t>(record_count))
         {
-            if (handshakeReceived)
-            {
-                return pplx::task_from_exception<void>(std::runtime_error("error"));
-            }
-            handshakeReceived = true;
-            return pplx::task_from_result();
-        });
+            all_received->set();
+        }
+    });
 
-    auto hub_connection = create_hub_connection(websocket_client);
     hub_connection->start().get();
+    ASSERT_FALSE(all_received->wait(5000));
+    hub_connection->stop().get();
 
-    try
+    for (auto i = 0; i < record_count; i++)
     {
-        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
-        ASSERT_TRUE(false); // exception expected but not thrown
+        ASSERT_EQ(i, received[i]);
     }
-    catch (const std::runtime_error& e)
+}
+
+TEST(hub_invocation, records_after_invalid_record_ignored_when_parsing_in_parallel)
+{
+    std::string batch;
+    for (auto i = 0; i < 20; i++)
     {
-        ASSERT_STREQ("error", e.what());
+        batch.append(i == 12 ? "{ \"type\": 1, " : "{ \"type\": 1, \"target\": \"tick\", \"arguments\": [ 1 ] }").append("\x1e");
+    }
+
+    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
+    auto hub_connection = create_hub_connection(create_batched_websocket_client(batch), writer, trace_level::errors);
+    signalr_client_config config;
+    config.set_parallel_parsing_threshold(2);
+    hub_connection->set_client_config(config);
+
+    std::atomic<int> received(0);
+    hub_connection->on(_XPLATSTR("tick"), [&received](const json::value&) { received++; });
+
+    hub_connection->start().get();
+
+    auto memory_writer = std::dynamic_pointer_cast<memory_log_writer>(writer);
+    for (auto wait_time_ms = 5; wait_time_ms < 1000 && memory_writer->get_log_entries().empty(); wait_time_ms <<= 1)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait_time_ms));
     }
 
-    // stop completes all outstanding callbacks so if we did not remove a callback when `invoke_void` failed an
-    // unobserved exception exception would be thrown. Note that this would happen on a different thread and would
-    // crash the process
     hub_connection->stop().get();
+
+    ASSERT_EQ(12, received.load());
+    auto log_entries = memory_writer->get_log_entries();
+    ASSERT_FALSE(log_entries.empty());
+    ASSERT_NE(utility::string_t::npos, log_entries[0].find(_XPLATSTR("error occured when parsing response: ")));
 }
 
-TEST(invoke, invoke_returns_value_returned_from_the_server)
+TEST(hub_invocation, arguments_of_methods_without_handler_not_parsed_when_parsing_lazily)
 {
-    auto callback_registered_event = std::make_shared<event>();
-
     int call_number = -1;
     auto websocket_client = create_test_websocket_client(
-        /* receive function */ [call_number, callback_registered_event]()
+        /* receive function */ [call_number]()
         mutable {
         std::string responses[]
         {
             "{ }\x1e",
-            "{ \"type\": 3, \"invocationId\": \"0\", \"result\": \"abc\" }\x1e"
+            "{ \"type\": 1, \"target\": \"unknown\", \"arguments\": [ 1 2 ] }\x1e"
+            "{ \"type\": 1, \"target\": \"broadcast\", \"arguments\": [ \"message\" ] }\x1e"
         };
 
         call_number = std::min(call_number + 1, 1);
 
-        if (call_number > 0)
-        {
-            callback_registered_event->wait();
-        }
-
         return pplx::task_from_result(responses[call_number]);
     });
 
     auto hub_connection = create_hub_connection(websocket_client);
-    auto result = hub_connection->start()
-        .then([hub_connection, callback_registered_event]()
-        {
-            auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
-            callback_registered_event->set();
-            return t;
-        }).get();
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing::lazy);
+    hub_connection->set_client_config(config);
 
-    ASSERT_EQ(_XPLATSTR("\"abc\""), result.serialize());
+    auto payload = std::make_shared<utility::string_t>();
+    auto on_broadcast_event = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("broadcast"), [on_broadcast_event, payload](const json_view& arguments)
+    {
+        *payload = arguments.serialize();
+        on_broadcast_event->set();
+    });
+
+    hub_connection->start().get();
+    ASSERT_FALSE(on_broadcast_event->wait(5000));
+
+    ASSERT_EQ(_XPLATSTR("[\"message\"]"), *payload);
 }
 
-TEST(invoke, invoke_propagates_hub_errors_from_server_as_hub_exceptions)
+TEST(hub_invocation, handler_gets_copy_of_arguments_when_parsing_into_arena)
+{
+    auto hub_connection = create_hub_connection(create_broadcast_websocket_client());
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing::arena);
+    hub_connection->set_client_config(config);
+
+    auto payload = std::make_shared<utility::string_t>();
+    auto on_broadcast_event = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("broadCAST"), [on_broadcast_event, payload](const json::value& message)
+    {
+        *payload = message.serialize();
+        on_broadcast_event->set();
+    });
+
+    hub_connection->start().get();
+    ASSERT_FALSE(on_broadcast_event->wait(5000));
+
+    ASSERT_EQ(_XPLATSTR("[\"message\\n\",1,{\"a\":[2.5,null]}]"), *payload);
+}
+
+void assert_invoke_returns_value(message_parsing message_parsing)
 {
     auto callback_registered_event = std::make_shared<event>();
 
@@ -481,7 +629,7 @@ TEST(invoke, invoke_propagates_hub_errors_from_server_as_hub_exceptions)
         std::string responses[]
         {
             "{ }\x1e",
-            "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
+            "{ \"type\": 3, \"invocationId\": \"0\", \"result\": { \"a\": \"b\" } }\x1e"
         };
 
         call_number = std::min(call_number + 1, 1);
@@ -495,27 +643,31 @@ TEST(invoke, invoke_propagates_hub_errors_from_server_as_hub_exceptions)
     });
 
     auto hub_connection = create_hub_connection(websocket_client);
-    try
-    {
-        hub_connection->start()
-            .then([hub_connection, callback_registered_event]()
-        {
-            auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
-            callback_registered_event->set();
-            return t;
-        }).get();
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing);
+    hub_connection->set_client_config(config);
 
-        ASSERT_TRUE(false); // exception expected but not thrown
-    }
-    catch (const hub_exception& e)
-    {
-        ASSERT_STREQ("\"Ooops\"", e.what());
-    }
+    hub_connection->start().get();
+    auto invoke_task = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+    callback_registered_event->set();
+
+    ASSERT_EQ(_XPLATSTR("{\"a\":\"b\"}"), invoke_task.get().serialize());
 }
 
-TEST(invoke, unblocks_task_when_server_completes_call)
+TEST(hub_invocation, invoke_returns_value_when_parsing_into_arena)
+{
+    assert_invoke_returns_value(message_parsing::arena);
+}
+
+TEST(hub_invocation, invoke_returns_value_when_parsing_lazily)
+{
+    assert_invoke_returns_value(message_parsing::lazy);
+}
+
+TEST(hub_invocation, invocations_traced_when_trace_sink_set)
 {
     auto callback_registered_event = std::make_shared<event>();
+    auto sent_message = std::make_shared<utility::string_t>();
 
     int call_number = -1;
     auto websocket_client = create_test_websocket_client(
@@ -524,7 +676,7 @@ TEST(invoke, unblocks_task_when_server_completes_call)
         std::string responses[]
         {
             "{ }\x1e",
-            "{ \"type\": 3, \"invocationId\": \"0\" }\x1e"
+            "{ \"type\": 3, \"invocationId\": \"0\", \"result\": 42 }\x1e"
         };
 
         call_number = std::min(call_number + 1, 1);
@@ -535,250 +687,2002 @@ TEST(invoke, unblocks_task_when_server_completes_call)
         }
 
         return pplx::task_from_result(responses[call_number]);
+    },
+        /* send function */ [sent_message](const utility::string_t& message)
+    {
+        *sent_message = message;
+        return pplx::task_from_result();
     });
 
+    auto trace_sink = std::make_shared<ring_buffer_trace_sink>(16);
     auto hub_connection = create_hub_connection(websocket_client);
-    hub_connection->start()
-        .then([hub_connection, callback_registered_event]()
+    signalr_client_config config;
+    config.set_invocation_trace_sink(trace_sink);
+    hub_connection->set_client_config(config);
+
+    hub_connection->start().get();
+    auto invoke_task = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+    callback_registered_event->set();
+    ASSERT_EQ(42, invoke_task.get().as_integer());
+
+    std::vector<invocation_span> spans;
+    for (auto i = 0; i < 500 && spans.empty(); i++)
     {
-        auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
-        callback_registered_event->set();
-        return t;
-    }).get();
+        // the span is recorded once the continuation of the send ran too
+        trace_sink->drain(spans);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
 
-    // should not block
-    ASSERT_TRUE(true);
+    ASSERT_EQ(1U, spans.size());
+    const auto& span = spans[0];
+    ASSERT_TRUE(span.succeeded);
+
+    const auto message = json::value::parse(sent_message->substr(0, sent_message->length() - 1));
+    ASSERT_EQ(span.traceparent(), message.at(_XPLATSTR("headers")).at(_XPLATSTR("traceparent")).as_string());
+
+    ASSERT_GE(span.get_stage(invocation_stage::serialized).count(), 0);
+    ASSERT_GE(span.get_stage(invocation_stage::enqueued), span.get_stage(invocation_stage::serialized));
+    ASSERT_GE(span.get_stage(invocation_stage::frame_written), span.get_stage(invocation_stage::enqueued));
+    ASSERT_GE(span.get_stage(invocation_stage::completion_received), span.get_stage(invocation_stage::enqueued));
+    ASSERT_GE(span.get_stage(invocation_stage::callback_completed), span.get_stage(invocation_stage::completion_received));
 }
 
-TEST(receive, logs_if_callback_for_given_id_not_found)
+TEST(hub_invocation, traceparent_not_sent_when_tracing_off)
 {
-    auto message_received_event = std::make_shared<event>();
-    auto handshake_sent = std::make_shared<event>();
+    auto sent_message = std::make_shared<utility::string_t>();
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */ [sent_message](const utility::string_t& message)
+    {
+        *sent_message = message;
+        return pplx::task_from_result();
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
+
+    ASSERT_EQ(utility::string_t::npos, sent_message->find(_XPLATSTR("headers")));
+}
+
+TEST(send, creates_correct_payload)
+{
+    utility::string_t payload;
+    bool handshakeReceived = false;
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */[&payload, &handshakeReceived](const utility::string_t& m)
+        {
+            if (handshakeReceived)
+            {
+                payload = m;
+                return pplx::task_from_result();
+            }
+            handshakeReceived = true;
+            return pplx::task_from_result();
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
 
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e"), payload);
+}
+
+TEST(send, does_not_wait_for_server_response)
+{
     int call_number = -1;
+    pplx::task_completion_event<void> waitForSend;
+
     auto websocket_client = create_test_websocket_client(
-        /* receive function */ [call_number, message_received_event, handshake_sent]()
-        mutable {
+    /* receive function */ [waitForSend, call_number]() mutable
+    {
         std::string responses[]
         {
             "{ }\x1e",
-            "{ \"type\": 3, \"invocationId\": \"0\" }\x1e"
             "{}"
         };
 
-        handshake_sent->wait(1000);
-
-        call_number = std::min(call_number + 1, 2);
+        call_number = std::min(call_number + 1, 1);
 
-        if (call_number > 1)
+        if (call_number == 1)
         {
-            message_received_event->set();
+            pplx::task<void>(waitForSend).get();
         }
 
         return pplx::task_from_result(responses[call_number]);
-    },
-    [handshake_sent](const utility::string_t&)
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    // wont block waiting for server response
+    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
+    waitForSend.set();
+}
+
+TEST(invoke, creates_correct_payload)
+{
+    utility::string_t payload;
+    bool handshakeReceived = false;
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */[&payload, &handshakeReceived](const utility::string_t& m)
     {
-        handshake_sent->set();
+        if (handshakeReceived)
+        {
+            payload = m;
+            return pplx::task_from_exception<void>(std::runtime_error("error"));
+        }
+        handshakeReceived = true;
+        return pplx::task_from_result();
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    try
+    {
+        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
+    }
+    catch (...)
+    {
+        // the invoke is not setup to succeed because it's not needed in this test
+    }
+
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"invocationId\":\"0\",\"target\":\"method\",\"type\":1}\x1e"), payload);
+}
+
+TEST(prepare, prepared_invoke_creates_correct_payload)
+{
+    std::vector<utility::string_t> payloads;
+    bool handshakeReceived = false;
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */[&payloads, &handshakeReceived](const utility::string_t& m)
+    {
+        if (handshakeReceived)
+        {
+            payloads.push_back(m);
+            return pplx::task_from_exception<void>(std::runtime_error("error"));
+        }
+        handshakeReceived = true;
         return pplx::task_from_result();
     });
 
-    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
-    auto hub_connection = create_hub_connection(websocket_client, writer, trace_level::info);
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    auto envelope = hub_connection->prepare(_XPLATSTR("method"));
+
+    auto arguments = json::value::array();
+    arguments[0] = json::value::string(_XPLATSTR("abc"));
+
+    for (auto i = 0; i < 2; i++)
+    {
+        try
+        {
+            hub_connection->invoke(*envelope, arguments).get();
+        }
+        catch (...)
+        {
+            // the invoke is not setup to succeed because it's not needed in this test
+        }
+    }
+
+    ASSERT_EQ(2U, payloads.size());
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[\"abc\"],\"invocationId\":\"0\",\"target\":\"method\",\"type\":1}\x1e"), payloads[0]);
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[\"abc\"],\"invocationId\":\"1\",\"target\":\"method\",\"type\":1}\x1e"), payloads[1]);
+}
+
+TEST(prepare, prepared_send_creates_correct_payload)
+{
+    utility::string_t payload;
+    bool handshakeReceived = false;
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */[&payload, &handshakeReceived](const utility::string_t& m)
+        {
+            if (handshakeReceived)
+            {
+                payload = m;
+                return pplx::task_from_result();
+            }
+            handshakeReceived = true;
+            return pplx::task_from_result();
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    auto envelope = hub_connection->prepare(_XPLATSTR("method"));
+    hub_connection->send(*envelope, json::value::array()).get();
+
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e"), payload);
+}
+
+TEST(prepare, method_name_must_not_be_empty_string)
+{
+    auto hub_connection = create_hub_connection();
+
+    try
+    {
+        hub_connection->prepare(_XPLATSTR(""));
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("method_name cannot be empty", e.what());
+    }
+}
+
+TEST(prepare, prepared_method_fails_if_hub_connection_destroyed)
+{
+    auto hub_connection = std::make_unique<signalr::hub_connection>(create_uri(), trace_level::none);
+    auto method = hub_connection->prepare(_XPLATSTR("method"));
+    hub_connection.reset();
+
+    ASSERT_EQ(_XPLATSTR("method"), method.get_method_name());
+
+    try
+    {
+        method.invoke().get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the hub connection has been deconstructed", e.what());
+    }
+}
+
+TEST(invoke, callback_not_called_if_send_throws)
+{
+    bool handshakeReceived = false;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */[handshakeReceived](const utility::string_t&) mutable
+        {
+            if (handshakeReceived)
+            {
+                return pplx::task_from_exception<void>(std::runtime_error("error"));
+            }
+            handshakeReceived = true;
+            return pplx::task_from_result();
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    try
+    {
+        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::runtime_error& e)
+    {
+        ASSERT_STREQ("error", e.what());
+    }
+
+    // stop completes all outstanding callbacks so if we did not remove a callback when `invoke_void` failed an
+    // unobserved exception exception would be thrown. Note that this would happen on a different thread and would
+    // crash the process
+    hub_connection->stop().get();
+}
+
+TEST(invoke, invoke_returns_value_returned_from_the_server)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\", \"result\": \"abc\" }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        if (call_number > 0)
+        {
+            callback_registered_event->wait();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    auto result = hub_connection->start()
+        .then([hub_connection, callback_registered_event]()
+        {
+            auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+            callback_registered_event->set();
+            return t;
+        }).get();
+
+    ASSERT_EQ(_XPLATSTR("\"abc\""), result.serialize());
+}
+
+TEST(invoke, invoke_propagates_hub_errors_from_server_as_hub_exceptions)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        if (call_number > 0)
+        {
+            callback_registered_event->wait();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    try
+    {
+        hub_connection->start()
+            .then([hub_connection, callback_registered_event]()
+        {
+            auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+            callback_registered_event->set();
+            return t;
+        }).get();
+
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const hub_exception& e)
+    {
+        ASSERT_STREQ("\"Ooops\"", e.what());
+    }
+}
+
+TEST(invoke, unblocks_task_when_server_completes_call)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\" }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        if (call_number > 0)
+        {
+            callback_registered_event->wait();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start()
+        .then([hub_connection, callback_registered_event]()
+    {
+        auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+        callback_registered_event->set();
+        return t;
+    }).get();
+
+    // should not block
+    ASSERT_TRUE(true);
+}
+
+std::shared_ptr<websocket_client> create_recording_websocket_client(std::shared_ptr<std::vector<utility::string_t>> messages,
+    std::shared_ptr<std::mutex> messages_lock, std::shared_ptr<event> cancel_invocation_sent)
+{
+    return create_test_websocket_client(
+        /* receive function */ []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string("{ }\x1e"));
+        },
+        /* send function */[messages, messages_lock, cancel_invocation_sent](const utility::string_t& m)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*messages_lock);
+                messages->push_back(m);
+            }
+
+            if (m.find(_XPLATSTR("\"type\":5")) != utility::string_t::npos)
+            {
+                cancel_invocation_sent->set();
+            }
+
+            return pplx::task_from_result();
+        });
+}
+
+TEST(invoke_timeout, invoke_fails_when_timeout_elapses)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    hub_connection->start().get();
+
+    try
+    {
+        hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+            std::chrono::milliseconds(200), pplx::cancellation_token::none()).get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the invocation timed out after 200 ms", e.what());
+    }
+
+    ASSERT_FALSE(cancel_invocation_sent->wait(5000));
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(_XPLATSTR("{\"invocationId\":\"0\",\"type\":5}\x1e"), messages->back());
+}
+
+TEST(invoke_limit, queued_invocation_sent_once_invocation_in_flight_completes)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    signalr_client_config config;
+    config.set_max_concurrent_invocations(1);
+    hub_connection->set_client_config(config);
+    hub_connection->start().get();
+
+    auto is_sent = [messages, messages_lock](const utility::char_t* invocation_id)
+    {
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        return std::any_of(messages->begin(), messages->end(), [invocation_id](const utility::string_t& message)
+        {
+            return message.find(utility::string_t(_XPLATSTR("\"invocationId\":\"")).append(invocation_id).append(_XPLATSTR("\",\"target\""))) != utility::string_t::npos;
+        });
+    };
+
+    auto first_invocation = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds(200), pplx::cancellation_token::none());
+    auto second_invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+
+    ASSERT_TRUE(is_sent(_XPLATSTR("0")));
+    ASSERT_FALSE(is_sent(_XPLATSTR("1")));
+
+    ASSERT_THROW(first_invocation.get(), signalr_exception);
+    ASSERT_TRUE(is_sent(_XPLATSTR("1")));
+
+    hub_connection->stop().get();
+    ASSERT_THROW(second_invocation.get(), signalr_exception);
+}
+
+TEST(invoke_limit, invocation_canceled_while_queued_not_sent)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    signalr_client_config config;
+    config.set_max_concurrent_invocations(1);
+    hub_connection->set_client_config(config);
+    hub_connection->start().get();
+
+    pplx::cancellation_token_source first_cts, second_cts;
+    auto first_invocation = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds(0), first_cts.get_token());
+    auto second_invocation = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds(0), second_cts.get_token());
+
+    second_cts.cancel();
+    ASSERT_THROW(second_invocation.get(), pplx::task_canceled);
+
+    first_cts.cancel();
+    ASSERT_THROW(first_invocation.get(), pplx::task_canceled);
+
+    // the permit of the canceled invocations is available again
+    auto third_invocation = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds(50), pplx::cancellation_token::none());
+    ASSERT_THROW(third_invocation.get(), signalr_exception);
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    for (const auto& message : *messages)
+    {
+        ASSERT_EQ(utility::string_t::npos, message.find(_XPLATSTR("\"invocationId\":\"1\",\"target\"")));
+        // the server is not asked to cancel an invocation it never received
+        ASSERT_NE(_XPLATSTR("{\"invocationId\":\"1\",\"type\":5}\x1e"), message);
+    }
+    ASSERT_NE(messages->end(), std::find(messages->begin(), messages->end(), _XPLATSTR("{\"invocationId\":\"0\",\"type\":5}\x1e")));
+    ASSERT_NE(utility::string_t::npos, messages->back().find(_XPLATSTR("\"invocationId\":\"2\"")));
+}
+
+std::shared_ptr<websocket_client> create_single_completion_websocket_client(std::shared_ptr<std::vector<utility::string_t>> messages,
+    std::shared_ptr<std::mutex> messages_lock, std::shared_ptr<event> invocations_made)
+{
+    int call_number = -1;
+    return create_test_websocket_client(
+        /* receive function */ [call_number, invocations_made]()
+        mutable {
+            std::string responses[]
+            {
+                "{ }\x1e",
+                "{ \"type\": 3, \"invocationId\": \"0\", \"result\": \"abc\" }\x1e",
+                "{}"
+            };
+
+            call_number = std::min(call_number + 1, 2);
+
+            if (call_number > 0)
+            {
+                invocations_made->wait();
+            }
+
+            return pplx::task_from_result(responses[call_number]);
+        },
+        /* send function */[messages, messages_lock](const utility::string_t& m)
+        {
+            std::lock_guard<std::mutex> lock(*messages_lock);
+            messages->push_back(m);
+            return pplx::task_from_result();
+        });
+}
+
+size_t count_invocations_sent(const std::vector<utility::string_t>& messages)
+{
+    return static_cast<size_t>(std::count_if(messages.begin(), messages.end(), [](const utility::string_t& message)
+    {
+        return message.find(_XPLATSTR("\"type\":1")) != utility::string_t::npos;
+    }));
+}
+
+TEST(invoke_coalescing, concurrent_invocations_with_equal_arguments_share_invocation)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto invocations_made = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_single_completion_websocket_client(messages, messages_lock, invocations_made));
+    hub_connection->coalesce_invocations(_XPLATSTR("method"));
+    hub_connection->start().get();
+
+    auto first_invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1, \"a\"]")));
+    auto second_invocation = hub_connection->invoke(_XPLATSTR("METHOD"), json::value::parse(_XPLATSTR("[1, \"a\"]")));
+    invocations_made->set();
+
+    ASSERT_EQ(_XPLATSTR("abc"), first_invocation.get().as_string());
+    ASSERT_EQ(_XPLATSTR("abc"), second_invocation.get().as_string());
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(1U, count_invocations_sent(*messages));
+}
+
+TEST(invoke_coalescing, invocations_with_different_arguments_or_cancelable_not_coalesced)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto invocations_made = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_single_completion_websocket_client(messages, messages_lock, invocations_made));
+    hub_connection->coalesce_invocations(_XPLATSTR("method"));
+    hub_connection->start().get();
+
+    pplx::cancellation_token_source cts;
+    auto first_invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]")));
+    auto second_invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[2]")));
+    auto third_invocation = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::parse(_XPLATSTR("[1]")),
+        std::chrono::milliseconds(0), cts.get_token());
+    auto fourth_invocation = hub_connection->invoke(_XPLATSTR("other"), json::value::parse(_XPLATSTR("[1]")));
+    auto fifth_invocation = hub_connection->invoke(_XPLATSTR("other"), json::value::parse(_XPLATSTR("[1]")));
+    invocations_made->set();
+
+    ASSERT_EQ(_XPLATSTR("abc"), first_invocation.get().as_string());
+
+    {
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        ASSERT_EQ(5U, count_invocations_sent(*messages));
+    }
+
+    hub_connection->stop().get();
+    ASSERT_THROW(second_invocation.get(), signalr_exception);
+    ASSERT_THROW(third_invocation.get(), signalr_exception);
+    ASSERT_THROW(fourth_invocation.get(), signalr_exception);
+    ASSERT_THROW(fifth_invocation.get(), signalr_exception);
+}
+
+TEST(invoke_coalescing, methods_coalesced_only_when_disconnected)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    ASSERT_THROW(hub_connection->coalesce_invocations(_XPLATSTR("method")), signalr_exception);
+    ASSERT_THROW(create_hub_connection()->coalesce_invocations(_XPLATSTR("")), std::invalid_argument);
+}
+
+TEST(invoke_result_cache, cached_result_returned_until_invalidated)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto invocation_made = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_single_completion_websocket_client(messages, messages_lock, invocation_made));
+    result_cache_config cache_config;
+    cache_config.set_time_to_live(std::chrono::seconds(60));
+    hub_connection->cache_results(_XPLATSTR("method"), cache_config);
+    hub_connection->start().get();
+
+    auto first_invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]")));
+    invocation_made->set();
+    ASSERT_EQ(_XPLATSTR("abc"), first_invocation.get().as_string());
+
+    // completed from the cache without sending the invocation
+    ASSERT_EQ(_XPLATSTR("abc"), hub_connection->invoke(_XPLATSTR("METHOD"), json::value::parse(_XPLATSTR("[1]"))).get().as_string());
+    {
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        ASSERT_EQ(1U, count_invocations_sent(*messages));
+    }
+
+    auto stats = hub_connection->get_result_cache_stats(_XPLATSTR("method"));
+    ASSERT_EQ(1U, stats.hits);
+    ASSERT_EQ(1U, stats.misses);
+    ASSERT_EQ(1U, stats.entries);
+
+    hub_connection->invalidate_cached_results(_XPLATSTR("method"));
+    auto third_invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]")));
+    {
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        ASSERT_EQ(2U, count_invocations_sent(*messages));
+    }
+
+    hub_connection->stop().get();
+    ASSERT_THROW(third_invocation.get(), signalr_exception);
+}
+
+TEST(invoke_result_cache, cached_results_dropped_when_server_invokes_invalidation_event)
+{
+    auto invocation_made = std::make_shared<event>();
+    auto invalidated = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, invocation_made, invalidated]()
+        mutable {
+            std::string responses[]
+            {
+                "{ }\x1e",
+                "{ \"type\": 3, \"invocationId\": \"0\", \"result\": \"abc\" }\x1e",
+                "{ \"type\": 1, \"target\": \"changed\", \"arguments\": [] }\x1e",
+                "{}"
+            };
+
+            call_number = std::min(call_number + 1, 3);
+
+            if (call_number == 1)
+            {
+                invocation_made->wait();
+            }
+            else if (call_number == 3)
+            {
+                invalidated->wait();
+            }
+
+            return pplx::task_from_result(responses[call_number]);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    result_cache_config cache_config;
+    cache_config.set_time_to_live(std::chrono::seconds(60));
+    cache_config.set_invalidation_event(_XPLATSTR("changed"));
+    hub_connection->cache_results(_XPLATSTR("method"), cache_config);
+
+    auto handler_invoked = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("changed"), [handler_invoked](const json::value&) { handler_invoked->set(); });
+    hub_connection->start().get();
+
+    auto invocation = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+    invocation_made->set();
+    ASSERT_EQ(_XPLATSTR("abc"), invocation.get().as_string());
+
+    ASSERT_FALSE(handler_invoked->wait(5000));
+    ASSERT_EQ(0U, hub_connection->get_result_cache_stats(_XPLATSTR("method")).entries);
+
+    invalidated->set();
+    hub_connection->stop().get();
+}
+
+TEST(invoke_result_cache, results_cached_only_when_disconnected)
+{
+    ASSERT_THROW(create_hub_connection()->get_result_cache_stats(_XPLATSTR("method")), signalr_exception);
+
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    ASSERT_THROW(hub_connection->cache_results(_XPLATSTR("method"), result_cache_config()), signalr_exception);
+}
+
+TEST(invoke_timeout, default_timeout_applies_to_invocations)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    hub_connection->set_invocation_timeout(std::chrono::milliseconds(100));
+    hub_connection->start().get();
+
+    try
+    {
+        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the invocation timed out after 100 ms", e.what());
+    }
+}
+
+TEST(invoke_timeout, timeout_does_not_affect_completed_invocation)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+            std::string responses[]
+            {
+                "{ }\x1e",
+                "{ \"type\": 3, \"invocationId\": \"0\", \"result\": \"abc\" }\x1e",
+                "{}"
+            };
+
+            call_number = std::min(call_number + 1, 2);
+
+            if (call_number > 0)
+            {
+                callback_registered_event->wait();
+            }
+
+            return pplx::task_from_result(responses[call_number]);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    std::mutex completions_lock;
+    std::vector<std::pair<utility::string_t, std::exception_ptr>> completions;
+    auto completed_event = std::make_shared<event>();
+    hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds(100), pplx::cancellation_token::none(),
+        [&completions_lock, &completions, completed_event](const json::value& result, std::exception_ptr exception)
+        {
+            std::lock_guard<std::mutex> lock(completions_lock);
+            completions.push_back(std::make_pair(result.serialize(), exception));
+            completed_event->set();
+        });
+    callback_registered_event->set();
+
+    ASSERT_FALSE(completed_event->wait(5000));
+
+    // the timer must have been released when the invocation completed so the result is not replaced by a timeout
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    std::lock_guard<std::mutex> lock(completions_lock);
+    ASSERT_EQ(1U, completions.size());
+    ASSERT_EQ(_XPLATSTR("\"abc\""), completions[0].first);
+    ASSERT_EQ(nullptr, completions[0].second);
+    ASSERT_EQ(connection_state::connected, hub_connection->get_connection_state());
+}
+
+TEST(invoke_timeout, negative_timeout_throws)
+{
+    auto hub_connection = create_hub_connection();
+
+    try
+    {
+        hub_connection->set_invocation_timeout(std::chrono::milliseconds(-1));
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("timeout cannot be negative", e.what());
+    }
+}
+
+TEST(invoke_cancel, invoke_canceled_when_token_canceled)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    hub_connection->start().get();
+
+    pplx::cancellation_token_source cts;
+    auto invoke_task = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds::zero(), cts.get_token());
+    cts.cancel();
+
+    ASSERT_THROW(invoke_task.get(), pplx::task_canceled);
+    ASSERT_FALSE(cancel_invocation_sent->wait(5000));
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(_XPLATSTR("{\"invocationId\":\"0\",\"type\":5}\x1e"), messages->back());
+}
+
+TEST(invoke_cancel, invoke_with_canceled_token_does_not_send_invocation)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    hub_connection->start().get();
+
+    pplx::cancellation_token_source cts;
+    cts.cancel();
+
+    auto invoke_task = hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        std::chrono::milliseconds::zero(), cts.get_token());
+
+    ASSERT_THROW(invoke_task.get(), pplx::task_canceled);
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    // only the handshake was sent
+    ASSERT_EQ(1U, messages->size());
+}
+
+TEST(invoke_callback, completion_receives_value_returned_from_the_server)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\", \"result\": \"abc\" }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        if (call_number > 0)
+        {
+            callback_registered_event->wait();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    auto completion_count = std::make_shared<std::atomic<int>>(0);
+    auto completed = std::make_shared<event>();
+    auto result = std::make_shared<json::value>();
+    auto exception = std::make_shared<std::exception_ptr>();
+    hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        [completion_count, completed, result, exception](const json::value& r, std::exception_ptr e)
+        {
+            ++(*completion_count);
+            *result = r;
+            *exception = e;
+            completed->set();
+        });
+    callback_registered_event->set();
+
+    ASSERT_FALSE(completed->wait(5000));
+    ASSERT_FALSE(*exception);
+    ASSERT_EQ(_XPLATSTR("\"abc\""), result->serialize());
+
+    hub_connection->stop().get();
+    ASSERT_EQ(1, completion_count->load());
+}
+
+TEST(invoke_callback, completion_receives_hub_errors_from_server)
+{
+    auto callback_registered_event = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, callback_registered_event]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
+        };
+
+        call_number = std::min(call_number + 1, 1);
+
+        if (call_number > 0)
+        {
+            callback_registered_event->wait();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    auto completion_count = std::make_shared<std::atomic<int>>(0);
+    auto completed = std::make_shared<event>();
+    auto exception = std::make_shared<std::exception_ptr>();
+    hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        [completion_count, completed, exception](const json::value&, std::exception_ptr e)
+        {
+            ++(*completion_count);
+            *exception = e;
+            completed->set();
+        });
+    callback_registered_event->set();
+
+    ASSERT_FALSE(completed->wait(5000));
+
+    try
+    {
+        std::rethrow_exception(*exception);
+    }
+    catch (const hub_exception& e)
+    {
+        ASSERT_STREQ("\"Ooops\"", e.what());
+    }
+
+    hub_connection->stop().get();
+    ASSERT_EQ(1, completion_count->load());
+}
+
+TEST(invoke_callback, completion_receives_send_errors)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); },
+        /* send function */ [](const utility::string_t& message)
+        {
+            if (message.find(_XPLATSTR("\"type\":1")) != utility::string_t::npos)
+            {
+                return pplx::task_from_exception<void>(std::runtime_error("error"));
+            }
+
+            return pplx::task_from_result();
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection->start().get();
+
+    auto invoke_completed = std::make_shared<event>();
+    auto invoke_exception = std::make_shared<std::exception_ptr>();
+    hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        [invoke_completed, invoke_exception](const json::value&, std::exception_ptr e)
+        {
+            *invoke_exception = e;
+            invoke_completed->set();
+        });
+
+    auto send_completed = std::make_shared<event>();
+    auto send_exception = std::make_shared<std::exception_ptr>();
+    hub_connection->send(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        [send_completed, send_exception](std::exception_ptr e)
+        {
+            *send_exception = e;
+            send_completed->set();
+        });
+
+    ASSERT_FALSE(invoke_completed->wait(5000));
+    ASSERT_FALSE(send_completed->wait(5000));
+    ASSERT_THROW(std::rethrow_exception(*invoke_exception), std::runtime_error);
+    ASSERT_THROW(std::rethrow_exception(*send_exception), std::runtime_error);
+}
+
+TEST(invoke_callback, send_completion_invoked_when_message_sent)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    hub_connection->start().get();
+
+    auto completed = std::make_shared<event>();
+    auto exception = std::make_shared<std::exception_ptr>();
+    hub_connection->send(invocation_envelope(_XPLATSTR("method")), json::value::array(),
+        [completed, exception](std::exception_ptr e)
+        {
+            *exception = e;
+            completed->set();
+        });
+
+    ASSERT_FALSE(completed->wait(5000));
+    ASSERT_FALSE(*exception);
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e"), messages->back());
+}
+
+TEST(invoke_callback, completion_invoked_when_timeout_elapses)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto cancel_invocation_sent = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_recording_websocket_client(messages, messages_lock, cancel_invocation_sent));
+    hub_connection->start().get();
+
+    auto completed = std::make_shared<event>();
+    auto exception = std::make_shared<std::exception_ptr>();
+    hub_connection->invoke(invocation_envelope(_XPLATSTR("method")), json::value::array(), std::chrono::milliseconds(100),
+        pplx::cancellation_token::none(), [completed, exception](const json::value&, std::exception_ptr e)
+        {
+            *exception = e;
+            completed->set();
+        });
+
+    ASSERT_FALSE(completed->wait(5000));
+    ASSERT_THROW(std::rethrow_exception(*exception), signalr_exception);
+    ASSERT_FALSE(cancel_invocation_sent->wait(5000));
+}
+
+TEST(invoke_callback, callback_invoke_allocates_less_than_task_based_invoke)
+{
+    // sends other than the handshake never complete so that no continuations run while allocations are counted
+    pplx::task_completion_event<void> send_tce;
+    auto handshake_sent = std::make_shared<std::atomic<bool>>(false);
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return pplx::task_from_result(std::string("{ }\x1e"));
+        },
+        /* send function */ [send_tce, handshake_sent](const utility::string_t&)
+        {
+            if (!handshake_sent->exchange(true))
+            {
+                return pplx::task_from_result();
+            }
+
+            return pplx::create_task(send_tce);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client, std::make_shared<memory_log_writer>(), trace_level::none);
+    hub_connection->start().get();
+
+    const invocation_envelope envelope(_XPLATSTR("method"));
+    const auto arguments = json::value::array();
+    const std::function<void(const json::value&, std::exception_ptr)> completion = [](const json::value&, std::exception_ptr) {};
+
+    // warm up so that pooled buffers and lazily created state are not counted
+    hub_connection->invoke(envelope, arguments);
+    hub_connection->invoke(envelope, arguments, completion);
+
+    size_t task_allocations, callback_allocations;
+    {
+        allocation_counter counter;
+        hub_connection->invoke(envelope, arguments);
+        task_allocations = counter.get_count();
+    }
+
+    {
+        allocation_counter counter;
+        hub_connection->invoke(envelope, arguments, completion);
+        callback_allocations = counter.get_count();
+    }
+
+    ASSERT_LT(callback_allocations, task_allocations);
+}
+
+TEST(receive, logs_if_callback_for_given_id_not_found)
+{
+    auto message_received_event = std::make_shared<event>();
+    auto handshake_sent = std::make_shared<event>();
+
+    int call_number = -1;
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ [call_number, message_received_event, handshake_sent]()
+        mutable {
+        std::string responses[]
+        {
+            "{ }\x1e",
+            "{ \"type\": 3, \"invocationId\": \"0\" }\x1e"
+            "{}"
+        };
+
+        handshake_sent->wait(1000);
+
+        call_number = std::min(call_number + 1, 2);
+
+        if (call_number > 1)
+        {
+            message_received_event->set();
+        }
+
+        return pplx::task_from_result(responses[call_number]);
+    },
+    [handshake_sent](const utility::string_t&)
+    {
+        handshake_sent->set();
+        return pplx::task_from_result();
+    });
+
+    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
+    auto hub_connection = create_hub_connection(websocket_client, writer, trace_level::info);
+    hub_connection->start().get();
+
+    ASSERT_FALSE(message_received_event->wait(5000));
+
+    auto log_entries = std::dynamic_pointer_cast<memory_log_writer>(writer)->get_log_entries();
+    ASSERT_TRUE(log_entries.size() > 1);
+
+    auto entry = remove_date_from_log_entry(log_entries[2]);
+    ASSERT_EQ(_XPLATSTR("[info        ] no callback found for id: 0\n"), entry) << dump_vector(log_entries);
+}
+
+// TODO Flaky until hub_connection.start waits for handshake response
+TEST(invoke, DISABLED_invoke_propagates_errors_from_server_as_exceptions)
+{
+   auto callback_registered_event = std::make_shared<event>();
+
+   int call_number = -1;
+   auto websocket_client = create_test_websocket_client(
+       /* receive function */ [call_number, callback_registered_event]()
+       mutable {
+       std::string responses[]
+       {
+           "{ }\x1e",
+           "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
+           "{}"
+       };
+
+       call_number = std::min(call_number + 1, 2);
+
+       if (call_number > 0)
+       {
+           callback_registered_event->wait();
+       }
+
+       return pplx::task_from_result(responses[call_number]);
+   });
+
+   auto hub_connection = create_hub_connection(websocket_client);
+   try
+   {
+       hub_connection->start()
+           .then([hub_connection, callback_registered_event]()
+       {
+           auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+           callback_registered_event->set();
+           return t;
+       }).get();
+
+       ASSERT_TRUE(false); // exception expected but not thrown
+   }
+   catch (const std::runtime_error& e)
+   {
+       ASSERT_STREQ("\"Ooops\"", e.what());
+   }
+}
+
+// TODO Flaky until hub_connection.start waits for handshake response
+TEST(invoke_void, DISABLED_invoke_creates_runtime_error)
+{
+   auto callback_registered_event = std::make_shared<event>();
+
+   int call_number = -1;
+   auto websocket_client = create_test_websocket_client(
+       /* receive function */ [call_number, callback_registered_event]()
+       mutable {
+       std::string responses[]
+       {
+           "{ }\x1e",
+           "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
+       };
+
+       call_number = std::min(call_number + 1, 1);
+
+       if (call_number > 0)
+       {
+           callback_registered_event->wait();
+       }
+
+       return pplx::task_from_result(responses[call_number]);
+   });
+
+   auto hub_connection = create_hub_connection(websocket_client);
+   try
+   {
+       hub_connection->start()
+           .then([hub_connection, callback_registered_event]()
+       {
+           auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+           callback_registered_event->set();
+           return t;
+       }).get();
+
+       ASSERT_TRUE(false); // exception expected but not thrown
+   }
+   catch (const signalr_exception& e)
+   {
+       ASSERT_STREQ("\"Ooops\"", e.what());
+       ASSERT_TRUE(dynamic_cast<const hub_exception *>(&e) == nullptr);
+   }
+}
+
+TEST(connection_id, can_get_connection_id)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    ASSERT_EQ(_XPLATSTR(""), hub_connection->get_connection_id());
+
+    hub_connection->start().get();
+    auto connection_id = hub_connection->get_connection_id();
+    hub_connection->stop().get();
+
+    ASSERT_EQ(_XPLATSTR("f7707523-307d-4cba-9abf-3eef701241e8"), connection_id);
+    ASSERT_EQ(_XPLATSTR("f7707523-307d-4cba-9abf-3eef701241e8"), hub_connection->get_connection_id());
+}
+
+TEST(on, event_name_must_not_be_empty_string)
+{
+    auto hub_connection = create_hub_connection();
+    try
+    {
+        hub_connection->on(_XPLATSTR(""), [](const json::value&) {});
+
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("event_name cannot be empty", e.what());
+    }
+}
+
+TEST(on, cannot_register_multiple_handlers_for_event)
+{
+    auto hub_connection = create_hub_connection();
+    hub_connection->on(_XPLATSTR("ping"), [](const json::value&) {});
+
+    try
+    {
+        hub_connection->on(_XPLATSTR("ping"), [](const json::value&) {});
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("an action for this event has already been registered. event name: ping", e.what());
+    }
+}
+
+TEST(on, cannot_register_handler_if_connection_not_in_disconnected_state)
+{
+    try
+    {
+        auto websocket_client = create_test_websocket_client(
+            /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
+        auto hub_connection = create_hub_connection(websocket_client);
+
+        hub_connection->start().get();
+
+        hub_connection->on(_XPLATSTR("myfunc"), [](const web::json::value&) {});
+
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("can't register a handler if the connection is in a disconnected state", e.what());
+    }
+}
+
+TEST(invoke, invoke_throws_when_the_underlying_connection_is_not_valid)
+{
+    auto hub_connection = create_hub_connection();
+
+    try
+    {
+        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
+        ASSERT_TRUE(true); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("cannot send data when the connection is not in the connected state. current connection state: disconnected", e.what());
+    }
+}
+
+TEST(invoke, send_throws_when_the_underlying_connection_is_not_valid)
+{
+    auto hub_connection = create_hub_connection();
+
+    try
+    {
+        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
+        ASSERT_TRUE(true); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("cannot send data when the connection is not in the connected state. current connection state: disconnected", e.what());
+    }
+}
+
+std::shared_ptr<hub_connection_impl> create_stateful_reconnect_hub_connection(std::shared_ptr<websocket_client> websocket_client,
+    size_t buffer_size = 100000)
+{
+    auto hub_connection = hub_connection_impl::create(create_uri(), trace_level::all, std::make_shared<trace_log_writer>(),
+        create_stateful_reconnect_web_request_factory(), std::make_unique<test_transport_factory>(websocket_client));
+
+    signalr_client_config config;
+    config.set_stateful_reconnect(true);
+    config.set_stateful_reconnect_buffer_size(buffer_size);
+    hub_connection->set_client_config(config);
+    return hub_connection;
+}
+
+// returns the results of the `responses` functions for the subsequent receive calls and empty messages afterwards
+std::function<pplx::task<std::string>()> create_scripted_receive(const std::vector<std::function<std::string()>>& responses)
+{
+    auto call_number = std::make_shared<std::atomic<size_t>>(0);
+    return [responses, call_number]()
+    {
+        const auto index = (*call_number)++;
+        if (index < responses.size())
+        {
+            return pplx::task_from_result(responses[index]());
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return pplx::task_from_result(std::string(""));
+    };
+}
+
+std::function<pplx::task<void>(const utility::string_t&)> create_recording_send(std::shared_ptr<std::vector<utility::string_t>> messages,
+    std::shared_ptr<std::mutex> messages_lock, std::shared_ptr<event> message_sent)
+{
+    return [messages, messages_lock, message_sent](const utility::string_t& m)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*messages_lock);
+            messages->push_back(m);
+        }
+
+        message_sent->set();
+        return pplx::task_from_result();
+    };
+}
+
+// waits until at least `count` messages were sent
+bool wait_for_messages(std::shared_ptr<std::vector<utility::string_t>> messages, std::shared_ptr<std::mutex> messages_lock,
+    std::shared_ptr<event> message_sent, size_t count)
+{
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*messages_lock);
+            if (messages->size() >= count)
+            {
+                return true;
+            }
+
+            // the event is reset under the lock so that a message sent after the check signals it again
+            message_sent->reset();
+        }
+
+        if (message_sent->wait(5000))
+        {
+            return false;
+        }
+    }
+}
+
+TEST(stateful_reconnect, start_sends_handshake_version_2)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive({ []() { return std::string("{ }\x1e"); } }),
+        create_recording_send(messages, messages_lock, message_sent));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    hub_connection->start().get();
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("{\"protocol\":\"json\",\"version\":2}\x1e") }, *messages);
+}
+
+TEST(stateful_reconnect, unacknowledged_messages_replayed_after_transport_reconnected)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto drop_transport = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive(
+        {
+            []() { return std::string("{ }\x1e"); },
+            [drop_transport]() -> std::string { drop_transport->wait(); throw std::runtime_error("connection dropped"); },
+            []() { return std::string("{\"type\":9,\"sequenceId\":1}\x1e"); }
+        }),
+        create_recording_send(messages, messages_lock, message_sent));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    hub_connection->start().get();
+    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
+    drop_transport->set();
+
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 4));
+    ASSERT_EQ(connection_state::connected, hub_connection->get_connection_state());
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(4U, messages->size());
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[1]);
+    ASSERT_EQ(_XPLATSTR("{\"sequenceId\":1,\"type\":9}\x1e"), (*messages)[2]);
+    ASSERT_EQ((*messages)[1], (*messages)[3]);
+}
+
+TEST(stateful_reconnect, acknowledged_messages_not_replayed)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto invocation_sent = std::make_shared<event>();
+    auto drop_transport = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive(
+        {
+            []() { return std::string("{ }\x1e"); },
+            [invocation_sent]() { invocation_sent->wait(); return std::string("{\"type\":8,\"sequenceId\":1}\x1e"); },
+            [drop_transport]() -> std::string { drop_transport->wait(); throw std::runtime_error("connection dropped"); },
+            []() { return std::string("{\"type\":9,\"sequenceId\":1}\x1e"); }
+        }),
+        create_recording_send(messages, messages_lock, message_sent));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    hub_connection->start().get();
+    hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
+    invocation_sent->set();
+    drop_transport->set();
+
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 3));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(3U, messages->size());
+    ASSERT_EQ(_XPLATSTR("{\"sequenceId\":2,\"type\":9}\x1e"), (*messages)[2]);
+}
+
+TEST(stateful_reconnect, received_messages_acknowledged)
+{
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto started = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive(
+        {
+            []() { return std::string("{ }\x1e"); },
+            [started]() { started->wait(); return std::string("{\"type\":1,\"target\":\"broadcast\",\"arguments\":[]}\x1e{\"type\":6}\x1e"); },
+            []() { return std::string("{\"type\":1,\"target\":\"broadcast\",\"arguments\":[]}\x1e"); }
+        }),
+        create_recording_send(messages, messages_lock, message_sent));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    hub_connection->start().get();
+    started->set();
+
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 2));
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(2U, messages->size());
+    // pings are not sequenced
+    ASSERT_EQ(_XPLATSTR("{\"sequenceId\":2,\"type\":8}\x1e"), (*messages)[1]);
+}
+
+TEST(stateful_reconnect, messages_received_before_transport_reconnected_skipped)
+{
+    auto started = std::make_shared<event>();
+    auto drop_transport = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive(
+        {
+            []() { return std::string("{ }\x1e"); },
+            [started]() { started->wait(); return std::string("{\"type\":1,\"target\":\"broadcast\",\"arguments\":[1]}\x1e"); },
+            [drop_transport]() -> std::string { drop_transport->wait(); throw std::runtime_error("connection dropped"); },
+            []()
+            {
+                return std::string("{\"type\":9,\"sequenceId\":1}\x1e")
+                    + "{\"type\":1,\"target\":\"broadcast\",\"arguments\":[1]}\x1e"
+                    + "{\"type\":1,\"target\":\"broadcast\",\"arguments\":[2]}\x1e";
+            }
+        }));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    auto received = std::make_shared<std::vector<utility::string_t>>();
+    auto received_lock = std::make_shared<std::mutex>();
+    auto second_received = std::make_shared<event>();
+    hub_connection->on(_XPLATSTR("broadcast"), [received, received_lock, second_received](const json::value& arguments)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*received_lock);
+            received->push_back(arguments.serialize());
+        }
+
+        if (arguments.at(0).as_integer() == 2)
+        {
+            second_received->set();
+        }
+    });
+
     hub_connection->start().get();
+    started->set();
+    drop_transport->set();
 
-    ASSERT_FALSE(message_received_event->wait(5000));
+    ASSERT_FALSE(second_received->wait(5000));
 
-    auto log_entries = std::dynamic_pointer_cast<memory_log_writer>(writer)->get_log_entries();
-    ASSERT_TRUE(log_entries.size() > 1);
+    std::lock_guard<std::mutex> lock(*received_lock);
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("[1]"), _XPLATSTR("[2]") }), *received);
+}
 
-    auto entry = remove_date_from_log_entry(log_entries[2]);
-    ASSERT_EQ(_XPLATSTR("[info        ] no callback found for id: 0\n"), entry) << dump_vector(log_entries);
+TEST(stateful_reconnect, send_fails_if_buffer_full)
+{
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive({ []() { return std::string("{ }\x1e"); } }));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client, 16);
+
+    hub_connection->start().get();
+
+    try
+    {
+        hub_connection->send(_XPLATSTR("method"), json::value::array()).get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the message cannot be sent because the stateful reconnect buffer is full. messages are released when the server acknowledges them.", e.what());
+    }
 }
 
-// TODO Flaky until hub_connection.start waits for handshake response
-TEST(invoke, DISABLED_invoke_propagates_errors_from_server_as_exceptions)
+TEST(failover, pending_invocations_failed_and_handshake_repeated_after_failing_over)
 {
-   auto callback_registered_event = std::make_shared<event>();
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto drop_transport = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive(
+        {
+            []() { return std::string("{ }\x1e"); },
+            [drop_transport]() -> std::string { drop_transport->wait(); throw std::runtime_error("connection dropped"); },
+            [messages, messages_lock, message_sent]()
+            {
+                // the server responds to the handshake sent after failing over
+                wait_for_messages(messages, messages_lock, message_sent, 3);
+                return std::string("{ }\x1e");
+            }
+        }),
+        create_recording_send(messages, messages_lock, message_sent));
 
-   int call_number = -1;
-   auto websocket_client = create_test_websocket_client(
-       /* receive function */ [call_number, callback_registered_event]()
-       mutable {
-       std::string responses[]
-       {
-           "{ }\x1e",
-           "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
-           "{}"
-       };
+    auto hub_connection = hub_connection_impl::create(
+        std::vector<utility::string_t>{ _XPLATSTR("http://first"), _XPLATSTR("http://second") }, trace_level::all,
+        std::make_shared<trace_log_writer>(),
+        create_multi_endpoint_web_request_factory(
+        {
+            { _XPLATSTR("first"), std::chrono::milliseconds(0) },
+            { _XPLATSTR("second"), std::chrono::milliseconds(50) }
+        }),
+        std::make_unique<test_transport_factory>(websocket_client));
 
-       call_number = std::min(call_number + 1, 2);
+    hub_connection->start().get();
+    ASSERT_EQ(_XPLATSTR("first"), hub_connection->get_connection_id());
 
-       if (call_number > 0)
-       {
-           callback_registered_event->wait();
-       }
+    auto invoke_task = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
+    drop_transport->set();
 
-       return pplx::task_from_result(responses[call_number]);
-   });
+    try
+    {
+        invoke_task.get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("\"the connection failed over to a different endpoint before invocation result was received\"", e.what());
+    }
 
-   auto hub_connection = create_hub_connection(websocket_client);
-   try
-   {
-       hub_connection->start()
-           .then([hub_connection, callback_registered_event]()
-       {
-           auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
-           callback_registered_event->set();
-           return t;
-       }).get();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 3));
+    ASSERT_EQ(_XPLATSTR("second"), hub_connection->get_connection_id());
 
-       ASSERT_TRUE(false); // exception expected but not thrown
-   }
-   catch (const std::runtime_error& e)
-   {
-       ASSERT_STREQ("\"Ooops\"", e.what());
-   }
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(_XPLATSTR("{\"protocol\":\"json\",\"version\":1}\x1e"), (*messages)[0]);
+    ASSERT_EQ((*messages)[0], (*messages)[2]);
 }
 
-// TODO Flaky until hub_connection.start waits for handshake response
-TEST(invoke_void, DISABLED_invoke_creates_runtime_error)
+TEST(hub_connection_impl_memory, connections_share_client_config)
 {
-   auto callback_registered_event = std::make_shared<event>();
+    web::http::http_headers headers;
+    for (auto i = 0; i < 100; i++)
+    {
+        headers.add(utility::conversions::to_string_t(std::to_string(i)), utility::string_t(1000, _XPLATSTR('x')));
+    }
 
-   int call_number = -1;
-   auto websocket_client = create_test_websocket_client(
-       /* receive function */ [call_number, callback_registered_event]()
-       mutable {
-       std::string responses[]
-       {
-           "{ }\x1e",
-           "{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e"
-       };
+    signalr_client_config config;
+    config.set_http_headers(headers);
 
-       call_number = std::min(call_number + 1, 1);
+    auto websocket_client = create_test_websocket_client();
 
-       if (call_number > 0)
-       {
-           callback_registered_event->wait();
-       }
+    const size_t connection_count = 100;
+    std::vector<std::shared_ptr<hub_connection_impl>> connections;
+    connections.reserve(connection_count);
 
-       return pplx::task_from_result(responses[call_number]);
-   });
+    size_t config_allocations = 0;
+    size_t bytes;
+    {
+        allocation_counter counter;
+        for (size_t i = 0; i < connection_count; i++)
+        {
+            connections.push_back(create_hub_connection(websocket_client));
 
-   auto hub_connection = create_hub_connection(websocket_client);
-   try
-   {
-       hub_connection->start()
-           .then([hub_connection, callback_registered_event]()
-       {
-           auto t = hub_connection->invoke(_XPLATSTR("method"), json::value::array());
-           callback_registered_event->set();
-           return t;
-       }).get();
+            const auto allocations = counter.get_count();
+            connections.back()->set_client_config(config);
+            config_allocations += counter.get_count() - allocations;
+        }
+        bytes = counter.get_bytes();
+    }
 
-       ASSERT_TRUE(false); // exception expected but not thrown
-   }
-   catch (const signalr_exception& e)
-   {
-       ASSERT_STREQ("\"Ooops\"", e.what());
-       ASSERT_TRUE(dynamic_cast<const hub_exception *>(&e) == nullptr);
-   }
+    const auto bytes_per_connection = bytes / connection_count;
+    // reported in the test results (--gtest_output=xml)
+    ::testing::Test::RecordProperty("heap_bytes_per_connection", static_cast<int>(bytes_per_connection));
+
+    ASSERT_EQ(0U, config_allocations);
+    // the headers alone take more than 100KB
+    ASSERT_LT(bytes_per_connection, 100U * 1000U);
 }
 
-TEST(connection_id, can_get_connection_id)
+namespace
 {
-    auto websocket_client = create_test_websocket_client(
-        /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
-    auto hub_connection = create_hub_connection(websocket_client);
+    bool wait_for_messages(const std::shared_ptr<std::vector<utility::string_t>>& messages, const std::shared_ptr<std::mutex>& messages_lock,
+        size_t count)
+    {
+        for (auto i = 0; i < 5000; i++)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*messages_lock);
+                if (messages->size() >= count)
+                {
+                    return true;
+                }
+            }
 
-    ASSERT_EQ(_XPLATSTR(""), hub_connection->get_connection_id());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return false;
+    }
+}
+
+TEST(hub_outbox, messages_sent_while_disconnected_sent_in_one_frame_after_handshake)
+{
+    outbox_directory directory;
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto stopped = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_single_completion_websocket_client(messages, messages_lock, stopped));
+
+    signalr_client_config config;
+    config.set_outbox_directory(directory.path());
+    hub_connection->set_client_config(config);
+
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[2]"))).get();
 
     hub_connection->start().get();
-    auto connection_id = hub_connection->get_connection_id();
-    hub_connection->stop().get();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, 2));
 
-    ASSERT_EQ(_XPLATSTR("f7707523-307d-4cba-9abf-3eef701241e8"), connection_id);
-    ASSERT_EQ(_XPLATSTR("f7707523-307d-4cba-9abf-3eef701241e8"), hub_connection->get_connection_id());
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[3]"))).get();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, 3));
+
+    {
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        ASSERT_EQ(_XPLATSTR("{\"arguments\":[1],\"target\":\"method\",\"type\":1}\x1e{\"arguments\":[2],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[1]);
+        ASSERT_EQ(_XPLATSTR("{\"arguments\":[3],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[2]);
+    }
+
+    stopped->set();
+    hub_connection->stop().get();
 }
 
-TEST(on, event_name_must_not_be_empty_string)
+TEST(hub_outbox, messages_not_sent_by_a_connection_sent_by_next_connection_using_outbox)
 {
-    auto hub_connection = create_hub_connection();
-    try
-    {
-        hub_connection->on(_XPLATSTR(""), [](const json::value&) {});
+    outbox_directory directory;
+    signalr_client_config config;
+    config.set_outbox_directory(directory.path());
 
-        ASSERT_TRUE(false); // exception expected but not thrown
+    {
+        auto hub_connection = create_hub_connection();
+        hub_connection->set_client_config(config);
+        hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
     }
-    catch (const std::invalid_argument& e)
+
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto stopped = std::make_shared<event>();
+    auto hub_connection = create_hub_connection(create_single_completion_websocket_client(messages, messages_lock, stopped));
+    hub_connection->set_client_config(config);
+
+    hub_connection->start().get();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, 2));
+
     {
-        ASSERT_STREQ("event_name cannot be empty", e.what());
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        ASSERT_EQ(_XPLATSTR("{\"arguments\":[1],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[1]);
     }
+
+    stopped->set();
+    hub_connection->stop().get();
 }
 
-TEST(on, cannot_register_multiple_handlers_for_event)
+TEST(hub_outbox, send_fails_when_outbox_full)
 {
+    outbox_directory directory;
     auto hub_connection = create_hub_connection();
-    hub_connection->on(_XPLATSTR("ping"), [](const json::value&) {});
+
+    // room for two messages, one in each segment
+    signalr_client_config config;
+    config.set_outbox_directory(directory.path());
+    config.set_outbox_size(160);
+    hub_connection->set_client_config(config);
+
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[2]"))).get();
 
     try
     {
-        hub_connection->on(_XPLATSTR("ping"), [](const json::value&) {});
+        hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[3]"))).get();
         ASSERT_TRUE(false); // exception expected but not thrown
     }
     catch (const signalr_exception& e)
     {
-        ASSERT_STREQ("an action for this event has already been registered. event name: ping", e.what());
+        ASSERT_EQ(_XPLATSTR("the message cannot be sent because the outbox is full. messages are removed from the outbox once they were sent."),
+            utility::conversions::to_string_t(e.what()));
     }
 }
 
-TEST(on, cannot_register_handler_if_connection_not_in_disconnected_state)
+// only hub_connection::send goes through the outbox, so an invocation does not wait for the messages queued in it
+TEST(hub_outbox, invocations_not_ordered_after_messages_in_outbox)
 {
-    try
-    {
-        auto websocket_client = create_test_websocket_client(
-            /* receive function */ []() { return pplx::task_from_result(std::string("{ }\x1e")); });
-        auto hub_connection = create_hub_connection(websocket_client);
+    outbox_directory directory;
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto batch_started = std::make_shared<event>();
+    auto release_batch = std::make_shared<event>();
+    auto record_send = create_recording_send(messages, messages_lock, message_sent);
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive({ []() { return std::string("{ }\x1e"); } }),
+        [record_send, batch_started, release_batch](const utility::string_t& message)
+        {
+            if (message.find(_XPLATSTR("[1]")) != utility::string_t::npos)
+            {
+                batch_started->set();
+                return pplx::create_task([record_send, release_batch, message]()
+                {
+                    release_batch->wait(5000);
+                    return record_send(message);
+                });
+            }
 
-        hub_connection->start().get();
+            return record_send(message);
+        });
+    auto hub_connection = create_hub_connection(websocket_client);
 
-        hub_connection->on(_XPLATSTR("myfunc"), [](const web::json::value&) {});
+    signalr_client_config config;
+    config.set_outbox_directory(directory.path());
+    hub_connection->set_client_config(config);
+
+    hub_connection->start().get();
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
+    ASSERT_FALSE(batch_started->wait(5000));
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[2]"))).get();
+
+    auto invoke_task = hub_connection->invoke(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[3]")));
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 2));
+    release_batch->set();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 4));
 
-        ASSERT_TRUE(false); // exception expected but not thrown
-    }
-    catch (const signalr_exception& e)
     {
-        ASSERT_STREQ("can't register a handler if the connection is in a disconnected state", e.what());
+        std::lock_guard<std::mutex> lock(*messages_lock);
+        ASSERT_EQ(_XPLATSTR("{\"arguments\":[3],\"invocationId\":\"0\",\"target\":\"method\",\"type\":1}\x1e"), (*messages)[1]);
+        ASSERT_EQ(_XPLATSTR("{\"arguments\":[1],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[2]);
+        ASSERT_EQ(_XPLATSTR("{\"arguments\":[2],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[3]);
     }
+
+    hub_connection->stop().get();
+    ASSERT_THROW(invoke_task.get(), signalr_exception);
 }
 
-TEST(invoke, invoke_throws_when_the_underlying_connection_is_not_valid)
+TEST(hub_outbox, outbox_cannot_be_changed_while_messages_sent_from_it)
 {
-    auto hub_connection = create_hub_connection();
+    outbox_directory directory;
+    auto batch_started = std::make_shared<event>();
+    auto release_batch = std::make_shared<event>();
+    auto batch_sent = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive({ []() { return std::string("{ }\x1e"); } }),
+        [batch_started, release_batch, batch_sent](const utility::string_t& message)
+        {
+            if (message.find(_XPLATSTR("\"target\"")) == utility::string_t::npos)
+            {
+                return pplx::task_from_result();
+            }
+
+            batch_started->set();
+            return pplx::create_task([release_batch, batch_sent]()
+            {
+                release_batch->wait(5000);
+                batch_sent->set();
+            });
+        });
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    signalr_client_config config;
+    config.set_outbox_directory(directory.path());
+    hub_connection->set_client_config(config);
+
+    hub_connection->start().get();
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
+    ASSERT_FALSE(batch_started->wait(5000));
+    hub_connection->stop().get();
+
+    auto other_config = config;
+    other_config.set_outbox_size(config.get_outbox_size() * 2);
 
     try
     {
-        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
-        ASSERT_TRUE(true); // exception expected but not thrown
+        hub_connection->set_client_config(other_config);
+        ASSERT_TRUE(false); // exception expected but not thrown
     }
     catch (const signalr_exception& e)
     {
-        ASSERT_STREQ("cannot send data when the connection is not in the connected state. current connection state: disconnected", e.what());
+        ASSERT_STREQ("cannot change the outbox while messages are being sent from it.", e.what());
     }
-}
 
-TEST(invoke, send_throws_when_the_underlying_connection_is_not_valid)
-{
-    auto hub_connection = create_hub_connection();
+    // settings other than the outbox can still be changed
+    config.set_stateful_reconnect(true);
+    hub_connection->set_client_config(config);
 
-    try
-    {
-        hub_connection->invoke(_XPLATSTR("method"), json::value::array()).get();
-        ASSERT_TRUE(true); // exception expected but not thrown
-    }
-    catch (const signalr_exception& e)
+    release_batch->set();
+    ASSERT_FALSE(batch_sent->wait(5000));
+    for (auto i = 0; i < 500; i++)
     {
-        ASSERT_STREQ("cannot send data when the connection is not in the connected state. current connection state: disconnected", e.what());
+        try
+        {
+            hub_connection->set_client_config(other_config);
+            return;
+        }
+        catch (const signalr_exception&)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
     }
+
+    ASSERT_TRUE(false); // the outbox was not changed once the messages were sent
+}
+
+TEST(hub_outbox, messages_of_a_batch_acknowledged_and_replayed_one_by_one)
+{
+    outbox_directory directory;
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto drop_transport = std::make_shared<event>();
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive(
+        {
+            []() { return std::string("{ }\x1e"); },
+            [messages, messages_lock, message_sent]()
+            {
+                wait_for_messages(messages, messages_lock, message_sent, 2);
+                return std::string("{\"type\":8,\"sequenceId\":1}\x1e");
+            },
+            [drop_transport]() -> std::string { drop_transport->wait(); throw std::runtime_error("connection dropped"); },
+            []() { return std::string("{\"type\":9,\"sequenceId\":1}\x1e"); }
+        }),
+        create_recording_send(messages, messages_lock, message_sent));
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    signalr_client_config config;
+    config.set_stateful_reconnect(true);
+    config.set_outbox_directory(directory.path());
+    hub_connection->set_client_config(config);
+
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[2]"))).get();
+
+    hub_connection->start().get();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 2));
+    // lets the acknowledgement be processed before the transport drops
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    drop_transport->set();
+
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 4));
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[1],\"target\":\"method\",\"type\":1}\x1e{\"arguments\":[2],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[1]);
+    // only the second message of the batch was not acknowledged
+    ASSERT_EQ(_XPLATSTR("{\"sequenceId\":2,\"type\":9}\x1e"), (*messages)[2]);
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[2],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[3]);
+}
+
+TEST(hub_outbox, messages_kept_if_transport_fails_to_send_batch_with_stateful_reconnect)
+{
+    outbox_directory directory;
+    auto messages = std::make_shared<std::vector<utility::string_t>>();
+    auto messages_lock = std::make_shared<std::mutex>();
+    auto message_sent = std::make_shared<event>();
+    auto send_failed = std::make_shared<event>();
+    auto fail_sends = std::make_shared<std::atomic<bool>>(true);
+    auto record_send = create_recording_send(messages, messages_lock, message_sent);
+    auto websocket_client = create_test_websocket_client(
+        create_scripted_receive({ []() { return std::string("{ }\x1e"); } }),
+        [record_send, send_failed, fail_sends](const utility::string_t& message)
+        {
+            if (*fail_sends && message.find(_XPLATSTR("\"target\"")) != utility::string_t::npos)
+            {
+                send_failed->set();
+                return pplx::task_from_exception<void>(std::runtime_error("send failed"));
+            }
+
+            return record_send(message);
+        });
+    auto hub_connection = create_stateful_reconnect_hub_connection(websocket_client);
+
+    signalr_client_config config;
+    config.set_stateful_reconnect(true);
+    config.set_outbox_directory(directory.path());
+    hub_connection->set_client_config(config);
+
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[1]"))).get();
+    hub_connection->start().get();
+    ASSERT_FALSE(send_failed->wait(5000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    *fail_sends = false;
+    hub_connection->send(_XPLATSTR("method"), json::value::parse(_XPLATSTR("[2]"))).get();
+    ASSERT_TRUE(wait_for_messages(messages, messages_lock, message_sent, 2));
+
+    std::lock_guard<std::mutex> lock(*messages_lock);
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[1],\"target\":\"method\",\"type\":1}\x1e{\"arguments\":[2],\"target\":\"method\",\"type\":1}\x1e"), (*messages)[1]);
+}
+
+TEST(hub_connect_timings, handshake_recorded_when_hub_connection_started)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* receive function */ []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return pplx::task_from_result(std::string("{ }\x1e"));
+        });
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    hub_connection->start().get();
+
+    const auto timings = hub_connection->get_connect_timings();
+    ASSERT_LE(0, timings.get_phase(connect_phase::negotiate).count());
+    ASSERT_EQ(0, timings.get_phase(connect_phase::redirects).count());
+    ASSERT_LE(0, timings.get_phase(connect_phase::websocket_connect).count());
+    ASSERT_LE(std::chrono::nanoseconds(std::chrono::milliseconds(20)).count(), timings.get_phase(connect_phase::handshake).count());
+    ASSERT_LE(timings.get_phase(connect_phase::handshake).count(), timings.total.count());
+
+    hub_connection->stop().get();
 }
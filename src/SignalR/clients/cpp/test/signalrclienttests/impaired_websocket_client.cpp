@@ -0,0 +1,474 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "impaired_websocket_client.h"
+#include "default_websocket_client.h"
+#include "websocket_transport.h"
+#include "signalrclient/signalr_exception.h"
+#include <algorithm>
+
+namespace signalr
+{
+    // unnamed namespace makes it invisble outside this translation unit
+    namespace
+    {
+        // the delay until the given time, rounded up to whole milliseconds so that nothing happens early
+        std::chrono::milliseconds delay_until(std::chrono::steady_clock::time_point time, std::chrono::steady_clock::time_point now)
+        {
+            if (time <= now)
+            {
+                return std::chrono::milliseconds(0);
+            }
+
+            const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(time - now);
+            return delay + std::chrono::milliseconds(now + delay < time ? 1 : 0);
+        }
+
+        // splits the frame after every `max_records` records
+        std::vector<std::string> split_frame(const std::string& frame, size_t max_records)
+        {
+            std::vector<std::string> parts;
+            size_t part_start = 0;
+            size_t records = 0;
+            for (size_t i = 0; i < frame.length(); ++i)
+            {
+                if (frame[i] == '\x1e' && ++records == max_records)
+                {
+                    parts.push_back(frame.substr(part_start, i + 1 - part_start));
+                    part_start = i + 1;
+                    records = 0;
+                }
+            }
+
+            if (part_start < frame.length() || parts.empty())
+            {
+                parts.push_back(frame.substr(part_start));
+            }
+
+            return parts;
+        }
+
+        // shared by all impaired clients so that impairing a connection does not start a ticker thread. The wheel
+        // of timer_wheel::get_default ticks every 100 ms, which is too coarse for latencies and bandwidths. It is
+        // leaked so that its ticker thread is never joined by a static destructor
+        std::shared_ptr<timer_wheel> get_impairment_timer_wheel()
+        {
+            static const auto impairment_timer_wheel = new std::shared_ptr<timer_wheel>([]()
+            {
+                auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(1), 1024);
+                timer_wheel->start();
+                return timer_wheel;
+            }());
+
+            return *impairment_timer_wheel;
+        }
+    }
+
+    impaired_websocket_client::impaired_websocket_client(const std::shared_ptr<websocket_client>& websocket_client,
+        const network_impairment& impairment, std::shared_ptr<timer_wheel> timer_wheel)
+        : m_state(std::make_shared<shared_state>())
+    {
+        if (!timer_wheel)
+        {
+            timer_wheel = get_impairment_timer_wheel();
+        }
+
+        m_state->websocket_client = websocket_client;
+        m_state->impairment = impairment;
+        m_state->timers = timer_wheel;
+        m_state->random.seed(impairment.seed);
+        m_state->next_frame_id = 1;
+        m_state->arrived_through = 0;
+        m_state->receive_buffer = nullptr;
+        m_state->received = nullptr;
+        m_state->disconnected = false;
+    }
+
+    // the handshake of the websocket takes a round trip
+    pplx::task<void> impaired_websocket_client::connect(const web::uri &url)
+    {
+        auto state = m_state;
+        return m_state->websocket_client->connect(url)
+            .then([state]()
+            {
+                pplx::task_completion_event<void> connected;
+                after(state, state->impairment.latency * 2, [state, connected]()
+                {
+                    receive_frames(state);
+                    connected.set();
+                });
+
+                return pplx::create_task(connected);
+            });
+    }
+
+    pplx::task<void> impaired_websocket_client::send(const utility::string_t &message)
+    {
+        // the message is sent after this function returned so it is copied
+        auto websocket_client = m_state->websocket_client;
+        auto message_copy = std::make_shared<utility::string_t>(message);
+        return send_impaired(m_state, message.length(), [websocket_client, message_copy]()
+        {
+            return websocket_client->send(*message_copy);
+        });
+    }
+
+    pplx::task<void> impaired_websocket_client::send(const uint8_t* data, size_t length, websocket_message_type message_type)
+    {
+        // the returned task completes before the frame reaches the decorated client so the caller's bytes are copied
+        auto websocket_client = m_state->websocket_client;
+        auto data_copy = std::make_shared<std::vector<uint8_t>>(data, data + length);
+        return send_impaired(m_state, length, [websocket_client, data_copy, message_type]()
+        {
+            return websocket_client->send(data_copy->data(), data_copy->size(), message_type)
+                .then([data_copy](pplx::task<void> send_task) { send_task.get(); });
+        });
+    }
+
+    pplx::task<std::string> impaired_websocket_client::receive()
+    {
+        pplx::task_completion_event<std::string> frame_received;
+        auto buffer = std::make_shared<std::vector<uint8_t>>();
+
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            m_state->owned_received = [frame_received, buffer](websocket_message_type, std::exception_ptr exception)
+            {
+                if (exception)
+                {
+                    frame_received.set_exception(exception);
+                }
+                else
+                {
+                    frame_received.set(std::string(buffer->begin(), buffer->end()));
+                }
+            };
+            m_state->receive_buffer = buffer.get();
+            m_state->received = &m_state->owned_received;
+        }
+
+        deliver_frames(m_state);
+        return pplx::create_task(frame_received);
+    }
+
+    pplx::task<websocket_message_type> impaired_websocket_client::receive(std::vector<uint8_t>& buffer)
+    {
+        pplx::task_completion_event<websocket_message_type> frame_received;
+
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            m_state->owned_received = [frame_received](websocket_message_type message_type, std::exception_ptr exception)
+            {
+                if (exception)
+                {
+                    frame_received.set_exception(exception);
+                }
+                else
+                {
+                    frame_received.set(message_type);
+                }
+            };
+            m_state->receive_buffer = &buffer;
+            m_state->received = &m_state->owned_received;
+        }
+
+        deliver_frames(m_state);
+        return pplx::create_task(frame_received);
+    }
+
+    void impaired_websocket_client::receive(std::vector<uint8_t>& buffer,
+        const std::function<void(websocket_message_type, std::exception_ptr)>& received)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            m_state->receive_buffer = &buffer;
+            m_state->received = &received;
+        }
+
+        deliver_frames(m_state);
+    }
+
+    pplx::task<void> impaired_websocket_client::close()
+    {
+        return m_state->websocket_client->close();
+    }
+
+    // The frame takes the link once the frames before it left the link and occupies it for the time it takes to
+    // carry its bytes plus, if it stalls, the stall duration. It arrives after the latency and the jitter but
+    // never before the frames sent before it. Must be called with the lock held.
+    void impaired_websocket_client::schedule_frame(shared_state& state, link& link, size_t length,
+        std::chrono::milliseconds& departure, std::chrono::milliseconds& arrival)
+    {
+        const auto& impairment = state.impairment;
+        const auto now = std::chrono::steady_clock::now();
+
+        auto free_at = std::max(now, link.free_at);
+        if (impairment.bandwidth > 0)
+        {
+            free_at += std::chrono::microseconds(static_cast<int64_t>(length * 1000000 / impairment.bandwidth));
+        }
+
+        if (chance(state, impairment.stall_probability))
+        {
+            free_at += impairment.stall_duration;
+        }
+
+        auto arrives_at = free_at + impairment.latency;
+        if (impairment.jitter.count() > 0)
+        {
+            arrives_at += std::chrono::milliseconds(
+                std::uniform_int_distribution<int64_t>(0, impairment.jitter.count())(state.random));
+        }
+
+        link.free_at = free_at;
+        link.last_arrival = std::max(arrives_at, link.last_arrival);
+
+        departure = delay_until(link.free_at, now);
+        arrival = delay_until(link.last_arrival, now);
+    }
+
+    // impairments that are off don't draw from the generator
+    bool impaired_websocket_client::chance(shared_state& state, double probability)
+    {
+        if (probability <= 0)
+        {
+            return false;
+        }
+
+        return std::uniform_real_distribution<double>(0, 1)(state.random) < probability;
+    }
+
+    void impaired_websocket_client::after(const std::shared_ptr<shared_state>& state, std::chrono::milliseconds delay,
+        const std::function<void()>& callback)
+    {
+        if (delay.count() <= 0)
+        {
+            callback();
+        }
+        else
+        {
+            state->timers->schedule(delay, callback);
+        }
+    }
+
+    // the send completes once the frame left the link, the decorated client sends it once it arrived
+    pplx::task<void> impaired_websocket_client::send_impaired(const std::shared_ptr<shared_state>& state, size_t length,
+        const std::function<pplx::task<void>()>& send)
+    {
+        std::chrono::milliseconds departure, arrival;
+
+        {
+            std::lock_guard<std::mutex> lock(state->lock);
+            if (state->disconnected)
+            {
+                return pplx::task_from_exception<void>(disconnected_error());
+            }
+
+            schedule_frame(*state, state->outbound, length, departure, arrival);
+        }
+
+        after(state, arrival, [send]()
+        {
+            send().then([](pplx::task<void> send_task)
+            {
+                // the frame was lost, just like a frame lost by the network
+                try { send_task.get(); }
+                catch (...) {}
+            });
+        });
+
+        pplx::task_completion_event<void> sent;
+        after(state, departure, [sent]() { sent.set(); });
+        return pplx::create_task(sent);
+    }
+
+    // receives frames from the decorated client as fast as it provides them and queues them in the inbox until they
+    // arrive. Stops when receiving fails or the connection was dropped. Only this loop uses the inbound buffer
+    void impaired_websocket_client::receive_frames(std::shared_ptr<shared_state> state)
+    {
+        state->websocket_client->receive(state->inbound_buffer)
+            .then([state](pplx::task<websocket_message_type> receive_task)
+            {
+                auto message_type = websocket_message_type::text;
+                std::string frame;
+                std::exception_ptr error;
+                try
+                {
+                    message_type = receive_task.get();
+                    frame.assign(state->inbound_buffer.begin(), state->inbound_buffer.end());
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::chrono::milliseconds departure, arrival;
+                uint64_t frame_id;
+                bool dropped = false;
+
+                {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    if (state->disconnected)
+                    {
+                        return;
+                    }
+
+                    if (!error && chance(*state, state->impairment.disconnect_probability))
+                    {
+                        error = disconnected_error();
+                        state->disconnected = dropped = true;
+                    }
+
+                    if (error)
+                    {
+                        // the error is delivered once the frames received before it were
+                        frame_id = state->next_frame_id++;
+                        state->inbox.push_back(inbound_frame{ frame_id, websocket_message_type::text, std::string(), error });
+                        arrival = delay_until(state->inbound.last_arrival, std::chrono::steady_clock::now());
+                    }
+                    else
+                    {
+                        schedule_frame(*state, state->inbound, frame.length(), departure, arrival);
+                        frame_id = state->next_frame_id++;
+                        // binary frames don't have record separators
+                        if (state->impairment.max_records_per_frame > 0 && message_type == websocket_message_type::text)
+                        {
+                            for (auto& part : split_frame(frame, state->impairment.max_records_per_frame))
+                            {
+                                state->inbox.push_back(inbound_frame{ frame_id, message_type, std::move(part), nullptr });
+                            }
+                        }
+                        else
+                        {
+                            state->inbox.push_back(inbound_frame{ frame_id, message_type, std::move(frame), nullptr });
+                        }
+                    }
+                }
+
+                // the decorated client is closed before the drop is delivered so that it is gone by the time the
+                // caller learns about it
+                if (dropped)
+                {
+                    state->websocket_client->close().then([](pplx::task<void> close_task)
+                    {
+                        try { close_task.get(); }
+                        catch (...) {}
+                    });
+                }
+
+                after(state, arrival, [state, frame_id]()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(state->lock);
+                        state->arrived_through = std::max(state->arrived_through, frame_id);
+                    }
+
+                    deliver_frames(state);
+                });
+
+                if (!error)
+                {
+                    receive_frames(state);
+                }
+            });
+    }
+
+    // completes the receive waiting for a frame with the first frame of the inbox if it arrived. Errors stay in the
+    // inbox so that every receive made afterwards fails too
+    void impaired_websocket_client::deliver_frames(const std::shared_ptr<shared_state>& state)
+    {
+        std::function<void(websocket_message_type, std::exception_ptr)> owned_received;
+        const std::function<void(websocket_message_type, std::exception_ptr)>* received;
+        std::exception_ptr error;
+        auto message_type = websocket_message_type::text;
+
+        {
+            std::lock_guard<std::mutex> lock(state->lock);
+            if (!state->received || state->inbox.empty() || state->inbox.front().id > state->arrived_through)
+            {
+                return;
+            }
+
+            auto& frame = state->inbox.front();
+            error = frame.error;
+            message_type = frame.type;
+            if (!error)
+            {
+                state->receive_buffer->assign(frame.frame.begin(), frame.frame.end());
+                state->inbox.pop_front();
+            }
+
+            received = state->received;
+            if (received == &state->owned_received)
+            {
+                owned_received = std::move(state->owned_received);
+                received = &owned_received;
+            }
+
+            state->received = nullptr;
+            state->receive_buffer = nullptr;
+        }
+
+        (*received)(message_type, error);
+    }
+
+    std::exception_ptr impaired_websocket_client::disconnected_error()
+    {
+        return std::make_exception_ptr(signalr_exception(_XPLATSTR("the connection was dropped by the network impairment")));
+    }
+
+    impaired_transport_factory::impaired_transport_factory(const network_impairment& impairment,
+        websocket_client_factory websocket_client_factory, std::shared_ptr<timer_wheel> timer_wheel)
+        : m_impairment(impairment), m_websocket_client_factory(websocket_client_factory), m_timer_wheel(timer_wheel),
+        m_client_count(std::make_shared<std::atomic<uint32_t>>(0))
+    {
+        if (!m_websocket_client_factory)
+        {
+            m_websocket_client_factory = [](const signalr_client_config& signalr_client_config)
+            {
+                return std::make_shared<default_websocket_client>(signalr_client_config);
+            };
+        }
+
+        if (!m_timer_wheel)
+        {
+            m_timer_wheel = get_impairment_timer_wheel();
+        }
+    }
+
+    std::shared_ptr<transport> impaired_transport_factory::create_transport(transport_type transport_type, const logger& logger,
+        const signalr_client_config& signalr_client_config,
+        std::function<void(const utility::string_t&)> process_response_callback,
+        std::function<void(const std::exception&)> error_callback)
+    {
+        if (transport_type == signalr::transport_type::websockets)
+        {
+            auto websocket_client_factory = m_websocket_client_factory;
+            return websocket_transport::create(
+                impair([websocket_client_factory, signalr_client_config]() { return websocket_client_factory(signalr_client_config); }),
+                logger, process_response_callback, error_callback);
+        }
+
+        throw std::runtime_error("not implemented");
+    }
+
+    std::function<std::shared_ptr<websocket_client>()> impaired_transport_factory::impair(
+        const std::function<std::shared_ptr<websocket_client>()>& create_websocket_client) const
+    {
+        auto impairment = m_impairment;
+        auto timer_wheel = m_timer_wheel;
+        auto client_count = m_client_count;
+        return [create_websocket_client, impairment, timer_wheel, client_count]() -> std::shared_ptr<websocket_client>
+        {
+            auto client_impairment = impairment;
+            client_impairment.seed += (*client_count)++;
+            return std::make_shared<impaired_websocket_client>(create_websocket_client(), client_impairment, timer_wheel);
+        };
+    }
+
+    const network_impairment& impaired_transport_factory::get_impairment() const noexcept
+    {
+        return m_impairment;
+    }
+}
@@ -0,0 +1,152 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include "websocket_client.h"
+#include "transport_factory.h"
+#include "timer_wheel.h"
+
+namespace signalr
+{
+    // The conditions of an impaired network an impaired_websocket_client simulates. Each direction of a connection
+    // is modelled as a link that carries one frame at a time at the given bandwidth; a frame arrives `latency` plus
+    // up to `jitter` after it left the link. Frames are never reordered. The default impairs nothing.
+    struct network_impairment
+    {
+        std::chrono::milliseconds latency = std::chrono::milliseconds(0);
+        std::chrono::milliseconds jitter = std::chrono::milliseconds(0);
+        // bytes per second carried by each direction, 0 for unlimited
+        size_t bandwidth = 0;
+        // received frames with more records than this are delivered as several frames, 0 never splits frames
+        size_t max_records_per_frame = 0;
+        // the probability that a frame stalls the link it is sent on for `stall_duration`, delaying the frames
+        // behind it as well
+        double stall_probability = 0;
+        std::chrono::milliseconds stall_duration = std::chrono::milliseconds(0);
+        // the probability that the connection drops when a frame is received. The receive that would have delivered
+        // the frame fails and so do sends made afterwards
+        double disconnect_probability = 0;
+        // the random choices (jitter, stalls, disconnects) are made in the same order from a generator seeded with
+        // this so the same traffic is impaired the same way every time
+        uint32_t seed = 0;
+    };
+
+    // Decorates a websocket client with the conditions of an impaired network to test reconnects, timeouts, batching
+    // and backpressure without a real network. A send completes once the frame left the simulated link and the
+    // frame is passed to the decorated client once it arrived. Frames are received from the decorated client as
+    // soon as it provides them and are delivered once they arrived. Delays are measured in ticks of the timer
+    // wheel so tests can advance time manually.
+    class impaired_websocket_client : public websocket_client
+    {
+    public:
+        // the timer wheel with a tick of a millisecond shared by all impaired clients is used if `timer_wheel` is null
+        impaired_websocket_client(const std::shared_ptr<websocket_client>& websocket_client, const network_impairment& impairment,
+            std::shared_ptr<timer_wheel> timer_wheel = nullptr);
+
+        pplx::task<void> connect(const web::uri &url) override;
+
+        pplx::task<void> send(const utility::string_t &message) override;
+
+        pplx::task<void> send(const uint8_t* data, size_t length, websocket_message_type message_type) override;
+
+        pplx::task<std::string> receive() override;
+
+        pplx::task<websocket_message_type> receive(std::vector<uint8_t>& buffer) override;
+
+        void receive(std::vector<uint8_t>& buffer, const std::function<void(websocket_message_type, std::exception_ptr)>& received) override;
+
+        pplx::task<void> close() override;
+
+    private:
+        struct link
+        {
+            // when the link is done carrying the frames sent so far and when the last of them arrives
+            std::chrono::steady_clock::time_point free_at;
+            std::chrono::steady_clock::time_point last_arrival;
+        };
+
+        // frames are numbered in the order they were received, a frame can be delivered once it and all the
+        // frames before it arrived
+        struct inbound_frame
+        {
+            uint64_t id;
+            websocket_message_type type;
+            std::string frame;
+            std::exception_ptr error;
+        };
+
+        // shared with the timers and the receive loop which may outlive the client
+        struct shared_state
+        {
+            std::shared_ptr<websocket_client> websocket_client;
+            network_impairment impairment;
+            std::shared_ptr<timer_wheel> timers;
+
+            std::mutex lock;
+            std::mt19937 random;
+            link outbound;
+            link inbound;
+            std::deque<inbound_frame> inbox;
+            uint64_t next_frame_id;
+            uint64_t arrived_through;
+            // the buffer frames are received into from the decorated client
+            std::vector<uint8_t> inbound_buffer;
+            // the receive waiting for a frame, `received` points to `owned_received` for task based receives
+            std::vector<uint8_t>* receive_buffer;
+            const std::function<void(websocket_message_type, std::exception_ptr)>* received;
+            std::function<void(websocket_message_type, std::exception_ptr)> owned_received;
+            bool disconnected;
+        };
+
+        std::shared_ptr<shared_state> m_state;
+
+        static void schedule_frame(shared_state& state, link& link, size_t length, std::chrono::milliseconds& departure,
+            std::chrono::milliseconds& arrival);
+        static bool chance(shared_state& state, double probability);
+        static void after(const std::shared_ptr<shared_state>& state, std::chrono::milliseconds delay, const std::function<void()>& callback);
+        static pplx::task<void> send_impaired(const std::shared_ptr<shared_state>& state, size_t length,
+            const std::function<pplx::task<void>()>& send);
+        static void receive_frames(std::shared_ptr<shared_state> state);
+        static void deliver_frames(const std::shared_ptr<shared_state>& state);
+        static std::exception_ptr disconnected_error();
+    };
+
+    // Creates transports whose websocket clients are impaired. Each client is seeded with the seed of the
+    // impairment plus the number of clients created before it so that reconnects are impaired differently but
+    // the same way every time.
+    class impaired_transport_factory : public transport_factory
+    {
+    public:
+        typedef std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)> websocket_client_factory;
+
+        // the clients `websocket_client_factory` creates are decorated, default_websocket_clients if it is null. The
+        // timer wheel shared by all impaired clients is used if `timer_wheel` is null
+        impaired_transport_factory(const network_impairment& impairment, websocket_client_factory websocket_client_factory = nullptr,
+            std::shared_ptr<timer_wheel> timer_wheel = nullptr);
+
+        std::shared_ptr<transport> create_transport(transport_type transport_type, const logger& logger,
+            const signalr_client_config& signalr_client_config,
+            std::function<void(const utility::string_t&)> process_response_callback,
+            std::function<void(const std::exception&)> error_callback) override;
+
+        // a function that decorates the clients `create_websocket_client` creates with the impairment, seeding each
+        // as described above. It does not refer to the factory so it can outlive it
+        std::function<std::shared_ptr<websocket_client>()> impair(
+            const std::function<std::shared_ptr<websocket_client>()>& create_websocket_client) const;
+
+        const network_impairment& get_impairment() const noexcept;
+
+    private:
+        network_impairment m_impairment;
+        websocket_client_factory m_websocket_client_factory;
+        std::shared_ptr<timer_wheel> m_timer_wheel;
+        std::shared_ptr<std::atomic<uint32_t>> m_client_count;
+    };
+}
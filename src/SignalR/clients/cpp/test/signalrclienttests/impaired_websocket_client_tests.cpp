@@ -0,0 +1,278 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "test_utils.h"
+#include "test_websocket_client.h"
+#include "impaired_websocket_client.h"
+#include "trace_log_writer.h"
+#include "signalrclient/signalr_exception.h"
+
+using namespace signalr;
+
+namespace
+{
+    // a client returning the given frames and then failing receives
+    std::shared_ptr<test_websocket_client> create_frames_websocket_client(const std::vector<std::string>& frames,
+        std::shared_ptr<std::vector<utility::string_t>> sent = nullptr)
+    {
+        auto websocket_client = std::make_shared<test_websocket_client>();
+        auto next_frame = std::make_shared<size_t>(0);
+        websocket_client->set_receive_function([frames, next_frame]()
+        {
+            if (*next_frame < frames.size())
+            {
+                return pplx::task_from_result(frames[(*next_frame)++]);
+            }
+
+            return pplx::task_from_exception<std::string>(std::runtime_error("no more frames"));
+        });
+
+        websocket_client->set_send_function([sent](const utility::string_t& message)
+        {
+            if (sent)
+            {
+                sent->push_back(message);
+            }
+
+            return pplx::task_from_result();
+        });
+
+        return websocket_client;
+    }
+
+    // a client receiving a single binary frame
+    class binary_frame_websocket_client : public test_websocket_client
+    {
+    public:
+        using test_websocket_client::receive;
+
+        pplx::task<websocket_message_type> receive(std::vector<uint8_t>& buffer) override
+        {
+            if (m_received)
+            {
+                return pplx::task_from_exception<websocket_message_type>(std::runtime_error("no more frames"));
+            }
+
+            m_received = true;
+            buffer.assign({ 0x91, 0x00, 0x1e });
+            return pplx::task_from_result(websocket_message_type::binary);
+        }
+
+    private:
+        bool m_received = false;
+    };
+
+    std::vector<std::string> receive_all(impaired_websocket_client& websocket_client)
+    {
+        std::vector<std::string> frames;
+        try
+        {
+            for (;;)
+            {
+                frames.push_back(websocket_client.receive().get());
+            }
+        }
+        catch (const std::exception&)
+        { }
+
+        return frames;
+    }
+
+    // the impaired client schedules its timers from continuations so the wheel is only advanced once they are
+    void wait_for_timers(const std::shared_ptr<timer_wheel>& timers, size_t count)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (timers->size() < count && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        ASSERT_LE(count, timers->size());
+    }
+}
+
+TEST(impaired_websocket_client, frames_delayed_by_latency)
+{
+    auto sent = std::make_shared<std::vector<utility::string_t>>();
+    auto timers = timer_wheel::create(std::chrono::milliseconds(10), 64);
+    network_impairment impairment;
+    impairment.latency = std::chrono::milliseconds(50);
+    impaired_websocket_client websocket_client(create_frames_websocket_client({ "a\x1e" }, sent), impairment, timers);
+
+    auto connect_task = websocket_client.connect(web::uri(_XPLATSTR("ws://fakeuri")));
+    wait_for_timers(timers, 1);
+    ASSERT_FALSE(connect_task.is_done());
+    timers->advance(11);
+    connect_task.get();
+
+    auto receive_task = websocket_client.receive();
+    // the send completes right away since the bandwidth is not limited but arrives later
+    websocket_client.send(_XPLATSTR("b\x1e")).get();
+    ASSERT_TRUE(sent->empty());
+
+    // the send and the frame received from the decorated client
+    wait_for_timers(timers, 2);
+    timers->advance(2);
+    ASSERT_FALSE(receive_task.is_done());
+    ASSERT_TRUE(sent->empty());
+
+    timers->advance(5);
+    ASSERT_EQ("a\x1e", receive_task.get());
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("b\x1e") }, *sent);
+}
+
+TEST(impaired_websocket_client, frames_split_by_records)
+{
+    network_impairment impairment;
+    impairment.max_records_per_frame = 2;
+    impaired_websocket_client websocket_client(create_frames_websocket_client({ "a\x1e" "b\x1e" "c\x1e", "d\x1e" }), impairment);
+
+    websocket_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+    ASSERT_EQ(std::vector<std::string>({ "a\x1e" "b\x1e", "c\x1e", "d\x1e" }), receive_all(websocket_client));
+}
+
+TEST(impaired_websocket_client, sends_and_receives_fail_once_disconnected)
+{
+    network_impairment impairment;
+    impairment.disconnect_probability = 1;
+    auto closed = std::make_shared<bool>(false);
+    auto inner_client = create_frames_websocket_client({ "a\x1e" });
+    inner_client->set_close_function([closed]()
+    {
+        *closed = true;
+        return pplx::task_from_result();
+    });
+
+    impaired_websocket_client websocket_client(inner_client, impairment);
+    websocket_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+    ASSERT_THROW(websocket_client.receive().get(), signalr_exception);
+    ASSERT_THROW(websocket_client.receive().get(), signalr_exception);
+    ASSERT_THROW(websocket_client.send(_XPLATSTR("b\x1e")).get(), signalr_exception);
+    ASSERT_TRUE(*closed);
+}
+
+TEST(impaired_websocket_client, same_seed_impairs_traffic_the_same_way)
+{
+    std::vector<std::string> frames;
+    for (auto i = 0; i < 200; i++)
+    {
+        frames.push_back(std::to_string(i).append("\x1e"));
+    }
+
+    network_impairment impairment;
+    impairment.disconnect_probability = 0.05;
+    impairment.seed = 42;
+
+    impaired_websocket_client first_client(create_frames_websocket_client(frames), impairment);
+    first_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+    const auto first_received = receive_all(first_client);
+
+    impaired_websocket_client second_client(create_frames_websocket_client(frames), impairment);
+    second_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+    ASSERT_LT(first_received.size(), frames.size());
+    ASSERT_EQ(first_received, receive_all(second_client));
+}
+
+TEST(impaired_websocket_client, sends_take_link_for_time_to_carry_bytes)
+{
+    auto sent = std::make_shared<std::vector<utility::string_t>>();
+    auto timers = timer_wheel::create(std::chrono::milliseconds(10), 64);
+    network_impairment impairment;
+    impairment.bandwidth = 1000;
+    impaired_websocket_client websocket_client(create_frames_websocket_client({}, sent), impairment, timers);
+    websocket_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+    // 100 bytes take 100ms at 1000 bytes per second and the second message waits for the first one
+    auto first_send = websocket_client.send(utility::string_t(100, _XPLATSTR('a')));
+    auto second_send = websocket_client.send(utility::string_t(100, _XPLATSTR('b')));
+
+    timers->advance(8);
+    ASSERT_FALSE(first_send.is_done());
+    ASSERT_TRUE(sent->empty());
+
+    timers->advance(4);
+    first_send.get();
+    ASSERT_FALSE(second_send.is_done());
+    ASSERT_EQ(1U, sent->size());
+
+    timers->advance(10);
+    second_send.get();
+    ASSERT_EQ(2U, sent->size());
+}
+
+TEST(impaired_websocket_client, stalled_frame_delays_frames_behind_it)
+{
+    auto sent = std::make_shared<std::vector<utility::string_t>>();
+    auto timers = timer_wheel::create(std::chrono::milliseconds(10), 64);
+    network_impairment impairment;
+    impairment.stall_probability = 1;
+    impairment.stall_duration = std::chrono::milliseconds(100);
+    impaired_websocket_client websocket_client(create_frames_websocket_client({}, sent), impairment, timers);
+    websocket_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+    auto first_send = websocket_client.send(_XPLATSTR("a\x1e"));
+    auto second_send = websocket_client.send(_XPLATSTR("b\x1e"));
+
+    timers->advance(8);
+    ASSERT_FALSE(first_send.is_done());
+    ASSERT_TRUE(sent->empty());
+
+    timers->advance(4);
+    first_send.get();
+    ASSERT_FALSE(second_send.is_done());
+
+    timers->advance(10);
+    second_send.get();
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("a\x1e"), _XPLATSTR("b\x1e") }), *sent);
+}
+
+TEST(impaired_websocket_client, binary_frames_received_as_binary)
+{
+    network_impairment impairment;
+    impairment.max_records_per_frame = 1;
+    impaired_websocket_client websocket_client(std::make_shared<binary_frame_websocket_client>(), impairment);
+    websocket_client.connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+    std::vector<uint8_t> buffer;
+    ASSERT_EQ(websocket_message_type::binary, websocket_client.receive(buffer).get());
+    ASSERT_EQ(std::vector<uint8_t>({ 0x91, 0x00, 0x1e }), buffer);
+    ASSERT_THROW(websocket_client.receive(buffer).get(), std::runtime_error);
+}
+
+TEST(impaired_transport_factory, transports_impair_clients_of_websocket_client_factory)
+{
+    network_impairment impairment;
+    impairment.disconnect_probability = 1;
+    auto created = std::make_shared<std::atomic<int>>(0);
+    impaired_transport_factory factory(impairment, [created](const signalr_client_config& config)
+        -> std::shared_ptr<websocket_client>
+    {
+        EXPECT_EQ(message_parsing::lazy, config.get_message_parsing());
+        (*created)++;
+        return create_frames_websocket_client({ "a\x1e" });
+    });
+
+    signalr_client_config config;
+    config.set_message_parsing(message_parsing::lazy);
+
+    for (auto i = 1; i <= 2; i++)
+    {
+        auto received = std::make_shared<std::atomic<bool>>(false);
+        auto dropped = std::make_shared<event>();
+        auto transport = factory.create_transport(transport_type::websockets, logger(std::make_shared<trace_log_writer>(), trace_level::none),
+            config, [received](const utility::string_t&) { *received = true; }, [dropped](const std::exception&) { dropped->set(); });
+
+        transport->connect(web::uri(_XPLATSTR("ws://fakeuri"))).get();
+
+        // the frame the decorated client provides is dropped with the connection
+        ASSERT_FALSE(dropped->wait(5000));
+        ASSERT_FALSE(*received);
+        ASSERT_EQ(i, *created);
+
+        transport->disconnect().get();
+    }
+}
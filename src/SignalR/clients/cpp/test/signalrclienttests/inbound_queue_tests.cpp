@@ -0,0 +1,308 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "inbound_queue.h"
+#include "trace_log_writer.h"
+#include "event.h"
+
+using namespace signalr;
+
+namespace
+{
+    // a handler that records the arguments it gets and does not return from the first invocation until released. The
+    // handler shares its state since the queue does not wait for the handler to return when it is destroyed
+    class blocking_handler
+    {
+    public:
+        blocking_handler()
+            : m_state(std::make_shared<state>())
+        { }
+
+        std::function<void(const web::json::value&)> get_handler()
+        {
+            auto state = m_state;
+            return [state](const web::json::value& arguments)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    state->received.push_back(arguments.serialize());
+                }
+
+                state->entered.set();
+                state->released.wait(10000);
+            };
+        }
+
+        bool wait_entered()
+        {
+            return m_state->entered.wait(5000) == 0;
+        }
+
+        void release()
+        {
+            m_state->released.set();
+        }
+
+        bool wait_for_received(size_t count)
+        {
+            for (auto i = 0; i < 500; i++)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_state->lock);
+                    if (m_state->received.size() >= count)
+                    {
+                        return true;
+                    }
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            return false;
+        }
+
+        std::vector<utility::string_t> get_received()
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            return m_state->received;
+        }
+
+    private:
+        struct state
+        {
+            std::mutex lock;
+            std::vector<utility::string_t> received;
+            event entered;
+            event released;
+        };
+
+        std::shared_ptr<state> m_state;
+    };
+
+    logger create_logger()
+    {
+        return logger(std::make_shared<trace_log_writer>(), trace_level::none);
+    }
+
+    web::json::value create_arguments(const utility::string_t& key, int value)
+    {
+        auto arguments = web::json::value::array();
+        arguments[0] = web::json::value::string(key);
+        arguments[1] = web::json::value::number(value);
+        return arguments;
+    }
+}
+
+TEST(inbound_queue_push, oldest_invocations_dropped_when_queue_full)
+{
+    blocking_handler handler;
+    inbound_queue_config config;
+    config.set_capacity(3);
+    config.set_overflow_policy(queue_overflow_policy::drop_oldest);
+
+    inbound_queue queue(config, handler.get_handler(), create_logger());
+
+    queue.push(create_arguments(_XPLATSTR("a"), 0));
+    ASSERT_TRUE(handler.wait_entered());
+
+    for (auto i = 1; i <= 5; i++)
+    {
+        queue.push(create_arguments(_XPLATSTR("a"), i));
+    }
+
+    auto stats = queue.get_stats();
+    ASSERT_EQ(3U, stats.depth);
+    ASSERT_EQ(2U, stats.dropped);
+    ASSERT_EQ(0U, stats.conflated);
+
+    handler.release();
+    ASSERT_TRUE(handler.wait_for_received(4));
+    ASSERT_EQ(0U, queue.get_stats().depth);
+
+    auto received = handler.get_received();
+    ASSERT_EQ(4U, received.size());
+    ASSERT_EQ(_XPLATSTR("[\"a\",0]"), received[0]);
+    ASSERT_EQ(_XPLATSTR("[\"a\",3]"), received[1]);
+    ASSERT_EQ(_XPLATSTR("[\"a\",4]"), received[2]);
+    ASSERT_EQ(_XPLATSTR("[\"a\",5]"), received[3]);
+}
+
+TEST(inbound_queue_push, only_latest_invocation_per_key_delivered_when_conflating)
+{
+    blocking_handler handler;
+    inbound_queue_config config;
+    config.set_capacity(10);
+    config.set_overflow_policy(queue_overflow_policy::conflate);
+    config.set_conflation_key_extractor([](const web::json::value& arguments) { return arguments.at(0).as_string(); });
+
+    inbound_queue queue(config, handler.get_handler(), create_logger());
+
+    queue.push(create_arguments(_XPLATSTR("first"), 0));
+    ASSERT_TRUE(handler.wait_entered());
+
+    queue.push(create_arguments(_XPLATSTR("a"), 1));
+    queue.push(create_arguments(_XPLATSTR("b"), 2));
+    queue.push(create_arguments(_XPLATSTR("a"), 3));
+    queue.push(create_arguments(_XPLATSTR("a"), 4));
+
+    auto stats = queue.get_stats();
+    ASSERT_EQ(2U, stats.depth);
+    ASSERT_EQ(0U, stats.dropped);
+    ASSERT_EQ(2U, stats.conflated);
+
+    handler.release();
+    ASSERT_TRUE(handler.wait_for_received(3));
+    ASSERT_EQ(0U, queue.get_stats().depth);
+
+    auto received = handler.get_received();
+    ASSERT_EQ(3U, received.size());
+    ASSERT_EQ(_XPLATSTR("[\"a\",4]"), received[1]);
+    ASSERT_EQ(_XPLATSTR("[\"b\",2]"), received[2]);
+}
+
+TEST(inbound_queue_push, push_blocks_while_queue_full)
+{
+    blocking_handler handler;
+    inbound_queue_config config;
+    config.set_capacity(1);
+
+    inbound_queue queue(config, handler.get_handler(), create_logger());
+
+    queue.push(create_arguments(_XPLATSTR("a"), 0));
+    ASSERT_TRUE(handler.wait_entered());
+    queue.push(create_arguments(_XPLATSTR("a"), 1));
+
+    std::atomic<bool> pushed(false);
+    std::thread pusher([&queue, &pushed]()
+    {
+        queue.push(create_arguments(_XPLATSTR("a"), 2));
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(pushed);
+
+    handler.release();
+    pusher.join();
+
+    ASSERT_TRUE(pushed);
+    ASSERT_EQ(0U, queue.get_stats().dropped);
+}
+
+TEST(inbound_queue_create, conflation_requires_key_extractor)
+{
+    inbound_queue_config config;
+    config.set_overflow_policy(queue_overflow_policy::conflate);
+
+    try
+    {
+        inbound_queue queue(config, [](const web::json::value&) {}, create_logger());
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("a conflation key extractor is required to conflate invocations", e.what());
+    }
+}
+
+TEST(inbound_queue_config, capacity_must_be_positive)
+{
+    inbound_queue_config config;
+
+    try
+    {
+        config.set_capacity(0);
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("capacity must be greater than zero", e.what());
+    }
+}
+
+TEST(inbound_queue_destroy, does_not_wait_for_running_handler)
+{
+    for (auto policy : { queue_overflow_policy::block, queue_overflow_policy::drop_oldest })
+    {
+        blocking_handler handler;
+        inbound_queue_config config;
+        config.set_overflow_policy(policy);
+
+        auto queue = std::make_shared<inbound_queue>(config, handler.get_handler(), create_logger());
+
+        queue->push(create_arguments(_XPLATSTR("a"), 0));
+        queue->push(create_arguments(_XPLATSTR("a"), 1));
+        ASSERT_TRUE(handler.wait_entered());
+
+        // the handler is still running when the queue is gone, the invocation still queued is dropped
+        queue.reset();
+        handler.release();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("[\"a\",0]") }, handler.get_received());
+    }
+}
+
+TEST(inbound_queue_push, invocation_queued_if_conflation_key_cannot_be_extracted)
+{
+    blocking_handler handler;
+    inbound_queue_config config;
+    config.set_overflow_policy(queue_overflow_policy::conflate);
+    config.set_conflation_key_extractor([](const web::json::value& arguments) { return arguments.at(0).as_string(); });
+
+    inbound_queue queue(config, handler.get_handler(), create_logger());
+
+    queue.push(create_arguments(_XPLATSTR("first"), 0));
+    ASSERT_TRUE(handler.wait_entered());
+
+    auto no_key = web::json::value::array();
+    no_key[0] = web::json::value::number(1);
+    ASSERT_NO_THROW(queue.push(no_key));
+    ASSERT_NO_THROW(queue.push(no_key));
+    queue.push(create_arguments(_XPLATSTR("a"), 2));
+    queue.push(create_arguments(_XPLATSTR("a"), 3));
+
+    auto stats = queue.get_stats();
+    ASSERT_EQ(3U, stats.depth);
+    ASSERT_EQ(1U, stats.conflated);
+
+    handler.release();
+    ASSERT_TRUE(handler.wait_for_received(4));
+
+    auto received = handler.get_received();
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("[\"first\",0]"), _XPLATSTR("[1]"), _XPLATSTR("[1]"), _XPLATSTR("[\"a\",3]") }), received);
+}
+
+TEST(inbound_queue_destroy, can_be_destroyed_by_handler)
+{
+    for (auto policy : { queue_overflow_policy::block, queue_overflow_policy::drop_oldest })
+    {
+        event destroyed;
+        inbound_queue_config config;
+        config.set_overflow_policy(policy);
+
+        std::shared_ptr<inbound_queue> queue;
+        std::mutex queue_lock;
+        queue = std::make_shared<inbound_queue>(config, [&queue, &queue_lock, &destroyed](const web::json::value&)
+        {
+            std::shared_ptr<inbound_queue> released;
+            {
+                std::lock_guard<std::mutex> lock(queue_lock);
+                released.swap(queue);
+            }
+
+            released.reset();
+            destroyed.set();
+        }, create_logger());
+
+        std::shared_ptr<inbound_queue> pushed;
+        {
+            std::lock_guard<std::mutex> lock(queue_lock);
+            pushed = queue;
+        }
+        pushed->push(create_arguments(_XPLATSTR("a"), 0));
+        pushed.reset();
+
+        ASSERT_FALSE(destroyed.wait(5000));
+    }
+}
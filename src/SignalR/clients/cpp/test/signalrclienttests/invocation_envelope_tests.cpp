@@ -0,0 +1,96 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "invocation_envelope.h"
+
+using namespace signalr;
+using namespace web;
+
+namespace
+{
+    utility::string_t serialize_invocation(const utility::string_t& method_name, const utility::string_t& invocation_id, const json::value& arguments)
+    {
+        json::value request;
+        request[_XPLATSTR("type")] = json::value(1);
+        if (!invocation_id.empty())
+        {
+            request[_XPLATSTR("invocationId")] = json::value::string(invocation_id);
+        }
+        request[_XPLATSTR("target")] = json::value::string(method_name);
+        request[_XPLATSTR("arguments")] = arguments;
+
+        return request.serialize() + _XPLATSTR('\x1e');
+    }
+}
+
+TEST(invocation_envelope_write, writes_invocation_with_invocation_id)
+{
+    invocation_envelope envelope(_XPLATSTR("method"));
+
+    utility::string_t buffer;
+    envelope.write(buffer, _XPLATSTR("42"), json::value::array());
+
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"invocationId\":\"42\",\"target\":\"method\",\"type\":1}\x1e"), buffer);
+}
+
+TEST(invocation_envelope_write, writes_traceparent_header)
+{
+    invocation_envelope envelope(_XPLATSTR("method"));
+
+    utility::string_t buffer;
+    envelope.write(buffer, _XPLATSTR("42"), json::value::array(),
+        _XPLATSTR("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"));
+
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"headers\":{\"traceparent\":\"00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01\"},")
+        _XPLATSTR("\"invocationId\":\"42\",\"target\":\"method\",\"type\":1}\x1e"), buffer);
+}
+
+TEST(invocation_envelope_write, omits_invocation_id_if_empty)
+{
+    invocation_envelope envelope(_XPLATSTR("method"));
+
+    utility::string_t buffer;
+    envelope.write(buffer, _XPLATSTR(""), json::value::array());
+
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e"), buffer);
+}
+
+TEST(invocation_envelope_write, output_matches_serialized_invocation_object)
+{
+    auto arguments = json::value::array();
+    arguments[0] = json::value::string(_XPLATSTR("message"));
+    arguments[1] = json::value::number(1);
+    arguments[2][_XPLATSTR("field")] = json::value::boolean(true);
+
+    utility::string_t method_names[] = { _XPLATSTR("Send"), _XPLATSTR("quoted \"method\""), _XPLATSTR("back\\slash") };
+
+    for (const auto& method_name : method_names)
+    {
+        invocation_envelope envelope(method_name);
+
+        utility::string_t buffer;
+        envelope.write(buffer, _XPLATSTR("7"), arguments);
+        ASSERT_EQ(serialize_invocation(method_name, _XPLATSTR("7"), arguments), buffer);
+
+        envelope.write(buffer, _XPLATSTR(""), arguments);
+        ASSERT_EQ(serialize_invocation(method_name, _XPLATSTR(""), arguments), buffer);
+    }
+}
+
+TEST(invocation_envelope_write, overwrites_previous_buffer_contents)
+{
+    invocation_envelope envelope(_XPLATSTR("method"));
+
+    utility::string_t buffer{ _XPLATSTR("leftover") };
+    envelope.write(buffer, _XPLATSTR("1"), json::value::array());
+
+    ASSERT_EQ(_XPLATSTR("{\"arguments\":[],\"invocationId\":\"1\",\"target\":\"method\",\"type\":1}\x1e"), buffer);
+}
+
+TEST(invocation_envelope_get_method_name, returns_method_name)
+{
+    invocation_envelope envelope(_XPLATSTR("method"));
+
+    ASSERT_EQ(_XPLATSTR("method"), envelope.get_method_name());
+}
@@ -0,0 +1,132 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "invocation_limiter.h"
+
+using namespace signalr;
+
+TEST(invocation_limiter, queued_invocations_started_in_order_as_permits_released)
+{
+    invocation_limiter limiter(2, false);
+
+    ASSERT_TRUE(limiter.try_acquire());
+    ASSERT_TRUE(limiter.try_acquire());
+    ASSERT_FALSE(limiter.try_acquire());
+
+    std::vector<int> started;
+    for (auto i = 0; i < 3; i++)
+    {
+        limiter.enqueue([&started, i]() { started.push_back(i); });
+    }
+
+    ASSERT_TRUE(started.empty());
+    ASSERT_EQ(3U, limiter.get_queued());
+
+    limiter.release();
+    ASSERT_EQ(std::vector<int>({ 0 }), started);
+
+    limiter.release(std::chrono::milliseconds(10), false);
+    ASSERT_EQ(std::vector<int>({ 0, 1 }), started);
+
+    // queued invocations go first even though a permit is available
+    limiter.release();
+    ASSERT_FALSE(limiter.try_acquire());
+    ASSERT_EQ(std::vector<int>({ 0, 1, 2 }), started);
+    ASSERT_EQ(2U, limiter.get_in_flight());
+    ASSERT_EQ(0U, limiter.get_queued());
+}
+
+TEST(invocation_limiter, invocation_started_right_away_when_permit_available)
+{
+    invocation_limiter limiter(1, false);
+
+    auto started = false;
+    limiter.enqueue([&started]() { started = true; });
+
+    ASSERT_TRUE(started);
+    ASSERT_EQ(1U, limiter.get_in_flight());
+}
+
+TEST(invocation_limiter, invocations_releasing_permit_when_started_do_not_grow_stack)
+{
+    invocation_limiter limiter(1, false);
+    ASSERT_TRUE(limiter.try_acquire());
+
+    auto started_count = 0;
+    for (auto i = 0; i < 100000; i++)
+    {
+        limiter.enqueue([&limiter, &started_count]()
+        {
+            started_count++;
+            limiter.release();
+        });
+    }
+
+    limiter.release();
+
+    ASSERT_EQ(100000, started_count);
+    ASSERT_EQ(0U, limiter.get_in_flight());
+}
+
+TEST(invocation_limiter, limit_fixed_unless_adaptive)
+{
+    invocation_limiter limiter(10, false);
+
+    for (auto i = 0; i < 100; i++)
+    {
+        ASSERT_TRUE(limiter.try_acquire());
+        limiter.release(std::chrono::seconds(i + 1), true);
+    }
+
+    ASSERT_EQ(10U, limiter.get_limit());
+}
+
+TEST(invocation_limiter, adaptive_limit_decreased_on_overload_and_increased_as_latency_recovers)
+{
+    invocation_limiter limiter(10, true);
+
+    auto complete = [&limiter](std::chrono::milliseconds latency, bool timed_out)
+    {
+        ASSERT_TRUE(limiter.try_acquire());
+        limiter.release(latency, timed_out);
+    };
+
+    complete(std::chrono::milliseconds(10), false);
+    ASSERT_EQ(10U, limiter.get_limit());
+
+    // within the tolerance of the baseline latency
+    complete(std::chrono::milliseconds(15), false);
+    ASSERT_EQ(10U, limiter.get_limit());
+
+    complete(std::chrono::milliseconds(100), false);
+    for (auto i = 0; i < 9; i++)
+    {
+        complete(std::chrono::milliseconds(10), false);
+    }
+    ASSERT_EQ(9U, limiter.get_limit());
+
+    // the limit is decreased at most once per window
+    for (auto i = 0; i < 9; i++)
+    {
+        complete(std::chrono::milliseconds(10), true);
+    }
+    ASSERT_EQ(8U, limiter.get_limit());
+
+    for (auto i = 0; i < 200; i++)
+    {
+        complete(std::chrono::milliseconds(1000), true);
+    }
+    ASSERT_EQ(1U, limiter.get_limit());
+
+    for (auto i = 0; i < 200; i++)
+    {
+        complete(std::chrono::milliseconds(10), false);
+    }
+    ASSERT_EQ(10U, limiter.get_limit());
+}
+
+TEST(invocation_limiter, max_limit_must_be_greater_than_zero)
+{
+    ASSERT_THROW(invocation_limiter(0, false), std::invalid_argument);
+}
@@ -0,0 +1,171 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/invocation_trace.h"
+#include "traced_invocation.h"
+#include "cpprest/asyncrt_utils.h"
+#include <fstream>
+#include <thread>
+
+using namespace signalr;
+
+namespace
+{
+    invocation_span create_span(uint8_t id)
+    {
+        invocation_span span = {};
+        span.trace_id[15] = id;
+        span.span_id[7] = id;
+        for (auto& stage : span.stages)
+        {
+            stage = std::chrono::nanoseconds(-1);
+        }
+        return span;
+    }
+
+    class trace_file
+    {
+    public:
+        trace_file()
+            : m_path(utility::conversions::to_string_t(::testing::UnitTest::GetInstance()->current_test_info()->name())
+                .append(_XPLATSTR(".trace")))
+        { }
+
+        ~trace_file()
+        {
+            std::remove(utility::conversions::to_utf8string(m_path).c_str());
+        }
+
+        const utility::string_t& path() const
+        {
+            return m_path;
+        }
+
+    private:
+        utility::string_t m_path;
+    };
+}
+
+TEST(invocation_span, traceparent_formatted_as_w3c_trace_context)
+{
+    invocation_span span = {};
+    const uint8_t trace_id[] = { 0x0a, 0xf7, 0x65, 0x19, 0x16, 0xcd, 0x43, 0xdd, 0x84, 0x48, 0xeb, 0x21, 0x1c, 0x80, 0x31, 0x9c };
+    const uint8_t span_id[] = { 0xb7, 0xad, 0x6b, 0x71, 0x69, 0x20, 0x33, 0x31 };
+    std::copy(std::begin(trace_id), std::end(trace_id), span.trace_id);
+    std::copy(std::begin(span_id), std::end(span_id), span.span_id);
+
+    ASSERT_EQ(_XPLATSTR("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"), span.traceparent());
+}
+
+TEST(ring_buffer_trace_sink, capacity_rounded_up_to_power_of_two)
+{
+    ASSERT_EQ(8U, ring_buffer_trace_sink(5).get_capacity());
+    ASSERT_EQ(8U, ring_buffer_trace_sink(8).get_capacity());
+}
+
+TEST(ring_buffer_trace_sink, spans_drained_in_order_and_dropped_when_full)
+{
+    ring_buffer_trace_sink sink(4);
+
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        sink.record(create_span(i));
+    }
+
+    std::vector<invocation_span> spans;
+    ASSERT_EQ(4U, sink.drain(spans));
+    ASSERT_EQ(2U, sink.get_dropped_count());
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        ASSERT_EQ(i, spans[i].trace_id[15]);
+    }
+
+    // drained slots are reused
+    sink.record(create_span(6));
+    spans.clear();
+    ASSERT_EQ(1U, sink.drain(spans));
+    ASSERT_EQ(6, spans[0].trace_id[15]);
+    ASSERT_EQ(0U, sink.drain(spans));
+}
+
+TEST(ring_buffer_trace_sink, spans_recorded_from_multiple_threads)
+{
+    ring_buffer_trace_sink sink(4096);
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&sink, i]()
+        {
+            for (auto j = 0; j < 500; j++)
+            {
+                sink.record(create_span(static_cast<uint8_t>(i)));
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<invocation_span> spans;
+    ASSERT_EQ(2000U, sink.drain(spans));
+    ASSERT_EQ(0U, sink.get_dropped_count());
+
+    size_t counts[4] = {};
+    for (const auto& span : spans)
+    {
+        counts[span.trace_id[15]]++;
+    }
+
+    for (auto count : counts)
+    {
+        ASSERT_EQ(500U, count);
+    }
+}
+
+TEST(ring_buffer_trace_sink, flush_appends_spans_to_file)
+{
+    trace_file file;
+    ring_buffer_trace_sink sink;
+
+    auto span = create_span(1);
+    span.start_time = std::chrono::system_clock::time_point(std::chrono::microseconds(1000));
+    span.stages[0] = std::chrono::microseconds(5);
+    span.stages[1] = std::chrono::microseconds(7);
+    span.succeeded = true;
+    sink.record(span);
+
+    ASSERT_EQ(1U, sink.flush(file.path()));
+    ASSERT_EQ(0U, sink.flush(file.path()));
+
+    std::ifstream stream(utility::conversions::to_utf8string(file.path()));
+    std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    ASSERT_EQ("00-00000000000000000000000000000001-0000000000000001-01,1000,5,7,-1,-1,-1,1\n", contents);
+}
+
+TEST(traced_invocation, span_recorded_after_both_releases)
+{
+    auto sink = std::make_shared<ring_buffer_trace_sink>(4);
+    std::vector<invocation_span> spans;
+
+    {
+        traced_invocation trace(sink);
+        trace.mark(invocation_stage::serialized);
+        trace.set_succeeded(true);
+
+        trace.release();
+        ASSERT_EQ(0U, sink->drain(spans));
+
+        trace.release();
+        ASSERT_EQ(1U, sink->drain(spans));
+        ASSERT_EQ(trace.get_traceparent(), spans[0].traceparent());
+    }
+
+    ASSERT_TRUE(spans[0].succeeded);
+    ASSERT_GE(spans[0].get_stage(invocation_stage::serialized).count(), 0);
+    ASSERT_LT(spans[0].get_stage(invocation_stage::enqueued).count(), 0);
+}
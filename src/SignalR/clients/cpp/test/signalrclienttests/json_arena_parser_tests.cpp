@@ -0,0 +1,265 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "json_arena.h"
+#include "json_arena_parser.h"
+#include "allocation_counter.h"
+
+using namespace signalr;
+
+json_view parse(json_arena_parser& parser, const utility::string_t& text)
+{
+    return parser.parse(text.data(), text.data() + text.length());
+}
+
+TEST(json_arena_allocate, returns_aligned_memory_from_the_same_block)
+{
+    json_arena arena(1024);
+
+    auto c = arena.allocate(1, 1);
+    auto d = arena.allocate(sizeof(double), alignof(double));
+
+    ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(d) % alignof(double));
+    ASSERT_TRUE(static_cast<char*>(d) > static_cast<char*>(c));
+    ASSERT_EQ(1024U, arena.get_capacity());
+}
+
+TEST(json_arena_allocate, allocates_blocks_for_allocations_larger_than_block_size)
+{
+    json_arena arena(16);
+
+    arena.allocate(100, 1);
+
+    ASSERT_EQ(100U, arena.get_capacity());
+}
+
+TEST(json_arena_reset, coalesces_blocks_so_that_memory_is_reused)
+{
+    json_arena arena(16);
+
+    for (auto i = 0; i < 4; i++)
+    {
+        arena.allocate(16, 1);
+    }
+
+    ASSERT_EQ(64U, arena.get_capacity());
+    arena.reset();
+    ASSERT_EQ(64U, arena.get_capacity());
+
+    for (auto i = 0; i < 4; i++)
+    {
+        arena.allocate(16, 1);
+    }
+
+    ASSERT_EQ(64U, arena.get_capacity());
+}
+
+TEST(json_arena_parser_parse, parses_scalar_values)
+{
+    json_arena_parser parser;
+
+    ASSERT_TRUE(parse(parser, _XPLATSTR("null")).is_null());
+    ASSERT_TRUE(parse(parser, _XPLATSTR(" true ")).as_bool());
+    ASSERT_FALSE(parse(parser, _XPLATSTR("false")).as_bool());
+    ASSERT_EQ(42, parse(parser, _XPLATSTR("42")).as_integer());
+    ASSERT_EQ(-9223372036854775807LL - 1, parse(parser, _XPLATSTR("-9223372036854775808")).as_int64());
+    ASSERT_TRUE(parse(parser, _XPLATSTR("-9223372036854775808")).is_integer());
+    ASSERT_FALSE(parse(parser, _XPLATSTR("9223372036854775808")).is_integer());
+    ASSERT_DOUBLE_EQ(-1.5e3, parse(parser, _XPLATSTR("-1.5e3")).as_double());
+    ASSERT_DOUBLE_EQ(0.25, parse(parser, _XPLATSTR("0.25")).as_double());
+    ASSERT_EQ(_XPLATSTR("abc"), parse(parser, _XPLATSTR("\"abc\"")).as_string());
+}
+
+TEST(json_arena_parser_parse, strings_without_escapes_point_into_the_text)
+{
+    json_arena_parser parser;
+    const utility::string_t text = _XPLATSTR("\"abc\"");
+
+    auto value = parse(parser, text);
+
+    ASSERT_EQ(text.data() + 1, value.string_data());
+    ASSERT_EQ(3U, value.string_length());
+}
+
+TEST(json_arena_parser_parse, unescapes_strings)
+{
+    json_arena_parser parser;
+
+    auto value = parse(parser, _XPLATSTR("\"a\\\"b\\\\c\\/d\\n\\t\\u0041\\u00e9\\u20ac\\ud83d\\ude00\""));
+
+    ASSERT_EQ(utility::conversions::to_string_t("a\"b\\c/d\n\tA\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"), value.as_string());
+}
+
+TEST(json_arena_parser_parse, parses_arrays_and_objects)
+{
+    json_arena_parser parser;
+
+    const utility::string_t text = _XPLATSTR("{ \"type\": 1, \"target\": \"method\", \"arguments\": [1, \"a\", [], {}, { \"x\": [true, null] }] }");
+
+    auto value = parse(parser, text);
+
+    ASSERT_TRUE(value.is_object());
+    ASSERT_EQ(3U, value.size());
+    ASSERT_EQ(_XPLATSTR("target"), value.field_name(1));
+    ASSERT_EQ(_XPLATSTR("method"), value.at(_XPLATSTR("target")).as_string());
+    ASSERT_TRUE(value.has_field(_XPLATSTR("arguments")));
+    ASSERT_FALSE(value.has_field(_XPLATSTR("invocationId")));
+
+    auto arguments = value.at(_XPLATSTR("arguments"));
+    ASSERT_EQ(5U, arguments.size());
+    ASSERT_EQ(1, arguments[0].as_integer());
+    ASSERT_EQ(_XPLATSTR("a"), arguments[1].as_string());
+    ASSERT_TRUE(arguments[2].is_array());
+    ASSERT_EQ(0U, arguments[2].size());
+    ASSERT_TRUE(arguments[3].is_object());
+    ASSERT_TRUE(arguments[4].at(_XPLATSTR("x"))[1].is_null());
+}
+
+TEST(json_arena_parser_parse, to_value_copies_the_viewed_value)
+{
+    json_arena_parser parser;
+    const utility::string_t text = _XPLATSTR("{\"arguments\":[1,2.5,\"a\\nb\",[true,false,null],{\"x\":{}}],\"target\":\"method\",\"type\":1}");
+
+    auto value = parse(parser, text).to_value();
+    parser.reset();
+
+    ASSERT_EQ(web::json::value::parse(text).serialize(), value.serialize());
+}
+
+TEST(json_arena_parser_parse, throws_for_invalid_json)
+{
+    const utility::string_t invalid_texts[]
+    {
+        _XPLATSTR(""),
+        _XPLATSTR("{"),
+        _XPLATSTR("{\"a\" 1}"),
+        _XPLATSTR("{\"a\": 1,}"),
+        _XPLATSTR("[1 2]"),
+        _XPLATSTR("\"abc"),
+        _XPLATSTR("\"\\x\""),
+        _XPLATSTR("\"\\u12\""),
+        _XPLATSTR("tru"),
+        _XPLATSTR("-"),
+        _XPLATSTR("1."),
+        _XPLATSTR("1e"),
+        _XPLATSTR("{} {}")
+    };
+
+    json_arena_parser parser;
+    for (const auto& text : invalid_texts)
+    {
+        ASSERT_THROW(parse(parser, text), web::json::json_exception) << utility::conversions::to_utf8string(text);
+    }
+}
+
+TEST(json_arena_parser_parse, throws_for_deeply_nested_values)
+{
+    json_arena_parser parser;
+
+    ASSERT_THROW(parse(parser, utility::string_t(1000, _XPLATSTR('[')) + utility::string_t(1000, _XPLATSTR(']'))),
+        web::json::json_exception);
+}
+
+TEST(json_arena_parser_parse, does_not_allocate_when_parsing_into_a_reset_arena)
+{
+    json_arena_parser parser;
+    const utility::string_t text =
+        _XPLATSTR("{\"type\":1,\"target\":\"update\",\"arguments\":[\"MSFT\",{\"bid\":101.25,\"ask\":101.5,\"note\":\"\\\"live\\\"\"}]}");
+
+    parse(parser, text);
+    parser.reset();
+
+    allocation_counter counter;
+    for (auto i = 0; i < 100; i++)
+    {
+        auto value = parse(parser, text);
+        ASSERT_EQ(_XPLATSTR("update"), value.at(_XPLATSTR("target")).as_string());
+        parser.reset();
+    }
+
+    // the only allocations are the strings returned by as_string, which fit in the small string buffer
+    ASSERT_EQ(0U, counter.get_count());
+}
+
+TEST(json_arena_parser_parse_lazy, parses_nested_values_when_accessed)
+{
+    json_arena_parser parser;
+    const utility::string_t text = _XPLATSTR("{ \"type\": 1, \"target\": \"method\", \"arguments\": [1, \"]\\\"[\", { \"x\": [true, null] }] }");
+
+    auto value = parser.parse_lazy(text.data(), text.data() + text.length());
+
+    ASSERT_EQ(1, value.at(_XPLATSTR("type")).as_integer());
+    ASSERT_EQ(_XPLATSTR("method"), value.at(_XPLATSTR("target")).as_string());
+
+    auto arguments = value.at(_XPLATSTR("arguments"));
+    ASSERT_TRUE(arguments.is_array());
+    ASSERT_EQ(3U, arguments.size());
+    ASSERT_EQ(_XPLATSTR("]\"["), arguments[1].as_string());
+    ASSERT_TRUE(arguments[2].at(_XPLATSTR("x"))[1].is_null());
+    ASSERT_EQ(web::json::value::parse(text).serialize(), value.serialize());
+}
+
+TEST(json_arena_parser_parse_lazy, throws_for_invalid_nested_values_only_when_accessed)
+{
+    json_arena_parser parser;
+    const utility::string_t text = _XPLATSTR("{ \"type\": 1, \"arguments\": [1 2] }");
+
+    auto value = parser.parse_lazy(text.data(), text.data() + text.length());
+
+    ASSERT_EQ(1, value.at(_XPLATSTR("type")).as_integer());
+    ASSERT_THROW(value.at(_XPLATSTR("arguments")).size(), web::json::json_exception);
+}
+
+TEST(json_arena_parser_parse_lazy, throws_for_invalid_envelope)
+{
+    const utility::string_t invalid_texts[]
+    {
+        _XPLATSTR("{\"arguments\": [1, 2}"),
+        _XPLATSTR("{\"arguments\": [\"]}"),
+        _XPLATSTR("{\"type\" 1}"),
+        _XPLATSTR("{\"arguments\": []} {}")
+    };
+
+    json_arena_parser parser;
+    for (const auto& text : invalid_texts)
+    {
+        ASSERT_THROW(parser.parse_lazy(text.data(), text.data() + text.length()), web::json::json_exception)
+            << utility::conversions::to_utf8string(text);
+    }
+}
+
+TEST(json_arena_parser_import, imports_json_values)
+{
+    json_arena_parser parser;
+    const auto value = web::json::value::parse(_XPLATSTR("{\"a\":[1,2.5,\"x\",null,true],\"b\":{}}"));
+
+    auto view = parser.import(value);
+
+    ASSERT_EQ(2U, view.size());
+    ASSERT_EQ(2.5, view.at(_XPLATSTR("a"))[1].as_double());
+    ASSERT_EQ(value.serialize(), view.serialize());
+}
+
+TEST(json_view, default_view_is_null)
+{
+    json_view view;
+
+    ASSERT_TRUE(view.is_null());
+    ASSERT_EQ(0U, view.size());
+    ASSERT_TRUE(view.to_value().is_null());
+}
+
+TEST(json_view, throws_when_accessing_value_as_different_type)
+{
+    json_arena_parser parser;
+
+    const utility::string_t text = _XPLATSTR("{\"a\":\"b\"}");
+
+    auto value = parse(parser, text);
+
+    ASSERT_THROW(value.as_string(), web::json::json_exception);
+    ASSERT_THROW(value.at(_XPLATSTR("a")).as_integer(), web::json::json_exception);
+    ASSERT_THROW(value.at(_XPLATSTR("c")), web::json::json_exception);
+    ASSERT_THROW(value[1], web::json::json_exception);
+}
@@ -0,0 +1,119 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "partitioned_dispatcher.h"
+#include "event.h"
+
+using namespace signalr;
+
+TEST(partitioned_dispatcher_dispatch, work_with_same_key_runs_in_order)
+{
+    const size_t key_count = 50;
+    const size_t items_per_key = 200;
+
+    std::mutex lock;
+    std::vector<std::vector<size_t>> received(key_count);
+    event all_received;
+    size_t received_count = 0;
+
+    {
+        partitioned_dispatcher dispatcher(4, 8);
+
+        for (size_t i = 0; i < items_per_key; ++i)
+        {
+            for (size_t key = 0; key < key_count; ++key)
+            {
+                dispatcher.dispatch(key, [&, key, i]()
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    received[key].push_back(i);
+                    if (++received_count == key_count * items_per_key)
+                    {
+                        all_received.set();
+                    }
+                });
+            }
+        }
+
+        ASSERT_FALSE(all_received.wait(10000));
+    }
+
+    for (const auto& items : received)
+    {
+        ASSERT_EQ(items_per_key, items.size());
+        for (size_t i = 0; i < items_per_key; ++i)
+        {
+            ASSERT_EQ(i, items[i]);
+        }
+    }
+}
+
+TEST(partitioned_dispatcher_dispatch, blocked_partition_does_not_block_other_partitions)
+{
+    partitioned_dispatcher dispatcher(2, 4);
+
+    event release_blocked;
+    event other_ran;
+
+    // both partitions are queued on the first thread, the second thread has to steal one of them
+    dispatcher.dispatch(0, [&release_blocked]() { release_blocked.wait(10000); });
+    dispatcher.dispatch(2, [&other_ran]() { other_ran.set(); });
+
+    ASSERT_FALSE(other_ran.wait(5000));
+    release_blocked.set();
+}
+
+TEST(partitioned_dispatcher_dispatch, work_with_same_key_does_not_run_concurrently)
+{
+    partitioned_dispatcher dispatcher(4, 4);
+
+    std::atomic<int> running(0);
+    std::atomic<bool> overlapped(false);
+    event done;
+
+    for (auto i = 0; i < 500; ++i)
+    {
+        dispatcher.dispatch(7, [&running, &overlapped, &done, i]()
+        {
+            if (++running > 1)
+            {
+                overlapped = true;
+            }
+            std::this_thread::yield();
+            --running;
+
+            if (i == 499)
+            {
+                done.set();
+            }
+        });
+    }
+
+    ASSERT_FALSE(done.wait(10000));
+    ASSERT_FALSE(overlapped);
+}
+
+TEST(partitioned_dispatcher_create, partition_count_must_be_positive)
+{
+    try
+    {
+        partitioned_dispatcher dispatcher(1, 0);
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const std::invalid_argument& e)
+    {
+        ASSERT_STREQ("partition_count must be greater than zero", e.what());
+    }
+}
+
+TEST(partitioned_dispatcher_get_shared, dispatcher_shared_by_thread_count)
+{
+    auto dispatcher = partitioned_dispatcher::get_shared(2);
+
+    ASSERT_EQ(dispatcher, partitioned_dispatcher::get_shared(2));
+    ASSERT_NE(dispatcher, partitioned_dispatcher::get_shared(3));
+    ASSERT_EQ(2U, dispatcher->get_thread_count());
+    ASSERT_EQ(32U, dispatcher->get_partition_count());
+    ASSERT_EQ(partitioned_dispatcher::get_shared(0), partitioned_dispatcher::get_shared(std::max(std::thread::hardware_concurrency(), 1U)));
+}
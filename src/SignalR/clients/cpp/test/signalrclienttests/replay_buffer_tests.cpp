@@ -0,0 +1,146 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "replay_buffer.h"
+
+using namespace signalr;
+
+namespace
+{
+    std::vector<utility::string_t> get_messages(const replay_buffer& buffer)
+    {
+        std::vector<utility::string_t> messages;
+        buffer.for_each([&messages](const utility::string_t& message) { messages.push_back(message); });
+        return messages;
+    }
+}
+
+TEST(replay_buffer_append, messages_retained_in_order)
+{
+    replay_buffer buffer(1024);
+
+    ASSERT_TRUE(buffer.append(_XPLATSTR("first")));
+    ASSERT_TRUE(buffer.append(_XPLATSTR("second")));
+    ASSERT_TRUE(buffer.append(_XPLATSTR("")));
+
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("first"), _XPLATSTR("second"), _XPLATSTR("") }), get_messages(buffer));
+    ASSERT_EQ(3U, buffer.size());
+    ASSERT_EQ(1, buffer.get_first_sequence_id());
+    ASSERT_EQ(4, buffer.get_next_sequence_id());
+}
+
+TEST(replay_buffer_append, append_fails_if_buffer_full)
+{
+    const utility::string_t message(_XPLATSTR("0123456789"));
+    const auto record_size = sizeof(uint32_t) + message.size() * sizeof(utility::char_t);
+    replay_buffer buffer(record_size * 2 + 1);
+
+    ASSERT_TRUE(buffer.append(message));
+    ASSERT_TRUE(buffer.append(message));
+    ASSERT_FALSE(buffer.append(message));
+
+    ASSERT_EQ(2U, buffer.size());
+    ASSERT_EQ(record_size * 2, buffer.size_in_bytes());
+}
+
+TEST(replay_buffer_append, append_fails_if_message_larger_than_capacity)
+{
+    replay_buffer buffer(8);
+
+    ASSERT_FALSE(buffer.append(_XPLATSTR("this message does not fit")));
+    ASSERT_EQ(0U, buffer.size());
+}
+
+TEST(replay_buffer_append_records, each_record_retained_with_sequence_id)
+{
+    replay_buffer buffer(1024);
+    buffer.append(_XPLATSTR("first\x1e"));
+
+    ASSERT_TRUE(buffer.append_records(_XPLATSTR("second\x1ethird\x1e")));
+
+    ASSERT_EQ(std::vector<utility::string_t>({ _XPLATSTR("first\x1e"), _XPLATSTR("second\x1e"), _XPLATSTR("third\x1e") }), get_messages(buffer));
+    ASSERT_EQ(4, buffer.get_next_sequence_id());
+
+    buffer.acknowledge(2);
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("third\x1e") }, get_messages(buffer));
+}
+
+TEST(replay_buffer_append_records, no_record_retained_if_not_all_fit)
+{
+    const utility::string_t record(_XPLATSTR("012345678\x1e"));
+    const auto record_size = sizeof(uint32_t) + record.size() * sizeof(utility::char_t);
+    replay_buffer buffer(record_size * 2 + 1);
+
+    ASSERT_TRUE(buffer.append(record));
+    ASSERT_FALSE(buffer.append_records(record + record));
+
+    ASSERT_EQ(1U, buffer.size());
+    ASSERT_TRUE(buffer.append_records(record));
+    ASSERT_EQ(2U, buffer.size());
+}
+
+TEST(replay_buffer_acknowledge, acknowledged_messages_released)
+{
+    replay_buffer buffer(1024);
+    buffer.append(_XPLATSTR("first"));
+    buffer.append(_XPLATSTR("second"));
+    buffer.append(_XPLATSTR("third"));
+
+    buffer.acknowledge(2);
+
+    ASSERT_EQ(std::vector<utility::string_t>{ _XPLATSTR("third") }, get_messages(buffer));
+    ASSERT_EQ(3, buffer.get_first_sequence_id());
+    ASSERT_EQ(4, buffer.get_next_sequence_id());
+
+    // acknowledging already released messages is a no-op
+    buffer.acknowledge(1);
+    ASSERT_EQ(1U, buffer.size());
+
+    buffer.acknowledge(10);
+    ASSERT_EQ(0U, buffer.size());
+    ASSERT_EQ(0U, buffer.size_in_bytes());
+    ASSERT_EQ(4, buffer.get_first_sequence_id());
+}
+
+TEST(replay_buffer_acknowledge, acknowledging_frees_space)
+{
+    const utility::string_t message(_XPLATSTR("0123456789"));
+    const auto record_size = sizeof(uint32_t) + message.size() * sizeof(utility::char_t);
+    replay_buffer buffer(record_size * 2);
+
+    ASSERT_TRUE(buffer.append(message));
+    ASSERT_TRUE(buffer.append(message));
+    ASSERT_FALSE(buffer.append(message));
+
+    buffer.acknowledge(1);
+
+    ASSERT_TRUE(buffer.append(message));
+    ASSERT_EQ(2, buffer.get_first_sequence_id());
+    ASSERT_EQ(4, buffer.get_next_sequence_id());
+}
+
+TEST(replay_buffer_for_each, messages_wrapping_around_the_ring_are_intact)
+{
+    // capacity not being a multiple of the record size makes records (and their length prefixes) wrap around
+    replay_buffer buffer(37);
+
+    std::vector<utility::string_t> expected;
+    for (auto i = 0; i < 50; i++)
+    {
+        utility::stringstream_t ss;
+        ss << _XPLATSTR("message-") << i;
+        const auto message = ss.str();
+
+        while (!buffer.append(message))
+        {
+            buffer.acknowledge(buffer.get_first_sequence_id());
+            expected.erase(expected.begin());
+        }
+
+        expected.push_back(message);
+        ASSERT_EQ(expected, get_messages(buffer));
+    }
+
+    ASSERT_EQ(51, buffer.get_next_sequence_id());
+}
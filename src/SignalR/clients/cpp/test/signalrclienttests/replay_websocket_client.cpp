@@ -0,0 +1,99 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "replay_websocket_client.h"
+
+replay_websocket_client::replay_websocket_client(std::vector<captured_frame> frames, replay_speed speed)
+    : m_speed(speed), m_position(0), m_first_timestamp(0), m_sent_count(0)
+{
+    for (auto& frame : frames)
+    {
+        if (frame.direction == frame_direction::received)
+        {
+            m_frames.push_back(std::move(frame));
+        }
+    }
+
+    if (!m_frames.empty())
+    {
+        m_first_timestamp = m_frames.front().timestamp;
+    }
+
+    if (m_speed == replay_speed::recorded)
+    {
+        m_timer_wheel = timer_wheel::create(std::chrono::milliseconds(1), 1024);
+        m_timer_wheel->start();
+    }
+}
+
+pplx::task<void> replay_websocket_client::connect(const web::uri &)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    m_replay_start = std::chrono::steady_clock::now();
+    return pplx::task_from_result();
+}
+
+pplx::task<void> replay_websocket_client::send(const utility::string_t&)
+{
+    m_sent_count++;
+    return pplx::task_from_result();
+}
+
+pplx::task<std::string> replay_websocket_client::receive()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (m_position == m_frames.size())
+    {
+        m_replay_completed.set();
+        return pplx::create_task(m_closed).then([]() -> std::string
+        {
+            throw std::runtime_error("the replay client was closed");
+        });
+    }
+
+    const auto& frame = m_frames[m_position++];
+    if (m_speed == replay_speed::as_fast_as_possible)
+    {
+        return pplx::task_from_result(frame.payload);
+    }
+
+    const auto due_time = m_replay_start + (frame.timestamp - m_first_timestamp);
+    const auto payload = frame.payload;
+    lock.unlock();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (due_time <= now)
+    {
+        return pplx::task_from_result(payload);
+    }
+
+    // rounded up so that no frame is delivered early
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(due_time - now);
+    if (now + delay < due_time)
+    {
+        delay += std::chrono::milliseconds(1);
+    }
+
+    pplx::task_completion_event<std::string> frame_due;
+    m_timer_wheel->schedule(delay, [frame_due, payload]() { frame_due.set(payload); });
+    return pplx::create_task(frame_due);
+}
+
+pplx::task<void> replay_websocket_client::close()
+{
+    m_closed.set();
+    return pplx::task_from_result();
+}
+
+pplx::task<void> replay_websocket_client::replay_completed() const
+{
+    return pplx::create_task(m_replay_completed);
+}
+
+size_t replay_websocket_client::get_sent_count() const noexcept
+{
+    return m_sent_count;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "websocket_client.h"
+#include "traffic_capture.h"
+#include "timer_wheel.h"
+
+using namespace signalr;
+
+enum class replay_speed
+{
+    as_fast_as_possible,
+    recorded
+};
+
+// Feeds the frames received in a traffic capture to the transport, either as fast as they are consumed or with the
+// timing they were recorded with. Frames the client sent are not replayed - the client sends them again. Once all
+// frames were received `receive` does not complete until the client is closed. Frames replayed with the recorded
+// timing are delivered by a timer wheel of the client with a tick of a millisecond.
+class replay_websocket_client : public websocket_client
+{
+public:
+    replay_websocket_client(std::vector<captured_frame> frames, replay_speed speed);
+
+    pplx::task<void> connect(const web::uri &url) override;
+
+    pplx::task<void> send(const utility::string_t& msg) override;
+
+    pplx::task<std::string> receive() override;
+
+    pplx::task<void> close() override;
+
+    // completes when the transport asks for a frame after the last one, i.e. after all frames were processed
+    pplx::task<void> replay_completed() const;
+
+    size_t get_sent_count() const noexcept;
+
+private:
+    std::vector<captured_frame> m_frames;
+    const replay_speed m_speed;
+    std::mutex m_lock;
+    size_t m_position;
+    std::chrono::steady_clock::time_point m_replay_start;
+    std::chrono::microseconds m_first_timestamp;
+    std::atomic<size_t> m_sent_count;
+    std::shared_ptr<signalr::timer_wheel> m_timer_wheel;
+    pplx::task_completion_event<void> m_replay_completed;
+    pplx::task_completion_event<void> m_closed;
+};
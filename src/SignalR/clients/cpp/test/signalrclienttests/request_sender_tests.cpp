@@ -45,3 +45,40 @@ TEST(request_sender_negotiate, negotiation_request_sent_and_response_serialized)
     ASSERT_EQ(_XPLATSTR("f7707523-307d-4cba-9abf-3eef701241e8"), response.connectionId);
     // TODO: response.availableTransports
 }
+
+TEST(request_sender_negotiate, stateful_reconnect_requested_if_enabled)
+{
+    web::uri requested_url;
+    auto request_factory = test_web_request_factory([&requested_url](const web::uri &url) -> std::unique_ptr<web_request>
+    {
+        utility::string_t response_body(
+            _XPLATSTR("{ \"connectionId\" : \"f7707523-307d-4cba-9abf-3eef701241e8\", ")
+            _XPLATSTR("\"availableTransports\" : [] }"));
+
+        requested_url = url;
+        return std::unique_ptr<web_request>(new web_request_stub((unsigned short)200, _XPLATSTR("OK"), response_body));
+    });
+
+    signalr_client_config config;
+    config.set_stateful_reconnect(true);
+    request_sender::negotiate(request_factory, web::uri{ _XPLATSTR("http://fake/signalr") }, config).get();
+
+    ASSERT_EQ(web::uri(_XPLATSTR("http://fake/signalr/negotiate?negotiateVersion=1&useStatefulReconnect=true")), requested_url);
+}
+
+TEST(request_sender_negotiate, stateful_reconnect_response_serialized)
+{
+    auto request_factory = test_web_request_factory([](const web::uri&) -> std::unique_ptr<web_request>
+    {
+        utility::string_t response_body(
+            _XPLATSTR("{\"connectionId\" : \"f7707523-307d-4cba-9abf-3eef701241e8\", \"connectionToken\" : \"token\", ")
+            _XPLATSTR("\"useStatefulReconnect\" : true, \"availableTransports\" : [] }"));
+
+        return std::unique_ptr<web_request>(new web_request_stub((unsigned short)200, _XPLATSTR("OK"), response_body));
+    });
+
+    auto response = request_sender::negotiate(request_factory, web::uri{ _XPLATSTR("http://fake/signalr") }).get();
+
+    ASSERT_EQ(_XPLATSTR("token"), response.connectionToken);
+    ASSERT_TRUE(response.useStatefulReconnect);
+}
@@ -0,0 +1,94 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "result_cache.h"
+
+using namespace signalr;
+
+namespace
+{
+    result_cache_config create_config(size_t max_entries, std::chrono::milliseconds time_to_live)
+    {
+        result_cache_config config;
+        config.set_max_entries(max_entries);
+        config.set_time_to_live(time_to_live);
+        return config;
+    }
+}
+
+TEST(result_cache, cached_result_returned_and_counted)
+{
+    result_cache cache(create_config(10, std::chrono::seconds(60)));
+    web::json::value result;
+    uint64_t generation = 0;
+
+    ASSERT_FALSE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    cache.add(_XPLATSTR("[1]"), web::json::value::string(_XPLATSTR("a")), generation);
+
+    ASSERT_TRUE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    ASSERT_EQ(_XPLATSTR("a"), result.as_string());
+    ASSERT_FALSE(cache.try_get(_XPLATSTR("[2]"), result, generation));
+
+    auto stats = cache.get_stats();
+    ASSERT_EQ(1U, stats.hits);
+    ASSERT_EQ(2U, stats.misses);
+    ASSERT_EQ(1U, stats.entries);
+}
+
+TEST(result_cache, least_recently_used_result_evicted_when_full)
+{
+    result_cache cache(create_config(2, std::chrono::seconds(60)));
+    web::json::value result;
+    uint64_t generation = 0;
+
+    cache.try_get(_XPLATSTR("[1]"), result, generation);
+    cache.add(_XPLATSTR("[1]"), web::json::value::number(1), generation);
+    cache.add(_XPLATSTR("[2]"), web::json::value::number(2), generation);
+
+    // makes [2] the least recently used result
+    ASSERT_TRUE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    cache.add(_XPLATSTR("[3]"), web::json::value::number(3), generation);
+
+    ASSERT_TRUE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    ASSERT_TRUE(cache.try_get(_XPLATSTR("[3]"), result, generation));
+    ASSERT_FALSE(cache.try_get(_XPLATSTR("[2]"), result, generation));
+    ASSERT_EQ(2U, cache.get_stats().entries);
+}
+
+TEST(result_cache, expired_result_not_returned)
+{
+    result_cache cache(create_config(10, std::chrono::milliseconds(20)));
+    web::json::value result;
+    uint64_t generation = 0;
+
+    cache.try_get(_XPLATSTR("[1]"), result, generation);
+    cache.add(_XPLATSTR("[1]"), web::json::value::number(1), generation);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    ASSERT_FALSE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    ASSERT_EQ(0U, cache.get_stats().entries);
+}
+
+TEST(result_cache, result_of_invocation_in_flight_when_cleared_not_added)
+{
+    result_cache cache(create_config(10, std::chrono::seconds(60)));
+    web::json::value result;
+    uint64_t generation = 0;
+
+    ASSERT_FALSE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    cache.clear();
+    cache.add(_XPLATSTR("[1]"), web::json::value::number(1), generation);
+
+    ASSERT_FALSE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    cache.add(_XPLATSTR("[1]"), web::json::value::number(2), generation);
+    ASSERT_TRUE(cache.try_get(_XPLATSTR("[1]"), result, generation));
+    ASSERT_EQ(2, result.as_integer());
+}
+
+TEST(result_cache_config, invalid_settings_rejected)
+{
+    result_cache_config config;
+    ASSERT_THROW(config.set_max_entries(0), std::invalid_argument);
+    ASSERT_THROW(config.set_time_to_live(std::chrono::milliseconds(0)), std::invalid_argument);
+}
@@ -0,0 +1,49 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "signalrclient/signalr_client_config.h"
+#include "allocation_counter.h"
+
+using namespace signalr;
+
+TEST(signalr_client_config, copying_config_does_not_allocate)
+{
+    signalr_client_config config;
+    web::http::http_headers headers;
+    headers.add(_XPLATSTR("Authorization"), _XPLATSTR("Bearer token"));
+    config.set_http_headers(headers);
+    config.set_stateful_reconnect(true);
+
+    size_t allocations;
+    {
+        allocation_counter counter;
+        signalr_client_config copy(config);
+        allocations = counter.get_count();
+
+        ASSERT_TRUE(copy.get_stateful_reconnect());
+    }
+
+    ASSERT_EQ(0U, allocations);
+}
+
+TEST(signalr_client_config, changing_copy_does_not_change_original)
+{
+    signalr_client_config config;
+    web::http::http_headers headers;
+    headers.add(_XPLATSTR("Authorization"), _XPLATSTR("Bearer token"));
+    config.set_http_headers(headers);
+
+    auto copy = config;
+    headers.add(_XPLATSTR("X-Custom"), _XPLATSTR("value"));
+    copy.set_http_headers(headers);
+    copy.set_stateful_reconnect_buffer_size(42);
+
+    ASSERT_EQ(1U, config.get_http_headers().size());
+    ASSERT_EQ(100000U, config.get_stateful_reconnect_buffer_size());
+    ASSERT_EQ(2U, copy.get_http_headers().size());
+    ASSERT_EQ(42U, copy.get_stateful_reconnect_buffer_size());
+
+    signalr_client_config other;
+    ASSERT_TRUE(other.get_http_headers().empty());
+}
@@ -0,0 +1,57 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "string_buffer_pool.h"
+
+using namespace signalr;
+
+TEST(string_buffer_pool_acquire, returns_empty_buffer_if_pool_empty)
+{
+    string_buffer_pool pool;
+
+    auto buffer = pool.acquire();
+
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_EQ(0U, pool.size());
+}
+
+TEST(string_buffer_pool_acquire, reuses_released_buffer)
+{
+    string_buffer_pool pool;
+
+    auto buffer = pool.acquire();
+    buffer.append(1000, _XPLATSTR('a'));
+    const auto capacity = buffer.capacity();
+    pool.release(std::move(buffer));
+
+    ASSERT_EQ(1U, pool.size());
+
+    auto reused = pool.acquire();
+    ASSERT_TRUE(reused.empty());
+    ASSERT_EQ(capacity, reused.capacity());
+    ASSERT_EQ(0U, pool.size());
+}
+
+TEST(string_buffer_pool_release, does_not_pool_more_than_max_buffers)
+{
+    string_buffer_pool pool(2);
+
+    for (auto i = 0; i < 3; i++)
+    {
+        pool.release(utility::string_t(_XPLATSTR("abc")));
+    }
+
+    ASSERT_EQ(2U, pool.size());
+}
+
+TEST(string_buffer_pool_release, does_not_pool_buffers_exceeding_max_capacity)
+{
+    string_buffer_pool pool(2, 16);
+
+    utility::string_t buffer;
+    buffer.reserve(1024);
+    pool.release(std::move(buffer));
+
+    ASSERT_EQ(0U, pool.size());
+}
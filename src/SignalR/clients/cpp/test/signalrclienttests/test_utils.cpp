@@ -2,6 +2,7 @@
 // Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
 
 #include "stdafx.h"
+#include <cstdio>
 #include "test_utils.h"
 #include "test_websocket_client.h"
 #include "test_web_request_factory.h"
@@ -47,6 +48,68 @@ std::unique_ptr<web_request_factory> create_test_web_request_factory()
     });
 }
 
+// negotiate response of a server that accepted the request to use stateful reconnect
+std::unique_ptr<web_request_factory> create_stateful_reconnect_web_request_factory()
+{
+    return std::make_unique<test_web_request_factory>([](const web::uri& url)
+    {
+        auto response_body =
+            url.path() == _XPLATSTR("/negotiate")
+            ? _XPLATSTR("{\"connectionId\" : \"f7707523-307d-4cba-9abf-3eef701241e8\", \"connectionToken\" : \"connection-token\", ")
+            _XPLATSTR("\"useStatefulReconnect\" : true, ")
+            _XPLATSTR("\"availableTransports\" : [ { \"transport\": \"WebSockets\", \"transferFormats\": [ \"Text\", \"Binary\" ] } ] }")
+            : _XPLATSTR("");
+
+        return std::unique_ptr<web_request>(new web_request_stub((unsigned short)200, _XPLATSTR("OK"), response_body));
+    });
+}
+
+// unnamed namespace makes it invisble outside this translation unit
+namespace
+{
+    struct delayed_web_request_stub : public web_request_stub
+    {
+        std::chrono::milliseconds m_delay;
+
+        delayed_web_request_stub(std::chrono::milliseconds delay, const utility::string_t& response_body)
+            : web_request_stub((unsigned short)200, _XPLATSTR("OK"), response_body), m_delay(delay)
+        { }
+
+        virtual pplx::task<web_response> get_response() override
+        {
+            auto delay = m_delay;
+            auto response_body = m_response_body;
+            return pplx::create_task([delay, response_body]()
+            {
+                std::this_thread::sleep_for(delay);
+                return web_response{ (unsigned short)200, _XPLATSTR("OK"), pplx::task_from_result<utility::string_t>(response_body) };
+            });
+        }
+    };
+}
+
+// negotiate responses of a server deployed at multiple endpoints. The endpoints in `response_delays` (keyed by host)
+// respond after the given delay using their host as the connection id, requests to other endpoints fail
+std::unique_ptr<web_request_factory> create_multi_endpoint_web_request_factory(
+    const std::map<utility::string_t, std::chrono::milliseconds>& response_delays, std::function<void(const web::uri& url)> on_request)
+{
+    return std::make_unique<test_web_request_factory>([response_delays, on_request](const web::uri& url)
+    {
+        on_request(url);
+
+        auto delay = response_delays.find(url.host());
+        if (delay == response_delays.end())
+        {
+            return std::unique_ptr<web_request>(new web_request_stub((unsigned short)503, _XPLATSTR("Service Unavailable")));
+        }
+
+        auto response_body = utility::string_t(_XPLATSTR("{\"connectionId\" : \"")).append(url.host())
+            .append(_XPLATSTR("\", \"availableTransports\" : [ { \"transport\": \"WebSockets\", \"transferFormats\": [ \"Text\" ] } ] }"));
+
+        return std::unique_ptr<web_request>(new delayed_web_request_stub(delay->second, response_body));
+    });
+}
+
 utility::string_t create_uri()
 {
     auto unit_test = ::testing::UnitTest::GetInstance();
@@ -95,3 +158,34 @@ utility::string_t dump_vector(const std::vector<utility::string_t>& source)
 
     return ss.str();
 }
+
+outbox_directory::outbox_directory()
+    : m_path(utility::conversions::to_string_t(::testing::UnitTest::GetInstance()->current_test_info()->name())
+        .append(_XPLATSTR(".outbox")))
+{
+    // files left behind by a previous run that crashed
+    remove_files();
+}
+
+outbox_directory::~outbox_directory()
+{
+    remove_files();
+}
+
+const utility::string_t& outbox_directory::path() const
+{
+    return m_path;
+}
+
+void outbox_directory::remove_files() const
+{
+    const auto path = utility::conversions::to_utf8string(m_path);
+    for (auto sequence_number = 0; sequence_number < 64; sequence_number++)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/outbox-%016x.seg", sequence_number);
+        std::remove((path + name).c_str());
+    }
+
+    std::remove(path.c_str());
+}
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <map>
 #include "cpprest/details/basic_types.h"
 #include "websocket_client.h"
 #include "web_request_factory.h"
@@ -16,7 +18,30 @@ std::shared_ptr<signalr::websocket_client> create_test_websocket_client(
     std::function<pplx::task<void>()> close_function = [](){ return pplx::task_from_result(); });
 
 std::unique_ptr<signalr::web_request_factory> create_test_web_request_factory();
+std::unique_ptr<signalr::web_request_factory> create_stateful_reconnect_web_request_factory();
+std::unique_ptr<signalr::web_request_factory> create_multi_endpoint_web_request_factory(
+    const std::map<utility::string_t, std::chrono::milliseconds>& response_delays,
+    std::function<void(const web::uri& url)> on_request = [](const web::uri&) {});
 utility::string_t create_uri();
 utility::string_t create_uri(const utility::string_t& query_string);
 std::vector<utility::string_t> filter_vector(const std::vector<utility::string_t>& source, const utility::string_t& string);
 utility::string_t dump_vector(const std::vector<utility::string_t>& source);
+
+// a directory for a durable outbox named after the current test, removed with the segment files of the outbox when
+// the test completes
+class outbox_directory
+{
+public:
+    outbox_directory();
+    ~outbox_directory();
+
+    outbox_directory(const outbox_directory&) = delete;
+    outbox_directory& operator=(const outbox_directory&) = delete;
+
+    const utility::string_t& path() const;
+
+private:
+    utility::string_t m_path;
+
+    void remove_files() const;
+};
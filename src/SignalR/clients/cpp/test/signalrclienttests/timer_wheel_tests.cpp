@@ -0,0 +1,159 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "timer_wheel.h"
+#include "event.h"
+
+using namespace signalr;
+
+TEST(timer_wheel_schedule, timer_fires_when_timeout_elapses)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 8);
+
+    auto fired = 0;
+    timer_wheel->schedule(std::chrono::milliseconds(30), [&fired]() { fired++; });
+
+    timer_wheel->advance(2);
+    ASSERT_EQ(0, fired);
+
+    timer_wheel->advance();
+    ASSERT_EQ(1, fired);
+
+    timer_wheel->advance(16);
+    ASSERT_EQ(1, fired);
+    ASSERT_EQ(0U, timer_wheel->size());
+}
+
+TEST(timer_wheel_schedule, timeout_rounded_up_to_full_tick)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 8);
+
+    auto fired = false;
+    timer_wheel->schedule(std::chrono::milliseconds(11), [&fired]() { fired = true; });
+
+    timer_wheel->advance();
+    ASSERT_FALSE(fired);
+
+    timer_wheel->advance();
+    ASSERT_TRUE(fired);
+}
+
+TEST(timer_wheel_schedule, timeout_longer_than_wheel_revolution_waits_rounds)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 4);
+
+    auto fired = false;
+    timer_wheel->schedule(std::chrono::milliseconds(100), [&fired]() { fired = true; });
+
+    timer_wheel->advance(9);
+    ASSERT_FALSE(fired);
+
+    timer_wheel->advance();
+    ASSERT_TRUE(fired);
+}
+
+TEST(timer_wheel_schedule, timers_in_the_same_slot_fire_independently)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 4);
+
+    std::vector<int> fired;
+    timer_wheel->schedule(std::chrono::milliseconds(20), [&fired]() { fired.push_back(1); });
+    timer_wheel->schedule(std::chrono::milliseconds(60), [&fired]() { fired.push_back(2); });
+
+    timer_wheel->advance(2);
+    ASSERT_EQ(std::vector<int>{ 1 }, fired);
+
+    timer_wheel->advance(4);
+    ASSERT_EQ(std::vector<int>({ 1, 2 }), fired);
+}
+
+TEST(timer_wheel_schedule, callback_can_schedule_timers)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 4);
+
+    auto fired = 0;
+    timer_wheel->schedule(std::chrono::milliseconds(10), [&fired, &timer_wheel]()
+    {
+        fired++;
+        timer_wheel->schedule(std::chrono::milliseconds(10), [&fired]() { fired++; });
+    });
+
+    timer_wheel->advance();
+    ASSERT_EQ(1, fired);
+
+    timer_wheel->advance();
+    ASSERT_EQ(2, fired);
+}
+
+TEST(timer_wheel_cancel, cancelled_timer_does_not_fire)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 8);
+
+    auto fired = false;
+    auto id = timer_wheel->schedule(std::chrono::milliseconds(10), [&fired]() { fired = true; });
+
+    ASSERT_TRUE(timer_wheel->cancel(id));
+    ASSERT_EQ(0U, timer_wheel->size());
+
+    timer_wheel->advance(8);
+    ASSERT_FALSE(fired);
+}
+
+TEST(timer_wheel_cancel, cancel_returns_false_for_fired_timer)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 8);
+
+    auto id = timer_wheel->schedule(std::chrono::milliseconds(10), []() {});
+    timer_wheel->advance();
+
+    ASSERT_FALSE(timer_wheel->cancel(id));
+}
+
+TEST(timer_wheel_cancel, cancel_is_independent_of_number_of_timers)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 16);
+
+    std::vector<timer_wheel::timer_id> ids;
+    for (auto i = 0; i < 100000; i++)
+    {
+        ids.push_back(timer_wheel->schedule(std::chrono::milliseconds(10 * (i % 64)), []() {}));
+    }
+
+    ASSERT_EQ(100000U, timer_wheel->size());
+
+    for (auto id : ids)
+    {
+        ASSERT_TRUE(timer_wheel->cancel(id));
+    }
+
+    ASSERT_EQ(0U, timer_wheel->size());
+}
+
+TEST(timer_wheel_start, background_thread_advances_wheel)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 8);
+    timer_wheel->start();
+
+    auto fired_event = std::make_shared<event>();
+    timer_wheel->schedule(std::chrono::milliseconds(50), [fired_event]() { fired_event->set(); });
+
+    ASSERT_FALSE(fired_event->wait(5000));
+}
+
+TEST(timer_wheel_start, wheel_can_be_destroyed_from_timer_callback)
+{
+    auto timer_wheel = timer_wheel::create(std::chrono::milliseconds(10), 8);
+    timer_wheel->start();
+
+    auto fired_event = std::make_shared<event>();
+    auto holder = std::make_shared<std::shared_ptr<signalr::timer_wheel>>(timer_wheel);
+    timer_wheel->schedule(std::chrono::milliseconds(10), [holder, fired_event]()
+    {
+        holder->reset();
+        fired_event->set();
+    });
+    timer_wheel.reset();
+
+    ASSERT_FALSE(fired_event->wait(5000));
+}
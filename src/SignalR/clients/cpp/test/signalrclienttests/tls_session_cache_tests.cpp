@@ -0,0 +1,252 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include "tls_session_cache.h"
+#include "http_client_pool.h"
+
+#ifndef _WIN32
+
+#include "boost/asio/ssl.hpp"
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+using namespace signalr;
+
+namespace
+{
+    // A TLS server with a self-signed certificate for localhost that the connections of the tests handshake with
+    // in memory. The server issues session tickets which it accepts for as long as it lives.
+    class tls_stand_in_server
+    {
+    public:
+        tls_stand_in_server()
+        {
+            auto key_context = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+            EVP_PKEY_keygen_init(key_context);
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_context, NID_X9_62_prime256v1);
+            m_key = nullptr;
+            EVP_PKEY_keygen(key_context, &m_key);
+            EVP_PKEY_CTX_free(key_context);
+
+            m_certificate = X509_new();
+            X509_set_version(m_certificate, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(m_certificate), 1);
+            X509_gmtime_adj(X509_getm_notBefore(m_certificate), -60);
+            X509_gmtime_adj(X509_getm_notAfter(m_certificate), 60 * 60);
+            X509_NAME_add_entry_by_txt(X509_get_subject_name(m_certificate), "CN", MBSTRING_ASC,
+                reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+            X509_set_issuer_name(m_certificate, X509_get_subject_name(m_certificate));
+            X509_set_pubkey(m_certificate, m_key);
+            X509_sign(m_certificate, m_key, EVP_sha256());
+
+            m_context = SSL_CTX_new(TLS_server_method());
+            SSL_CTX_use_certificate(m_context, m_certificate);
+            SSL_CTX_use_PrivateKey(m_context, m_key);
+        }
+
+        ~tls_stand_in_server()
+        {
+            SSL_CTX_free(m_context);
+            X509_free(m_certificate);
+            EVP_PKEY_free(m_key);
+        }
+
+        tls_stand_in_server(const tls_stand_in_server&) = delete;
+        tls_stand_in_server& operator=(const tls_stand_in_server&) = delete;
+
+        // Connects a client with a context of its own, as the http and websocket clients create for each
+        // connection, to the server and reads a message so that the client receives the session tickets. Returns
+        // whether the client resumed a session.
+        bool connect(const std::shared_ptr<tls_session_cache>& cache, const web::uri& url, bool verify_server = true,
+            uint64_t config_id = 0)
+        {
+            auto client_context = SSL_CTX_new(TLS_client_method());
+            if (verify_server)
+            {
+                SSL_CTX_set_verify(client_context, SSL_VERIFY_PEER, nullptr);
+                X509_STORE_add_cert(SSL_CTX_get_cert_store(client_context), m_certificate);
+            }
+
+            cache->attach(client_context, url, config_id);
+
+            auto client = SSL_new(client_context);
+            SSL_CTX_free(client_context);
+            auto server = SSL_new(m_context);
+
+            BIO* client_bio;
+            BIO* server_bio;
+            BIO_new_bio_pair(&client_bio, 0, &server_bio, 0);
+            SSL_set_bio(client, client_bio, client_bio);
+            SSL_set_bio(server, server_bio, server_bio);
+            SSL_set_tlsext_host_name(client, "localhost");
+            SSL_set_connect_state(client);
+            SSL_set_accept_state(server);
+
+            auto client_done = false;
+            auto server_done = false;
+            for (auto i = 0; i < 10 && !(client_done && server_done); ++i)
+            {
+                client_done = client_done || SSL_do_handshake(client) == 1;
+                server_done = server_done || SSL_do_handshake(server) == 1;
+            }
+
+            char message = 0;
+            if (!client_done || !server_done || SSL_write(server, "x", 1) != 1 || SSL_read(client, &message, 1) != 1 || message != 'x')
+            {
+                SSL_free(client);
+                SSL_free(server);
+                throw std::runtime_error("the handshake with the stand-in server failed");
+            }
+
+            const auto reused = SSL_session_reused(client) == 1;
+
+            SSL_shutdown(client);
+            SSL_free(client);
+            SSL_free(server);
+
+            return reused;
+        }
+
+    private:
+        EVP_PKEY* m_key;
+        X509* m_certificate;
+        SSL_CTX* m_context;
+    };
+}
+
+TEST(tls_session_cache, session_resumed_by_next_connection_to_origin)
+{
+    tls_stand_in_server server;
+    auto cache = std::make_shared<tls_session_cache>();
+
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost:8443/negotiate"))));
+    ASSERT_EQ(1U, cache->size());
+
+    ASSERT_TRUE(server.connect(cache, web::uri(_XPLATSTR("wss://localhost:8443/?id=1"))));
+    ASSERT_TRUE(server.connect(cache, web::uri(_XPLATSTR("wss://LOCALHOST:8443/?id=1"))));
+    ASSERT_EQ(1U, cache->size());
+}
+
+TEST(tls_session_cache, session_not_resumed_by_connection_to_other_origin)
+{
+    tls_stand_in_server server;
+    auto cache = std::make_shared<tls_session_cache>();
+
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost:8443/negotiate"))));
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost/negotiate"))));
+    ASSERT_EQ(2U, cache->size());
+
+    ASSERT_TRUE(server.connect(cache, web::uri(_XPLATSTR("wss://localhost:443/"))));
+}
+
+TEST(tls_session_cache, session_not_resumed_by_connection_with_other_tls_settings)
+{
+    tls_stand_in_server server;
+    auto cache = std::make_shared<tls_session_cache>();
+
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost/negotiate")), true, 1));
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("wss://localhost/")), true, 2));
+    ASSERT_EQ(2U, cache->size());
+
+    ASSERT_TRUE(server.connect(cache, web::uri(_XPLATSTR("wss://localhost/")), true, 1));
+}
+
+TEST(tls_session_cache, sessions_of_unverified_servers_not_cached)
+{
+    tls_stand_in_server server;
+    auto cache = std::make_shared<tls_session_cache>();
+
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost/negotiate")), false));
+    ASSERT_EQ(0U, cache->size());
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost/negotiate"))));
+}
+
+TEST(tls_session_cache, least_recently_used_origin_dropped_when_cache_full)
+{
+    tls_stand_in_server server;
+    auto cache = std::make_shared<tls_session_cache>(2);
+
+    server.connect(cache, web::uri(_XPLATSTR("https://localhost:1/")));
+    server.connect(cache, web::uri(_XPLATSTR("https://localhost:2/")));
+    ASSERT_TRUE(server.connect(cache, web::uri(_XPLATSTR("https://localhost:1/"))));
+    server.connect(cache, web::uri(_XPLATSTR("https://localhost:3/")));
+
+    ASSERT_EQ(2U, cache->size());
+    ASSERT_TRUE(server.connect(cache, web::uri(_XPLATSTR("https://localhost:1/"))));
+    ASSERT_FALSE(server.connect(cache, web::uri(_XPLATSTR("https://localhost:2/"))));
+}
+
+TEST(tls_session_cache, attached_to_contexts_after_ssl_context_callback_of_config)
+{
+    auto cache = std::make_shared<tls_session_cache>();
+    auto callback_invoked = false;
+    web::websockets::client::websocket_client_config config;
+    config.set_ssl_context_callback([&callback_invoked](boost::asio::ssl::context& context)
+    {
+        ASSERT_EQ(nullptr, SSL_CTX_get_info_callback(context.native_handle()));
+        callback_invoked = true;
+    });
+
+    auto attached_config = cache->attach(config, web::uri(_XPLATSTR("wss://localhost/")), 0);
+
+    boost::asio::ssl::context context(boost::asio::ssl::context::sslv23);
+    attached_config.get_ssl_context_callback()(context);
+
+    ASSERT_TRUE(callback_invoked);
+    ASSERT_NE(nullptr, SSL_CTX_get_info_callback(context.native_handle()));
+}
+
+TEST(tls_session_cache, attached_to_pooled_http_clients_unless_disabled)
+{
+    http_client_pool pool;
+    signalr_client_config config;
+
+    auto client = pool.get_client(web::uri(_XPLATSTR("https://fake/negotiate")), config);
+    boost::asio::ssl::context context(boost::asio::ssl::context::sslv23);
+    client->client_config().get_ssl_context_callback()(context);
+    ASSERT_NE(nullptr, SSL_CTX_get_info_callback(context.native_handle()));
+
+    config.set_tls_session_resumption(false);
+    auto other_client = pool.get_client(web::uri(_XPLATSTR("https://fake/negotiate")), config);
+    ASSERT_NE(client, other_client);
+    ASSERT_FALSE(static_cast<bool>(other_client->client_config().get_ssl_context_callback()));
+}
+
+TEST(tls_session_cache_get_config_id, changes_with_client_configs)
+{
+    signalr_client_config config;
+    ASSERT_EQ(0U, tls_session_cache::get_config_id(config));
+
+    config.set_http_headers(web::http::http_headers());
+    ASSERT_EQ(0U, tls_session_cache::get_config_id(config));
+
+    config.set_websocket_client_config(web::websockets::client::websocket_client_config());
+    const auto websocket_config_id = tls_session_cache::get_config_id(config);
+    ASSERT_NE(0U, websocket_config_id);
+
+    auto copy = config;
+    ASSERT_EQ(websocket_config_id, tls_session_cache::get_config_id(copy));
+
+    copy.set_http_client_config(web::http::client::http_client_config());
+    ASSERT_NE(websocket_config_id, tls_session_cache::get_config_id(copy));
+    ASSERT_EQ(websocket_config_id, tls_session_cache::get_config_id(config));
+}
+
+TEST(tls_session_cache_get_key, origin_and_config_id)
+{
+    ASSERT_EQ("fake:443#0", tls_session_cache::get_key(web::uri(_XPLATSTR("https://fake/negotiate")), 0));
+    ASSERT_EQ("fake:443#7", tls_session_cache::get_key(web::uri(_XPLATSTR("wss://fake/")), 7));
+}
+
+TEST(tls_session_cache_get_origin, default_ports_by_scheme)
+{
+    ASSERT_EQ("fake:443", tls_session_cache::get_origin(web::uri(_XPLATSTR("https://fake/negotiate"))));
+    ASSERT_EQ("fake:443", tls_session_cache::get_origin(web::uri(_XPLATSTR("wss://Fake/"))));
+    ASSERT_EQ("fake:80", tls_session_cache::get_origin(web::uri(_XPLATSTR("ws://fake/"))));
+    ASSERT_EQ("fake:8443", tls_session_cache::get_origin(web::uri(_XPLATSTR("wss://fake:8443/"))));
+}
+
+#endif
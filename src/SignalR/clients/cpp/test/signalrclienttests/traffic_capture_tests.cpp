@@ -0,0 +1,328 @@
+// Copyright (c) .NET Foundation. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See License.txt in the project root for license information.
+
+#include "stdafx.h"
+#include <cstdio>
+#include "test_utils.h"
+#include "test_websocket_client.h"
+#include "test_transport_factory.h"
+#include "test_web_request_factory.h"
+#include "replay_websocket_client.h"
+#include "recording_websocket_client.h"
+#include "traffic_capture.h"
+#include "hub_connection_impl.h"
+#include "trace_log_writer.h"
+#include "signalrclient/signalr_exception.h"
+
+using namespace signalr;
+
+namespace
+{
+    // removes the capture file when the test completes
+    class capture_file
+    {
+    public:
+        capture_file()
+            : m_path(utility::conversions::to_string_t(::testing::UnitTest::GetInstance()->current_test_info()->name())
+                .append(_XPLATSTR(".capture")))
+        { }
+
+        ~capture_file()
+        {
+            std::remove(utility::conversions::to_utf8string(m_path).c_str());
+        }
+
+        const utility::string_t& path() const
+        {
+            return m_path;
+        }
+
+    private:
+        utility::string_t m_path;
+    };
+}
+
+TEST(traffic_capture, frames_round_trip)
+{
+    capture_file file;
+    const std::string large_payload(100000, 'x');
+
+    {
+        traffic_capture_writer writer(file.path());
+        writer.write(frame_direction::received, "{ }\x1e");
+        writer.write(frame_direction::sent, "{\"type\":6}\x1e");
+        writer.write(frame_direction::received, large_payload);
+        writer.write(frame_direction::received, "");
+    }
+
+    auto frames = traffic_capture_reader::read_all(file.path());
+
+    ASSERT_EQ(4U, frames.size());
+    ASSERT_EQ(frame_direction::received, frames[0].direction);
+    ASSERT_EQ("{ }\x1e", frames[0].payload);
+    ASSERT_EQ(frame_direction::sent, frames[1].direction);
+    ASSERT_EQ("{\"type\":6}\x1e", frames[1].payload);
+    ASSERT_EQ(large_payload, frames[2].payload);
+    ASSERT_EQ("", frames[3].payload);
+
+    for (size_t i = 1; i < frames.size(); i++)
+    {
+        ASSERT_LE(frames[i - 1].timestamp, frames[i].timestamp);
+    }
+}
+
+TEST(traffic_capture, reader_rejects_files_that_are_not_captures)
+{
+    capture_file file;
+    {
+        std::ofstream stream(file.path(), std::ios::binary);
+        stream << "not a capture";
+    }
+
+    try
+    {
+        traffic_capture_reader reader(file.path());
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("invalid traffic capture - unrecognized file format", e.what());
+    }
+}
+
+TEST(traffic_capture, reader_rejects_truncated_frames)
+{
+    capture_file file;
+    {
+        traffic_capture_writer writer(file.path());
+        writer.write(frame_direction::received, "a message that will be truncated");
+    }
+
+    {
+        std::ifstream stream(file.path(), std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        std::ofstream truncated(file.path(), std::ios::binary | std::ios::trunc);
+        truncated.write(contents.data(), contents.size() - 5);
+    }
+
+    try
+    {
+        traffic_capture_reader::read_all(file.path());
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("invalid traffic capture - truncated frame", e.what());
+    }
+}
+
+TEST(traffic_capture, reader_rejects_frames_longer_than_file)
+{
+    capture_file file;
+    {
+        // a received frame claiming to be 2^56 bytes long
+        const char contents[] = { 'S', 'R', 'T', 'C', 1, 0, 0, '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', 1, 'a' };
+        std::ofstream stream(file.path(), std::ios::binary);
+        stream.write(contents, sizeof(contents));
+    }
+
+    try
+    {
+        traffic_capture_reader::read_all(file.path());
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("invalid traffic capture - truncated frame", e.what());
+    }
+}
+
+TEST(recording_websocket_client, sent_and_received_frames_recorded)
+{
+    capture_file file;
+
+    {
+        auto call_number = std::make_shared<int>(0);
+        auto websocket_client = create_test_websocket_client(
+            /* receive function */ [call_number]()
+            {
+                return pplx::task_from_result(std::string((*call_number)++ == 0 ? "first" : "second"));
+            });
+
+        recording_websocket_client recording_client(websocket_client, std::make_shared<traffic_capture_writer>(file.path()));
+        recording_client.connect(web::uri(_XPLATSTR("ws://fake"))).get();
+        ASSERT_EQ("first", recording_client.receive().get());
+        recording_client.send(_XPLATSTR("sent")).get();
+        ASSERT_EQ("second", recording_client.receive().get());
+        recording_client.close().get();
+    }
+
+    auto frames = traffic_capture_reader::read_all(file.path());
+
+    ASSERT_EQ(3U, frames.size());
+    ASSERT_EQ(frame_direction::received, frames[0].direction);
+    ASSERT_EQ("first", frames[0].payload);
+    ASSERT_EQ(frame_direction::sent, frames[1].direction);
+    ASSERT_EQ("sent", frames[1].payload);
+    ASSERT_EQ(frame_direction::received, frames[2].direction);
+    ASSERT_EQ("second", frames[2].payload);
+}
+
+TEST(recording_websocket_client, frames_sent_and_received_as_bytes_recorded)
+{
+    capture_file file;
+    auto sent = std::make_shared<utility::string_t>();
+
+    {
+        auto websocket_client = create_test_websocket_client(
+            /* receive function */ []() { return pplx::task_from_result(std::string("received")); },
+            /* send function */ [sent](const utility::string_t& message)
+            {
+                *sent = message;
+                return pplx::task_from_result();
+            });
+
+        recording_websocket_client recording_client(websocket_client, std::make_shared<traffic_capture_writer>(file.path()));
+        recording_client.connect(web::uri(_XPLATSTR("ws://fake"))).get();
+
+        std::vector<uint8_t> buffer(64, 'x');
+        ASSERT_EQ(websocket_message_type::text, recording_client.receive(buffer).get());
+        ASSERT_EQ("received", std::string(buffer.begin(), buffer.end()));
+        ASSERT_EQ(64U, buffer.capacity());
+
+        const std::string message = "sent";
+        recording_client.send(reinterpret_cast<const uint8_t*>(message.data()), message.length(), websocket_message_type::text).get();
+        recording_client.close().get();
+    }
+
+    ASSERT_EQ(_XPLATSTR("sent"), *sent);
+
+    auto frames = traffic_capture_reader::read_all(file.path());
+
+    ASSERT_EQ(2U, frames.size());
+    ASSERT_EQ(frame_direction::received, frames[0].direction);
+    ASSERT_EQ("received", frames[0].payload);
+    ASSERT_EQ(frame_direction::sent, frames[1].direction);
+    ASSERT_EQ("sent", frames[1].payload);
+}
+
+TEST(recording_websocket_client, binary_frames_fail_if_decorated_client_only_supports_text)
+{
+    capture_file file;
+
+    auto websocket_client = create_test_websocket_client();
+    recording_websocket_client recording_client(websocket_client, std::make_shared<traffic_capture_writer>(file.path()));
+
+    const uint8_t message[] = { 0, 1, 2 };
+    try
+    {
+        recording_client.send(message, sizeof(message), websocket_message_type::binary).get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the websocket client does not support binary frames", e.what());
+    }
+}
+
+TEST(replay_websocket_client, received_frames_replayed_in_order)
+{
+    std::vector<captured_frame> frames
+    {
+        { frame_direction::received, std::chrono::microseconds(0), "first" },
+        { frame_direction::sent, std::chrono::microseconds(10), "sent" },
+        { frame_direction::received, std::chrono::microseconds(20), "second" }
+    };
+
+    replay_websocket_client client(frames, replay_speed::as_fast_as_possible);
+    client.connect(web::uri(_XPLATSTR("ws://fake"))).get();
+
+    ASSERT_EQ("first", client.receive().get());
+    ASSERT_EQ("second", client.receive().get());
+    ASSERT_FALSE(client.replay_completed().is_done());
+
+    auto receive_task = client.receive();
+    client.replay_completed().get();
+    ASSERT_FALSE(receive_task.is_done());
+
+    client.close().get();
+    ASSERT_THROW(receive_task.get(), std::runtime_error);
+}
+
+TEST(replay_websocket_client, frames_replayed_at_recorded_speed)
+{
+    std::vector<captured_frame> frames
+    {
+        { frame_direction::received, std::chrono::microseconds(1000000), "first" },
+        { frame_direction::received, std::chrono::microseconds(1200000), "second" }
+    };
+
+    replay_websocket_client client(frames, replay_speed::recorded);
+    client.connect(web::uri(_XPLATSTR("ws://fake"))).get();
+    const auto start = std::chrono::steady_clock::now();
+
+    ASSERT_EQ("first", client.receive().get());
+    ASSERT_EQ("second", client.receive().get());
+
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+}
+
+TEST(replay_websocket_client, recorded_hub_traffic_replayed_into_hub_connection)
+{
+    capture_file file;
+    const std::string broadcast("{\"type\":1,\"target\":\"broadcast\",\"arguments\":[1]}\x1e");
+
+    {
+        auto call_number = std::make_shared<std::atomic<int>>(0);
+        auto websocket_client = create_test_websocket_client(
+            /* receive function */ [call_number, broadcast]()
+            {
+                auto index = (*call_number)++;
+                if (index == 0)
+                {
+                    return pplx::task_from_result(std::string("{ }\x1e"));
+                }
+
+                if (index <= 3)
+                {
+                    return pplx::task_from_result(broadcast + (index == 3 ? broadcast : ""));
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                return pplx::task_from_result(std::string(""));
+            });
+
+        auto capture_writer = std::make_shared<traffic_capture_writer>(file.path());
+        auto hub_connection = hub_connection_impl::create(create_uri(), trace_level::none, std::make_shared<trace_log_writer>(),
+            create_test_web_request_factory(), std::make_unique<test_transport_factory>(
+                std::make_shared<recording_websocket_client>(websocket_client, capture_writer)));
+
+        auto received = std::make_shared<event>();
+        auto received_count = std::make_shared<std::atomic<int>>(0);
+        hub_connection->on(_XPLATSTR("broadcast"), [received, received_count](const json::value&)
+        {
+            if (++(*received_count) == 4)
+            {
+                received->set();
+            }
+        });
+
+        hub_connection->start().get();
+        ASSERT_FALSE(received->wait(5000));
+        hub_connection->stop().get();
+    }
+
+    auto replay_client = std::make_shared<replay_websocket_client>(traffic_capture_reader::read_all(file.path()), replay_speed::as_fast_as_possible);
+    auto hub_connection = hub_connection_impl::create(create_uri(), trace_level::none, std::make_shared<trace_log_writer>(),
+        create_test_web_request_factory(), std::make_unique<test_transport_factory>(replay_client));
+
+    auto received_count = std::make_shared<std::atomic<int>>(0);
+    hub_connection->on(_XPLATSTR("broadcast"), [received_count](const json::value&) { ++(*received_count); });
+
+    hub_connection->start().get();
+    replay_client->replay_completed().get();
+
+    // the recorded empty frames are replayed too but do not invoke the handler
+    ASSERT_EQ(4, received_count->load());
+    ASSERT_EQ(1U, replay_client->get_sent_count());
+}
@@ -7,6 +7,7 @@
 #include "test_websocket_client.h"
 #include "websocket_transport.h"
 #include "memory_log_writer.h"
+#include "allocation_counter.h"
 
 using namespace signalr;
 
@@ -436,6 +437,85 @@ TEST(websocket_transport_receive_loop, error_callback_called_when_exception_thro
     ASSERT_TRUE(*close_invoked);
 }
 
+namespace
+{
+    // completes receives on the thread calling `deliver` so that the receive pump runs on the test thread
+    class manual_receive_websocket_client : public test_websocket_client
+    {
+    public:
+        using websocket_client::receive;
+
+        void receive(std::vector<uint8_t>& buffer,
+            const std::function<void(websocket_message_type, std::exception_ptr)>& received) override
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_buffer = &buffer;
+            m_received = &received;
+            m_receive_started.set();
+        }
+
+        void deliver(const std::string& frame)
+        {
+            ASSERT_FALSE(m_receive_started.wait(5000));
+
+            std::vector<uint8_t>* buffer;
+            const std::function<void(websocket_message_type, std::exception_ptr)>* received;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                buffer = m_buffer;
+                received = m_received;
+                m_receive_started.reset();
+            }
+
+            buffer->assign(frame.begin(), frame.end());
+            (*received)(websocket_message_type::text, nullptr);
+        }
+
+    private:
+        std::mutex m_lock;
+        event m_receive_started;
+        std::vector<uint8_t>* m_buffer = nullptr;
+        const std::function<void(websocket_message_type, std::exception_ptr)>* m_received = nullptr;
+    };
+}
+
+TEST(websocket_transport_receive_loop, receiving_messages_does_not_allocate)
+{
+    auto client = std::make_shared<manual_receive_websocket_client>();
+
+    auto ws_transport = websocket_transport::create([&](){ return client; }, logger(std::make_shared<trace_log_writer>(), trace_level::none),
+        [](const utility::string_t&){}, [](const std::exception&){});
+
+    size_t received_count = 0;
+    size_t received_length = 0;
+    ws_transport->set_process_raw_response_callback([&received_count, &received_length](const uint8_t*, size_t length)
+    {
+        received_count++;
+        received_length += length;
+    });
+
+    ws_transport->connect(_XPLATSTR("ws://fakeuri.org")).get();
+
+    const std::string frame("{\"type\":1,\"target\":\"method\",\"arguments\":[1,2,3]}\x1e");
+
+    // the first frame grows the receive buffer
+    client->deliver(frame);
+
+    size_t allocations;
+    {
+        allocation_counter counter;
+        for (auto i = 0; i < 1000; i++)
+        {
+            client->deliver(frame);
+        }
+        allocations = counter.get_count();
+    }
+
+    ASSERT_EQ(0U, allocations);
+    ASSERT_EQ(1001U, received_count);
+    ASSERT_EQ(1001U * frame.length(), received_length);
+}
+
 TEST(websocket_transport_get_transport_type, get_transport_type_returns_websockets)
 {
     auto ws_transport = websocket_transport::create(